@@ -0,0 +1,1040 @@
+/************************************************************************/
+/*																		*/
+/*	MtdsBench.cpp	--	Wire Cost Benchmark for the MTDS Library		*/
+/*																		*/
+/************************************************************************/
+/*  File Description:													*/
+/*																		*/
+/*	Runs a set of typical drawing workloads through the unmodified		*/
+/*	MTDS and MyDisp libraries against the host shield emulator and		*/
+/*	reports, per frame, how many command round trips were made, how		*/
+/*	many bytes crossed the SPI bus and how long that takes at a given	*/
+/*	SPI clock. Workloads that draw the same picture two ways print a	*/
+/*	frame buffer checksum so the results can be compared directly.		*/
+/*																		*/
+/*	The modeled time is bus time plus the library's own handshake		*/
+/*	delays. It leaves out shield processing time, so it is a lower		*/
+/*	bound on what real hardware will do.								*/
+/*																		*/
+/*	Build (from this directory):										*/
+/*		g++ -O2 -Ihost -I../../src -o MtdsBench MtdsBench.cpp			*/
+/*			MtdsEmu.cpp MtdsEmuHal.cpp ../../src/mtds.cpp				*/
+/*			../../src/MtdsCore.cpp ../../src/MtdsGdi.cpp				*/
+/*			../../src/MtdsUtil.cpp ../../src/MtdsWin.cpp				*/
+/*			../../src/MtdsFs.cpp ../../src/MtdsDlst.cpp					*/
+/*			../../src/MyDisp.cpp -lm									*/
+/*																		*/
+/*	Add -DcpktDataOutCredit=N to let the library stream up to N			*/
+/*	data-out packets without polling (see MtdsCore.h). The				*/
+/*	default of 1 sends one packet at a time.							*/
+/*																		*/
+/*	Usage:																*/
+/*		MtdsBench [-w workload] [-f frames] [-fw major.minor]			*/
+/*				  [-s spi_hz] [-r resource_dir] [-o ppm_dir]			*/
+/*																		*/
+/*		-w	dash, dashdl, chart, poly, blit, mydisp, mydisppost, icons,	*/
+/*			mem, file512, file, touch, touchpin or all					*/
+/*		-f	frames per workload (default 10)							*/
+/*		-fw	firmware version the emulator reports (default 1.0)			*/
+/*			It has no effect on data-out credits.						*/
+/*		-s	SPI clock used for the time model (default 4MHz)			*/
+/*		-r	directory LoadBitmap reads from (default ../Resources)		*/
+/*		-o	write the last frame of each workload as <workload>.ppm		*/
+/*																		*/
+/************************************************************************/
+
+/* ------------------------------------------------------------ */
+/*				Include File Definitions						*/
+/* ------------------------------------------------------------ */
+
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+
+#include	<stdint.h>
+
+#include	"mtds.h"
+#include	"MyDisp.h"
+#include	"MtdsEmu.h"
+
+/* ------------------------------------------------------------ */
+/*				Local Type and Constant Definitions				*/
+/* ------------------------------------------------------------ */
+
+#define	cfrmDefault		10
+#define	cpntChart		120
+#define	cbMemXfer		(64ul*1024ul)
+#define	cpollTouch		16
+
+struct WKLD {
+	const char *	szName;
+	const char *	szDesc;
+	bool			(*pfnSetup)();
+	void			(*pfnFrame)(int ifrm);
+};
+
+/* ------------------------------------------------------------ */
+/*				Local Variables									*/
+/* ------------------------------------------------------------ */
+
+static HDS		hdsBench;
+static HDS		hdsBenchOff;
+static HBMP		hbmpBenchOff;
+static HBR		rghbrBench[4];
+static HMEM		hmemBench;
+static uint8_t	rgbBenchMem[cbMemXfer];
+static uint8_t	rgbBenchRd[cbMemXfer];
+static PNT		rgpntBench[cpntChart];
+static int		cbtnBench;
+
+/* ------------------------------------------------------------ */
+/*				Forward Declarations							*/
+/* ------------------------------------------------------------ */
+
+static bool		FSetupDash();
+static void		FrameDash(int ifrm);
+static void		FrameDashDl(int ifrm);
+static void		FrameChart(int ifrm);
+static void		FramePoly(int ifrm);
+static bool		FSetupBlit();
+static void		FrameBlit(int ifrm);
+static bool		FSetupMyDisp();
+static void		FrameMyDisp(int ifrm);
+static void		FrameMyDispPost(int ifrm);
+static bool		FSetupIcons();
+static void		FrameIcons(int ifrm);
+static bool		FBeginMyDisp();
+static bool		FSetupMem();
+static void		FrameMem(int ifrm);
+static void		FrameFile512(int ifrm);
+static void		FrameFile(int ifrm);
+static void		BenchFile(int ifrm, const char * szWkld, uint32_t cbBuf);
+static uint32_t	CbBenchFileSrc(void * pvRef, uint8_t * rgbBuf, uint32_t cbBuf);
+static uint32_t	CbBenchFileDst(void * pvRef, uint8_t * rgbBuf, uint32_t cbBuf);
+static bool		FSetupTouch();
+static bool		FSetupTouchPin();
+static void		FrameTouch(int ifrm);
+static void		ChartPoints(int ifrm);
+
+static const WKLD	rgwkld[] = {
+	{ "dash",	"12 tiles: state setters, Rectangle, TextOut",	FSetupDash,		FrameDash	},
+	{ "dashdl",	"dash inside a display list",					FSetupDash,		FrameDashDl	},
+	{ "chart",	"120 point chart with MoveTo/LineTo",			FSetupDash,		FrameChart	},
+	{ "poly",	"the same chart with one PolyLine",				FSetupDash,		FramePoly	},
+	{ "blit",	"draw off screen, one BitBlt to the display",	FSetupBlit,		FrameBlit	},
+	{ "mydisp",	"16 MyDisp buttons, text and a touch",			FSetupMyDisp,	FrameMyDisp	},
+	{ "mydisppost", "mydisp with postButton/updateButtons",		FSetupMyDisp,	FrameMyDispPost	},
+	{ "icons",	"12 MyDisp drawImage calls by name",			FSetupIcons,	FrameIcons	},
+	{ "mem",	"64KB WriteMem + 64KB ReadMem",					FSetupMem,		FrameMem	},
+	{ "file512", "64KB SndFile + RcvFile, 512 byte buffer",		FSetupMem,		FrameFile512	},
+	{ "file",	"64KB SndFile + RcvFile, 64KB buffer",			FSetupMem,		FrameFile	},
+	{ "touch",	"16 checkTouch polls, a touch every 4th frame",	FSetupTouch,	FrameTouch	},
+	{ "touchpin", "touch with status pin A enabled",			FSetupTouchPin,	FrameTouch	},
+};
+
+#define	cwkld	(sizeof(rgwkld) / sizeof(WKLD))
+
+/* ------------------------------------------------------------ */
+/*				Procedure Definitions							*/
+/* ------------------------------------------------------------ */
+/***	main(argc, argv)
+**
+**	Parameters:
+**		argc, argv		- command line, see the file header
+**
+**	Return Values:
+**		Returns 0 on success, 1 on a usage error or failed workload
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Run the selected workloads, each against a freshly powered up
+**		emulator, and print one line of per frame costs for each.
+*/
+
+int main(int argc, char * argv[]) {
+	const char *	szWkld = "all";
+	const char *	szResDir = "../Resources";
+	const char *	szOutDir = 0;
+	char			szFile[512];
+	int				cfrm = cfrmDefault;
+	unsigned		verMajor = 1;
+	unsigned		verMinor = 0;
+	uint32_t		frqSpi = frqMtdsSpiDefault;
+	uint32_t		rgcrc[cwkld];
+	EMUSTAT			stat;
+	double			tmsFrame;
+	bool			fOk;
+	int				iarg;
+	unsigned		iwkld;
+	int				ifrm;
+
+	for (iarg = 1; iarg < argc; iarg++) {
+		if ((strcmp(argv[iarg], "-w") == 0) && (iarg + 1 < argc)) {
+			szWkld = argv[++iarg];
+		}
+		else if ((strcmp(argv[iarg], "-f") == 0) && (iarg + 1 < argc)) {
+			cfrm = atoi(argv[++iarg]);
+		}
+		else if ((strcmp(argv[iarg], "-fw") == 0) && (iarg + 1 < argc)) {
+			if (sscanf(argv[++iarg], "%u.%u", &verMajor, &verMinor) < 1) {
+				goto lUsage;
+			}
+		}
+		else if ((strcmp(argv[iarg], "-s") == 0) && (iarg + 1 < argc)) {
+			frqSpi = strtoul(argv[++iarg], 0, 0);
+		}
+		else if ((strcmp(argv[iarg], "-r") == 0) && (iarg + 1 < argc)) {
+			szResDir = argv[++iarg];
+		}
+		else if ((strcmp(argv[iarg], "-o") == 0) && (iarg + 1 < argc)) {
+			szOutDir = argv[++iarg];
+		}
+		else {
+			goto lUsage;
+		}
+	}
+	if ((cfrm <= 0) || (frqSpi == 0)) {
+		goto lUsage;
+	}
+
+	printf("firmware %u.%u, SPI %lu Hz, %d frames per workload\n\n",
+			verMajor, verMinor, (unsigned long)frqSpi, cfrm);
+	printf("%-10s %8s %9s %9s %7s %7s %9s %10s  %s\n", "workload", "cmd/frm", "bytes/frm",
+			"poll/frm", "pkt/frm", "dly us", "ms/frm", "checksum", "description");
+
+	fOk = true;
+	for (iwkld = 0; iwkld < cwkld; iwkld++) {
+		rgcrc[iwkld] = 0;
+		if ((strcmp(szWkld, "all") != 0) && (strcmp(szWkld, rgwkld[iwkld].szName) != 0)) {
+			continue;
+		}
+
+		MtdsEmuInit(verMajor, verMinor, szResDir);
+		if (!mtds.begin() || !rgwkld[iwkld].pfnSetup()) {
+			printf("%-10s setup failed, error 0x%02X\n", rgwkld[iwkld].szName, mtds.GetLastError());
+			fOk = false;
+			continue;
+		}
+
+		MtdsEmuClearStat();
+		for (ifrm = 0; ifrm < cfrm; ifrm++) {
+			rgwkld[iwkld].pfnFrame(ifrm);
+		}
+		MtdsEmuGetStat(&stat);
+		rgcrc[iwkld] = MtdsEmuChecksum();
+
+		tmsFrame = ((stat.cbSpi * 8.0 * 1000.0) / frqSpi + stat.tusDelay / 1000.0) / cfrm;
+		printf("%-10s %8.1f %9.0f %9.0f %7.1f %7.0f %9.2f   %08X  %s\n", rgwkld[iwkld].szName,
+				(double)stat.ccmd / cfrm, (double)stat.cbSpi / cfrm, (double)stat.cbPoll / cfrm,
+				(double)(stat.cpktOut + stat.cpktIn) / cfrm, (double)stat.tusDelay / cfrm,
+				tmsFrame, (unsigned)rgcrc[iwkld], rgwkld[iwkld].szDesc);
+
+		if (szOutDir != 0) {
+			snprintf(szFile, sizeof(szFile), "%s/%s.ppm", szOutDir, rgwkld[iwkld].szName);
+			if (!MtdsEmuSavePpm(szFile)) {
+				printf("         can't write %s\n", szFile);
+			}
+		}
+	}
+
+	/* Pairs that draw the same frames should end with the same picture.
+	*/
+	printf("\n");
+	if ((rgcrc[0] != 0) && (rgcrc[1] != 0)) {
+		printf("dash vs dashdl:  %s\n", (rgcrc[0] == rgcrc[1]) ? "same frame" : "FRAMES DIFFER");
+		fOk = fOk && (rgcrc[0] == rgcrc[1]);
+	}
+	if ((rgcrc[2] != 0) && (rgcrc[3] != 0)) {
+		printf("chart vs poly:   %s\n", (rgcrc[2] == rgcrc[3]) ? "same frame" : "FRAMES DIFFER");
+		fOk = fOk && (rgcrc[2] == rgcrc[3]);
+	}
+	if ((rgcrc[5] != 0) && (rgcrc[6] != 0)) {
+		printf("mydisp vs post:  %s\n", (rgcrc[5] == rgcrc[6]) ? "same frame" : "FRAMES DIFFER");
+		fOk = fOk && (rgcrc[5] == rgcrc[6]);
+	}
+	if ((rgcrc[11] != 0) && (rgcrc[12] != 0)) {
+		printf("touch vs pin:    %s\n", (rgcrc[11] == rgcrc[12]) ? "same frame" : "FRAMES DIFFER");
+		fOk = fOk && (rgcrc[11] == rgcrc[12]);
+	}
+
+	return fOk ? 0 : 1;
+
+lUsage:
+	fprintf(stderr, "usage: %s [-w workload] [-f frames] [-fw major.minor] [-s spi_hz]"
+			" [-r resource_dir] [-o ppm_dir]\n", argv[0]);
+	return 1;
+}
+
+/* ------------------------------------------------------------ */
+/***	FSetupDash()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns true if successful
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Get a DS on the display and the brushes the dashboard uses.
+*/
+
+static bool FSetupDash() {
+	static const uint32_t	rgclr[4] = { clrDkBlue, clrDkGreen, clrDkRed, clrDkYellow };
+	int		ihbr;
+
+	if ((hdsBench = mtds.GetDs()) == 0) {
+		return false;
+	}
+	mtds.SetDrawingSurface(hdsBench, mtds.GetDisplayBitmap());
+	for (ihbr = 0; ihbr < 4; ihbr++) {
+		if ((rghbrBench[ihbr] = mtds.CreateSolidBrush(rgclr[ihbr])) == 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* ------------------------------------------------------------ */
+/***	FrameDash(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Redraw a 3x4 grid of value tiles. Written the way application
+**		code usually is: every tile sets all the state it needs even
+**		when it is already set.
+*/
+
+static void FrameDash(int ifrm) {
+	RCT		rct;
+	char	szVal[16];
+	int		itile;
+	int16_t	xco;
+	int16_t	yco;
+
+	mtds.SetRect(&rct, 0, 0, dxcoEmuDisplay, dycoEmuDisplay);
+	mtds.FillRect(hdsBench, &rct, hbrBlack);
+
+	for (itile = 0; itile < 12; itile++) {
+		xco = (itile % 3) * 80;
+		yco = (itile / 3) * 80;
+		mtds.SetPen(hdsBench, penSolid);
+		mtds.SetFgColor(hdsBench, clrWhite);
+		mtds.SetBrush(hdsBench, rghbrBench[itile & 3]);
+		mtds.Rectangle(hdsBench, xco + 2, yco + 2, xco + 78, yco + 78);
+
+		mtds.SetFont(hdsBench, hfntConsole);
+		mtds.SetBkMode(hdsBench, bkTransparent);
+		mtds.SetFgColor(hdsBench, clrYellow);
+		sprintf(szVal, "%d", (ifrm * 37 + itile * 11) % 1000);
+		mtds.TextOut(hdsBench, xco + 10, yco + 30, strlen(szVal), szVal);
+
+		mtds.SetFgColor(hdsBench, clrLtGray);
+		mtds.MoveTo(hdsBench, xco + 10, yco + 60);
+		mtds.LineTo(hdsBench, xco + 10 + ((ifrm + itile) * 7) % 60, yco + 60);
+		mtds.SetBkMode(hdsBench, bkOpaque);
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	FrameDashDl(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		The same dashboard recorded into a display list.
+*/
+
+static void FrameDashDl(int ifrm) {
+
+	mtds.BeginDisplayList();
+	FrameDash(ifrm);
+	mtds.EndDisplayList();
+
+}
+
+/* ------------------------------------------------------------ */
+/***	FrameChart(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Clear the plot area and draw a scrolling trace one LineTo at a
+**		time.
+*/
+
+static void FrameChart(int ifrm) {
+	RCT		rct;
+	int		ipnt;
+
+	ChartPoints(ifrm);
+	mtds.SetRect(&rct, 0, 0, dxcoEmuDisplay, dycoEmuDisplay);
+	mtds.FillRect(hdsBench, &rct, hbrBlack);
+	mtds.SetFgColor(hdsBench, clrGreen);
+	mtds.MoveTo(hdsBench, rgpntBench[0].xco, rgpntBench[0].yco);
+	for (ipnt = 1; ipnt < cpntChart; ipnt++) {
+		mtds.LineTo(hdsBench, rgpntBench[ipnt].xco, rgpntBench[ipnt].yco);
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	FramePoly(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		The same trace as FrameChart() sent as one PolyLine.
+*/
+
+static void FramePoly(int ifrm) {
+	RCT		rct;
+
+	ChartPoints(ifrm);
+	mtds.SetRect(&rct, 0, 0, dxcoEmuDisplay, dycoEmuDisplay);
+	mtds.FillRect(hdsBench, &rct, hbrBlack);
+	mtds.SetFgColor(hdsBench, clrGreen);
+	mtds.PolyLine(hdsBench, cpntChart, rgpntBench);
+
+}
+
+/* ------------------------------------------------------------ */
+/***	ChartPoints(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Fill rgpntBench with a deterministic trace for this frame.
+*/
+
+static void ChartPoints(int ifrm) {
+	int		ipnt;
+	int		val;
+
+	for (ipnt = 0; ipnt < cpntChart; ipnt++) {
+		val = ((ipnt + ifrm) * 2654435761u >> 24) % 120;
+		rgpntBench[ipnt].xco = ipnt * 2;
+		rgpntBench[ipnt].yco = 100 + val;
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	FSetupBlit()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns true if successful
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Create a 120x120 off screen bitmap with its own DS.
+*/
+
+static bool FSetupBlit() {
+
+	if (!FSetupDash()) {
+		return false;
+	}
+	if (((hbmpBenchOff = mtds.CreateBitmap(120, 120, 16)) == 0) ||
+		((hdsBenchOff = mtds.GetDs()) == 0)) {
+		return false;
+	}
+	mtds.SetDrawingSurface(hdsBenchOff, hbmpBenchOff);
+	return true;
+}
+
+/* ------------------------------------------------------------ */
+/***	FrameBlit(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Compose a gauge off screen and copy it to the display in one
+**		BitBlt.
+*/
+
+static void FrameBlit(int ifrm) {
+	RCT		rct;
+
+	mtds.SetRect(&rct, 0, 0, 120, 120);
+	mtds.FillRect(hdsBenchOff, &rct, hbrDkGray);
+	mtds.SetFgColor(hdsBenchOff, clrWhite);
+	mtds.SetBrush(hdsBenchOff, rghbrBench[ifrm & 3]);
+	mtds.Ellipse(hdsBenchOff, 10, 10, 110, 110);
+	mtds.MoveTo(hdsBenchOff, 60, 60);
+	mtds.LineTo(hdsBenchOff, 20 + (ifrm * 13) % 80, 20);
+	mtds.BitBlt(hdsBench, 60, 100, 120, 120, hdsBenchOff, 0, 0, ropSrcCopy);
+
+}
+
+/* ------------------------------------------------------------ */
+/***	FSetupMyDisp()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns true if successful
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Start MyDisp and create a 4x4 grid of buttons from the bitmap
+**		library. If the resource directory doesn't have them the workload
+**		runs with text only.
+*/
+
+static bool FSetupMyDisp() {
+	static const char *	rgszBtn[4][2] = {
+		{ "BmpLib/led_48x48_r_off.bmp", "BmpLib/led_48x48_r_on.bmp" },
+		{ "BmpLib/led_48x48_g_off.bmp", "BmpLib/led_48x48_g_on.bmp" },
+		{ "BmpLib/led_48x48_b_off.bmp", "BmpLib/led_48x48_b_on.bmp" },
+		{ "BmpLib/led_48x48_y_off.bmp", "BmpLib/led_48x48_y_on.bmp" },
+	};
+	int		ibtn;
+
+	if (!FBeginMyDisp()) {
+		return false;
+	}
+	mydisp.clearDisplay(0);
+	cbtnBench = 0;
+	for (ibtn = 0; ibtn < 16; ibtn++) {
+		if (!mydisp.createButton(ibtn, (char *)rgszBtn[ibtn % 4][0], (char *)rgszBtn[ibtn % 4][1],
+									10 + (ibtn % 4) * 56, 96 + (ibtn / 4) * 56)) {
+			printf("mydisp   %s not found below the resource directory, no buttons\n", rgszBtn[ibtn % 4][0]);
+			break;
+		}
+		mydisp.enableButton(ibtn, true);
+		cbtnBench += 1;
+	}
+	return true;
+}
+
+/* ------------------------------------------------------------ */
+/***	FrameMyDisp(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Draw every button, a quarter of which change state each frame,
+**		update a status line and feed a touch through checkTouch().
+*/
+
+static void FrameMyDisp(int ifrm) {
+	char	szLine[32];
+	int		ibtn;
+
+	for (ibtn = 0; ibtn < cbtnBench; ibtn++) {
+		mydisp.drawButton(ibtn, (((ifrm + ibtn) >> 2) & 1) ? BUTTON_DOWN : BUTTON_UP);
+	}
+	sprintf(szLine, "frame %4d", ifrm);
+	mydisp.setForeground(clrWhite);
+	mydisp.drawText(szLine, 10, 10);
+
+	MtdsEmuPostTouch((ifrm & 1) ? msgFinger1Up : msgFinger1Down, 30 + (ifrm % 4) * 56, 120);
+	mydisp.checkTouch();
+
+}
+
+/* ------------------------------------------------------------ */
+/***	FrameMyDispPost(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		The mydisp frame with the button states posted and drawn by
+**		one updateButtons() call.
+*/
+
+static void FrameMyDispPost(int ifrm) {
+	char	szLine[32];
+	int		ibtn;
+
+	for (ibtn = 0; ibtn < cbtnBench; ibtn++) {
+		mydisp.postButton(ibtn, (((ifrm + ibtn) >> 2) & 1) ? BUTTON_DOWN : BUTTON_UP);
+	}
+	mydisp.updateButtons();
+	sprintf(szLine, "frame %4d", ifrm);
+	mydisp.setForeground(clrWhite);
+	mydisp.drawText(szLine, 10, 10);
+
+	MtdsEmuPostTouch((ifrm & 1) ? msgFinger1Up : msgFinger1Down, 30 + (ifrm % 4) * 56, 120);
+	mydisp.checkTouch();
+
+}
+
+/* ------------------------------------------------------------ */
+/***	FSetupIcons()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns true if successful
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Start MyDisp and preload the icons drawn by FrameIcons().
+*/
+
+static const char *	rgszIcon[] = {
+	"BmpLib/icon48x48_black_on_gray.bmp",
+	"BmpLib/icon48x48_white_on_black.bmp",
+	"BmpLib/icon48x48_blk_on_white.bmp",
+	"BmpLib/led_24x24_r_on.bmp",
+	"BmpLib/led_24x24_g_on.bmp",
+	"BmpLib/pwr_button_off.bmp",
+};
+
+#define	cszIcon		(sizeof(rgszIcon) / sizeof(rgszIcon[0]))
+
+static bool FSetupIcons() {
+	unsigned	isz;
+
+	if (!FBeginMyDisp()) {
+		return false;
+	}
+	mydisp.clearDisplay(0);
+	for (isz = 0; isz < cszIcon; isz++) {
+		if (!mydisp.preloadImage((char *)rgszIcon[isz])) {
+			printf("icons      %s not found below the resource directory\n", rgszIcon[isz]);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* ------------------------------------------------------------ */
+/***	FrameIcons(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Draw a 4x3 grid of icons by name, shifting which icon goes
+**		where each frame.
+*/
+
+static void FrameIcons(int ifrm) {
+	int		iicon;
+
+	for (iicon = 0; iicon < 12; iicon++) {
+		mydisp.drawImage((char *)rgszIcon[(iicon + ifrm) % cszIcon],
+						12 + (iicon % 4) * 56, 60 + (iicon / 4) * 64);
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	FSetupTouch()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns true if successful
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Start MyDisp with touch messages found by polling the shield.
+*/
+
+static bool FSetupTouch() {
+
+	if (!FBeginMyDisp()) {
+		return false;
+	}
+	mydisp.clearDisplay(0);
+	return true;
+}
+
+/* ------------------------------------------------------------ */
+/***	FSetupTouchPin()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns true if successful
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Start MyDisp with status pin A telling the library when there
+**		are touch messages to fetch.
+*/
+
+static bool FSetupTouchPin() {
+
+	return FSetupTouch() && mtds.EnableStatusPin(idPinStatusA, true);
+}
+
+/* ------------------------------------------------------------ */
+/***	FrameTouch(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		An application main loop that mostly waits: checkTouch() is
+**		polled cpollTouch times a frame and a finger goes down or up
+**		every 4th frame. Where the finger was seen is marked on the
+**		display so touch and touchpin can be compared by checksum.
+*/
+
+static void FrameTouch(int ifrm) {
+	MDFNG	fng;
+	int		ipoll;
+
+	if ((ifrm & 3) == 0) {
+		MtdsEmuPostTouch(((ifrm >> 2) & 1) ? msgFinger1Up : msgFinger1Down,
+						10 + ((ifrm * 13) % 220), 10 + ((ifrm * 29) % 300));
+	}
+	for (ipoll = 0; ipoll < cpollTouch; ipoll++) {
+		mydisp.checkTouch();
+	}
+
+	if (((ifrm & 3) == 0) && mydisp.getFinger(0, &fng)) {
+		mydisp.setForeground((fng.st == FINGER_DOWN) ? clrWhite : clrDkGray);
+		mydisp.drawRectangle(true, fng.x - 3, fng.y - 3, fng.x + 3, fng.y + 3);
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	FBeginMyDisp()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns true if successful
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Start MyDisp for a workload. The emulator has been reset since
+**		any earlier MyDisp workload, so MyDisp is started over rather
+**		than left to reuse its old handles.
+*/
+
+static bool FBeginMyDisp() {
+	static bool		fBegun = false;
+
+	if (fBegun) {
+		mydisp.end();
+	}
+	fBegun = mydisp.begin();
+
+	return fBegun;
+}
+
+/* ------------------------------------------------------------ */
+/***	FSetupMem()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns true if successful
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Allocate a shield memory block for the transfer test.
+*/
+
+static bool FSetupMem() {
+	uint32_t	ib;
+
+	for (ib = 0; ib < cbMemXfer; ib++) {
+		rgbBenchMem[ib] = (uint8_t)(ib * 7);
+	}
+	return (hmemBench = mtds.AllocMem(cbMemXfer)) != 0;
+}
+
+/* ------------------------------------------------------------ */
+/***	FrameMem(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Write the block to the shield and read it back. This is where
+**		data-out packet credits (-DcpktDataOutCredit=N) show up.
+*/
+
+static void FrameMem(int ifrm) {
+	static uint8_t	rgbRd[cbMemXfer];
+	uint32_t	cbRes;
+	uint32_t	ib;
+
+	for (ib = 0; ib < cbMemXfer; ib += 0x8000) {
+		mtds.WriteMem(hmemBench, ib, 0x8000, &rgbBenchMem[ib], &cbRes);
+	}
+	for (ib = 0; ib < cbMemXfer; ib += 0x8000) {
+		mtds.ReadMem(hmemBench, ib, 0x8000, &rgbRd[ib], &cbRes);
+	}
+	if (memcmp(rgbRd, rgbBenchMem, cbMemXfer) != 0) {
+		printf("mem      frame %d read back differs\n", ifrm);
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	FrameFile512(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Copy the memory block into a file on the shield and back,
+**		one packet's worth at a time.
+*/
+
+static void FrameFile512(int ifrm) {
+
+	BenchFile(ifrm, "file512", 512);
+
+}
+
+/* ------------------------------------------------------------ */
+/***	FrameFile(ifrm)
+**
+**	Parameters:
+**		ifrm		- frame number
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Copy the memory block into a file on the shield and back with
+**		a buffer the size of the whole file.
+*/
+
+static void FrameFile(int ifrm) {
+
+	BenchFile(ifrm, "file", cbMemXfer);
+
+}
+
+/* ------------------------------------------------------------ */
+/***	BenchFile(ifrm, szWkld, cbBuf)
+**
+**	Parameters:
+**		ifrm		- frame number
+**		szWkld		- workload name for messages
+**		cbBuf		- transfer buffer size
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Send rgbBenchMem to the shield with MTFS::SndFile(), read it
+**		back with MTFS::RcvFile() and check that it came back intact.
+**		The file statistics are printed for the first frame.
+*/
+
+static void BenchFile(int ifrm, const char * szWkld, uint32_t cbBuf) {
+	static uint8_t	rgbBuf[cbMemXfer];
+	FSXS		fsxsSnd;
+	FSXS		fsxsRcv;
+	uint32_t	ib;
+
+	ib = 0;
+	if (!mtfs.SndFile((char *)"asset.bin", CbBenchFileSrc, &ib, rgbBuf, cbBuf, &fsxsSnd)) {
+		printf("%-10s frame %d SndFile failed, error 0x%02X\n", szWkld, ifrm, mtfs.GetLastError());
+		return;
+	}
+
+	memset(rgbBenchRd, 0, sizeof(rgbBenchRd));
+	ib = 0;
+	if (!mtfs.RcvFile((char *)"asset.bin", CbBenchFileDst, &ib, rgbBuf, cbBuf, &fsxsRcv)) {
+		printf("%-10s frame %d RcvFile failed, error 0x%02X\n", szWkld, ifrm, mtfs.GetLastError());
+		return;
+	}
+
+	if ((fsxsRcv.cbXfer != cbMemXfer) || (memcmp(rgbBenchRd, rgbBenchMem, cbMemXfer) != 0)) {
+		printf("%-10s frame %d read back differs\n", szWkld, ifrm);
+	}
+	if (ifrm == 0) {
+		printf("%-10s SndFile %lu bytes in %lu writes, RcvFile %lu bytes in %lu reads\n", szWkld,
+				(unsigned long)fsxsSnd.cbXfer, (unsigned long)fsxsSnd.ccmd,
+				(unsigned long)fsxsRcv.cbXfer, (unsigned long)fsxsRcv.ccmd);
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	CbBenchFileSrc(pvRef, rgbBuf, cbBuf)
+**
+**	Parameters:
+**		pvRef		- pointer to the offset of the next byte to send
+**		rgbBuf		- buffer to fill
+**		cbBuf		- size of the buffer
+**
+**	Return Values:
+**		Returns the number of bytes put in the buffer
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		SndFile() source that reads from rgbBenchMem.
+*/
+
+static uint32_t CbBenchFileSrc(void * pvRef, uint8_t * rgbBuf, uint32_t cbBuf) {
+	uint32_t *	pib = (uint32_t *)pvRef;
+	uint32_t	cb;
+
+	cb = cbMemXfer - *pib;
+	if (cb > cbBuf) {
+		cb = cbBuf;
+	}
+	memcpy(rgbBuf, &rgbBenchMem[*pib], cb);
+	*pib += cb;
+
+	return cb;
+}
+
+/* ------------------------------------------------------------ */
+/***	CbBenchFileDst(pvRef, rgbBuf, cbBuf)
+**
+**	Parameters:
+**		pvRef		- pointer to the offset of the next byte to store
+**		rgbBuf		- data read from the file
+**		cbBuf		- number of bytes read
+**
+**	Return Values:
+**		Returns the number of bytes consumed
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		RcvFile() destination that stores into rgbBenchRd. Anything
+**		past the end of rgbBenchRd is refused.
+*/
+
+static uint32_t CbBenchFileDst(void * pvRef, uint8_t * rgbBuf, uint32_t cbBuf) {
+	uint32_t *	pib = (uint32_t *)pvRef;
+	uint32_t	cb;
+
+	cb = cbMemXfer - *pib;
+	if (cb > cbBuf) {
+		cb = cbBuf;
+	}
+	memcpy(&rgbBenchRd[*pib], rgbBuf, cb);
+	*pib += cb;
+
+	return cb;
+}
+
+/* ------------------------------------------------------------ */
+
+/************************************************************************/
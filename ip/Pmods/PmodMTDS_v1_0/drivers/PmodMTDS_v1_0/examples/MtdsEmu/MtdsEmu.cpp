@@ -0,0 +1,2534 @@
+/************************************************************************/
+/*																		*/
+/*	MtdsEmu.cpp	--	Host Emulator of the MTDS Shield Side Protocol		*/
+/*																		*/
+/************************************************************************/
+/*  File Description:													*/
+/*																		*/
+/*	This module plays the part of the display shield firmware on the	*/
+/*	other end of the SPI link. It follows the channel protocol in		*/
+/*	ProtoDefs.h byte for byte: sync/start, command packets, the busy/	*/
+/*	ready/done handshake, data-out and data-in packets, aborts and		*/
+/*	status packets. Commands are executed against an in-memory model.	*/
+/*																		*/
+/*	What is modeled:													*/
+/*	 - Util: init, version, display settings, ClearDisplay, the message	*/
+/*	   queue, and the memory heap (alloc/read/write/free/free space).	*/
+/*	 - GDI: drawing surfaces, bitmaps, solid and stock brushes, pens,	*/
+/*	   drawing rops, lines, rectangles, ellipses, arcs (outline only),	*/
+/*	   BitBlt/PatBlt/DrawBitmap and box-glyph text. LoadBitmap reads	*/
+/*	   16 and 24 bit .bmp files from a host directory.					*/
+/*	 - Win: accepted and answered with dummy handles, no drawing.		*/
+/*	 - Fs: files are kept in host memory and can be opened, read,		*/
+/*	   written, positioned and sized. Directory, volume, rename, delete	*/
+/*	   and attribute commands fail with staFsNotEnabled. SD card		*/
+/*	   access time is not modeled.										*/
+/*																		*/
+/*	Rendering is meant to be close enough to compare frames between		*/
+/*	two ways of drawing the same thing, not pixel exact with the		*/
+/*	firmware. In particular text is drawn as one filled box per glyph.	*/
+/*																		*/
+/************************************************************************/
+
+/* ------------------------------------------------------------ */
+/*				Include File Definitions						*/
+/* ------------------------------------------------------------ */
+
+#include	<stdio.h>
+#include	<stdlib.h>
+#include	<string.h>
+#include	<math.h>
+
+#include	<stdint.h>
+#include	<vector>
+#include	<algorithm>
+
+#include	"ProtoDefs.h"
+#include	"mtds.h"
+#include	"MtdsCore.h"
+#include	"MtdsEmu.h"
+
+/* ------------------------------------------------------------ */
+/*				Local Type and Constant Definitions				*/
+/* ------------------------------------------------------------ */
+
+/* Channel states. The reply to each byte is decided by the state the
+** emulator is in when the byte arrives.
+*/
+#define	stEmuSync		0			// waiting for chnCmdStart
+#define	stEmuIdle		1			// waiting for a command packet
+#define	stEmuCmdRx		2			// receiving a command packet
+#define	stEmuBusy		3			// command accepted, next poll sees busy
+#define	stEmuReady		4			// waiting for a data-out packet
+#define	stEmuDataRx		5			// receiving a data-out packet
+#define	stEmuDataIn		6			// sending data-in packets
+#define	stEmuDone		7			// waiting for the status read command
+#define	stEmuAbort		8			// command aborted, waiting for resume
+#define	stEmuStatus		9			// sending the status packet
+
+#define	cbEmuParamMax	64			// largest parameter block accepted
+#define	cbEmuHeap		(1024ul*1024ul)		// memory shared by bitmaps and memory blocks
+#define	cfntEmuStock	6
+
+#define	ixhEmu(h)		(((h) & 0x000FFFFF) - 1)	// object table index from a handle
+
+/* Objects owned by the emulated shield.
+*/
+struct EMUBMP {
+	bool		fUsed;
+	int16_t		dxco;
+	int16_t		dyco;
+	int16_t		cbpp;
+	std::vector<uint16_t>	vclr;	// RGB565 pixels, row major
+};
+
+struct EMUDS {
+	bool		fUsed;
+	uint32_t	clrFg;
+	uint32_t	clrBg;
+	uint32_t	clrTrans;
+	uint16_t	ity;
+	uint16_t	pen;
+	uint16_t	bk;
+	uint16_t	drw;
+	HBR			hbr;
+	HFNT		hfnt;
+	HBMP		hbmp;
+	int16_t		xcoCur;
+	int16_t		ycoCur;
+};
+
+struct EMUBR {
+	bool		fUsed;
+	uint32_t	clr;
+};
+
+struct EMUMEM {
+	bool		fUsed;
+	std::vector<uint8_t>	vb;
+};
+
+struct EMUFILE {
+	char		szName[cchNameMax+1];
+	std::vector<uint8_t>	vb;
+};
+
+struct EMUFIL {
+	bool		fUsed;
+	int			ifile;				// index of the file in vfileEmu
+	uint32_t	ib;					// file pointer
+	uint8_t		md;					// access mode the file was opened with
+};
+
+/* ------------------------------------------------------------ */
+/*				Global Variables								*/
+/* ------------------------------------------------------------ */
+
+
+/* ------------------------------------------------------------ */
+/*				Local Variables									*/
+/* ------------------------------------------------------------ */
+
+/* Channel state.
+*/
+static int		stEmu;
+static int		stEmuNext;				// state to enter after the busy poll
+static bool		fEmuFrameStart;			// next byte is the first of a CS frame
+static bool		fEmuPinA;				// status pin A enabled by the host
+static bool		fEmuPinB;				// status pin B enabled by the host
+static uint8_t	rgbEmuCmd[sizeof(CHDR) + cbEmuParamMax];
+static int		cbEmuCmd;
+static uint8_t	rgbEmuDhdr[sizeof(DHDR)];
+static int		cbEmuDhdr;
+static int		cbEmuPktRem;
+static std::vector<uint8_t>	vbEmuOut;	// data-out bytes received so far
+static uint32_t	cbEmuOutNeed;
+static std::vector<uint8_t>	vbEmuTx;	// data-in packets or status packet being sent
+static uint32_t	ibEmuTx;
+static uint8_t	rgbEmuSta[sizeof(RHDR) + cbRhdrDataMax];
+
+/* Shield state.
+*/
+static uint16_t	verEmuFwMajor;
+static uint16_t	verEmuFwMinor;
+static const char *	szEmuResDir;
+static uint32_t	rgvalEmuUtil[0x40];
+static std::vector<EMUBMP>	vbmpEmu;
+static std::vector<EMUDS>	vdsEmu;
+static std::vector<EMUBR>	vbrEmu;
+static std::vector<EMUMEM>	vmemEmu;
+static std::vector<MEVT>	vevtEmu;
+static std::vector<EMUFILE>	vfileEmu;
+static std::vector<EMUFIL>	vfilEmu;
+static EMUBMP	bmpEmuDisplay;
+static uint32_t	cbEmuHeapUsed;
+static uint32_t	hwinEmuNext;
+static EMUSTAT	statEmu;
+
+static const uint32_t	rgclrEmuStockBr[] = {
+	0, clrWhite, clrLtGray, clrMedGray, clrDkGray, clrBlack,
+	clrRed, clrGreen, clrBlue, clrLtBlueGray, clrMedBlueGray
+};
+
+/* Character cell sizes of the stock fonts.
+*/
+static const uint8_t	rgdxcoEmuFont[cfntEmuStock] = {  8,  6,  8, 12, 16, 24 };
+static const uint8_t	rgdycoEmuFont[cfntEmuStock] = { 16,  8, 12, 16, 24, 32 };
+
+/* ------------------------------------------------------------ */
+/*				Forward Declarations							*/
+/* ------------------------------------------------------------ */
+
+static void		EmuCommand();
+static void		EmuDataPacket();
+static int32_t	CbEmuDataOut(uint8_t cls, uint8_t cmd, uint8_t * pbPrm);
+static void		EmuExecute(uint8_t cls, uint8_t cmd, uint8_t * pbPrm, uint8_t * pbData, uint32_t cbData);
+static void		EmuExecUtil(uint8_t cmd, uint8_t * pbPrm, uint8_t * pbData, uint32_t cbData);
+static void		EmuExecGdi(uint8_t cmd, uint8_t * pbPrm, uint8_t * pbData, uint32_t cbData);
+static void		EmuExecWin(uint8_t cmd, uint8_t * pbPrm);
+static void		EmuExecFs(uint8_t cmd, uint8_t * pbPrm, uint8_t * pbData, uint32_t cbData);
+static void		EmuRet(uint8_t sta, const void * pvRet, uint8_t cbRet);
+static void		EmuRetA(uint8_t sta, uint32_t valA1, uint32_t valA2, uint32_t valA3, uint32_t valA4);
+static void		EmuRetB(uint8_t sta, uint16_t valB1, uint16_t valB2, uint16_t valB3, uint16_t valB4);
+static void		EmuQueueDataIn(uint8_t cmd, const uint8_t * pb, uint32_t cb);
+
+static uint16_t	Clr565(uint32_t clr);
+static uint32_t	ClrRgb(uint16_t clr);
+static EMUDS *	PdsEmu(HDS hds);
+static EMUBMP *	PbmpEmu(HBMP hbmp);
+static bool		FEmuBrushColor(HBR hbr, uint16_t * pclr);
+static EMUMEM *	PmemEmu(HMEM hmem);
+static HBMP		HbmpEmuNew(int16_t dxco, int16_t dyco, int16_t cbpp);
+static void		EmuFreeBmp(HBMP hbmp);
+static void		EmuPlot(EMUBMP * pbmp, int xco, int yco, uint16_t clr, uint16_t drw);
+static void		EmuPenPixel(EMUDS * pds, EMUBMP * pbmp, int xco, int yco, int * pipx);
+static void		EmuLine(EMUDS * pds, EMUBMP * pbmp, int xco1, int yco1, int xco2, int yco2, int * pipx);
+static void		EmuFill(EMUBMP * pbmp, int xcoL, int ycoT, int xcoR, int ycoB, uint16_t clr);
+static void		EmuRectangle(EMUDS * pds, EMUBMP * pbmp, PRM1A4B * pprm);
+static void		EmuEllipse(EMUDS * pds, EMUBMP * pbmp, PRM1A8B * pprm, bool fArc);
+static void		EmuText(EMUDS * pds, EMUBMP * pbmp, int xco, int yco, const uint8_t * pch, int cch, bool fMove);
+static uint16_t	ClrEmuRop(uint16_t rop, uint16_t clrS, uint16_t clrD, uint16_t clrP, EMUDS * pds);
+static void		EmuBlt(EMUDS * pdsDst, int xco, int yco, int dxco, int dyco, EMUDS * pdsSrc,
+						int xcoSrc, int ycoSrc, uint16_t rop, bool fDraw);
+static uint8_t	StaEmuLoadBitmap(const char * szName, HBMP * phbmp);
+
+/* ------------------------------------------------------------ */
+/*				Procedure Definitions							*/
+/* ------------------------------------------------------------ */
+/***	MtdsEmuInit(verFwMajor, verFwMinor, szResDir)
+**
+**	Parameters:
+**		verFwMajor		- firmware major version to report
+**		verFwMinor		- firmware minor version to report
+**		szResDir		- host directory LoadBitmap reads from
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Put the emulated shield in its power up state: channel in sync,
+**		display black, no objects allocated.
+*/
+
+void MtdsEmuInit(uint16_t verFwMajor, uint16_t verFwMinor, const char * szResDir) {
+
+	verEmuFwMajor = verFwMajor;
+	verEmuFwMinor = verFwMinor;
+	szEmuResDir = szResDir;
+
+	stEmu = stEmuSync;
+	fEmuFrameStart = false;
+	vbEmuTx.clear();
+
+	bmpEmuDisplay.fUsed = true;
+	bmpEmuDisplay.dxco = dxcoEmuDisplay;
+	bmpEmuDisplay.dyco = dycoEmuDisplay;
+	bmpEmuDisplay.cbpp = 16;
+	bmpEmuDisplay.vclr.assign(dxcoEmuDisplay * dycoEmuDisplay, 0);
+
+	vbmpEmu.clear();
+	vdsEmu.clear();
+	vbrEmu.clear();
+	vmemEmu.clear();
+	vevtEmu.clear();
+	fEmuPinA = false;
+	fEmuPinB = false;
+	vfileEmu.clear();
+	vfilEmu.clear();
+	cbEmuHeapUsed = 0;
+	hwinEmuNext = 1;
+	memset(rgvalEmuUtil, 0, sizeof(rgvalEmuUtil));
+	rgvalEmuUtil[cmdUtilSetDspEnable] = 1;
+	rgvalEmuUtil[cmdUtilSetDspBacklight] = 100;
+
+	MtdsEmuClearStat();
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsEmuSelect(fEn)
+**
+**	Parameters:
+**		fEn		- true when slave select is asserted
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Track slave select. The shield looks at the first byte of each
+**		frame to decide between a channel command and a packet.
+*/
+
+void MtdsEmuSelect(bool fEn) {
+
+	if (fEn) {
+		fEmuFrameStart = true;
+		statEmu.cframe += 1;
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsEmuXfer(bSnd)
+**
+**	Parameters:
+**		bSnd		- byte sent by the host
+**
+**	Return Values:
+**		Returns the byte the shield clocks back
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Exchange one byte. The reply reflects the state before bSnd is
+**		looked at, the same way the shield has its reply loaded in the
+**		SPI data register before the host starts clocking.
+*/
+
+uint8_t MtdsEmuXfer(uint8_t bSnd) {
+	uint8_t	bRsp;
+	bool	fFirst;
+
+	fFirst = fEmuFrameStart;
+	fEmuFrameStart = false;
+	statEmu.cbSpi += 1;
+
+	switch (stEmu) {
+	case stEmuSync:
+		bRsp = chnStaSync;
+		statEmu.cbPoll += 1;
+		if (bSnd == chnCmdStart) {
+			stEmu = stEmuIdle;
+		}
+		break;
+
+	case stEmuCmdRx:
+		bRsp = chnStaBusy;
+		rgbEmuCmd[cbEmuCmd++] = bSnd;
+		if ((cbEmuCmd >= (int)sizeof(CHDR)) &&
+			(cbEmuCmd == (int)sizeof(CHDR) + ((CHDR *)rgbEmuCmd)->cb)) {
+			EmuCommand();
+		}
+		else if (cbEmuCmd >= (int)sizeof(rgbEmuCmd)) {
+			/* Parameter block too big. Drop back to sync, the host will
+			** resynchronize when its next handshake fails.
+			*/
+			stEmu = stEmuSync;
+		}
+		break;
+
+	case stEmuDataRx:
+		bRsp = chnStaBusy;
+		if (cbEmuDhdr < (int)sizeof(DHDR)) {
+			rgbEmuDhdr[cbEmuDhdr++] = bSnd;
+			if (cbEmuDhdr == (int)sizeof(DHDR)) {
+				cbEmuPktRem = ((DHDR *)rgbEmuDhdr)->cb;
+				if ((cbEmuPktRem == 0) || (cbEmuPktRem > cbDhdrDataOutMax)) {
+					stEmu = stEmuSync;
+				}
+			}
+		}
+		else {
+			vbEmuOut.push_back(bSnd);
+			if (--cbEmuPktRem == 0) {
+				EmuDataPacket();
+			}
+		}
+		break;
+
+	case stEmuDataIn:
+	case stEmuStatus:
+		if (fFirst && (bSnd == chnCmdSync)) {
+			bRsp = chnStaBusy;
+			stEmu = stEmuSync;
+			break;
+		}
+		bRsp = vbEmuTx[ibEmuTx++];
+		if (ibEmuTx >= vbEmuTx.size()) {
+			vbEmuTx.clear();
+			stEmu = (stEmu == stEmuDataIn) ? stEmuDone : stEmuIdle;
+		}
+		break;
+
+	default:
+		/* The polled states: idle, busy, ready, done, abort.
+		*/
+		switch (stEmu) {
+		case stEmuIdle:		bRsp = chnStaIdle;	break;
+		case stEmuBusy:		bRsp = chnStaBusy;	break;
+		case stEmuReady:	bRsp = chnStaReady;	break;
+		case stEmuDone:		bRsp = chnStaDone;	break;
+		default:			bRsp = chnStaAbort;	break;
+		}
+		statEmu.cbPoll += 1;
+
+		if (fFirst && (bSnd == chnCmdSync)) {
+			stEmu = stEmuSync;
+		}
+		else if (fFirst && ((bSnd & mskPacketCls) == clsPacketCmd) &&
+				((stEmu == stEmuIdle) || (stEmu == stEmuDone))) {
+			rgbEmuCmd[0] = bSnd;
+			cbEmuCmd = 1;
+			stEmu = stEmuCmdRx;
+		}
+		else if (fFirst && (bSnd == clsDataOut) && (stEmu == stEmuReady)) {
+			rgbEmuDhdr[0] = bSnd;
+			cbEmuDhdr = 1;
+			stEmu = stEmuDataRx;
+		}
+		else if (stEmu == stEmuBusy) {
+			/* The host has seen busy, move on to whatever the command
+			** needs next.
+			*/
+			stEmu = stEmuNext;
+		}
+		else if ((stEmu == stEmuAbort) && (bSnd == chnCmdResume)) {
+			stEmu = stEmuDone;
+		}
+		break;
+	}
+
+	return bRsp;
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuCommand()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		A complete command packet is in rgbEmuCmd. Decide what the
+**		host will see next: a status packet, a data-out handshake,
+**		data-in packets or just done.
+*/
+
+static void EmuCommand() {
+	CHDR *	pchdr = (CHDR *)rgbEmuCmd;
+	uint8_t	*	pbPrm = &rgbEmuCmd[sizeof(CHDR)];
+	int32_t	cbOut;
+
+	if ((pchdr->cls == clsCmdUtil) && (pchdr->cmd == cmdUtilReadStatusPacket)) {
+		vbEmuTx.assign(rgbEmuSta, rgbEmuSta + sizeof(RHDR) + ((RHDR *)rgbEmuSta)->cb);
+		ibEmuTx = 0;
+		stEmu = stEmuStatus;
+		return;
+	}
+
+	statEmu.ccmd += 1;
+	vbEmuOut.clear();
+	vbEmuTx.clear();
+	ibEmuTx = 0;
+	stEmu = stEmuBusy;
+
+	cbOut = CbEmuDataOut(pchdr->cls, pchdr->cmd, pbPrm);
+	if (cbOut < 0) {
+		/* A data-out command we don't implement. Abort it so the host
+		** stops sending and resumes the channel.
+		*/
+		EmuRet(staCmdNotSupported, 0, 0);
+		statEmu.cabort += 1;
+		stEmuNext = stEmuAbort;
+	}
+	else if (cbOut > 0) {
+		cbEmuOutNeed = cbOut;
+		stEmuNext = stEmuReady;
+	}
+	else {
+		EmuExecute(pchdr->cls, pchdr->cmd, pbPrm, 0, 0);
+		stEmuNext = vbEmuTx.empty() ? stEmuDone : stEmuDataIn;
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuDataPacket()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		A data-out packet has been received. Once all of the data for
+**		the command is in, execute it. Otherwise go straight back to
+**		ready; a host built with cpktDataOutCredit above 1 may send the
+**		next packet without polling first.
+*/
+
+static void EmuDataPacket() {
+	CHDR *	pchdr = (CHDR *)rgbEmuCmd;
+
+	statEmu.cpktOut += 1;
+	if (vbEmuOut.size() >= cbEmuOutNeed) {
+		EmuExecute(pchdr->cls, pchdr->cmd, &rgbEmuCmd[sizeof(CHDR)], vbEmuOut.data(), vbEmuOut.size());
+		stEmu = stEmuDone;
+	}
+	else {
+		stEmu = stEmuReady;
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	CbEmuDataOut(cls, cmd, pbPrm)
+**
+**	Parameters:
+**		cls			- command class
+**		cmd			- command code
+**		pbPrm		- command parameters
+**
+**	Return Values:
+**		Returns the number of data-out bytes the command carries, or -1
+**		for a data-out command the emulator doesn't implement
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		The data length is not in the command header, it is implied by
+**		the command, so this has to mirror the library.
+*/
+
+static int32_t CbEmuDataOut(uint8_t cls, uint8_t cmd, uint8_t * pbPrm) {
+
+	if (cls == clsCmdUtil) {
+		if (cmd == cmdUtilWriteMem) {
+			return ((PRM3A *)pbPrm)->valA3;
+		}
+		if (cmd == cmdUtilBeginUpdate) {
+			return -1;
+		}
+	}
+	else if (cls == clsCmdGdi) {
+		switch (cmd) {
+		case cmdGdiLoadBitmap:
+		case cmdGdiTextOutCch:
+		case cmdGdiGetTextExtent:
+			return ((PRM1A1B *)pbPrm)->valB1;
+		case cmdGdiTextOutXcoYco:
+			return ((PRM1A3B *)pbPrm)->valB3;
+		case cmdGdiPolyLine:
+		case cmdGdiPolyLineTo:
+			return ((PRM1A1B *)pbPrm)->valB1 * sizeof(PNT);
+		case cmdGdiStoreBitmap:
+		case cmdGdiSndBitmap:
+		case cmdGdiStoreFont:
+		case cmdGdiLoadFont:
+		case cmdGdiSndFont:
+			return -1;
+		}
+	}
+	else if (cls == clsCmdWin) {
+		if ((cmd == cmdWinSetWindowTitle) || (cmd == cmdWinSetWindowString)) {
+			return -1;
+		}
+	}
+	else if (cls == clsCmdFs) {
+		switch (cmd) {
+		case cmdFsOpen:
+			return ((PRM2B *)pbPrm)->valB1;
+		case cmdFsWrite:
+			return ((PRM2A *)pbPrm)->valA2;
+		case cmdFsSetCurDir:
+		case cmdFsMkdir:
+		case cmdFsOpenDir:
+		case cmdFsSetFname:
+		case cmdFsDelete:
+		case cmdFsRename:
+		case cmdFsSetAttrib:
+		case cmdFsSetTime:
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuExecute(cls, cmd, pbPrm, pbData, cbData)
+**
+**	Parameters:
+**		cls			- command class
+**		cmd			- command code
+**		pbPrm		- command parameters
+**		pbData		- data-out bytes, if any
+**		cbData		- number of data-out bytes
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Execute a command and leave its status packet in rgbEmuSta.
+**		Read commands also leave their data-in packets in vbEmuTx.
+*/
+
+static void EmuExecute(uint8_t cls, uint8_t cmd, uint8_t * pbPrm, uint8_t * pbData, uint32_t cbData) {
+
+	((RHDR *)rgbEmuSta)->cls = clsPacketSta | (cls & ~mskPacketCls);
+	((RHDR *)rgbEmuSta)->cmd = cmd;
+	EmuRet(staCmdNotSupported, 0, 0);
+
+	switch (cls) {
+	case clsCmdUtil:
+		EmuExecUtil(cmd, pbPrm, pbData, cbData);
+		break;
+	case clsCmdGdi:
+		EmuExecGdi(cmd, pbPrm, pbData, cbData);
+		break;
+	case clsCmdWin:
+		EmuExecWin(cmd, pbPrm);
+		break;
+	case clsCmdFs:
+		EmuExecFs(cmd, pbPrm, pbData, cbData);
+		break;
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuExecUtil(cmd, pbPrm, pbData, cbData)
+**
+**	Parameters:
+**		cmd			- command code
+**		pbPrm		- command parameters
+**		pbData		- data-out bytes
+**		cbData		- number of data-out bytes
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Execute a utility class command.
+*/
+
+static void EmuExecUtil(uint8_t cmd, uint8_t * pbPrm, uint8_t * pbData, uint32_t cbData) {
+	PRM3A *		pprm = (PRM3A *)pbPrm;
+	EMUMEM *	pmem;
+	MEVT		evt;
+	MSTAT		mstat;
+	uint32_t	ib;
+	uint32_t	cb;
+	uint32_t	imem;
+
+	(void)cbData;
+
+	switch (cmd) {
+	case cmdUtilEnableStatusPin:
+		if (((PRM2B *)pbPrm)->valB1 == idPinStatusA) {
+			fEmuPinA = (((PRM2B *)pbPrm)->valB2 != 0);
+		}
+		else if (((PRM2B *)pbPrm)->valB1 == idPinStatusB) {
+			fEmuPinB = (((PRM2B *)pbPrm)->valB2 != 0);
+		}
+		EmuRet(staCmdSuccess, 0, 0);
+		break;
+
+	case cmdUtilInit:
+	case cmdUtilSetStatusPin:
+	case cmdUtilSetMemMode:
+		EmuRet(staCmdSuccess, 0, 0);
+		break;
+
+	case cmdUtilGetFirmwareVersion:
+		EmuRetB(staCmdSuccess, verEmuFwMajor, verEmuFwMinor, 0, 0);
+		break;
+
+	case cmdUtilSetDspEnable:
+	case cmdUtilSetDspOrientation:
+	case cmdUtilSetDspBacklight:
+	case cmdUtilSetTchSensitivity:
+	case cmdUtilSetTchMoveDelta:
+		rgvalEmuUtil[cmd] = pprm->valA1;
+		EmuRet(staCmdSuccess, 0, 0);
+		break;
+
+	case cmdUtilSetBacklightMode:
+		EmuRetA(staCmdSuccess, rgvalEmuUtil[cmd], 0, 0, 0);
+		rgvalEmuUtil[cmd] = pprm->valA1;
+		break;
+
+	case cmdUtilGetDspEnable:
+	case cmdUtilGetDspOrientation:
+	case cmdUtilGetDspBacklight:
+	case cmdUtilGetTchSensitivity:
+		EmuRetA(staCmdSuccess, rgvalEmuUtil[cmd-1], 0, 0, 0);
+		break;
+
+	case cmdUtilGetTchMoveDelta:
+		EmuRetB(staCmdSuccess, rgvalEmuUtil[cmd-1] & 0xFFFF, rgvalEmuUtil[cmd-1] >> 16, 0, 0);
+		break;
+
+	case cmdUtilClearDisplay:
+		bmpEmuDisplay.vclr.assign(bmpEmuDisplay.vclr.size(), ((PRM1B *)pbPrm)->valB1);
+		EmuRet(staCmdSuccess, 0, 0);
+		break;
+
+	case cmdUtilGetMsgStatus:
+		EmuRetA(staCmdSuccess, vevtEmu.size(), 0, 0, 0);
+		break;
+
+	case cmdUtilClearMsgQueue:
+		vevtEmu.clear();
+		EmuRet(staCmdSuccess, 0, 0);
+		break;
+
+	case cmdUtilPeekMsg:
+	case cmdUtilGetMsg:
+		if (vevtEmu.empty()) {
+			EmuRet(staCmdError, 0, 0);
+			break;
+		}
+		evt = vevtEmu.front();
+		if (cmd == cmdUtilGetMsg) {
+			vevtEmu.erase(vevtEmu.begin());
+		}
+		EmuRetA(staCmdSuccess, evt.tms, evt.hwin, ((uint32_t)evt.msg << 16) | evt.val1, evt.val2);
+		break;
+
+	case cmdUtilPostMsg:
+	case cmdUtilPushMsg:
+		evt.tms = ((PRM4A *)pbPrm)->valA1;
+		evt.hwin = ((PRM4A *)pbPrm)->valA2;
+		evt.msg = ((PRM4A *)pbPrm)->valA3 >> 16;
+		evt.val1 = ((PRM4A *)pbPrm)->valA3 & 0xFFFF;
+		evt.val2 = ((PRM4A *)pbPrm)->valA4;
+		if (cmd == cmdUtilPostMsg) {
+			vevtEmu.push_back(evt);
+		}
+		else {
+			vevtEmu.insert(vevtEmu.begin(), evt);
+		}
+		EmuRet(staCmdSuccess, 0, 0);
+		break;
+
+	case cmdUtilGetMemStatus:
+		memset(&mstat, 0, sizeof(mstat));
+		for (imem = 0; imem < vmemEmu.size(); imem++) {
+			mstat.chmemAlloc += vmemEmu[imem].fUsed ? 1 : 0;
+		}
+		mstat.chmemTotal = 64;
+		mstat.cbAlloc = cbEmuHeapUsed;
+		mstat.cbFree = cbEmuHeap - cbEmuHeapUsed;
+		EmuQueueDataIn(cmd, (uint8_t *)&mstat, sizeof(mstat));
+		EmuRet(staCmdSuccess, 0, 0);
+		break;
+
+	case cmdUtilGetFreeMem:
+		EmuRetA(staCmdSuccess, cbEmuHeap - cbEmuHeapUsed, 0, 0, 0);
+		break;
+
+	case cmdUtilAllocMem:
+		if (pprm->valA1 > cbEmuHeap - cbEmuHeapUsed) {
+			EmuRet(staCmdOutOfMemory, 0, 0);
+			break;
+		}
+		for (imem = 0; imem < vmemEmu.size(); imem++) {
+			if (!vmemEmu[imem].fUsed) {
+				break;
+			}
+		}
+		if (imem == vmemEmu.size()) {
+			vmemEmu.resize(imem + 1);
+		}
+		vmemEmu[imem].fUsed = true;
+		vmemEmu[imem].vb.assign(pprm->valA1, 0);
+		cbEmuHeapUsed += pprm->valA1;
+		EmuRetA(staCmdSuccess, sigHmem + imem + 1, 0, 0, 0);
+		break;
+
+	case cmdUtilGetMemSize:
+	case cmdUtilFreeMem:
+		if ((pmem = PmemEmu(pprm->valA1)) == 0) {
+			EmuRet(staUtilInvalidMemoryHandle, 0, 0);
+			break;
+		}
+		if (cmd == cmdUtilGetMemSize) {
+			EmuRetA(staCmdSuccess, pmem->vb.size(), 0, 0, 0);
+		}
+		else {
+			cbEmuHeapUsed -= pmem->vb.size();
+			pmem->vb.clear();
+			pmem->fUsed = false;
+			EmuRet(staCmdSuccess, 0, 0);
+		}
+		break;
+
+	case cmdUtilReadMem:
+	case cmdUtilWriteMem:
+		if ((pmem = PmemEmu(pprm->valA1)) == 0) {
+			EmuRet(staUtilInvalidMemoryHandle, 0, 0);
+			break;
+		}
+		ib = pprm->valA2;
+		cb = pprm->valA3;
+		if (ib > pmem->vb.size()) {
+			ib = pmem->vb.size();
+		}
+		if (cb > pmem->vb.size() - ib) {
+			cb = pmem->vb.size() - ib;
+		}
+		if (cmd == cmdUtilReadMem) {
+			EmuQueueDataIn(cmd, &pmem->vb[0] + ib, cb);
+		}
+		else {
+			memcpy(&pmem->vb[0] + ib, pbData, cb);
+		}
+		EmuRetA(staCmdSuccess, cb, 0, 0, 0);
+		break;
+
+	case cmdUtilSetDateTime:
+	case cmdUtilGetDateTime:
+		EmuRet(staUtilNotSupported, 0, 0);
+		break;
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuExecGdi(cmd, pbPrm, pbData, cbData)
+**
+**	Parameters:
+**		cmd			- command code
+**		pbPrm		- command parameters
+**		pbData		- data-out bytes
+**		cbData		- number of data-out bytes
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Execute a GDI class command. Every command that takes an HDS
+**		has it as its first parameter.
+*/
+
+static void EmuExecGdi(uint8_t cmd, uint8_t * pbPrm, uint8_t * pbData, uint32_t cbData) {
+	PRM2A *		pprm2a = (PRM2A *)pbPrm;
+	PRM1A1B *	pprm1a1b = (PRM1A1B *)pbPrm;
+	PRM1A4B *	pprm1a4b = (PRM1A4B *)pbPrm;
+	PRM1A8B		prm8b;
+	EMUDS *		pds;
+	EMUDS *		pdsSrc;
+	EMUBMP *	pbmp;
+	PNT *		rgpnt;
+	HBMP		hbmp;
+	uint16_t	clr;
+	uint32_t	ids;
+	int			ipx;
+	int			ipnt;
+	int			ifnt;
+	uint8_t		sta;
+
+	/* Commands that don't operate on an existing DS.
+	*/
+	switch (cmd) {
+	case cmdGdiGetDisplayDs:
+	case cmdGdiGetDs:
+		for (ids = 0; ids < vdsEmu.size(); ids++) {
+			if (!vdsEmu[ids].fUsed) {
+				break;
+			}
+		}
+		if (ids == vdsEmu.size()) {
+			vdsEmu.resize(ids + 1);
+		}
+		pds = &vdsEmu[ids];
+		pds->fUsed = true;
+		pds->clrFg = clrWhite;
+		pds->clrBg = clrBlack;
+		pds->clrTrans = clrBlack;
+		pds->ity = 100;
+		pds->pen = penSolid;
+		pds->bk = bkOpaque;
+		pds->drw = drwCopyPen;
+		pds->hbr = hbrNull;
+		pds->hfnt = hfntConsole;
+		pds->hbmp = sigHbmp + sigHbmpStock;
+		pds->xcoCur = 0;
+		pds->ycoCur = 0;
+		EmuRetA(staCmdSuccess, sigHds + ids + 1, 0, 0, 0);
+		return;
+
+	case cmdGdiCreateBitmap:
+		hbmp = HbmpEmuNew(((PRM3B *)pbPrm)->valB1, ((PRM3B *)pbPrm)->valB2, ((PRM3B *)pbPrm)->valB3);
+		EmuRetA((hbmp != 0) ? staCmdSuccess : staCmdOutOfMemory, hbmp, 0, 0, 0);
+		return;
+
+	case cmdGdiDestroyBitmap:
+		if ((PbmpEmu(pprm2a->valA1) == 0) || (pprm2a->valA1 == sigHbmp + sigHbmpStock)) {
+			EmuRet(staGdiInvalidBitmap, 0, 0);
+			return;
+		}
+		EmuFreeBmp(pprm2a->valA1);
+		EmuRet(staCmdSuccess, 0, 0);
+		return;
+
+	case cmdGdiGetDisplayBitmap:
+		EmuRetA(staCmdSuccess, sigHbmp + sigHbmpStock, 0, 0, 0);
+		return;
+
+	case cmdGdiGetBitmapDim:
+		if ((pbmp = PbmpEmu(pprm2a->valA1)) == 0) {
+			EmuRet(staGdiInvalidBitmap, 0, 0);
+			return;
+		}
+		EmuRetB(staCmdSuccess, pbmp->dxco, pbmp->dyco, pbmp->cbpp, 0);
+		return;
+
+	case cmdGdiLoadBitmap:
+		if (cbData == 0) {
+			EmuRet(staGdiBadParameter, 0, 0);
+			return;
+		}
+		pbData[cbData-1] = '\0';
+		sta = StaEmuLoadBitmap((char *)pbData, &hbmp);
+		EmuRetA(sta, hbmp, 0, 0, 0);
+		return;
+
+	case cmdGdiCreateSolidBrush:
+	case cmdGdiCreatePatternBrush:
+	case cmdGdiCreateCustomBrush:
+		/* Pattern and custom brushes are drawn as solid brushes in the
+		** foreground color or the first pixel of the bitmap.
+		*/
+		clr = 0;
+		if (cmd == cmdGdiCreateCustomBrush) {
+			if ((pbmp = PbmpEmu(pprm2a->valA1)) == 0) {
+				EmuRet(staGdiInvalidBitmap, 0, 0);
+				return;
+			}
+			clr = pbmp->vclr.empty() ? 0 : pbmp->vclr[0];
+		}
+		for (ids = 0; ids < vbrEmu.size(); ids++) {
+			if (!vbrEmu[ids].fUsed) {
+				break;
+			}
+		}
+		if (ids == vbrEmu.size()) {
+			vbrEmu.resize(ids + 1);
+		}
+		vbrEmu[ids].fUsed = true;
+		vbrEmu[ids].clr = (cmd == cmdGdiCreateCustomBrush) ? ClrRgb(clr) : pprm2a->valA1;
+		EmuRetA(staCmdSuccess, sigHbr + ids + 1, 0, 0, 0);
+		return;
+
+	case cmdGdiDestroyBrush:
+		if (((pprm2a->valA1 & 0xFFF00000) != sigHbr) || (ixhEmu(pprm2a->valA1) >= vbrEmu.size()) ||
+			!vbrEmu[ixhEmu(pprm2a->valA1)].fUsed) {
+			EmuRet(staGdiInvalidBrush, 0, 0);
+			return;
+		}
+		vbrEmu[ixhEmu(pprm2a->valA1)].fUsed = false;
+		EmuRet(staCmdSuccess, 0, 0);
+		return;
+
+	case cmdGdiGetNearestColor:
+		EmuRetA(staCmdSuccess, ClrRgb(Clr565(pprm2a->valA1)), 0, 0, 0);
+		return;
+
+	case cmdGdiStoreBitmap:
+	case cmdGdiSndBitmap:
+	case cmdGdiRcvBitmap:
+	case cmdGdiCreateFont:
+	case cmdGdiDestroyFont:
+	case cmdGdiStoreFont:
+	case cmdGdiLoadFont:
+	case cmdGdiSndFont:
+	case cmdGdiRcvFont:
+	case cmdGdiGetFontSize:
+	case cmdGdiGetBitmapSize:
+		EmuRet(staCmdNotSupported, 0, 0);
+		return;
+	}
+
+	/* Everything else operates on the DS in the first parameter.
+	*/
+	if ((pds = PdsEmu(pprm2a->valA1)) == 0) {
+		EmuRet(staGdiInvalidDs, 0, 0);
+		return;
+	}
+	if ((pbmp = PbmpEmu(pds->hbmp)) == 0) {
+		EmuRet(staGdiInvalidBitmap, 0, 0);
+		return;
+	}
+	EmuRet(staCmdSuccess, 0, 0);
+	ipx = 0;
+
+	switch (cmd) {
+	case cmdGdiReleaseDs:
+		pds->fUsed = false;
+		break;
+
+	case cmdGdiSetFgColor:		pds->clrFg = pprm2a->valA2;		break;
+	case cmdGdiSetBgColor:		pds->clrBg = pprm2a->valA2;		break;
+	case cmdGdiSetTransColor:	pds->clrTrans = pprm2a->valA2;	break;
+	case cmdGdiSetIntensity:	pds->ity = pprm1a1b->valB1;		break;
+	case cmdGdiSetPen:			pds->pen = pprm1a1b->valB1;		break;
+	case cmdGdiSetBkMode:		pds->bk = pprm1a1b->valB1;		break;
+	case cmdGdiSetDrwRop:		pds->drw = pprm1a1b->valB1;		break;
+	case cmdGdiSetBrush:		pds->hbr = pprm2a->valA2;		break;
+
+	case cmdGdiGetFgColor:		EmuRetA(staCmdSuccess, pds->clrFg, 0, 0, 0);	break;
+	case cmdGdiGetBgColor:		EmuRetA(staCmdSuccess, pds->clrBg, 0, 0, 0);	break;
+	case cmdGdiGetTransColor:	EmuRetA(staCmdSuccess, pds->clrTrans, 0, 0, 0);	break;
+	case cmdGdiGetIntensity:	EmuRetB(staCmdSuccess, pds->ity, 0, 0, 0);		break;
+	case cmdGdiGetPen:			EmuRetB(staCmdSuccess, pds->pen, 0, 0, 0);		break;
+	case cmdGdiGetBkMode:		EmuRetB(staCmdSuccess, pds->bk, 0, 0, 0);		break;
+	case cmdGdiGetDrwRop:		EmuRetB(staCmdSuccess, pds->drw, 0, 0, 0);		break;
+	case cmdGdiGetBrush:		EmuRetA(staCmdSuccess, pds->hbr, 0, 0, 0);		break;
+	case cmdGdiGetFont:			EmuRetA(staCmdSuccess, pds->hfnt, 0, 0, 0);		break;
+	case cmdGdiGetDrawingSurface: EmuRetA(staCmdSuccess, pds->hbmp, 0, 0, 0);	break;
+	case cmdGdiGetCurPos:		EmuRetB(staCmdSuccess, pds->xcoCur, pds->ycoCur, 0, 0); break;
+
+	case cmdGdiSetFont:
+		if (((pprm2a->valA2 & 0xFFF00000) != sigHfnt + sigHfntStock) ||
+			((pprm2a->valA2 & 0xFFFF) >= cfntEmuStock)) {
+			EmuRet(staGdiInvalidFont, 0, 0);
+			break;
+		}
+		pds->hfnt = pprm2a->valA2;
+		break;
+
+	case cmdGdiSetDrawingSurface:
+		if (PbmpEmu(pprm2a->valA2) == 0) {
+			EmuRet(staGdiInvalidBitmap, 0, 0);
+			break;
+		}
+		pds->hbmp = pprm2a->valA2;
+		break;
+
+	case cmdGdiSetPixel:
+		EmuPlot(pbmp, ((PRM2A2B *)pbPrm)->valB1, ((PRM2A2B *)pbPrm)->valB2, Clr565(pprm2a->valA2), drwCopyPen);
+		break;
+
+	case cmdGdiGetPixel:
+		if (((int16_t)((PRM1A2B *)pbPrm)->valB1 < 0) || ((int16_t)((PRM1A2B *)pbPrm)->valB1 >= pbmp->dxco) ||
+			((int16_t)((PRM1A2B *)pbPrm)->valB2 < 0) || ((int16_t)((PRM1A2B *)pbPrm)->valB2 >= pbmp->dyco)) {
+			EmuRet(staGdiBadParameter, 0, 0);
+			break;
+		}
+		clr = pbmp->vclr[((PRM1A2B *)pbPrm)->valB2 * pbmp->dxco + ((PRM1A2B *)pbPrm)->valB1];
+		EmuRetA(staCmdSuccess, ClrRgb(clr), 0, 0, 0);
+		break;
+
+	case cmdGdiMoveTo:
+		pds->xcoCur = ((PRM1A2B *)pbPrm)->valB1;
+		pds->ycoCur = ((PRM1A2B *)pbPrm)->valB2;
+		break;
+
+	case cmdGdiLine:
+	case cmdGdiLineTo:
+		EmuLine(pds, pbmp, pds->xcoCur, pds->ycoCur,
+					(int16_t)((PRM1A2B *)pbPrm)->valB1, (int16_t)((PRM1A2B *)pbPrm)->valB2, &ipx);
+		if (cmd == cmdGdiLineTo) {
+			pds->xcoCur = ((PRM1A2B *)pbPrm)->valB1;
+			pds->ycoCur = ((PRM1A2B *)pbPrm)->valB2;
+		}
+		break;
+
+	case cmdGdiPolyLine:
+	case cmdGdiPolyLineTo:
+		rgpnt = (PNT *)pbData;
+		if (pprm1a1b->valB1 == 0) {
+			break;
+		}
+		if (cmd == cmdGdiPolyLineTo) {
+			EmuLine(pds, pbmp, pds->xcoCur, pds->ycoCur, rgpnt[0].xco, rgpnt[0].yco, &ipx);
+		}
+		for (ipnt = 1; ipnt < pprm1a1b->valB1; ipnt++) {
+			EmuLine(pds, pbmp, rgpnt[ipnt-1].xco, rgpnt[ipnt-1].yco, rgpnt[ipnt].xco, rgpnt[ipnt].yco, &ipx);
+		}
+		if (cmd == cmdGdiPolyLineTo) {
+			pds->xcoCur = rgpnt[pprm1a1b->valB1-1].xco;
+			pds->ycoCur = rgpnt[pprm1a1b->valB1-1].yco;
+		}
+		break;
+
+	case cmdGdiRectangle:
+	case cmdGdiRoundRect:
+		EmuRectangle(pds, pbmp, pprm1a4b);
+		break;
+
+	case cmdGdiEllipse:
+		memcpy(&prm8b, pbPrm, sizeof(PRM1A4B));
+		EmuEllipse(pds, pbmp, &prm8b, false);
+		break;
+
+	case cmdGdiArc:
+	case cmdGdiArcTo:
+	case cmdGdiChord:
+	case cmdGdiPie:
+		memcpy(&prm8b, pbPrm, sizeof(PRM1A8B));
+		EmuEllipse(pds, pbmp, &prm8b, true);
+		break;
+
+	case cmdGdiFrameRect:
+		EmuLine(pds, pbmp, (int16_t)pprm1a4b->valB1, (int16_t)pprm1a4b->valB2,
+					(int16_t)pprm1a4b->valB3 - 1, (int16_t)pprm1a4b->valB2, &ipx);
+		EmuLine(pds, pbmp, (int16_t)pprm1a4b->valB3 - 1, (int16_t)pprm1a4b->valB2,
+					(int16_t)pprm1a4b->valB3 - 1, (int16_t)pprm1a4b->valB4 - 1, &ipx);
+		EmuLine(pds, pbmp, (int16_t)pprm1a4b->valB3 - 1, (int16_t)pprm1a4b->valB4 - 1,
+					(int16_t)pprm1a4b->valB1, (int16_t)pprm1a4b->valB4 - 1, &ipx);
+		EmuLine(pds, pbmp, (int16_t)pprm1a4b->valB1, (int16_t)pprm1a4b->valB4 - 1,
+					(int16_t)pprm1a4b->valB1, (int16_t)pprm1a4b->valB2, &ipx);
+		break;
+
+	case cmdGdiFillRect:
+		if (FEmuBrushColor(((PRM1A4B1A *)pbPrm)->valA2, &clr)) {
+			EmuFill(pbmp, (int16_t)pprm1a4b->valB1, (int16_t)pprm1a4b->valB2,
+						(int16_t)pprm1a4b->valB3, (int16_t)pprm1a4b->valB4, clr);
+		}
+		break;
+
+	case cmdGdiInvertRect:
+		EmuBlt(pds, (int16_t)pprm1a4b->valB1, (int16_t)pprm1a4b->valB2,
+				(int16_t)pprm1a4b->valB3 - (int16_t)pprm1a4b->valB1,
+				(int16_t)pprm1a4b->valB4 - (int16_t)pprm1a4b->valB2, 0, 0, 0, ropDstNot, false);
+		break;
+
+	case cmdGdiTextOutCch:
+		EmuText(pds, pbmp, pds->xcoCur, pds->ycoCur, pbData, pprm1a1b->valB1, true);
+		break;
+
+	case cmdGdiTextOutXcoYco:
+		EmuText(pds, pbmp, (int16_t)((PRM1A3B *)pbPrm)->valB1, (int16_t)((PRM1A3B *)pbPrm)->valB2,
+					pbData, ((PRM1A3B *)pbPrm)->valB3, false);
+		break;
+
+	case cmdGdiGetTextExtent:
+		ifnt = pds->hfnt & 0xFFFF;
+		EmuRetB(staCmdSuccess, pprm1a1b->valB1 * rgdxcoEmuFont[ifnt], rgdycoEmuFont[ifnt], 0, 0);
+		break;
+
+	case cmdGdiBitBlt:
+	case cmdGdiDrawBitmap:
+		if ((pdsSrc = PdsEmu(((PRM1A4B1A3B *)pbPrm)->valA2)) == 0) {
+			EmuRet(staGdiInvalidDs, 0, 0);
+			break;
+		}
+		EmuBlt(pds, (int16_t)pprm1a4b->valB1, (int16_t)pprm1a4b->valB2,
+				(int16_t)pprm1a4b->valB3, (int16_t)pprm1a4b->valB4, pdsSrc,
+				(int16_t)((PRM1A4B1A3B *)pbPrm)->valB5, (int16_t)((PRM1A4B1A3B *)pbPrm)->valB6,
+				(cmd == cmdGdiBitBlt) ? ((PRM1A4B1A3B *)pbPrm)->valB7 : ropSrc, cmd == cmdGdiDrawBitmap);
+		break;
+
+	case cmdGdiPatBlt:
+		EmuBlt(pds, (int16_t)pprm1a4b->valB1, (int16_t)pprm1a4b->valB2,
+				(int16_t)pprm1a4b->valB3, (int16_t)pprm1a4b->valB4, 0, 0, 0,
+				((PRM1A5B *)pbPrm)->valB5, false);
+		break;
+
+	default:
+		EmuRet(staCmdNotSupported, 0, 0);
+		break;
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuExecWin(cmd, pbPrm)
+**
+**	Parameters:
+**		cmd			- command code
+**		pbPrm		- command parameters
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Windows are not modeled. Creation hands out unique handles,
+**		BeginUpdate hands out the display DS and everything else
+**		succeeds without doing anything.
+*/
+
+static void EmuExecWin(uint8_t cmd, uint8_t * pbPrm) {
+
+	(void)pbPrm;
+
+	switch (cmd) {
+	case cmdWinCreateWindow:
+		EmuRetA(staCmdSuccess, sigHwin + hwinEmuNext++, 0, 0, 0);
+		break;
+
+	case cmdWinBeginUpdate:
+	case cmdWinBeginNcUpdate:
+		EmuRetA(staCmdSuccess, vdsEmu.empty() ? 0 : sigHds + 1, 0, 0, 0);
+		break;
+
+	case cmdWinGetWindowTitle:
+	case cmdWinGetWindowString:
+		EmuRet(staWinNoString, 0, 0);
+		break;
+
+	default:
+		EmuRetA(staCmdSuccess, 0, 0, 0, 0);
+		break;
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuExecFs(cmd, pbPrm, pbData, cbData)
+**
+**	Parameters:
+**		cmd			- command code
+**		pbPrm		- command parameters
+**		pbData		- data-out bytes
+**		cbData		- number of data-out bytes
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Execute a file system class command against the files kept in
+**		host memory. There are no directories, so a name is just a key.
+*/
+
+static void EmuExecFs(uint8_t cmd, uint8_t * pbPrm, uint8_t * pbData, uint32_t cbData) {
+	PRM2A *		pprm = (PRM2A *)pbPrm;
+	EMUFIL *	pfil;
+	EMUFIL		fil;
+	EMUFILE		file;
+	uint32_t	ixh;
+	uint32_t	cb;
+	int			ifile;
+
+	if (cmd == cmdFsOpen) {
+		if ((cbData == 0) || (pbData[cbData - 1] != 0) || (cbData > sizeof(file.szName))) {
+			EmuRet(staFsInvalidName, 0, 0);
+			return;
+		}
+
+		for (ifile = 0; ifile < (int)vfileEmu.size(); ifile++) {
+			if (strcmp(vfileEmu[ifile].szName, (char *)pbData) == 0) {
+				break;
+			}
+		}
+
+		fil.md = ((PRM2B *)pbPrm)->valB2;
+		if (ifile == (int)vfileEmu.size()) {
+			if ((fil.md & (mdMtdsCreateNew|mdMtdsCreateAlways|mdMtdsOpenAlways)) == 0) {
+				EmuRet(staFsFileNotFound, 0, 0);
+				return;
+			}
+			strcpy(file.szName, (char *)pbData);
+			vfileEmu.push_back(file);
+		}
+		else if ((fil.md & mdMtdsCreateNew) != 0) {
+			EmuRet(staFsExist, 0, 0);
+			return;
+		}
+		else if ((fil.md & mdMtdsCreateAlways) != 0) {
+			vfileEmu[ifile].vb.clear();
+		}
+
+		fil.fUsed = true;
+		fil.ifile = ifile;
+		fil.ib = 0;
+		for (ixh = 0; (ixh < vfilEmu.size()) && vfilEmu[ixh].fUsed; ixh++) {
+		}
+		if (ixh == vfilEmu.size()) {
+			vfilEmu.push_back(fil);
+		}
+		else {
+			vfilEmu[ixh] = fil;
+		}
+		EmuRetA(staCmdSuccess, sigHfile + ixh + 1, 0, 0, 0);
+		return;
+	}
+
+	switch (cmd) {
+	case cmdFsClose:
+	case cmdFsSync:
+	case cmdFsRead:
+	case cmdFsWrite:
+	case cmdFsSeek:
+	case cmdFsTell:
+	case cmdFsSize:
+	case cmdFsFeof:
+	case cmdFsErr:
+		break;
+	default:
+		EmuRet(staFsNotEnabled, 0, 0);
+		return;
+	}
+
+	/* The rest all take a file handle as the first parameter.
+	*/
+	ixh = ixhEmu(pprm->valA1);
+	if (((pprm->valA1 & 0xFF000000) != sigHfile) || (ixh >= vfilEmu.size()) || !vfilEmu[ixh].fUsed) {
+		EmuRet(staFsInvalidHandle, 0, 0);
+		return;
+	}
+	pfil = &vfilEmu[ixh];
+	std::vector<uint8_t> &	vb = vfileEmu[pfil->ifile].vb;
+
+	switch (cmd) {
+	case cmdFsClose:
+		pfil->fUsed = false;
+		EmuRet(staCmdSuccess, 0, 0);
+		break;
+
+	case cmdFsSync:
+		EmuRet(staCmdSuccess, 0, 0);
+		break;
+
+	case cmdFsRead:
+		if ((pfil->md & mdMtdsRead) == 0) {
+			EmuRet(staFsAccessDenied, 0, 0);
+			break;
+		}
+		cb = pprm->valA2;
+		if (pfil->ib > vb.size()) {
+			cb = 0;
+		}
+		else if (cb > vb.size() - pfil->ib) {
+			cb = vb.size() - pfil->ib;
+		}
+		EmuQueueDataIn(cmd, (cb != 0) ? &vb[pfil->ib] : 0, cb);
+		pfil->ib += cb;
+		EmuRetA(staCmdSuccess, cb, 0, 0, 0);
+		break;
+
+	case cmdFsWrite:
+		if ((pfil->md & mdMtdsWrite) == 0) {
+			EmuRet(staFsAccessDenied, 0, 0);
+			break;
+		}
+		if (cbData != 0) {
+			if (pfil->ib + cbData > vb.size()) {
+				vb.resize(pfil->ib + cbData);
+			}
+			memcpy(&vb[0] + pfil->ib, pbData, cbData);
+			pfil->ib += cbData;
+		}
+		EmuRetA(staCmdSuccess, cbData, 0, 0, 0);
+		break;
+
+	case cmdFsSeek:
+		pfil->ib = pprm->valA2;
+		EmuRet(staCmdSuccess, 0, 0);
+		break;
+
+	case cmdFsTell:
+		EmuRetA(staCmdSuccess, pfil->ib, 0, 0, 0);
+		break;
+
+	case cmdFsSize:
+		EmuRetA(staCmdSuccess, vb.size(), 0, 0, 0);
+		break;
+
+	case cmdFsFeof:
+		EmuRetB(staCmdSuccess, (pfil->ib >= vb.size()) ? 1 : 0, 0, 0, 0);
+		break;
+
+	case cmdFsErr:
+		EmuRetB(staCmdSuccess, 0, 0, 0, 0);
+		break;
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuRet(sta, pvRet, cbRet)
+**
+**	Parameters:
+**		sta			- status code
+**		pvRet		- return value bytes
+**		cbRet		- number of return value bytes
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Fill in the status packet for the current command.
+*/
+
+static void EmuRet(uint8_t sta, const void * pvRet, uint8_t cbRet) {
+
+	((RHDR *)rgbEmuSta)->sta = sta;
+	((RHDR *)rgbEmuSta)->cb = cbRet;
+	if (cbRet > 0) {
+		memcpy(&rgbEmuSta[sizeof(RHDR)], pvRet, cbRet);
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuRetA(sta, valA1, valA2, valA3, valA4)
+**
+**	Parameters:
+**		sta			- status code
+**		valA1..4	- 32 bit return values
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Fill in a status packet carrying a RET4A.
+*/
+
+static void EmuRetA(uint8_t sta, uint32_t valA1, uint32_t valA2, uint32_t valA3, uint32_t valA4) {
+	RET4A	ret;
+
+	ret.valA1 = valA1;
+	ret.valA2 = valA2;
+	ret.valA3 = valA3;
+	ret.valA4 = valA4;
+	EmuRet(sta, &ret, sizeof(ret));
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuRetB(sta, valB1, valB2, valB3, valB4)
+**
+**	Parameters:
+**		sta			- status code
+**		valB1..4	- 16 bit return values
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Fill in a status packet carrying a RET4B.
+*/
+
+static void EmuRetB(uint8_t sta, uint16_t valB1, uint16_t valB2, uint16_t valB3, uint16_t valB4) {
+	RET4B	ret;
+
+	ret.valB1 = valB1;
+	ret.valB2 = valB2;
+	ret.valB3 = valB3;
+	ret.valB4 = valB4;
+	EmuRet(sta, &ret, sizeof(ret));
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuQueueDataIn(cmd, pb, cb)
+**
+**	Parameters:
+**		cmd			- command code for the packet headers
+**		pb			- data to send
+**		cb			- number of bytes to send
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Split the data into data-in packets and queue them for the
+**		host to read.
+*/
+
+static void EmuQueueDataIn(uint8_t cmd, const uint8_t * pb, uint32_t cb) {
+	DHDR		dhdr;
+	uint32_t	cbCur;
+
+	while (cb > 0) {
+		cbCur = (cb > cbDhdrDataInMax) ? cbDhdrDataInMax : cb;
+		dhdr.cls = clsDataIn;
+		dhdr.cmd = cmd;
+		dhdr.cb = cbCur;
+		vbEmuTx.insert(vbEmuTx.end(), (uint8_t *)&dhdr, (uint8_t *)&dhdr + sizeof(dhdr));
+		vbEmuTx.insert(vbEmuTx.end(), pb, pb + cbCur);
+		statEmu.cpktIn += 1;
+		pb += cbCur;
+		cb -= cbCur;
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	Clr565(clr)
+**
+**	Parameters:
+**		clr		- 24 bit RGB color
+**
+**	Return Values:
+**		Returns the RGB565 color
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Convert a library color to the frame buffer format.
+*/
+
+static uint16_t Clr565(uint32_t clr) {
+
+	return ((GetRed(clr) >> 3) << 11) | ((GetGreen(clr) >> 2) << 5) | (GetBlue(clr) >> 3);
+}
+
+/* ------------------------------------------------------------ */
+/***	ClrRgb(clr)
+**
+**	Parameters:
+**		clr		- RGB565 color
+**
+**	Return Values:
+**		Returns the 24 bit RGB color
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Convert a frame buffer color back to a library color.
+*/
+
+static uint32_t ClrRgb(uint16_t clr) {
+	uint32_t	r = (clr >> 11) & 0x1F;
+	uint32_t	g = (clr >> 5) & 0x3F;
+	uint32_t	b = clr & 0x1F;
+
+	return COLOR((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+/* ------------------------------------------------------------ */
+/***	PdsEmu(hds)
+**
+**	Parameters:
+**		hds		- DS handle
+**
+**	Return Values:
+**		Returns the DS, or 0 if the handle is not valid
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Look up a drawing surface.
+*/
+
+static EMUDS * PdsEmu(HDS hds) {
+
+	if (((hds & 0xFF000000) != sigHds) || (ixhEmu(hds) >= vdsEmu.size()) || !vdsEmu[ixhEmu(hds)].fUsed) {
+		return 0;
+	}
+	return &vdsEmu[ixhEmu(hds)];
+}
+
+/* ------------------------------------------------------------ */
+/***	PbmpEmu(hbmp)
+**
+**	Parameters:
+**		hbmp	- bitmap handle
+**
+**	Return Values:
+**		Returns the bitmap, or 0 if the handle is not valid
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Look up a bitmap. The display is the stock bitmap 0.
+*/
+
+static EMUBMP * PbmpEmu(HBMP hbmp) {
+
+	if (hbmp == sigHbmp + sigHbmpStock) {
+		return &bmpEmuDisplay;
+	}
+	if (((hbmp & 0xFFF00000) != sigHbmp) || (ixhEmu(hbmp) >= vbmpEmu.size()) || !vbmpEmu[ixhEmu(hbmp)].fUsed) {
+		return 0;
+	}
+	return &vbmpEmu[ixhEmu(hbmp)];
+}
+
+/* ------------------------------------------------------------ */
+/***	FEmuBrushColor(hbr, pclr)
+**
+**	Parameters:
+**		hbr		- brush handle
+**		pclr	- receives the RGB565 brush color
+**
+**	Return Values:
+**		Returns false for the null brush or an invalid handle
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Get the fill color of a brush.
+*/
+
+static bool FEmuBrushColor(HBR hbr, uint16_t * pclr) {
+
+	if ((hbr & 0xFFF00000) == sigHbr + sigHbrStock) {
+		if (((hbr & 0xFFFF) == 0) || ((hbr & 0xFFFF) >= sizeof(rgclrEmuStockBr) / sizeof(uint32_t))) {
+			return false;
+		}
+		*pclr = Clr565(rgclrEmuStockBr[hbr & 0xFFFF]);
+		return true;
+	}
+	if (((hbr & 0xFFF00000) != sigHbr) || (ixhEmu(hbr) >= vbrEmu.size()) || !vbrEmu[ixhEmu(hbr)].fUsed) {
+		return false;
+	}
+	*pclr = Clr565(vbrEmu[ixhEmu(hbr)].clr);
+	return true;
+}
+
+/* ------------------------------------------------------------ */
+/***	PmemEmu(hmem)
+**
+**	Parameters:
+**		hmem	- memory handle
+**
+**	Return Values:
+**		Returns the memory block, or 0 if the handle is not valid
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Look up a memory block.
+*/
+
+static EMUMEM * PmemEmu(HMEM hmem) {
+
+	if (((hmem & 0xFF000000) != sigHmem) || (ixhEmu(hmem) >= vmemEmu.size()) || !vmemEmu[ixhEmu(hmem)].fUsed) {
+		return 0;
+	}
+	return &vmemEmu[ixhEmu(hmem)];
+}
+
+/* ------------------------------------------------------------ */
+/***	HbmpEmuNew(dxco, dyco, cbpp)
+**
+**	Parameters:
+**		dxco		- width
+**		dyco		- height
+**		cbpp		- bits per pixel
+**
+**	Return Values:
+**		Returns the bitmap handle, or 0 if out of memory
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Allocate a bitmap from the emulated heap. Pixels are always
+**		stored as RGB565 but charged at the requested depth.
+*/
+
+static HBMP HbmpEmuNew(int16_t dxco, int16_t dyco, int16_t cbpp) {
+	uint32_t	cb;
+	uint32_t	ibmp;
+
+	if ((dxco <= 0) || (dyco <= 0)) {
+		return 0;
+	}
+	cb = (uint32_t)dxco * dyco * ((cbpp > 16) ? 3 : 2);
+	if (cb > cbEmuHeap - cbEmuHeapUsed) {
+		return 0;
+	}
+	for (ibmp = 0; ibmp < vbmpEmu.size(); ibmp++) {
+		if (!vbmpEmu[ibmp].fUsed) {
+			break;
+		}
+	}
+	if (ibmp == vbmpEmu.size()) {
+		vbmpEmu.resize(ibmp + 1);
+	}
+	vbmpEmu[ibmp].fUsed = true;
+	vbmpEmu[ibmp].dxco = dxco;
+	vbmpEmu[ibmp].dyco = dyco;
+	vbmpEmu[ibmp].cbpp = cbpp;
+	vbmpEmu[ibmp].vclr.assign((uint32_t)dxco * dyco, 0);
+	cbEmuHeapUsed += cb;
+
+	return sigHbmp + ibmp + 1;
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuFreeBmp(hbmp)
+**
+**	Parameters:
+**		hbmp	- bitmap handle, already checked
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Return a bitmap's memory to the emulated heap.
+*/
+
+static void EmuFreeBmp(HBMP hbmp) {
+	EMUBMP *	pbmp = &vbmpEmu[ixhEmu(hbmp)];
+
+	cbEmuHeapUsed -= (uint32_t)pbmp->dxco * pbmp->dyco * ((pbmp->cbpp > 16) ? 3 : 2);
+	pbmp->vclr.clear();
+	pbmp->fUsed = false;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuPlot(pbmp, xco, yco, clr, drw)
+**
+**	Parameters:
+**		pbmp		- destination bitmap
+**		xco, yco	- pixel position
+**		clr			- RGB565 pen color
+**		drw			- drawing rop, drwBlack..drwWhite
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Combine one pixel with the destination. The drawing rop is the
+**		truth table of pen and destination: bit (2*P + D) of drw is the
+**		result, applied bitwise across the pixel.
+*/
+
+static void EmuPlot(EMUBMP * pbmp, int xco, int yco, uint16_t clr, uint16_t drw) {
+	uint16_t *	pclr;
+	uint16_t	clrRes;
+
+	if ((xco < 0) || (yco < 0) || (xco >= pbmp->dxco) || (yco >= pbmp->dyco)) {
+		return;
+	}
+	pclr = &pbmp->vclr[yco * pbmp->dxco + xco];
+	if (drw == drwCopyPen) {
+		*pclr = clr;
+		return;
+	}
+	clrRes = 0;
+	if (drw & 1) clrRes |= ~clr & ~*pclr;
+	if (drw & 2) clrRes |= ~clr &  *pclr;
+	if (drw & 4) clrRes |=  clr & ~*pclr;
+	if (drw & 8) clrRes |=  clr &  *pclr;
+	*pclr = clrRes;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuPenPixel(pds, pbmp, xco, yco, pipx)
+**
+**	Parameters:
+**		pds			- drawing surface
+**		pbmp		- its bitmap
+**		xco, yco	- pixel position
+**		pipx		- position along the line, advanced
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Draw one pixel of a line with the DS pen. Pen pattern bits that
+**		are set draw the foreground color, clear bits draw the
+**		background color in opaque mode and nothing in transparent mode.
+*/
+
+static void EmuPenPixel(EMUDS * pds, EMUBMP * pbmp, int xco, int yco, int * pipx) {
+
+	if (pds->pen == penNull) {
+		return;
+	}
+	if (pds->pen & (0x8000 >> (*pipx & 15))) {
+		EmuPlot(pbmp, xco, yco, Clr565(pds->clrFg), pds->drw);
+	}
+	else if (pds->bk == bkOpaque) {
+		EmuPlot(pbmp, xco, yco, Clr565(pds->clrBg), pds->drw);
+	}
+	*pipx += 1;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuLine(pds, pbmp, xco1, yco1, xco2, yco2, pipx)
+**
+**	Parameters:
+**		pds				- drawing surface
+**		pbmp			- its bitmap
+**		xco1, yco1		- start point, drawn
+**		xco2, yco2		- end point, not drawn
+**		pipx			- pen pattern position, advanced
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Bresenham line in the DS pen.
+*/
+
+static void EmuLine(EMUDS * pds, EMUBMP * pbmp, int xco1, int yco1, int xco2, int yco2, int * pipx) {
+	int		dx = abs(xco2 - xco1);
+	int		dy = -abs(yco2 - yco1);
+	int		sx = (xco1 < xco2) ? 1 : -1;
+	int		sy = (yco1 < yco2) ? 1 : -1;
+	int		err = dx + dy;
+
+	while ((xco1 != xco2) || (yco1 != yco2)) {
+		EmuPenPixel(pds, pbmp, xco1, yco1, pipx);
+		if (2*err >= dy) {
+			err += dy;
+			xco1 += sx;
+		}
+		if (2*err <= dx) {
+			err += dx;
+			yco1 += sy;
+		}
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuFill(pbmp, xcoL, ycoT, xcoR, ycoB, clr)
+**
+**	Parameters:
+**		pbmp			- destination bitmap
+**		xcoL, ycoT		- top left, inclusive
+**		xcoR, ycoB		- bottom right, exclusive
+**		clr				- RGB565 fill color
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Fill a clipped rectangle.
+*/
+
+static void EmuFill(EMUBMP * pbmp, int xcoL, int ycoT, int xcoR, int ycoB, uint16_t clr) {
+	int		yco;
+
+	xcoL = (xcoL < 0) ? 0 : xcoL;
+	ycoT = (ycoT < 0) ? 0 : ycoT;
+	xcoR = (xcoR > pbmp->dxco) ? pbmp->dxco : xcoR;
+	ycoB = (ycoB > pbmp->dyco) ? pbmp->dyco : ycoB;
+
+	for (yco = ycoT; yco < ycoB; yco++) {
+		if (xcoL < xcoR) {
+			std::fill(pbmp->vclr.begin() + yco * pbmp->dxco + xcoL,
+					  pbmp->vclr.begin() + yco * pbmp->dxco + xcoR, clr);
+		}
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuRectangle(pds, pbmp, pprm)
+**
+**	Parameters:
+**		pds			- drawing surface
+**		pbmp		- its bitmap
+**		pprm		- HDS and rectangle, right and bottom exclusive
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Fill with the DS brush and outline with the DS pen. RoundRect
+**		is drawn this way too.
+*/
+
+static void EmuRectangle(EMUDS * pds, EMUBMP * pbmp, PRM1A4B * pprm) {
+	int			xcoL = (int16_t)pprm->valB1;
+	int			ycoT = (int16_t)pprm->valB2;
+	int			xcoR = (int16_t)pprm->valB3 - 1;
+	int			ycoB = (int16_t)pprm->valB4 - 1;
+	uint16_t	clr;
+	int			ipx;
+
+	if (FEmuBrushColor(pds->hbr, &clr)) {
+		EmuFill(pbmp, xcoL + 1, ycoT + 1, xcoR, ycoB, clr);
+	}
+	ipx = 0;
+	EmuLine(pds, pbmp, xcoL, ycoT, xcoR, ycoT, &ipx);
+	EmuLine(pds, pbmp, xcoR, ycoT, xcoR, ycoB, &ipx);
+	EmuLine(pds, pbmp, xcoR, ycoB, xcoL, ycoB, &ipx);
+	EmuLine(pds, pbmp, xcoL, ycoB, xcoL, ycoT, &ipx);
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuEllipse(pds, pbmp, pprm, fArc)
+**
+**	Parameters:
+**		pds			- drawing surface
+**		pbmp		- its bitmap
+**		pprm		- HDS, bounding rectangle and the two radial points
+**		fArc		- true to draw only the arc between the radials
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Draw an ellipse filled with the brush, or the outline of an arc
+**		running counterclockwise from the first radial to the second.
+**		Chord, Pie and ArcTo are drawn as arcs, their fills and extra
+**		lines are not modeled.
+*/
+
+static void EmuEllipse(EMUDS * pds, EMUBMP * pbmp, PRM1A8B * pprm, bool fArc) {
+	double		xcoC = ((int16_t)pprm->valB1 + (int16_t)pprm->valB3 - 1) / 2.0;
+	double		ycoC = ((int16_t)pprm->valB2 + (int16_t)pprm->valB4 - 1) / 2.0;
+	double		a = ((int16_t)pprm->valB3 - (int16_t)pprm->valB1 - 1) / 2.0;
+	double		b = ((int16_t)pprm->valB4 - (int16_t)pprm->valB2 - 1) / 2.0;
+	double		ang1 = 0;
+	double		angSpan = 0;
+	double		ang;
+	double		w;
+	int			rgxco[2];
+	int			rgyco[2];
+	int			xco;
+	int			yco;
+	int			ipt;
+	int			ipx;
+	uint16_t	clr;
+	bool		fFill;
+
+	if ((a < 0.5) || (b < 0.5)) {
+		return;
+	}
+	if (fArc) {
+		ang1 = atan2(ycoC - (int16_t)pprm->valB6, (int16_t)pprm->valB5 - xcoC);
+		angSpan = fmod(atan2(ycoC - (int16_t)pprm->valB8, (int16_t)pprm->valB7 - xcoC) - ang1 + 4*M_PI, 2*M_PI);
+	}
+	fFill = !fArc && FEmuBrushColor(pds->hbr, &clr);
+	ipx = 0;
+
+	/* Walk rows for the fill and the flat parts of the outline, then
+	** columns for the steep parts.
+	*/
+	for (yco = (int16_t)pprm->valB2; yco < (int16_t)pprm->valB4; yco++) {
+		w = 1.0 - ((yco - ycoC) * (yco - ycoC)) / (b * b);
+		w = (w > 0) ? a * sqrt(w) : 0;
+		rgxco[0] = (int)floor(xcoC - w + 0.5);
+		rgxco[1] = (int)floor(xcoC + w + 0.5);
+		if (fFill) {
+			EmuFill(pbmp, rgxco[0] + 1, yco, rgxco[1], yco + 1, clr);
+		}
+		for (ipt = 0; ipt < 2; ipt++) {
+			ang = fmod(atan2(ycoC - yco, rgxco[ipt] - xcoC) - ang1 + 4*M_PI, 2*M_PI);
+			if (!fArc || (ang <= angSpan)) {
+				EmuPenPixel(pds, pbmp, rgxco[ipt], yco, &ipx);
+			}
+		}
+	}
+	for (xco = (int16_t)pprm->valB1; xco < (int16_t)pprm->valB3; xco++) {
+		w = 1.0 - ((xco - xcoC) * (xco - xcoC)) / (a * a);
+		w = (w > 0) ? b * sqrt(w) : 0;
+		rgyco[0] = (int)floor(ycoC - w + 0.5);
+		rgyco[1] = (int)floor(ycoC + w + 0.5);
+		for (ipt = 0; ipt < 2; ipt++) {
+			ang = fmod(atan2(ycoC - rgyco[ipt], xco - xcoC) - ang1 + 4*M_PI, 2*M_PI);
+			if (!fArc || (ang <= angSpan)) {
+				EmuPenPixel(pds, pbmp, xco, rgyco[ipt], &ipx);
+			}
+		}
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuText(pds, pbmp, xco, yco, pch, cch, fMove)
+**
+**	Parameters:
+**		pds			- drawing surface
+**		pbmp		- its bitmap
+**		xco, yco	- top left of the first character cell
+**		pch			- characters
+**		cch			- number of characters
+**		fMove		- true to advance the current position
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Draw text with the DS font cell size. The cell background is
+**		filled in opaque mode and each non-blank glyph is a filled box
+**		in the foreground color. '\r' and '\n' move the position.
+*/
+
+static void EmuText(EMUDS * pds, EMUBMP * pbmp, int xco, int yco, const uint8_t * pch, int cch, bool fMove) {
+	int		ifnt = pds->hfnt & 0xFFFF;
+	int		dxco = rgdxcoEmuFont[ifnt];
+	int		dyco = rgdycoEmuFont[ifnt];
+	int		xcoStart = xco;
+	int		ich;
+
+	for (ich = 0; ich < cch; ich++) {
+		if (pch[ich] == '\r') {
+			xco = xcoStart;
+			continue;
+		}
+		if (pch[ich] == '\n') {
+			yco += dyco;
+			continue;
+		}
+		if (pds->bk == bkOpaque) {
+			EmuFill(pbmp, xco, yco, xco + dxco, yco + dyco, Clr565(pds->clrBg));
+		}
+		if (pch[ich] != ' ') {
+			EmuFill(pbmp, xco + 1, yco + dyco/4, xco + dxco - 1, yco + dyco - dyco/8, Clr565(pds->clrFg));
+		}
+		xco += dxco;
+	}
+	if (fMove) {
+		pds->xcoCur = xco;
+		pds->ycoCur = yco;
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	ClrEmuRop(rop, clrS, clrD, clrP, pds)
+**
+**	Parameters:
+**		rop			- raster operation
+**		clrS		- source pixel
+**		clrD		- destination pixel
+**		clrP		- pattern (brush) color
+**		pds			- destination DS, for the fg/bg rops
+**
+**	Return Values:
+**		Returns the resulting RGB565 pixel
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Evaluate one of the rop codes in MtdsDefs.h.
+*/
+
+static uint16_t ClrEmuRop(uint16_t rop, uint16_t clrS, uint16_t clrD, uint16_t clrP, EMUDS * pds) {
+	int		r;
+	int		g;
+	int		b;
+	int		sgn;
+
+	switch (rop & mskRopId) {
+	case 0:		return 0;
+	case 1:		return 0xFFFF;
+	case 2:		return clrS;
+	case 3:		return ~clrS;
+	case 4:		return clrD;
+	case 5:		return ~clrD;
+	case 6:		return clrS & clrD;
+	case 7:		return clrS | clrD;
+	case 8:		return clrS ^ clrD;
+	case 9:		return ~(clrS & clrD);
+	case 10:	return ~(clrS | clrD);
+	case 11:	return ~(clrS ^ clrD);
+	case 12:	return clrS & ~clrD;
+	case 13:	return ~clrS & clrD;
+	case 14:	return clrS | ~clrD;
+	case 15:	return ~clrS | clrD;
+	case 16:	return clrP;
+	case 17:	return ~clrP;
+	case 18:	return clrP & clrD;
+	case 19:	return clrP | clrD;
+	case 20:	return clrP ^ clrD;
+	case 21:	return ~(clrP & clrD);
+	case 22:	return ~(clrP | clrD);
+	case 23:	return ~(clrP ^ clrD);
+	case 24:	return ~clrP & clrD;
+	case 25:	return clrP & ~clrD;
+	case 26:	return ~clrP | clrD;
+	case 27:	return clrP | ~clrD;
+	case 28:	return clrP & clrS;
+	case 29:	return clrP | clrS;
+	case 30:	return clrP ^ clrS;
+	case 31:	return (clrP | ~clrS) | clrD;
+	case 32:	return Clr565(pds->clrFg);
+	case 33:	return Clr565(pds->clrBg);
+	}
+
+	/* Per component add and subtract.
+	*/
+	sgn = ((rop & mskRopId) <= 35) ? 1 : -1;
+	r = ((clrS >> 11) & 0x1F) + sgn * ((clrD >> 11) & 0x1F);
+	g = ((clrS >> 5) & 0x3F) + sgn * ((clrD >> 5) & 0x3F);
+	b = (clrS & 0x1F) + sgn * (clrD & 0x1F);
+	if (((rop & mskRopId) == 35) || ((rop & mskRopId) == 37)) {
+		r = (r < 0) ? 0 : ((r > 0x1F) ? 0x1F : r);
+		g = (g < 0) ? 0 : ((g > 0x3F) ? 0x3F : g);
+		b = (b < 0) ? 0 : ((b > 0x1F) ? 0x1F : b);
+	}
+	return ((r & 0x1F) << 11) | ((g & 0x3F) << 5) | (b & 0x1F);
+}
+
+/* ------------------------------------------------------------ */
+/***	EmuBlt(pdsDst, xco, yco, dxco, dyco, pdsSrc, xcoSrc, ycoSrc, rop, fDraw)
+**
+**	Parameters:
+**		pdsDst			- destination DS
+**		xco, yco		- destination position
+**		dxco, dyco		- size
+**		pdsSrc			- source DS, 0 if the rop has no source
+**		xcoSrc, ycoSrc	- source position
+**		rop				- raster operation
+**		fDraw			- true for DrawBitmap semantics
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Common code for BitBlt, PatBlt, InvertRect and DrawBitmap. The
+**		source is copied out first so overlapping blits on one bitmap
+**		behave. DrawBitmap skips pixels matching the destination DS
+**		transparent color in transparent mode and scales the rest by
+**		the DS intensity.
+*/
+
+static void EmuBlt(EMUDS * pdsDst, int xco, int yco, int dxco, int dyco, EMUDS * pdsSrc,
+						int xcoSrc, int ycoSrc, uint16_t rop, bool fDraw) {
+	EMUBMP *	pbmpDst = PbmpEmu(pdsDst->hbmp);
+	EMUBMP *	pbmpSrc = (pdsSrc != 0) ? PbmpEmu(pdsSrc->hbmp) : 0;
+	std::vector<uint16_t>	vclrSrc;
+	uint16_t	clrP;
+	uint16_t	clrS;
+	uint16_t	clrTrans;
+	uint16_t *	pclrD;
+	int			xcoCur;
+	int			ycoCur;
+	int			dx;
+	int			dy;
+
+	if ((pbmpDst == 0) || (dxco <= 0) || (dyco <= 0)) {
+		return;
+	}
+	if (!FEmuBrushColor(pdsDst->hbr, &clrP)) {
+		clrP = 0;
+	}
+	clrTrans = Clr565(pdsDst->clrTrans);
+
+	if (pbmpSrc != 0) {
+		vclrSrc.resize(dxco * dyco);
+		for (dy = 0; dy < dyco; dy++) {
+			for (dx = 0; dx < dxco; dx++) {
+				xcoCur = xcoSrc + dx;
+				ycoCur = ycoSrc + dy;
+				vclrSrc[dy * dxco + dx] = ((xcoCur >= 0) && (ycoCur >= 0) && (xcoCur < pbmpSrc->dxco) &&
+						(ycoCur < pbmpSrc->dyco)) ? pbmpSrc->vclr[ycoCur * pbmpSrc->dxco + xcoCur] : 0;
+			}
+		}
+	}
+
+	for (dy = 0; dy < dyco; dy++) {
+		ycoCur = yco + dy;
+		if ((ycoCur < 0) || (ycoCur >= pbmpDst->dyco)) {
+			continue;
+		}
+		for (dx = 0; dx < dxco; dx++) {
+			xcoCur = xco + dx;
+			if ((xcoCur < 0) || (xcoCur >= pbmpDst->dxco)) {
+				continue;
+			}
+			pclrD = &pbmpDst->vclr[ycoCur * pbmpDst->dxco + xcoCur];
+			clrS = (pbmpSrc != 0) ? vclrSrc[dy * dxco + dx] : 0;
+			if (fDraw) {
+				if ((pdsDst->bk == bkTransparent) && (clrS == clrTrans)) {
+					continue;
+				}
+				if (pdsDst->ity < 100) {
+					clrS = ((((clrS >> 11) & 0x1F) * pdsDst->ity / 100) << 11) |
+						   ((((clrS >> 5) & 0x3F) * pdsDst->ity / 100) << 5) |
+						   (((clrS & 0x1F) * pdsDst->ity / 100));
+				}
+				*pclrD = clrS;
+			}
+			else {
+				*pclrD = ClrEmuRop(rop, clrS, *pclrD, clrP, pdsDst);
+			}
+		}
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	StaEmuLoadBitmap(szName, phbmp)
+**
+**	Parameters:
+**		szName		- file name sent by the host
+**		phbmp		- receives the new bitmap handle
+**
+**	Return Values:
+**		Returns the command status
+**
+**	Errors:
+**		staGdiFileNotFound, staGdiFormatNotSupported, staCmdOutOfMemory
+**
+**	Description:
+**		Load an uncompressed 16 bit (555 or 565) or 24 bit .bmp file
+**		from the resource directory. The name is tried as given below
+**		the directory and then with any path stripped.
+*/
+
+static uint8_t StaEmuLoadBitmap(const char * szName, HBMP * phbmp) {
+	char		szPath[512];
+	const char *	szBase;
+	FILE *		pfl;
+	uint8_t		rgbHdr[66];
+	std::vector<uint8_t>	vbRow;
+	EMUBMP *	pbmp;
+	uint32_t	ibBits;
+	int32_t		dxco;
+	int32_t		dyco;
+	uint16_t	cbpp;
+	uint32_t	cmpr;
+	uint32_t	cbRow;
+	bool		f565;
+	uint16_t	clr;
+	int			yco;
+	int			xco;
+
+	*phbmp = 0;
+	while ((*szName == '/') || (*szName == '\\')) {
+		szName++;
+	}
+	snprintf(szPath, sizeof(szPath), "%s/%s", szEmuResDir, szName);
+	if ((pfl = fopen(szPath, "rb")) == 0) {
+		szBase = strrchr(szName, '/');
+		if (szBase == 0) {
+			szBase = strrchr(szName, '\\');
+		}
+		if (szBase == 0) {
+			return staGdiFileNotFound;
+		}
+		snprintf(szPath, sizeof(szPath), "%s/%s", szEmuResDir, szBase + 1);
+		if ((pfl = fopen(szPath, "rb")) == 0) {
+			return staGdiFileNotFound;
+		}
+	}
+
+	if ((fread(rgbHdr, 1, sizeof(rgbHdr), pfl) < 54) || (rgbHdr[0] != 'B') || (rgbHdr[1] != 'M')) {
+		fclose(pfl);
+		return staGdiFormatNotSupported;
+	}
+	memcpy(&ibBits, &rgbHdr[10], 4);
+	memcpy(&dxco, &rgbHdr[18], 4);
+	memcpy(&dyco, &rgbHdr[22], 4);
+	memcpy(&cbpp, &rgbHdr[28], 2);
+	memcpy(&cmpr, &rgbHdr[30], 4);
+
+	/* BI_BITFIELDS 16 bit files carry their masks after the header;
+	** a green mask of 0x07E0 means 565, anything else is taken as 555.
+	*/
+	f565 = (cbpp == 16) && (cmpr == 3) && (rgbHdr[58] == 0xE0) && (rgbHdr[59] == 0x07);
+	if (((cbpp != 16) && (cbpp != 24)) || ((cmpr != 0) && (cmpr != 3)) ||
+		(dxco <= 0) || (dyco == 0) || (dxco > 0x7FFF) || (abs(dyco) > 0x7FFF)) {
+		fclose(pfl);
+		return staGdiFormatNotSupported;
+	}
+
+	if ((*phbmp = HbmpEmuNew(dxco, abs(dyco), 16)) == 0) {
+		fclose(pfl);
+		return staCmdOutOfMemory;
+	}
+	pbmp = PbmpEmu(*phbmp);
+
+	cbRow = ((dxco * cbpp / 8) + 3) & ~3;
+	vbRow.resize(cbRow);
+	fseek(pfl, ibBits, SEEK_SET);
+	for (yco = 0; yco < abs(dyco); yco++) {
+		if (fread(vbRow.data(), 1, cbRow, pfl) != cbRow) {
+			break;
+		}
+		for (xco = 0; xco < dxco; xco++) {
+			if (cbpp == 24) {
+				clr = Clr565(COLOR(vbRow[3*xco+2], vbRow[3*xco+1], vbRow[3*xco]));
+			}
+			else {
+				clr = vbRow[2*xco] | (vbRow[2*xco+1] << 8);
+				if (!f565) {
+					clr = ((clr & 0x7FE0) << 1) | ((clr & 0x0200) >> 4) | (clr & 0x001F);
+				}
+			}
+			pbmp->vclr[((dyco > 0) ? (dyco - 1 - yco) : yco) * dxco + xco] = clr;
+		}
+	}
+	fclose(pfl);
+
+	return staCmdSuccess;
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsEmuGetStatusPin(idPin)
+**
+**	Parameters:
+**		idPin		- status pin
+**
+**	Return Values:
+**		Returns the pin state
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		The touch message status pin (idPinStatusA) is at stMtdsMsgPinActive
+**		while the message queue is not empty. The ready pin (idPinStatusB) is high
+**		whenever the channel is idle. A pin the host has not enabled
+**		reads low.
+*/
+
+bool MtdsEmuGetStatusPin(int idPin) {
+
+	if ((idPin == idPinStatusA) && fEmuPinA) {
+		return vevtEmu.empty() == (stMtdsMsgPinActive == 0);
+	}
+	if ((idPin == idPinStatusB) && fEmuPinB) {
+		return stEmu == stEmuIdle;
+	}
+	return false;
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsEmuPostTouch(msg, xco, yco)
+**
+**	Parameters:
+**		msg			- msgFinger1Down etc.
+**		xco, yco	- touch position
+**
+**	Return Values:
+**		Returns true
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Queue a touch message the way the touch panel task would, so a
+**		benchmark can drive MYDISP::checkTouch().
+*/
+
+bool MtdsEmuPostTouch(uint16_t msg, int16_t xco, int16_t yco) {
+	MEVT	evt;
+	MTCH *	pmtch = (MTCH *)&evt;
+
+	memset(&evt, 0, sizeof(evt));
+	pmtch->tms = MtdsHalTmsElapsed();
+	pmtch->msg = msg;
+	pmtch->xco = xco;
+	pmtch->yco = yco;
+	pmtch->wgt = 1;
+	vevtEmu.push_back(evt);
+
+	return true;
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsEmuAddDelay(tus)
+**
+**	Parameters:
+**		tus		- microseconds the host spent in a HAL delay
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Account host delay time in the statistics.
+*/
+
+void MtdsEmuAddDelay(uint32_t tus) {
+
+	statEmu.tusDelay += tus;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsEmuGetStat(pstat)
+**
+**	Parameters:
+**		pstat		- receives the statistics
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Return the counters accumulated since MtdsEmuClearStat().
+*/
+
+void MtdsEmuGetStat(EMUSTAT * pstat) {
+
+	*pstat = statEmu;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsEmuClearStat()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Reset the wire statistics.
+*/
+
+void MtdsEmuClearStat() {
+
+	memset(&statEmu, 0, sizeof(statEmu));
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsEmuChecksum()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns a checksum of the display frame buffer
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		FNV-1a over the display pixels. Used to check that two ways of
+**		drawing a frame produce the same picture.
+*/
+
+uint32_t MtdsEmuChecksum() {
+	uint32_t	crc = 2166136261u;
+	uint32_t	ipx;
+
+	for (ipx = 0; ipx < bmpEmuDisplay.vclr.size(); ipx++) {
+		crc = (crc ^ (bmpEmuDisplay.vclr[ipx] & 0xFF)) * 16777619u;
+		crc = (crc ^ (bmpEmuDisplay.vclr[ipx] >> 8)) * 16777619u;
+	}
+	return crc;
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsEmuSavePpm(szFile)
+**
+**	Parameters:
+**		szFile		- output file name
+**
+**	Return Values:
+**		Returns true if the file was written
+**
+**	Errors:
+**		Returns false if the file can't be created
+**
+**	Description:
+**		Write the display as a binary PPM (P6). Most image viewers
+**		read it, and `convert frame.ppm frame.png` turns it into a PNG.
+*/
+
+bool MtdsEmuSavePpm(const char * szFile) {
+	FILE *		pfl;
+	uint32_t	ipx;
+	uint32_t	clr;
+	uint8_t		rgb[3];
+
+	if ((pfl = fopen(szFile, "wb")) == 0) {
+		return false;
+	}
+	fprintf(pfl, "P6\n%d %d\n255\n", bmpEmuDisplay.dxco, bmpEmuDisplay.dyco);
+	for (ipx = 0; ipx < bmpEmuDisplay.vclr.size(); ipx++) {
+		clr = ClrRgb(bmpEmuDisplay.vclr[ipx]);
+		rgb[0] = GetRed(clr);
+		rgb[1] = GetGreen(clr);
+		rgb[2] = GetBlue(clr);
+		fwrite(rgb, 1, 3, pfl);
+	}
+	fclose(pfl);
+
+	return true;
+}
+
+/* ------------------------------------------------------------ */
+
+/************************************************************************/
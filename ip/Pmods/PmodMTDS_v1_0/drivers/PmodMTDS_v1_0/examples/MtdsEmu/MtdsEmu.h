@@ -0,0 +1,68 @@
+/************************************************************************/
+/*																		*/
+/*	MtdsEmu.h	--	Host Emulator of the MTDS Shield Side Protocol		*/
+/*																		*/
+/************************************************************************/
+/*  File Description:													*/
+/*																		*/
+/*	Declarations for a host-buildable model of the display shield. It	*/
+/*	answers the SPI byte stream described in ProtoDefs.h the same way	*/
+/*	the shield firmware does, executes the GDI commands into an			*/
+/*	in-memory RGB565 frame buffer and counts what crossed the wire.		*/
+/*																		*/
+/*	The emulator is driven one byte at a time by MtdsEmuXfer(), which	*/
+/*	the host HAL (MtdsEmuHal.cpp) calls from MtdsHalPutSpiByte().		*/
+/*																		*/
+/************************************************************************/
+
+#if !defined(_MTDSEMU_H_)
+#define	_MTDSEMU_H_
+
+#include	<stdint.h>
+
+/* ------------------------------------------------------------ */
+/*					Miscellaneous Declarations					*/
+/* ------------------------------------------------------------ */
+
+#define	dxcoEmuDisplay	240				// display width in pixels
+#define	dycoEmuDisplay	320				// display height in pixels
+
+/* ------------------------------------------------------------ */
+/*					General Type Declarations					*/
+/* ------------------------------------------------------------ */
+
+/* Wire statistics. Everything is counted in bytes clocked over SPI
+** or in whole packets, so the numbers are independent of the host
+** CPU speed.
+*/
+struct EMUSTAT {
+	uint32_t	cbSpi;			// total bytes exchanged
+	uint32_t	cbPoll;			// handshake bytes answered with a channel status
+	uint32_t	cframe;			// slave select assertions
+	uint32_t	ccmd;			// command packets, status reads excluded
+	uint32_t	cpktOut;		// data-out packets
+	uint32_t	cpktIn;			// data-in packets
+	uint32_t	cabort;			// commands aborted by the emulator
+	uint32_t	tusDelay;		// time the host spent in HAL delays
+};
+
+/* ------------------------------------------------------------ */
+/*					Procedure Declarations						*/
+/* ------------------------------------------------------------ */
+
+void		MtdsEmuInit(uint16_t verFwMajor, uint16_t verFwMinor, const char * szResDir);
+uint8_t		MtdsEmuXfer(uint8_t bSnd);
+void		MtdsEmuSelect(bool fEn);
+bool		MtdsEmuGetStatusPin(int idPin);
+bool		MtdsEmuPostTouch(uint16_t msg, int16_t xco, int16_t yco);
+void		MtdsEmuAddDelay(uint32_t tus);
+void		MtdsEmuGetStat(EMUSTAT * pstat);
+void		MtdsEmuClearStat();
+uint32_t	MtdsEmuChecksum();
+bool		MtdsEmuSavePpm(const char * szFile);
+
+/* ------------------------------------------------------------ */
+
+#endif		// _MTDSEMU_H_
+
+/************************************************************************/
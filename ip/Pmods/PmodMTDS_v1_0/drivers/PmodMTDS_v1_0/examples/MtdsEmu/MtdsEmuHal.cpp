@@ -0,0 +1,493 @@
+/************************************************************************/
+/*																		*/
+/*	MtdsEmuHal.cpp	--	MTDS Library HAL for the Host Shield Emulator	*/
+/*																		*/
+/************************************************************************/
+/*  File Description:													*/
+/*																		*/
+/*	This is a replacement for src/MtdsHal.cpp used when the MTDS		*/
+/*	library is built on a host PC. Instead of driving the AXI Quad SPI	*/
+/*	controller every byte is handed to the shield emulator. Delays are	*/
+/*	not slept; they are added to a virtual clock so the library's		*/
+/*	timing still comes out right and the benchmark can report them.		*/
+/*																		*/
+/************************************************************************/
+
+/* ------------------------------------------------------------ */
+/*				Include File Definitions						*/
+/* ------------------------------------------------------------ */
+
+#include	<stdint.h>
+#include	<time.h>
+
+#include	"MtdsHal.h"
+#include	"MtdsEmu.h"
+
+/* ------------------------------------------------------------ */
+/*				Local Type and Constant Definitions				*/
+/* ------------------------------------------------------------ */
+
+
+/* ------------------------------------------------------------ */
+/*				Global Variables								*/
+/* ------------------------------------------------------------ */
+
+/* The timer object and register offset table normally come from
+** MtdsHal.cpp and the xtmrctr driver. millis() in MtdsHal.h reads
+** the counter register through these.
+*/
+XTmrCtr	Timer;
+u8		XTmrCtr_Offsets[] = { 0, 0x10 };
+
+/* ------------------------------------------------------------ */
+/*				Local Variables									*/
+/* ------------------------------------------------------------ */
+
+static uint64_t	tusEmuVirtual;			// delay time added by the HAL
+static uint64_t	tusEmuBase;
+
+/* ------------------------------------------------------------ */
+/*				Forward Declarations							*/
+/* ------------------------------------------------------------ */
+
+static uint64_t	TusEmuNow();
+
+/* ------------------------------------------------------------ */
+/*				Procedure Definitions							*/
+/* ------------------------------------------------------------ */
+/***	MtdsEmuIn32(addr)
+**
+**	Parameters:
+**		addr		- register address
+**
+**	Return Values:
+**		Returns the register value
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Register read hook for Xil_In32(). The only register read is the
+**		timer counter, which is returned as a 100MHz count.
+*/
+
+u32 MtdsEmuIn32(UINTPTR addr) {
+
+	(void)addr;
+	return (u32)(TusEmuNow() * 100);
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalInit(pinSel)
+**
+**	Parameters:
+**		pinSel		- slave select pin, ignored
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Start the virtual clock.
+*/
+
+void MtdsHalInit(int pinSel) {
+
+	(void)pinSel;
+	tusEmuVirtual = 0;
+	tusEmuBase = 0;
+	tusEmuBase = TusEmuNow();
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalEnableStatusPin(idPin)
+**
+**	Parameters:
+**		idPin		- status pin to enable
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		The emulated status pins need no setup.
+*/
+
+void MtdsHalEnableStatusPin(int idPin) {
+
+	(void)idPin;
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalGetStatusPin(idPin)
+**
+**	Parameters:
+**		idPin		- status pin to read
+**
+**	Return Values:
+**		Returns the state of the pin
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Return the emulated status pin state.
+*/
+
+bool MtdsHalGetStatusPin(int idPin) {
+
+	return MtdsEmuGetStatusPin(idPin);
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalResetDisplay(pinSel)
+**
+**	Parameters:
+**		pinSel		- slave select pin, ignored
+**
+**	Return Values:
+**		Returns false, there is no reset line to pulse
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		The emulator powers up in the sync state, so no reset is needed.
+*/
+
+bool MtdsHalResetDisplay(int pinSel) {
+
+	(void)pinSel;
+	return false;
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalInitSpi(pspiInit, frq)
+**
+**	Parameters:
+**		pspiInit	- SPI controller base, ignored
+**		frq			- SPI clock, ignored
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		The benchmark converts byte counts to time itself, so the clock
+**		frequency is not needed here.
+*/
+
+void MtdsHalInitSpi(uint32_t pspiInit, uint32_t frq) {
+
+	(void)pspiInit;
+	(void)frq;
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalEnableSlave(fEn)
+**
+**	Parameters:
+**		fEn		- true to assert slave select
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Pass the slave select edge to the emulator. The first byte
+**		after an assertion is how the shield tells a channel command
+**		from the start of a packet.
+*/
+
+void MtdsHalEnableSlave(bool fEn) {
+
+	MtdsEmuSelect(fEn);
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalSpiReady()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns true, the emulated controller is never busy
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Transfers complete synchronously in MtdsHalPutSpiByte().
+*/
+
+bool MtdsHalSpiReady() {
+
+	return true;
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalPutSpiByte(bSnd)
+**
+**	Parameters:
+**		bSnd		- byte to send
+**
+**	Return Values:
+**		Returns the byte received from the shield
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Exchange one byte with the emulated shield.
+*/
+
+uint8_t MtdsHalPutSpiByte(uint8_t bSnd) {
+
+	return MtdsEmuXfer(bSnd);
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalBeginSpiBlock(cb, pbSnd, bFill, pbRcv)
+**
+**	Parameters:
+**		cb			- number of bytes to transfer
+**		pbSnd		- bytes to send, or 0 to send bFill
+**		bFill		- fill byte when pbSnd is 0
+**		pbRcv		- buffer for received bytes, or 0 to discard
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Block transfers are run to completion immediately, so
+**		MtdsHalSpiBlockDone() always returns true afterwards.
+*/
+
+void MtdsHalBeginSpiBlock(uint16_t cb, uint8_t * pbSnd, uint8_t bFill, uint8_t * pbRcv) {
+
+	MtdsHalPutSpiBlock(cb, pbSnd, bFill, pbRcv);
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalSpiBlockDone()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns true
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		See MtdsHalBeginSpiBlock().
+*/
+
+bool MtdsHalSpiBlockDone() {
+
+	return true;
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalPutSpiBlock(cb, pbSnd, bFill, pbRcv)
+**
+**	Parameters:
+**		cb			- number of bytes to transfer
+**		pbSnd		- bytes to send, or 0 to send bFill
+**		bFill		- fill byte when pbSnd is 0
+**		pbRcv		- buffer for received bytes, or 0 to discard
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Exchange a block of bytes with the emulated shield.
+*/
+
+void MtdsHalPutSpiBlock(uint16_t cb, uint8_t * pbSnd, uint8_t bFill, uint8_t * pbRcv) {
+	uint8_t		bRcv;
+
+	while (cb > 0) {
+		bRcv = MtdsEmuXfer((pbSnd != 0) ? *pbSnd++ : bFill);
+		if (pbRcv != 0) {
+			*pbRcv++ = bRcv;
+		}
+		cb -= 1;
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalEnableSpiIntr(fEn)
+**
+**	Parameters:
+**		fEn		- ignored
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		There is no interrupt to enable on the host.
+*/
+
+void MtdsHalEnableSpiIntr(bool fEn) {
+
+	(void)fEn;
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalSpiIntrHandler(pvRef)
+**
+**	Parameters:
+**		pvRef		- ignored
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Never called on the host.
+*/
+
+void MtdsHalSpiIntrHandler(void * pvRef) {
+
+	(void)pvRef;
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalTmsElapsed()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns milliseconds since MtdsHalInit()
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Host time plus the accumulated virtual delay time.
+*/
+
+uint32_t MtdsHalTmsElapsed() {
+
+	return (uint32_t)(TusEmuNow() / 1000);
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalDelayMs(tmsDelay)
+**
+**	Parameters:
+**		tmsDelay	- delay in milliseconds
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Advance the virtual clock instead of waiting.
+*/
+
+void MtdsHalDelayMs(uint32_t tmsDelay) {
+
+	MtdsHalDelayUs(tmsDelay * 1000);
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalTusElapsed()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns microseconds since MtdsHalInit()
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Host time plus the accumulated virtual delay time.
+*/
+
+uint32_t MtdsHalTusElapsed() {
+
+	return (uint32_t)TusEmuNow();
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalDelayUs(usDelay)
+**
+**	Parameters:
+**		usDelay		- delay in microseconds
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Advance the virtual clock instead of waiting, and report the
+**		delay to the emulator statistics.
+*/
+
+void MtdsHalDelayUs(uint32_t usDelay) {
+
+	tusEmuVirtual += usDelay;
+	MtdsEmuAddDelay(usDelay);
+
+}
+
+/* ------------------------------------------------------------ */
+/***	TusEmuNow()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns the virtual clock in microseconds
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Monotonic host time since MtdsHalInit() plus virtual delays.
+*/
+
+static uint64_t TusEmuNow() {
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000) + tusEmuVirtual - tusEmuBase;
+}
+
+/* ------------------------------------------------------------ */
+
+/************************************************************************/
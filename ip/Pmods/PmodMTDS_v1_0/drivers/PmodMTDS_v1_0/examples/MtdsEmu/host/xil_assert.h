@@ -0,0 +1,19 @@
+/************************************************************************/
+/*																		*/
+/*	xil_assert.h	--	Host stand-in for the Xilinx BSP assert header	*/
+/*																		*/
+/************************************************************************/
+
+#if !defined(_XIL_ASSERT_H_)
+#define	_XIL_ASSERT_H_
+
+#include	"xil_types.h"
+
+#define	Xil_AssertVoid(exp)
+#define	Xil_AssertNonvoid(exp)
+#define	Xil_AssertVoidAlways()
+#define	Xil_AssertNonvoidAlways()
+
+#endif		// _XIL_ASSERT_H_
+
+/************************************************************************/
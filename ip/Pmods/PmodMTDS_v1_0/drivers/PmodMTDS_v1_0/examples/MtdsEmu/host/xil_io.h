@@ -0,0 +1,35 @@
+/************************************************************************/
+/*																		*/
+/*	xil_io.h	--	Host stand-in for the Xilinx BSP register access	*/
+/*																		*/
+/************************************************************************/
+/*  File Description:													*/
+/*																		*/
+/*	The only register the MTDS library reads directly is the AXI timer	*/
+/*	counter used by millis() in MtdsHal.h. Register reads are routed to	*/
+/*	the emulator HAL, which returns a free running 100MHz count derived	*/
+/*	from the host clock. Register writes are discarded.					*/
+/*																		*/
+/************************************************************************/
+
+#if !defined(_XIL_IO_H_)
+#define	_XIL_IO_H_
+
+#include	"xil_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+u32		MtdsEmuIn32(UINTPTR addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define	Xil_In32(addr)			MtdsEmuIn32((UINTPTR)(addr))
+#define	Xil_Out32(addr, val)	((void)(addr), (void)(val))
+
+#endif		// _XIL_IO_H_
+
+/************************************************************************/
@@ -0,0 +1,35 @@
+/************************************************************************/
+/*																		*/
+/*	xil_types.h	--	Host stand-in for the Xilinx BSP type header		*/
+/*																		*/
+/************************************************************************/
+/*  File Description:													*/
+/*																		*/
+/*	Just enough of the standalone BSP declarations to let the MTDS		*/
+/*	library and the timer driver headers compile on a host PC for the	*/
+/*	shield emulator. Nothing here talks to hardware.					*/
+/*																		*/
+/************************************************************************/
+
+#if !defined(_XIL_TYPES_H_)
+#define	_XIL_TYPES_H_
+
+#include	<stdint.h>
+#include	<stddef.h>
+
+typedef uint8_t		u8;
+typedef uint16_t	u16;
+typedef uint32_t	u32;
+typedef uint64_t	u64;
+typedef int8_t		s8;
+typedef int16_t		s16;
+typedef int32_t		s32;
+typedef uintptr_t	UINTPTR;
+typedef intptr_t	INTPTR;
+
+#define	XIL_COMPONENT_IS_READY		0x11111111U
+#define	XIL_COMPONENT_IS_STARTED	0x22222222U
+
+#endif		// _XIL_TYPES_H_
+
+/************************************************************************/
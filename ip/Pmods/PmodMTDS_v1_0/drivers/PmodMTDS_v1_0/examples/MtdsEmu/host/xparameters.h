@@ -0,0 +1,16 @@
+/************************************************************************/
+/*																		*/
+/*	xparameters.h	--	Host stand-in for the generated BSP parameters	*/
+/*																		*/
+/************************************************************************/
+
+#if !defined(_XPARAMETERS_H_)
+#define	_XPARAMETERS_H_
+
+#define	XPAR_PMODMTDS_0_AXI_LITE_SPI_BASEADDR	0x00000000
+#define	XPAR_PMODMTDS_0_AXI_LITE_GPIO_BASEADDR	0x00001000
+#define	XPAR_PMODMTDS_0_AXI_LITE_TIMER_BASEADDR	0x00002000
+
+#endif		// _XPARAMETERS_H_
+
+/************************************************************************/
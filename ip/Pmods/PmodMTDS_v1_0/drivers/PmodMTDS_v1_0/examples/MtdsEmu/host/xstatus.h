@@ -0,0 +1,16 @@
+/************************************************************************/
+/*																		*/
+/*	xstatus.h	--	Host stand-in for the Xilinx BSP status codes		*/
+/*																		*/
+/************************************************************************/
+
+#if !defined(_XSTATUS_H_)
+#define	_XSTATUS_H_
+
+#define	XST_SUCCESS				0L
+#define	XST_FAILURE				1L
+#define	XST_DEVICE_IS_STARTED	5L
+
+#endif		// _XSTATUS_H_
+
+/************************************************************************/
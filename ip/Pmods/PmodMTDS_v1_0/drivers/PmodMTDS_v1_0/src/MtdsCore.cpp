@@ -459,18 +459,15 @@ bool MtdsReadDhdr(uint8_t * pb) {
 **		This functions writes the specified number of bytes into the
 **		transmit buffer to the shield. Because the shield uses the SPI
 **		port in enhanced mode with FIFO, we can burst the data quickly.
-**		However, we need to be careful to not overrun the FIFO, so we
-**		burst it in bursts of a maximum of 8 bytes and then wait a bit.
+**		The whole block goes to the HAL at once, which keeps the SPI
+**		controller busy rather than starting and stopping it per byte.
+**		So as not to overrun the FIFO in the shield, the HAL keeps no
+**		more than cbMtdsSpiFifo bytes in flight.
 */
 
 void MtdsSendData(uint16_t cb, uint8_t * pb) {
-	int		cbCur;
 
-	for (cbCur = 0; cbCur < cb; cbCur++) {
-		while (!MtdsHalSpiReady()) {
-		}
-		MtdsHalPutSpiByte(*pb++);
-	}
+	MtdsHalPutSpiBlock(cb, pb, 0, 0);
 
 }
 
@@ -492,20 +489,8 @@ void MtdsSendData(uint16_t cb, uint8_t * pb) {
 */
 
 void MtdsReadData(uint16_t cb, uint8_t * pb) {
-	int		cbCur;
-	uint8_t	bRcv;
-
-	cbCur = 0;
 
-	while(cbCur < cb) {
-		while (!MtdsHalSpiReady()) {
-		}
-		bRcv = MtdsHalPutSpiByte(chnCmdRead);
-		if (pb != 0) {
-			*pb++ = bRcv;
-		}
-		cbCur += 1;
-	}
+	MtdsHalPutSpiBlock(cb, 0, chnCmdRead, pb);
 
 }
 
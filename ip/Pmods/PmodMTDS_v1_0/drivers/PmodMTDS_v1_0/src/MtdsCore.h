@@ -70,6 +70,15 @@
 #define cbDataInMax		cbDhdrDataInMax					// maximum payload of data in packet
 #define	cbRetValInit	(sizeof(RHDR)+cbRhdrDataMax)	// size of status packet buffer
 
+/* Number of data-out packets sent for each chnStaReady from the shield. No
+** released shield firmware buffers more than one packet or reports that it can,
+** so this is 1, a ready handshake before every packet. Define it larger only when
+** building for shield firmware whose ready grants credit for that many packets.
+*/
+#if !defined(cpktDataOutCredit)
+#define	cpktDataOutCredit	1
+#endif
+
 /* ------------------------------------------------------------ */
 /*					General Type Declarations					*/
 /* ------------------------------------------------------------ */
@@ -414,6 +414,21 @@ struct FINF {
 };
 #pragma pack(pop)
 
+/* File transfer statistics, filled in by MTFS::SndFile() and MTFS::RcvFile().
+*/
+struct FSXS {
+	uint32_t	cbXfer;			// number of bytes transferred
+	uint32_t	ccmd;			// number of read or write commands sent
+	uint32_t	tusXfer;		// time taken, including opening and closing the file
+	uint32_t	cbPerSec;		// throughput in bytes per second
+};
+
+/* Source or destination of a streaming file transfer. It is passed a buffer of
+** cbBuf bytes to fill, or cbBuf bytes to consume, and returns the number of
+** bytes filled or consumed. A source returns 0 at the end of its data.
+*/
+typedef uint32_t (* PFNFSXFER)(void * pvRef, uint8_t * rgbBuf, uint32_t cbBuf);
+
 /* File access modes
 */
 #define	mdMtdsRead			0x01
@@ -0,0 +1,414 @@
+/********************************************************************************/
+/*																				*/
+/*	MtdsDlst.cpp	--	Implementation for MTDS GDI Display Lists				*/
+/*																				*/
+/********************************************************************************/
+/*	Copyright 2015, Digilent, Inc. All rights reserved.							*/
+/********************************************************************************/
+/*  Module Description: 														*/
+/*																				*/
+/*	A display list records GDI drawing calls in a local buffer instead of		*/
+/*	sending each one to the shield as it is made. The recorded commands are		*/
+/*	sent back to back when the list is flushed. While recording, calls that		*/
+/*	set DS state to the value it already has are dropped, and a MoveTo that		*/
+/*	immediately follows another MoveTo on the same DS replaces it.				*/
+/*																				*/
+/********************************************************************************/
+/*  Revision History:															*/
+/*																				*/
+/*	2026-10-19: Created															*/
+/*																				*/
+/********************************************************************************/
+
+#define	OPT_BOARD_INTERNAL
+
+/* ------------------------------------------------------------ */
+/*				Include File Definitions						*/
+/* ------------------------------------------------------------ */
+
+#include	<stdlib.h>
+#include	<string.h>
+
+#include	<stdint.h>
+
+#include	"ProtoDefs.h"
+#include	"mtds.h"
+#include	"MtdsCore.h"
+
+/* ------------------------------------------------------------ */
+/*				Local Type Definitions							*/
+/* ------------------------------------------------------------ */
+
+/* Each display list entry is a six byte header followed by the command
+** parameters and then the data-out bytes for the command.
+**		byte 0		- command class
+**		byte 1		- command code
+**		byte 2-3	- number of parameter bytes (little endian)
+**		byte 4-5	- number of data-out bytes (little endian)
+*/
+#define	cbDlstHdr		6
+
+/* The DS state setters, cmdGdiSetFgColor through cmdGdiSetDrawingSurface, use
+** every other command code. This gives the index of a setter in DSST.rgval.
+*/
+#define	IvalDlstState(cmd)	(((cmd) - cmdGdiSetFgColor) >> 1)
+#define	FDlstStateCmd(cmd)	(((cmd) >= cmdGdiSetFgColor) && ((cmd) <= cmdGdiSetDrawingSurface) && \
+								((((cmd) - cmdGdiSetFgColor) & 1) == 0))
+
+/* ------------------------------------------------------------ */
+/*				Global Variables								*/
+/* ------------------------------------------------------------ */
+
+extern RHDR *	prhdrMtdsRet;
+
+/* ------------------------------------------------------------ */
+/*				Local Variables									*/
+/* ------------------------------------------------------------ */
+
+static uint8_t	rgbDlst[cbMtdsDlstMax];		// recorded commands
+static uint16_t	cbDlst;						// number of bytes recorded
+static uint16_t	ibDlstLast;					// offset of the last entry recorded
+static bool		fDlstSending;				// commands are being sent from the list
+
+static DSST		rgdsstDlst[cdsMtdsDlstCache];	// DS state last sent to the shield
+static int		idsstDlstNext;					// next cache entry to replace
+
+/* ------------------------------------------------------------ */
+/*				Forward Declarations							*/
+/* ------------------------------------------------------------ */
+
+static DSST *	PdsstDlstFind(HDS hds);
+static void		DlstInvalidateState();
+
+/* ------------------------------------------------------------ */
+/*				Procedure Definitions							*/
+/* ------------------------------------------------------------ */
+/***	PdsstDlstFind(hds)
+**
+**	Parameters:
+**		hds		- handle of the DS to look up
+**
+**	Return Values:
+**		Returns the state cache entry for the DS
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Return the state cache entry for the specified DS. If the DS isn't in
+**		the cache, an entry is taken over for it, round robin, with no valid
+**		state values.
+*/
+
+static DSST * PdsstDlstFind(HDS hds) {
+	DSST *	pdsst;
+	int		idsst;
+
+	for (idsst = 0; idsst < cdsMtdsDlstCache; idsst++) {
+		if ((rgdsstDlst[idsst].fsValid != 0) && (rgdsstDlst[idsst].hds == hds)) {
+			return &rgdsstDlst[idsst];
+		}
+	}
+
+	pdsst = &rgdsstDlst[idsstDlstNext];
+	idsstDlstNext = (idsstDlstNext + 1) % cdsMtdsDlstCache;
+
+	pdsst->hds = hds;
+	pdsst->fsValid = 0;
+
+	return pdsst;
+}
+
+/* ------------------------------------------------------------ */
+/***	DlstInvalidateState()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Forget all cached DS state, so that the next state setter call for
+**		any DS will be sent to the shield.
+*/
+
+static void DlstInvalidateState() {
+	int		idsst;
+
+	for (idsst = 0; idsst < cdsMtdsDlstCache; idsst++) {
+		rgdsstDlst[idsst].fsValid = 0;
+	}
+}
+
+/* ------------------------------------------------------------ */
+/*				MTDS Object Class Implementation				*/
+/* ------------------------------------------------------------ */
+/***	MTDS::BeginDisplayList()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		Returns true if successful, false if not
+**
+**	Description:
+**		Start recording GDI drawing calls into the display list. Until the list
+**		is flushed, recorded calls return success without talking to the shield.
+**		An error in a recorded call is reported by the call that sends the list.
+**		Any call that isn't recorded sends the list before it runs.
+*/
+
+bool MTDS::BeginDisplayList() {
+
+	if (!fDlstOpen) {
+		cbDlst = 0;
+		DlstInvalidateState();
+		fDlstOpen = true;
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------ */
+/***	MTDS::FlushDisplayList()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		Returns true if successful, false if not
+**
+**	Description:
+**		Send the commands recorded in the display list to the shield and empty
+**		the list. The list stays open. If a command fails, the rest of the list
+**		is discarded and GetLastError() reports the command that failed.
+*/
+
+bool MTDS::FlushDisplayList() {
+	uint16_t	ib;
+	uint16_t	cb;
+	uint16_t	cbParam;
+	uint16_t	cbData;
+	uint8_t *	pbEnt;
+	bool		fStat;
+
+	if (cbDlst == 0) {
+		return true;
+	}
+
+	/* Empty the list before sending it, so that commands sent from it don't
+	** try to flush it again.
+	*/
+	cb = cbDlst;
+	cbDlst = 0;
+	fDlstSending = true;
+	fStat = true;
+
+	for (ib = 0; ib < cb; ib += cbDlstHdr + cbParam + cbData) {
+		pbEnt = &rgbDlst[ib];
+		cbParam = pbEnt[2] + (pbEnt[3] << 8);
+		cbData = pbEnt[4] + (pbEnt[5] << 8);
+
+		MtdsProcessCmdWr(pbEnt[0], pbEnt[1], cbParam, pbEnt + cbDlstHdr,
+							cbData, pbEnt + cbDlstHdr + cbParam);
+
+		if (staLastError != staCmdSuccess) {
+			/* The cached DS state may include values from commands that will
+			** now never be sent.
+			*/
+			DlstInvalidateState();
+			fStat = false;
+			break;
+		}
+	}
+
+	fDlstSending = false;
+
+	return fStat;
+}
+
+/* ------------------------------------------------------------ */
+/***	MTDS::EndDisplayList()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		Returns true if successful, false if not
+**
+**	Description:
+**		Send any commands left in the display list and stop recording.
+*/
+
+bool MTDS::EndDisplayList() {
+	bool	fStat;
+
+	fStat = FlushDisplayList();
+
+	fDlstOpen = false;
+	DlstInvalidateState();
+
+	return fStat;
+}
+
+/* ------------------------------------------------------------ */
+/***	MTDS::MtdsQueueCmdWr(cls, cmd, cbParam, pbParam, cbData, pbData)
+**
+**	Parameters:
+**		cls		- command class
+**		cmd		- command code
+**		cbParam	- number of bytes of parameter data in command packet
+**		pbParam	- pointer to parameter data to send
+**		cbData	- number of bytes of data to send in data out packets
+**		pbData	- pointer to data to send
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Takes the same parameters as MtdsProcessCmdWr() and is used by GDI
+**		calls that have no return value other than success or failure.
+**		When no display list is open, the command is sent immediately.
+**		Otherwise it is added to the display list and success is reported
+**		in prhdrMtdsRet->sta, as if the command had been sent. The list is
+**		flushed first if the command won't fit. A command too big for the
+**		list buffer is sent immediately after the list.
+*/
+
+void MTDS::MtdsQueueCmdWr(uint8_t cls, uint8_t cmd, uint16_t cbParam, uint8_t * pbParam,
+						uint16_t cbData, uint8_t * pbData) {
+	DSST *		pdsst;
+	HDS			hds;
+	uint32_t	val;
+	uint16_t	fsVal;
+	uint16_t	cbEnt;
+	uint8_t *	pbEnt;
+
+	if (!fDlstOpen) {
+		MtdsProcessCmdWr(cls, cmd, cbParam, pbParam, cbData, pbData);
+		return;
+	}
+
+	/* State setters take the HDS followed by the value being set. Drop the
+	** command if the shield already has this value.
+	*/
+	if ((cls == clsCmdGdi) && FDlstStateCmd(cmd) && (cbParam > sizeof(HDS))) {
+		val = 0;
+		memcpy(&val, pbParam + sizeof(HDS),
+				(cbParam - sizeof(HDS) < sizeof(val)) ? cbParam - sizeof(HDS) : sizeof(val));
+
+		memcpy(&hds, pbParam, sizeof(hds));
+		pdsst = PdsstDlstFind(hds);
+		fsVal = 1 << IvalDlstState(cmd);
+
+		if (((pdsst->fsValid & fsVal) != 0) && (pdsst->rgval[IvalDlstState(cmd)] == val)) {
+			goto lQueueExit;
+		}
+
+		pdsst->rgval[IvalDlstState(cmd)] = val;
+		pdsst->fsValid |= fsVal;
+	}
+
+	/* Only the last of several MoveTo calls in a row on the same DS matters.
+	*/
+	if ((cls == clsCmdGdi) && (cmd == cmdGdiMoveTo) && (cbDlst != 0)) {
+		pbEnt = &rgbDlst[ibDlstLast];
+		if ((pbEnt[0] == cls) && (pbEnt[1] == cmd) &&
+			(memcmp(pbEnt + cbDlstHdr, pbParam, sizeof(HDS)) == 0)) {
+			memcpy(pbEnt + cbDlstHdr, pbParam, cbParam);
+			goto lQueueExit;
+		}
+	}
+
+	cbEnt = cbDlstHdr + cbParam + cbData;
+
+	if (cbEnt > cbMtdsDlstMax - cbDlst) {
+		if (!FlushDisplayList()) {
+			prhdrMtdsRet->sta = staLastError;
+			return;
+		}
+	}
+
+	if (cbEnt > cbMtdsDlstMax) {
+		fDlstSending = true;
+		MtdsProcessCmdWr(cls, cmd, cbParam, pbParam, cbData, pbData);
+		fDlstSending = false;
+		return;
+	}
+
+	pbEnt = &rgbDlst[cbDlst];
+	pbEnt[0] = cls;
+	pbEnt[1] = cmd;
+	pbEnt[2] = cbParam & 0xFF;
+	pbEnt[3] = cbParam >> 8;
+	pbEnt[4] = cbData & 0xFF;
+	pbEnt[5] = cbData >> 8;
+	memcpy(pbEnt + cbDlstHdr, pbParam, cbParam);
+	memcpy(pbEnt + cbDlstHdr + cbParam, pbData, cbData);
+
+	ibDlstLast = cbDlst;
+	cbDlst += cbEnt;
+
+lQueueExit:
+	clsLastError = cls;
+	cmdLastError = cmd;
+	staLastError = staCmdSuccess;
+	prhdrMtdsRet->sta = staCmdSuccess;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MTDS::MtdsSyncDisplayList(cls, cmd)
+**
+**	Parameters:
+**		cls		- class of the command about to be sent
+**		cmd		- code of the command about to be sent
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Called before a command is sent to the shield. Commands recorded in
+**		the display list must reach the shield before any command that isn't
+**		recorded, so the list is flushed. Graphics and window commands, and
+**		reinitializing the firmware, may change DS state behind our back, so
+**		the cached state is forgotten.
+*/
+
+void MTDS::MtdsSyncDisplayList(uint8_t cls, uint8_t cmd) {
+
+	if (fDlstSending) {
+		return;
+	}
+
+	FlushDisplayList();
+
+	if ((cls == clsCmdGdi) || (cls == clsCmdWin) ||
+		((cls == clsCmdUtil) && (cmd == cmdUtilInit))) {
+		DlstInvalidateState();
+	}
+}
+
+/* ------------------------------------------------------------ */
+
+/********************************************************************************/
+
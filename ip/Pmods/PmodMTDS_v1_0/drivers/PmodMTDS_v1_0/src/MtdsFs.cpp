@@ -35,6 +35,11 @@
 /*				Local Type Definitions							*/
 /* ------------------------------------------------------------ */
 
+/* Most data moved by a single read or write command. The data count passed down
+** to the command layer is 16 bits, and a multiple of the packet size keeps every
+** data packet but the last one full.
+*/
+#define	cbFsXferMax		32768
 
 /* ------------------------------------------------------------ */
 /*				Global Variables								*/
@@ -580,27 +585,41 @@ bool MTFS::CloseFile(HFIL fh) {
 **		Returns true if successful, false if not
 **
 **	Description:
-**		Read the specified number of bytes from the specified file.
+**		Read the specified number of bytes from the specified file. Reads larger
+**		than cbFsXferMax are split into several read commands. Fewer bytes than
+**		requested are read if the end of the file is reached.
 */
 
 bool MTFS::ReadFile(HFIL fh, uint8_t * rgbBuf, uint32_t cbRead, uint32_t * pcbRes) {
-	RET4A *	pret = (RET4A *)&rgbMtdsRetVal[sizeof(RHDR)];
-	PRM2A	prm;
+	RET4A *		pret = (RET4A *)&rgbMtdsRetVal[sizeof(RHDR)];
+	PRM2A		prm;
+	uint32_t	cbCur;
+
+	*pcbRes = 0;
+	do {
+		cbCur = cbRead - *pcbRes;
+		if (cbCur > cbFsXferMax) {
+			cbCur = cbFsXferMax;
+		}
+
+		/* Send the command packet.
+		*/
+		prm.valA1 = fh;
+		prm.valA2 = cbCur;
 
-	/* Send the command packet.
-	*/
-	prm.valA1 = fh;
-	prm.valA2 = cbRead;
+		mtds.MtdsProcessCmdRd(clsCmdFs, cmdFsRead, sizeof(prm), (uint8_t *)&prm,
+								(uint16_t)cbCur, rgbBuf + *pcbRes);
+		ccmdXfer += 1;
 
-	mtds.MtdsProcessCmdRd(clsCmdFs, cmdFsRead, sizeof(prm), (uint8_t *)&prm, cbRead, rgbBuf);
+		*pcbRes += pret->valA1;
 
-	*pcbRes = pret->valA1;
+		/* Check for error and return failure.
+		*/
+		if (prhdrMtdsRet->sta != staCmdSuccess) {
+			return false;
+		}
 
-	/* Check for error and return failure.
-	*/
-	if (prhdrMtdsRet->sta != staCmdSuccess) {
-		return false;
-	}
+	} while ((*pcbRes < cbRead) && (pret->valA1 == cbCur));
 
 	/* Return success.
 	*/
@@ -624,31 +643,224 @@ bool MTFS::ReadFile(HFIL fh, uint8_t * rgbBuf, uint32_t cbRead, uint32_t * pcbRe
 **		Returns true if successful, false if not
 **
 **	Description:
-**		Write the specified number of bytes to the specified file.
+**		Write the specified number of bytes to the specified file. Writes larger
+**		than cbFsXferMax are split into several write commands, stopping if the
+**		shield writes less than it was sent (e.g. the disk is full).
 */
 
 bool MTFS::WriteFile(HFIL fh, uint8_t * rgbBuf, uint32_t cbWrite, uint32_t * pcbRes) {
-	RET4A *	pret = (RET4A *)&rgbMtdsRetVal[sizeof(RHDR)];
-	PRM2A	prm;
+	RET4A *		pret = (RET4A *)&rgbMtdsRetVal[sizeof(RHDR)];
+	PRM2A		prm;
+	uint32_t	cbCur;
+
+	*pcbRes = 0;
+	do {
+		cbCur = cbWrite - *pcbRes;
+		if (cbCur > cbFsXferMax) {
+			cbCur = cbFsXferMax;
+		}
+
+		/* Send the command packet.
+		*/
+		prm.valA1 = fh;
+		prm.valA2 = cbCur;
 
-	/* Send the command packet.
+		mtds.MtdsProcessCmdWr(clsCmdFs, cmdFsWrite, sizeof(prm), (uint8_t *)&prm,
+								(uint16_t)cbCur, rgbBuf + *pcbRes);
+		ccmdXfer += 1;
+
+		*pcbRes += pret->valA1;
+
+		/* Check for error and return failure.
+		*/
+		if (prhdrMtdsRet->sta != staCmdSuccess) {
+			return false;
+		}
+
+	} while ((*pcbRes < cbWrite) && (pret->valA1 == cbCur));
+
+	/* Return success.
 	*/
-	prm.valA1 = fh;
-	prm.valA2 = cbWrite;
+	return true;
 
-	mtds.MtdsProcessCmdWr(clsCmdFs, cmdFsWrite, sizeof(prm), (uint8_t *)&prm, cbWrite, rgbBuf);
+}
 
-	*pcbRes = pret->valA1;
+/* ------------------------------------------------------------ */
+/***	MTFS::SndFile(szFile, pfnSrc, pvRef, rgbBuf, cbBuf, pfsxs)
+**
+**	Parameters:
+**		szFile	- name of the file to create on the shield
+**		pfnSrc	- function that supplies the file contents
+**		pvRef	- value passed to pfnSrc
+**		rgbBuf	- transfer buffer
+**		cbBuf	- size of the transfer buffer
+**		pfsxs	- pointer to variable to receive transfer statistics, or 0
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		Returns true if successful, false if not. If the shield writes fewer
+**		bytes than it was given, the transfer stops with staFsAborted.
+**
+**	Description:
+**		Create the specified file, replacing any existing file, and fill it with
+**		the data returned by pfnSrc. pfnSrc is called to fill rgbBuf until it
+**		returns 0, and each buffer is written with as few commands as possible,
+**		so a larger buffer means fewer round trips. The file stays open for the
+**		whole transfer.
+*/
 
-	/* Check for error and return failure.
+bool MTFS::SndFile(char * szFile, PFNFSXFER pfnSrc, void * pvRef,
+						uint8_t * rgbBuf, uint32_t cbBuf, FSXS * pfsxs) {
+	HFIL		fh;
+	FSXS		fsxs;
+	uint32_t	tusStart;
+	uint32_t	cbCur;
+	uint32_t	cbRes;
+	uint8_t		cls;
+	uint8_t		cmd;
+	uint8_t		sta;
+	bool		fStat;
+
+	tusStart = MtdsHalTusElapsed();
+	memset(&fsxs, 0, sizeof(fsxs));
+	fsxs.ccmd = ccmdXfer;
+
+	if ((fh = OpenFile(szFile, mdMtdsWrite|mdMtdsCreateAlways)) == 0) {
+		return false;
+	}
+
+	fStat = true;
+	while ((cbCur = pfnSrc(pvRef, rgbBuf, cbBuf)) != 0) {
+		fStat = WriteFile(fh, rgbBuf, cbCur, &cbRes);
+		fsxs.cbXfer += cbRes;
+
+		if (!fStat) {
+			break;
+		}
+
+		if (cbRes != cbCur) {
+			/* The shield took less than we gave it, most likely the disk is full.
+			*/
+			mtds.staLastError = staFsAborted;
+			fStat = false;
+			break;
+		}
+	}
+
+	/* Close the file even if the transfer failed, but report the error that
+	** stopped the transfer rather than any from closing the file.
 	*/
-	if (prhdrMtdsRet->sta != staCmdSuccess) {
+	sta = mtds.GetLastError(&cls, &cmd);
+	if (!CloseFile(fh) && fStat) {
+		fStat = false;
+	}
+	else if (!fStat) {
+		mtds.clsLastError = cls;
+		mtds.cmdLastError = cmd;
+		mtds.staLastError = sta;
+	}
+
+	fsxs.ccmd = ccmdXfer - fsxs.ccmd;
+	fsxs.tusXfer = MtdsHalTusElapsed() - tusStart;
+	if (fsxs.tusXfer != 0) {
+		fsxs.cbPerSec = (uint32_t)(((uint64_t)fsxs.cbXfer * 1000000) / fsxs.tusXfer);
+	}
+	if (pfsxs != 0) {
+		*pfsxs = fsxs;
+	}
+
+	return fStat;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MTFS::RcvFile(szFile, pfnDst, pvRef, rgbBuf, cbBuf, pfsxs)
+**
+**	Parameters:
+**		szFile	- name of the file on the shield to read
+**		pfnDst	- function that consumes the file contents
+**		pvRef	- value passed to pfnDst
+**		rgbBuf	- transfer buffer
+**		cbBuf	- size of the transfer buffer
+**		pfsxs	- pointer to variable to receive transfer statistics, or 0
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		Returns true if successful, false if not. If pfnDst consumes fewer
+**		bytes than it was given, the transfer stops with staFsAborted.
+**
+**	Description:
+**		Read the specified file from start to end, passing it to pfnDst up to
+**		cbBuf bytes at a time. Each buffer is read with as few commands as
+**		possible and the file stays open for the whole transfer.
+*/
+
+bool MTFS::RcvFile(char * szFile, PFNFSXFER pfnDst, void * pvRef,
+						uint8_t * rgbBuf, uint32_t cbBuf, FSXS * pfsxs) {
+	HFIL		fh;
+	FSXS		fsxs;
+	uint32_t	tusStart;
+	uint32_t	cbRes;
+	uint8_t		cls;
+	uint8_t		cmd;
+	uint8_t		sta;
+	bool		fStat;
+
+	tusStart = MtdsHalTusElapsed();
+	memset(&fsxs, 0, sizeof(fsxs));
+	fsxs.ccmd = ccmdXfer;
+
+	if ((fh = OpenFile(szFile, mdMtdsRead|mdMtdsOpenExisting)) == 0) {
 		return false;
 	}
 
-	/* Return the file handle.
+	while (true) {
+		fStat = ReadFile(fh, rgbBuf, cbBuf, &cbRes);
+		if (!fStat) {
+			break;
+		}
+
+		if ((cbRes != 0) && (pfnDst(pvRef, rgbBuf, cbRes) != cbRes)) {
+			mtds.staLastError = staFsAborted;
+			fStat = false;
+			break;
+		}
+		fsxs.cbXfer += cbRes;
+
+		if (cbRes < cbBuf) {
+			/* Short read, we are at the end of the file.
+			*/
+			break;
+		}
+	}
+
+	/* Close the file even if the transfer failed, but report the error that
+	** stopped the transfer rather than any from closing the file.
 	*/
-	return true;
+	sta = mtds.GetLastError(&cls, &cmd);
+	if (!CloseFile(fh) && fStat) {
+		fStat = false;
+	}
+	else if (!fStat) {
+		mtds.clsLastError = cls;
+		mtds.cmdLastError = cmd;
+		mtds.staLastError = sta;
+	}
+
+	fsxs.ccmd = ccmdXfer - fsxs.ccmd;
+	fsxs.tusXfer = MtdsHalTusElapsed() - tusStart;
+	if (fsxs.tusXfer != 0) {
+		fsxs.cbPerSec = (uint32_t)(((uint64_t)fsxs.cbXfer * 1000000) / fsxs.tusXfer);
+	}
+	if (pfsxs != 0) {
+		*pfsxs = fsxs;
+	}
+
+	return fStat;
 
 }
 
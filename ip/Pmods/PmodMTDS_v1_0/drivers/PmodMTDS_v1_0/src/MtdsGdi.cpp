@@ -635,7 +635,7 @@ bool MTDS::SetFgColor(HDS hds, uint32_t clr) {
 	prm.valA1 = hds;
 	prm.valA2 = clr;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiSetFgColor, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiSetFgColor, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -710,7 +710,7 @@ bool MTDS::SetBgColor(HDS hds, uint32_t clr) {
 	prm.valA1 = hds;
 	prm.valA2 = clr;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiSetBgColor, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiSetBgColor, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -786,7 +786,7 @@ bool MTDS::SetTransColor(HDS hds, uint32_t clr) {
 	prm.valA1 = hds;
 	prm.valA2 = clr;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiSetTransColor, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiSetTransColor, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -877,7 +877,7 @@ bool MTDS::SetIntensity(HDS hds, int ity) {
 	prm.valA1 = hds;
 	prm.valB1 = (uint16_t)ity;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiSetIntensity, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiSetIntensity, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -952,7 +952,7 @@ bool MTDS::SetPen(HDS hds, uint16_t pen) {
 	prm.valA1 = hds;
 	prm.valB1 = pen;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiSetPen, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiSetPen, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1032,7 +1032,7 @@ bool MTDS::SetBkMode(HDS hds, int bkReq) {
 	prm.valA1 = hds;
 	prm.valB1 = (uint16_t)(bkReq & 0xFFFF);
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiSetBkMode, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiSetBkMode, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1114,7 +1114,7 @@ bool MTDS::SetDrwRop(HDS hds, int drw) {
 	prm.valA1 = hds;
 	prm.valB1 = (uint16_t)(drw & 0xFFFF);
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiSetDrwRop, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiSetDrwRop, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1190,7 +1190,7 @@ bool MTDS::SetBrush(HDS hds, HBR hbr) {
 	prm.valA1 = hds;
 	prm.valA2 = hbr;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiSetBrush, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiSetBrush, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1266,7 +1266,7 @@ bool MTDS::SetFont(HDS hds, HFNT hfnt) {
 	prm.valA1 = hds;
 	prm.valA2 = hfnt;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiSetFont, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiSetFont, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1342,7 +1342,7 @@ bool MTDS::SetDrawingSurface(HDS hds, HBMP hbmp) {
 	prm.valA1 = hds;
 	prm.valA2 = hbmp;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiSetDrawingSurface, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiSetDrawingSurface, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1420,7 +1420,7 @@ bool MTDS::SetPixel(HDS hds, int16_t xco, int16_t yco, uint32_t clr) {
 	prm.valB1 = xco;
 	prm.valB2 = yco;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiSetPixel, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiSetPixel, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1540,7 +1540,7 @@ bool MTDS::MoveTo(HDS hds, int16_t xco, int16_t yco) {
 	prm.valB1 = xco;
 	prm.valB2 = yco;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiMoveTo, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiMoveTo, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1581,7 +1581,7 @@ bool MTDS::Line(HDS hds, int16_t xco, int16_t yco) {
 	prm.valB1 = xco;
 	prm.valB2 = yco;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiLine, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiLine, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1622,7 +1622,7 @@ bool MTDS::LineTo(HDS hds, int16_t xco, int16_t yco) {
 	prm.valB1 = xco;
 	prm.valB2 = yco;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiLineTo, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiLineTo, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1663,7 +1663,7 @@ bool MTDS::PolyLine(HDS hds, int cpnt, PNT * rgpnt) {
 	prm.valA1 = hds;
 	prm.valB1 = cpnt;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiPolyLine, sizeof(prm), (uint8_t *)&prm,
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiPolyLine, sizeof(prm), (uint8_t *)&prm,
 						cpnt*sizeof(PNT), (uint8_t *)rgpnt);
 
 	/* Check for error and return failure.
@@ -1706,7 +1706,7 @@ bool MTDS::PolyLineTo(HDS hds, int cpnt, PNT * rgpnt) {
 	prm.valA1 = hds;
 	prm.valB1 = cpnt;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiPolyLineTo, sizeof(prm), (uint8_t *)&prm,
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiPolyLineTo, sizeof(prm), (uint8_t *)&prm,
 						cpnt*sizeof(PNT), (uint8_t *)rgpnt);
 
 	/* Check for error and return failure.
@@ -1765,7 +1765,7 @@ bool MTDS::Arc(HDS hds, int16_t xcoLeft, int16_t ycoTop, int16_t xcoRight, int16
 	prm.valB7 = xcoRad2;
 	prm.valB8 = ycoRad2;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiArc, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiArc, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1823,7 +1823,7 @@ bool MTDS::ArcTo(HDS hds, int16_t xcoLeft, int16_t ycoTop, int16_t xcoRight, int
 	prm.valB7 = xcoRad2;
 	prm.valB8 = ycoRad2;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiArcTo, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiArcTo, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1871,7 +1871,7 @@ bool MTDS::Ellipse(HDS hds, int16_t xcoLeft, int16_t ycoTop, int16_t xcoRight, i
 	prm.valB3 = xcoRight;
 	prm.valB4 = ycoBottom;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiEllipse, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiEllipse, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1928,7 +1928,7 @@ bool MTDS::Chord(HDS hds, int16_t xcoLeft, int16_t ycoTop, int16_t xcoRight, int
 	prm.valB7 = xcoRad2;
 	prm.valB8 = ycoRad2;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiChord, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiChord, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -1985,7 +1985,7 @@ bool MTDS::Pie(HDS hds, int16_t xcoLeft, int16_t ycoTop, int16_t xcoRight, int16
 	prm.valB7 = xcoRad2;
 	prm.valB8 = ycoRad2;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiPie, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiPie, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -2032,7 +2032,7 @@ bool MTDS::Rectangle(HDS hds, int16_t xcoLeft, int16_t ycoTop, int16_t xcoRight,
 	prm.valB3 = xcoRight;
 	prm.valB4 = ycoBottom;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiRectangle, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiRectangle, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -2082,7 +2082,7 @@ bool MTDS::RoundRect(HDS hds, int16_t xcoLeft, int16_t ycoTop, int16_t xcoRight,
 	prm.valB5 = dxcoWidth;
 	prm.valB6 = dycoHeight;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiRoundRect, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiRoundRect, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -2138,7 +2138,7 @@ bool MTDS::BitBlt(HDS hdsDst, int16_t xcoDst, int16_t ycoDst, int16_t dxco, int1
 	prm.valB6 = ycoSrc;
 	prm.valB7 = rop;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiBitBlt, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiBitBlt, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -2183,7 +2183,7 @@ bool MTDS::PatBlt(HDS hds, int16_t xco, int16_t yco, int16_t dxco, int16_t dyco,
 	prm.valB4 = dyco;
 	prm.valB5 = rop;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiPatBlt, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiPatBlt, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -2239,7 +2239,7 @@ bool MTDS::DrawBitmap(HDS hdsDst, int16_t xcoDst, int16_t ycoDst, int16_t dxco,
 	prm.valB5 = xcoSrc;
 	prm.valB6 = ycoSrc;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiDrawBitmap, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiDrawBitmap, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -2360,7 +2360,7 @@ bool MTDS::TextOut(HDS hds, int cchText, char * rgchText) {
 	prm.valA1 = hds;
 	prm.valB1 = cchText;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiTextOutCch, sizeof(prm), (uint8_t *)&prm,
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiTextOutCch, sizeof(prm), (uint8_t *)&prm,
 						cchText, (uint8_t *)rgchText);
 
 	/* Check for error and return failure.
@@ -2407,7 +2407,7 @@ bool MTDS::TextOut(HDS hds, int16_t xco, int16_t yco, int cchText, char * rgchTe
 	prm.valB2 = yco;
 	prm.valB3 = cchText;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiTextOutXcoYco, sizeof(prm), (uint8_t *)&prm,
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiTextOutXcoYco, sizeof(prm), (uint8_t *)&prm,
 						cchText, (uint8_t *)rgchText);
 
 	/* Check for error and return failure.
@@ -2752,7 +2752,7 @@ bool MTDS::FrameRect(HDS hds, RCT * prct) {
 	prm.valB3 = prct->xcoRight;
 	prm.valB4 = prct->ycoBottom;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiFrameRect, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiFrameRect, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -2795,7 +2795,7 @@ bool MTDS::FillRect(HDS hds, RCT * prct, HBR hbr) {
 	prm.valB4 = prct->ycoBottom;
 	prm.valA2 = hbr;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiFillRect, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiFillRect, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
@@ -2836,7 +2836,7 @@ bool MTDS::InvertRect(HDS hds, RCT * prct) {
 	prm.valB3 = prct->xcoRight;
 	prm.valB4 = prct->ycoBottom;
 
-	MtdsProcessCmdWr(clsCmdGdi, cmdGdiInvertRect, sizeof(prm), (uint8_t *)&prm, 0, 0);
+	MtdsQueueCmdWr(clsCmdGdi, cmdGdiInvertRect, sizeof(prm), (uint8_t *)&prm, 0, 0);
 
 	/* Check for error and return failure.
 	*/
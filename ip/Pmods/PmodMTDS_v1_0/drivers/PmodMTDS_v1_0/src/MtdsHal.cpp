@@ -78,11 +78,25 @@ XSpi_Config MTDSSPIConfig =
 /*				Local Variables									*/
 /* ------------------------------------------------------------ */
 
+/* State of the block transfer in progress. The interrupt handler
+** advances it when interrupt driven completion is enabled.
+*/
+static uint8_t *			pbSpiBlkSnd;
+static uint8_t *			pbSpiBlkRcv;
+static uint8_t				bSpiBlkFill;
+static uint16_t				cbSpiBlk;
+static uint16_t				ibSpiBlkSnd;
+static uint16_t				ibSpiBlkRcv;
+static volatile bool		fSpiBlkDone = true;
+static bool					fSpiIntr = false;
+
 
 /* ------------------------------------------------------------ */
 /*				Forward Declarations							*/
 /* ------------------------------------------------------------ */
 
+static void	MtdsHalSpiPump();
+
 /* ------------------------------------------------------------ */
 /*				Procedure Definitions							*/
 /* ------------------------------------------------------------ */
@@ -162,10 +176,23 @@ void MtdsHalEnableStatusPin(int idPin) {
 **
 **	Description:
 **		Return the state of the specified status pin.
+**
+**		The status pins come in on GPIO channel 1. Bit 0 is Pmod pin 7
+**		(pinMtdsIntA) and bit 1 is Pmod pin 8, which carries pin B on the
+**		PmodMTDS.
 */
 
 bool MtdsHalGetStatusPin(int idPin) {
+	uint32_t	fsPin;
 
+	fsPin = Xil_In32(XPAR_PMODMTDS_0_AXI_LITE_GPIO_BASEADDR);
+
+	if (idPin == idPinStatusA) {
+		return (fsPin & 0b01) != 0;
+	}
+	if (idPin == idPinStatusB) {
+		return (fsPin & 0b10) != 0;
+	}
 	return false;
 }
 
@@ -304,6 +331,220 @@ uint8_t MtdsHalPutSpiByte(uint8_t bSnd) {
 	return bRcv;
 }
 
+/* ------------------------------------------------------------ */
+/***	MtdsHalBeginSpiBlock(cb, pbSnd, bFill, pbRcv)
+**
+**	Parameters:
+**		cb			- number of bytes to exchange
+**		pbSnd		- bytes to send, 0 to send bFill for every byte
+**		bFill		- byte to send when pbSnd is 0
+**		pbRcv		- buffer to receive the bytes read, 0 to discard them
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Start exchanging a block of bytes with the SPI slave (display board).
+**		Unlike MtdsHalPutSpiByte, the transfer inhibit bit is only toggled once
+**		for the whole block and up to cbMtdsSpiFifo bytes are kept in the
+**		controller at a time. The buffers must stay valid until
+**		MtdsHalSpiBlockDone returns true. Only one block can be in progress.
+*/
+
+void MtdsHalBeginSpiBlock(uint16_t cb, uint8_t * pbSnd, uint8_t bFill, uint8_t * pbRcv) {
+
+	pbSpiBlkSnd = pbSnd;
+	pbSpiBlkRcv = pbRcv;
+	bSpiBlkFill = bFill;
+	cbSpiBlk = cb;
+	ibSpiBlkSnd = 0;
+	ibSpiBlkRcv = 0;
+	fSpiBlkDone = (cb == 0);
+
+	if (fSpiBlkDone) {
+		return;
+	}
+
+	/* Throw away anything left in the receive register, then fill
+	** the transmitter and let it go.
+	*/
+	while ((XSpi_GetStatusReg(&MTDS_Spi) & XSP_SR_RX_EMPTY_MASK) == 0) {
+		XSpi_ReadReg(MTDS_Spi.BaseAddr, XSP_DRR_OFFSET);
+	}
+
+	XSpi_SetControlReg(&MTDS_Spi, XSpi_GetControlReg(&MTDS_Spi) | XSP_CR_TRANS_INHIBIT_MASK);
+	MtdsHalSpiPump();
+	XSpi_IntrClear(&MTDS_Spi, XSP_INTR_TX_EMPTY_MASK);
+	XSpi_SetControlReg(&MTDS_Spi, XSpi_GetControlReg(&MTDS_Spi) & ~XSP_CR_TRANS_INHIBIT_MASK);
+
+	if (fSpiIntr) {
+		XSpi_IntrEnable(&MTDS_Spi, XSP_INTR_TX_EMPTY_MASK);
+	}
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalSpiBlockDone()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns true when the block transfer has completed
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		When interrupt driven completion is enabled, this only checks the
+**		flag set by the interrupt handler. Otherwise it moves the transfer
+**		along, so it must be called until it returns true.
+*/
+
+bool MtdsHalSpiBlockDone() {
+
+	if (!fSpiIntr && !fSpiBlkDone) {
+		MtdsHalSpiPump();
+	}
+
+	return fSpiBlkDone;
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalPutSpiBlock(cb, pbSnd, bFill, pbRcv)
+**
+**	Parameters:
+**		cb			- number of bytes to exchange
+**		pbSnd		- bytes to send, 0 to send bFill for every byte
+**		bFill		- byte to send when pbSnd is 0
+**		pbRcv		- buffer to receive the bytes read, 0 to discard them
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Exchange a block of bytes with the SPI slave (display board) and
+**		wait for it to complete.
+*/
+
+void MtdsHalPutSpiBlock(uint16_t cb, uint8_t * pbSnd, uint8_t bFill, uint8_t * pbRcv) {
+
+	MtdsHalBeginSpiBlock(cb, pbSnd, bFill, pbRcv);
+	while (!MtdsHalSpiBlockDone()) {
+	}
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalEnableSpiIntr(fEn)
+**
+**	Parameters:
+**		fEn		- true to complete block transfers from the SPI interrupt
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Block transfers are polled by default. Before enabling interrupt
+**		driven completion, the application must connect MtdsHalSpiIntrHandler
+**		to the SPI interrupt of the PmodMTDS in its interrupt controller.
+**		The CPU is then free while a block is in progress, see
+**		MtdsHalBeginSpiBlock and MtdsHalSpiBlockDone.
+*/
+
+void MtdsHalEnableSpiIntr(bool fEn) {
+
+	while (!MtdsHalSpiBlockDone()) {
+	}
+
+	fSpiIntr = fEn;
+	XSpi_IntrDisable(&MTDS_Spi, XSP_INTR_TX_EMPTY_MASK);
+	if (fEn) {
+		XSpi_IntrGlobalEnable(&MTDS_Spi);
+	}
+	else {
+		XSpi_IntrGlobalDisable(&MTDS_Spi);
+	}
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalSpiIntrHandler(pvRef)
+**
+**	Parameters:
+**		pvRef	- callback reference from the interrupt controller, not used
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		SPI interrupt handler. The transmitter going empty means the bytes
+**		in flight have been exchanged, so read them and send the next ones.
+*/
+
+void MtdsHalSpiIntrHandler(void * pvRef) {
+
+	XSpi_IntrClear(&MTDS_Spi, XSpi_IntrGetStatus(&MTDS_Spi));
+
+	if (!fSpiBlkDone) {
+		MtdsHalSpiPump();
+	}
+
+	if (fSpiBlkDone) {
+		XSpi_IntrDisable(&MTDS_Spi, XSP_INTR_TX_EMPTY_MASK);
+	}
+}
+
+/* ------------------------------------------------------------ */
+/***	MtdsHalSpiPump()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Read whatever bytes of the current block have come in, and
+**		top up the transmitter so no more than cbMtdsSpiFifo bytes
+**		are in flight. Stop the transfer when all bytes are in.
+*/
+
+static void MtdsHalSpiPump() {
+	uint8_t	bRcv;
+
+	while ((ibSpiBlkRcv < ibSpiBlkSnd) &&
+			((XSpi_GetStatusReg(&MTDS_Spi) & XSP_SR_RX_EMPTY_MASK) == 0)) {
+		bRcv = XSpi_ReadReg(MTDS_Spi.BaseAddr, XSP_DRR_OFFSET);
+		if (pbSpiBlkRcv != 0) {
+			pbSpiBlkRcv[ibSpiBlkRcv] = bRcv;
+		}
+		ibSpiBlkRcv += 1;
+	}
+
+	while ((ibSpiBlkSnd < cbSpiBlk) && ((ibSpiBlkSnd - ibSpiBlkRcv) < cbMtdsSpiFifo)) {
+		XSpi_WriteReg(MTDS_Spi.BaseAddr, XSP_DTR_OFFSET, (pbSpiBlkSnd != 0) ? pbSpiBlkSnd[ibSpiBlkSnd] : bSpiBlkFill);
+		ibSpiBlkSnd += 1;
+	}
+
+	if (ibSpiBlkRcv == cbSpiBlk) {
+		XSpi_SetControlReg(&MTDS_Spi, XSpi_GetControlReg(&MTDS_Spi) | XSP_CR_TRANS_INHIBIT_MASK);
+		fSpiBlkDone = true;
+	}
+}
+
 /* ------------------------------------------------------------ */
 /***	MtdsHalTmsElapsed()
 **
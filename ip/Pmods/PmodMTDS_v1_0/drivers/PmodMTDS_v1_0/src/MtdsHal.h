@@ -101,6 +101,15 @@ void inline delay(int milliseconds){
 //TODO: This value is not required for FPGA designs, but it should be fixed to be accurate
 #define	frqMtdsSpiDefault	4000000
 
+/* Depth of the transmit/receive FIFOs of the AXI Quad SPI controller. The
+** block transfer functions keep this many bytes in flight. The PmodMTDS IP is
+** built with C_FIFO_DEPTH = 0, which is a single data register, so this is 1.
+** Set it to 16 or 256 if the IP is rebuilt with FIFOs.
+*/
+#if !defined(cbMtdsSpiFifo)
+#define	cbMtdsSpiFifo		1
+#endif
+
 
 /* ------------------------------------------------------------ */
 /*					General Type Declarations					*/
@@ -132,6 +141,11 @@ void		MtdsHalInitSpi(uint32_t pspiInit, uint32_t frq);
 void		MtdsHalEnableSlave(bool fEn);
 bool		MtdsHalSpiReady();
 uint8_t		MtdsHalPutSpiByte(uint8_t bSnd);
+void		MtdsHalBeginSpiBlock(uint16_t cb, uint8_t * pbSnd, uint8_t bFill, uint8_t * pbRcv);
+bool		MtdsHalSpiBlockDone();
+void		MtdsHalPutSpiBlock(uint16_t cb, uint8_t * pbSnd, uint8_t bFill, uint8_t * pbRcv);
+void		MtdsHalEnableSpiIntr(bool fEn);
+void		MtdsHalSpiIntrHandler(void * pvRef);
 uint32_t	MtdsHalTmsElapsed();
 void		MtdsHalDelayMs(uint32_t tmsDelay);
 uint32_t	MtdsHalTusElapsed();
@@ -36,6 +36,9 @@
 /*				Local Type Definitions							*/
 /* ------------------------------------------------------------ */
 
+/* Status pin A says the shield has messages queued, at the level in mtds.h.
+*/
+#define	FMtdsMsgPinSet()	(MtdsHalGetStatusPin(idPinStatusA) == (stMtdsMsgPinActive != 0))
 
 /* ------------------------------------------------------------ */
 /*				Global Variables								*/
@@ -464,7 +467,8 @@ bool MTDS::ClearDisplay(uint16_t clr) {
 **		the hardware interface spec and may or may not be supported. An attempt to enable
 **		a non-supported status pin will fail, with an error code of staUtilNotSupported.
 **		When supported, status pin A is set when there are touch messages in the message
-**		queue.
+**		queue. While it is enabled the message functions below only talk to the shield
+**		when the pin is set, and serve messages from a local queue otherwise.
 **		When supported, status pin B is used internally as part of the communications
 **		protocol between the host and the display hardware and its use can reduce some
 **		of the communications overhead.
@@ -491,6 +495,13 @@ bool MTDS::EnableStatusPin(int idPin, int fEn) {
 		return false;
 	}
 
+	/* Messages already drained into the local queue stay there, and are
+	** returned ahead of those still on the shield when the pin is disabled.
+	*/
+	if (idPin == idPinStatusA) {
+		fMsgPin = (fEn != 0);
+	}
+
 	return true;
 }
 
@@ -696,12 +707,19 @@ bool MTDS::GetTchMoveDelta(int16_t * pdxco, int16_t * pdyco) {
 **		None
 **
 **	Description:
-**		Query the shield for the status of the event system.
+**		Query the shield for the status of the event system. While status
+**		pin A is enabled this is the number of messages in the local queue,
+**		which is only refilled from the shield when the pin is set.
 */
 
 uint32_t MTDS::GetMsgStatus() {
 	RET4A *	pret = (RET4A *)&rgbMtdsRetVal[sizeof(RHDR)];
 
+	if (fMsgPin || (cevtMsgQueued != 0)) {
+		MtdsFillMsgQueue();
+		return cevtMsgQueued;
+	}
+
 	/* Send the command packet.
 	*/
 	MtdsProcessCmdWr(clsCmdUtil, cmdUtilGetMsgStatus, 0, 0, 0, 0);
@@ -731,11 +749,15 @@ uint32_t MTDS::GetMsgStatus() {
 **		Returns true if successful, false if not
 **
 **	Description:
-**		Clear and reset the event queue on the shield.
+**		Clear and reset the event queue on the shield, and the local
+**		queue.
 */
 
 bool MTDS::ClearMsgQueue() {
 
+	ievtMsgHead = 0;
+	cevtMsgQueued = 0;
+
 	/* Send the command packet.
 	*/
 	MtdsProcessCmdWr(clsCmdUtil, cmdUtilClearMsgQueue, 0, 0, 0, 0);
@@ -767,27 +789,14 @@ bool MTDS::ClearMsgQueue() {
 */
 
 bool MTDS::PeekMsg(MEVT * pevt) {
-	RET4A *	pret = (RET4A *)&rgbMtdsRetVal[sizeof(RHDR)];
 
-	/* Send the command packet.
-	*/
-	MtdsProcessCmdWr(clsCmdUtil, cmdUtilPeekMsg, 0, 0, 0, 0);
-
-	/* Check for error and return failure if so.
-	*/
-	if (prhdrMtdsRet->sta != staCmdSuccess) {
-		return false;
+	MtdsFillMsgQueue();
+	if (cevtMsgQueued != 0) {
+		*pevt = rgevtMsgQueue[ievtMsgHead];
+		return true;
 	}
 
-	/* Unpack the message from the return value packet.
-	*/
-	pevt->tms = pret->valA1;
-	pevt->hwin = pret->valA2;
-	pevt->msg = (pret->valA3 >> 16) & 0xFFFF;
-	pevt->val1 = pret->valA3 & 0xFFFF;
-	pevt->val2 = pret->valA4;
-
-	return true;
+	return MtdsRcvMsg(cmdUtilPeekMsg, pevt);
 
 }
 
@@ -809,27 +818,16 @@ bool MTDS::PeekMsg(MEVT * pevt) {
 */
 
 bool MTDS::GetMsg(MEVT * pevt) {
-	RET4A *	pret = (RET4A *)&rgbMtdsRetVal[sizeof(RHDR)];
 
-	/* Send the command packet.
-	*/
-	MtdsProcessCmdWr(clsCmdUtil, cmdUtilGetMsg, 0, 0, 0, 0);
-
-	/* Check for error and return failure if so.
-	*/
-	if (prhdrMtdsRet->sta != staCmdSuccess) {
-		return false;
+	MtdsFillMsgQueue();
+	if (cevtMsgQueued != 0) {
+		*pevt = rgevtMsgQueue[ievtMsgHead];
+		ievtMsgHead = (ievtMsgHead + 1) % cevtMtdsMsgQueue;
+		cevtMsgQueued -= 1;
+		return true;
 	}
 
-	/* Unpack the message from the return value packet.
-	*/
-	pevt->tms = pret->valA1;
-	pevt->hwin = pret->valA2;
-	pevt->msg = (pret->valA3 >> 16) & 0xFFFF;
-	pevt->val1 = pret->valA3 & 0xFFFF;
-	pevt->val2 = pret->valA4;
-
-	return true;
+	return MtdsRcvMsg(cmdUtilGetMsg, pevt);
 
 }
 
@@ -884,12 +882,30 @@ bool MTDS::PostMsg(MEVT * pevt) {
 **		Returns true if successful, false if error
 **
 **	Description:
-**		Put the specified event at the head of the queue
+**		Put the specified event at the head of the queue. Messages already
+**		drained into the local queue are ahead of the shield's queue, so while
+**		the local queue is in use the event goes to its head. If the local
+**		queue is full this fails with staUtilEventCacheExhausted rather than
+**		putting the event behind the queued messages.
 */
 
 bool MTDS::PushMsg(MEVT * pevt) {
 	PRM4A		prm;
 
+	if (fMsgPin || (cevtMsgQueued != 0)) {
+		if (cevtMsgQueued >= cevtMtdsMsgQueue) {
+			clsLastError = clsCmdUtil;
+			cmdLastError = cmdUtilPushMsg;
+			staLastError = staUtilEventCacheExhausted;
+			return false;
+		}
+
+		ievtMsgHead = (ievtMsgHead + cevtMtdsMsgQueue - 1) % cevtMtdsMsgQueue;
+		rgevtMsgQueue[ievtMsgHead] = *pevt;
+		cevtMsgQueued += 1;
+		return true;
+	}
+
 	/* Send the command packet.
 	*/
 	prm.valA1 = pevt->tms;
@@ -909,6 +925,94 @@ bool MTDS::PushMsg(MEVT * pevt) {
 
 }
 
+/* ------------------------------------------------------------ */
+/***	MTDS::MtdsRcvMsg(cmd, pevt)
+**
+**	Parameters:
+**		cmd			- cmdUtilGetMsg or cmdUtilPeekMsg
+**		pevt		- pointer to structure to receive the event
+**
+**	Return Values:
+**		Returns error status
+**
+**	Errors:
+**		Returns true if successful, false if error
+**
+**	Description:
+**		Read the next event from the event queue on the shield.
+*/
+
+bool MTDS::MtdsRcvMsg(uint8_t cmd, MEVT * pevt) {
+	RET4A *	pret = (RET4A *)&rgbMtdsRetVal[sizeof(RHDR)];
+
+	/* While status pin A is enabled a clear pin means the shield has nothing
+	** queued, so don't spend a command finding that out.
+	*/
+	if (fMsgPin && !FMtdsMsgPinSet()) {
+		clsLastError = clsCmdUtil;
+		cmdLastError = cmd;
+		staLastError = staCmdError;
+		return false;
+	}
+
+	/* Send the command packet.
+	*/
+	MtdsProcessCmdWr(clsCmdUtil, cmd, 0, 0, 0, 0);
+
+	/* Check for error and return failure if so.
+	*/
+	if (prhdrMtdsRet->sta != staCmdSuccess) {
+		return false;
+	}
+
+	/* Unpack the message from the return value packet.
+	*/
+	pevt->tms = pret->valA1;
+	pevt->hwin = pret->valA2;
+	pevt->msg = (pret->valA3 >> 16) & 0xFFFF;
+	pevt->val1 = pret->valA3 & 0xFFFF;
+	pevt->val2 = pret->valA4;
+
+	return true;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MTDS::MtdsFillMsgQueue()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		If status pin A is enabled and set, move messages from the shield
+**		into the local queue until the pin drops or the local queue is full.
+**		Reading the pin is a register access, so when the shield has nothing
+**		to report this costs no SPI traffic.
+*/
+
+void MTDS::MtdsFillMsgQueue() {
+	uint8_t		ievt;
+
+	if (!fMsgPin) {
+		return;
+	}
+
+	while ((cevtMsgQueued < cevtMtdsMsgQueue) && FMtdsMsgPinSet()) {
+		ievt = (ievtMsgHead + cevtMsgQueued) % cevtMtdsMsgQueue;
+		if (!MtdsRcvMsg(cmdUtilGetMsg, &rgevtMsgQueue[ievt])) {
+			break;
+		}
+		cevtMsgQueued += 1;
+	}
+
+}
+
 /* ------------------------------------------------------------ */
 /***	MTDS::GetMemStatus(pmstat)
 **
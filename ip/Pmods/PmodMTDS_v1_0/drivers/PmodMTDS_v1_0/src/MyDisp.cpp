@@ -35,6 +35,7 @@
 #include	<stdint.h>
 #include	<string.h>
 
+#include	"ProtoDefs.h"
 #include	"MyDisp.h"
 
 /* ------------------------------------------------------------ */
@@ -90,6 +91,7 @@ MYDISP::MYDISP() {
 	idBtnTrack = -1;
 	hdsDisp = 0;
 	hdsBlt = 0;
+	hdsCmp = 0;
 	hbrFg = 0;
 	ityCur = 100;
 
@@ -175,6 +177,13 @@ bool MYDISP::begin() {
 		return false;
 	}
 
+	/* The DS used to build cached button images is optional. Without it, buttons
+	** are drawn from their bitmaps each time their state changes.
+	*/
+	if ((hdsCmp = mtds.GetDs()) != 0) {
+		mtds.SetDrwRop(hdsCmp, drwCopyPen);
+	}
+
 	idBtnTrack = -1;
 	clrFg = clrWhite;
 	clrBg = clrBlack;
@@ -200,7 +209,15 @@ bool MYDISP::begin() {
 		rgbtn[ibtn].hbmpUp = 0;
 		rgbtn[ibtn].hbmpDn = 0;
 		rgbtn[ibtn].hbmpBg = 0;
+		rgbtn[ibtn].hbmpCmpUp = 0;
+		rgbtn[ibtn].hbmpCmpDn = 0;
 	}
+	memset(rgfsBtnGrid, 0, sizeof(rgfsBtnGrid));
+
+	/* Start with an empty image cache.
+	*/
+	memset(rgimg, 0, sizeof(rgimg));
+	tckImg = 0;
 
 	/* Initialize the finger activity array.
 	*/
@@ -244,8 +261,14 @@ void MYDISP::end() {
 		deleteButton(ibtn);
 	}
 
+	flushImages();
+
 	mtds.ReleaseDs(hdsDisp);
 	mtds.ReleaseDs(hdsBlt);
+	if (hdsCmp != 0) {
+		mtds.ReleaseDs(hdsCmp);
+		hdsCmp = 0;
+	}
 
 	mtds.end();
 	fInitialized = false;
@@ -351,10 +374,16 @@ bool MYDISP::setBackground(uint32_t clr) {
 **		Returns true if successful, false if not.
 **
 **	Description:
-**		Set the background transparency mode.
+**		Set the background transparency mode. Buttons are drawn using this mode,
+**		so the cached button images are rebuilt the next time they are needed.
 */
 
 bool MYDISP::setTransparency(bool fTrans) {
+	int		ibtn;
+
+	for (ibtn = 0; ibtn < NUM_BUTTONS; ibtn++) {
+		rgbtn[ibtn].fs &= ~(fsBtnCmpUp|fsBtnCmpDn);
+	}
 
 	bkCur = fTrans ? bkTransparent : bkOpaque;
 	return mtds.SetBkMode(hdsDisp, bkCur);
@@ -570,14 +599,31 @@ bool MYDISP::drawText(char * txt, int x, int y) {
 **		Returns true if successful, false if not.
 **
 **	Description:
-**		This function will load a bitmap file from the SD card and draw it at the
-**		specified location. The bitmap is discarded after being drawn.
+**		This function will draw the named bitmap file at the specified location.
+**		The bitmap is loaded from the SD card the first time it is drawn and then
+**		kept in the image cache, so drawing it again doesn't reload the file.
+**		A bitmap whose name is too long for the cache is loaded from the SD card
+**		and discarded after being drawn.
+**		The cache is keyed by name only. After the file is replaced on the SD
+**		card, for example with SndFile(), call flushImage() with its name or
+**		flushImages() so that the new file is loaded the next time it is drawn.
 */
 
 bool MYDISP::drawImage(char * name, int x, int y) {
 	HBMP	hbmp;
+	int		iimg;
 
-	if ((hbmp = mtds.LoadBitmap(name)) == 0) {
+	if (strlen(name) < cchImgNameMax) {
+		if ((iimg = IimgCache(name)) < 0) {
+			return false;
+		}
+
+		mtds.SetDrawingSurface(hdsBlt, rgimg[iimg].hbmp);
+		return mtds.DrawBitmap(hdsDisp, (int16_t)x, (int16_t)y,
+								rgimg[iimg].dxco, rgimg[iimg].dyco, hdsBlt, 0, 0);
+	}
+
+	if ((hbmp = HbmpLoadEvict(name)) == 0) {
 		/* Unable to load the bitmap.
 		*/
 #if !defined(__SIM__)
@@ -644,13 +690,14 @@ bool MYDISP::drawImage(HBMP hbmp, int x, int y) {
 **
 **	Description:
 **		This function will read the specified image file and load it into
-**		memory as an internal, device-dependent bitmap.
+**		memory as an internal, device-dependent bitmap. If the shield runs out
+**		of memory, cached images are discarded to make room.
 */
 
 HBMP MYDISP::loadImage(char * name) {
 	HBMP		hbmp;
 
-	if ((hbmp = mtds.LoadBitmap(name)) == 0) {
+	if ((hbmp = HbmpLoadEvict(name)) == 0) {
 		/* Unable to load the bitmap.
 		*/
 #if !defined(__SIM__)
@@ -666,6 +713,96 @@ HBMP MYDISP::loadImage(char * name) {
 
 }
 
+/* ------------------------------------------------------------ */
+/***	MYDISP::preloadImage(name)
+**
+**	Parameters:
+**		name		- filename of the bitmap file to load
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		Returns true if successful, false if not.
+**
+**	Description:
+**		Load the named bitmap file into the image cache without drawing it, so
+**		that the first drawImage() of it doesn't have to wait for the SD card.
+**		This is normally done for each icon right after begin().
+*/
+
+bool MYDISP::preloadImage(char * name) {
+
+	if (strlen(name) >= cchImgNameMax) {
+		return false;
+	}
+
+	return IimgCache(name) >= 0;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MYDISP::flushImages()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Discard every image in the image cache and give its display memory back.
+**		Call this after replacing image files on the SD card.
+*/
+
+void MYDISP::flushImages() {
+	int		iimg;
+
+	for (iimg = 0; iimg < NUM_IMAGES; iimg++) {
+		if (rgimg[iimg].hbmp != 0) {
+			mtds.DestroyBitmap(rgimg[iimg].hbmp);
+			rgimg[iimg].hbmp = 0;
+		}
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MYDISP::flushImage(name)
+**
+**	Parameters:
+**		name		- filename of the bitmap file
+**
+**	Return Values:
+**		Returns true if the image was in the cache, false if not
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Discard the named image from the image cache, so that the next
+**		drawImage() of it loads the file again. Call this after replacing the
+**		file on the SD card.
+*/
+
+bool MYDISP::flushImage(char * name) {
+	int		iimg;
+
+	for (iimg = 0; iimg < NUM_IMAGES; iimg++) {
+		if ((rgimg[iimg].hbmp != 0) && (strcmp(rgimg[iimg].szName, name) == 0)) {
+			mtds.DestroyBitmap(rgimg[iimg].hbmp);
+			rgimg[iimg].hbmp = 0;
+			return true;
+		}
+	}
+
+	return false;
+
+}
+
 /* ------------------------------------------------------------ */
 /***	MYDISP::createButton(id, name, x, y)
 **
@@ -696,7 +833,7 @@ bool MYDISP::createButton(int id, char * name, int x, int y) {
 
 	/* Load the bitmap used to render the button.
 	*/
-	if ((hbmp = mtds.LoadBitmap(name)) == 0) {
+	if ((hbmp = HbmpLoadEvict(name)) == 0) {
 #if !defined(__SIM__)
 #if defined(__MTDSTRACE__)
 		Serial.print("!createButton ");
@@ -748,7 +885,7 @@ bool MYDISP::createButton(int id, char * name1, char * name2, int x, int y) {
 	/* Load the bitmaps used to render the button.
 	** The first bitmap is used to render the button in the UP state.
 	*/
-	if ((hbmp1 = mtds.LoadBitmap(name1)) == 0) {
+	if ((hbmp1 = HbmpLoadEvict(name1)) == 0) {
 #if !defined(__SIM__)
 #if defined(__MTDSTRACE__)
 		Serial.print("!createButton ");
@@ -760,7 +897,7 @@ bool MYDISP::createButton(int id, char * name1, char * name2, int x, int y) {
 
 	/* The second bitmap is used to render the button in the DOWN state.
 	*/
-	if ((hbmp2 = mtds.LoadBitmap(name2)) == 0) {
+	if ((hbmp2 = HbmpLoadEvict(name2)) == 0) {
 #if !defined(__SIM__)
 #if defined(__MTDSTRACE__)
 		Serial.print("!createButton ");
@@ -816,6 +953,9 @@ bool MYDISP::createButton(int id, HBMP hbmp1, HBMP hbmp2, int x, int y) {
 	rgbtn[id].fs = 0;
 	rgbtn[id].hbmpUp = hbmp1;
 	rgbtn[id].hbmpDn = hbmp2;
+	rgbtn[id].hbmpCmpUp = 0;
+	rgbtn[id].hbmpCmpDn = 0;
+	rgbtn[id].stPost = BUTTON_UP;
 
 	/* We use the button-up bitmap to establish the button dimensions.
 	*/
@@ -826,7 +966,7 @@ bool MYDISP::createButton(int id, HBMP hbmp1, HBMP hbmp2, int x, int y) {
 	/* Create the bitmap used to hold the background behind the button so that we
 	** can erase it later.
 	*/
-	if ((rgbtn[id].hbmpBg = mtds.CreateBitmap(bmpd.dxco, bmpd.dyco, bmpd.cbpp)) == 0) {
+	if ((rgbtn[id].hbmpBg = HbmpCreateEvict(bmpd.dxco, bmpd.dyco, bmpd.cbpp)) == 0) {
 		goto lErrorExit;
 	}
 
@@ -878,6 +1018,9 @@ bool MYDISP::deleteButton(int id) {
 	/* Release any bitmaps associated with this button and then mark the button
 	** as not being allocated.
 	*/
+	if ((rgbtn[id].fs & fsBtnEnabled) != 0) {
+		SetBtnGrid(id, false);
+	}
 	DeleteBtnBitmaps(id);
 	rgbtn[id].fs = 0;
 
@@ -923,6 +1066,11 @@ bool MYDISP::enableButton(int id, bool fEn) {
 			mtds.SetDrawingSurface(hdsBlt, rgbtn[id].hbmpBg);
 			mtds.BitBlt(hdsBlt, 0, 0, rgbtn[id].dxco, rgbtn[id].dyco,
 							hdsDisp, rgbtn[id].rct.xcoLeft, rgbtn[id].rct.ycoTop, ropSrcCopy);
+
+			/* The cached button images were built over the old background.
+			*/
+			rgbtn[id].fs &= ~(fsBtnCmpUp|fsBtnCmpDn);
+			SetBtnGrid(id, true);
 		}
 
 		/* Mark the button as being enabled and clear its last known drawing state.
@@ -931,8 +1079,13 @@ bool MYDISP::enableButton(int id, bool fEn) {
 		rgbtn[id].fs &= ~(fsBtnImageUp|fsBtnImageDn);
 	}
 	else {
-		/* Mark the button as being disabled.
+		/* Mark the button as being disabled. It can no longer be touched, and the
+		** memory used by its cached images is given back to the shield.
 		*/
+		if ((rgbtn[id].fs & fsBtnEnabled) != 0) {
+			SetBtnGrid(id, false);
+			DeleteBtnImages(id);
+		}
 		rgbtn[id].fs &= ~fsBtnEnabled;
 	}
 
@@ -953,7 +1106,8 @@ bool MYDISP::enableButton(int id, bool fEn) {
 **		Returns true if successful, false if not
 **
 **	Description:
-**		Update the visible state of the button as specified
+**		Update the visible state of the button as specified. This replaces any
+**		state posted for the button with postButton().
 */
 
 bool MYDISP::drawButton(int id, int st) {
@@ -964,6 +1118,8 @@ bool MYDISP::drawButton(int id, int st) {
 		return false;
 	}
 
+	rgbtn[id].fs &= ~fsBtnDirty;
+
 	/* Check that the button is enabled. We only draw enabled buttons.
 	*/
 	if ((rgbtn[id].fs & fsBtnEnabled) == 0) {
@@ -977,22 +1133,7 @@ bool MYDISP::drawButton(int id, int st) {
 			/* If the button is already drawn in the "up" state, don't draw it again.
 			*/
 			if ((rgbtn[id].fs & fsBtnImageUp) == 0) {
-				/* Erase the background before drawing the button.
-				*/
-				mtds.SetDrawingSurface(hdsBlt, rgbtn[id].hbmpBg);
-				mtds.BitBlt(hdsDisp, rgbtn[id].rct.xcoLeft, rgbtn[id].rct.ycoTop,
-									rgbtn[id].dxco, rgbtn[id].dyco,
-									hdsBlt, 0, 0, ropSrcCopy);
-
-				/* Draw the button in the up/un-pressed state by drawing the UP bitmap
-				** on the display.
-				*/
-				mtds.SetDrawingSurface(hdsBlt, rgbtn[id].hbmpUp);
-				mtds.SetIntensity(hdsDisp, 100);
-				mtds.DrawBitmap(hdsDisp, rgbtn[id].rct.xcoLeft, rgbtn[id].rct.ycoTop,
-									 rgbtn[id].dxco, rgbtn[id].dyco,
-									 hdsBlt, 0, 0);
-				mtds.SetIntensity(hdsDisp, ityCur);
+				DrawBtnImage(id, BUTTON_UP);
 			}
 
 			/* Mark that it is drawn in the up state.
@@ -1006,27 +1147,7 @@ bool MYDISP::drawButton(int id, int st) {
 			** again.
 			*/
 			if ((rgbtn[id].fs & fsBtnImageDn) == 0) {
-				/* Erase the background before drawing the button.
-				*/
-				mtds.SetDrawingSurface(hdsBlt, rgbtn[id].hbmpBg);
-				mtds.BitBlt(hdsDisp, rgbtn[id].rct.xcoLeft, rgbtn[id].rct.ycoTop,
-									rgbtn[id].dxco, rgbtn[id].dyco,
-									hdsBlt, 0, 0, ropSrcCopy);
-
-				/* Draw the button in the down/pressed state.
-				*/
-				if (rgbtn[id].hbmpDn == 0) {
-					mtds.SetDrawingSurface(hdsBlt, rgbtn[id].hbmpUp);
-					mtds.SetIntensity(hdsDisp, 50);
-				}
-				else {
-					mtds.SetDrawingSurface(hdsBlt, rgbtn[id].hbmpDn);
-					mtds.SetIntensity(hdsDisp, 100);
-				}
-				mtds.DrawBitmap(hdsDisp, rgbtn[id].rct.xcoLeft, rgbtn[id].rct.ycoTop,
-									rgbtn[id].dxco, rgbtn[id].dyco,
-									hdsBlt, 0, 0);
-				mtds.SetIntensity(hdsDisp, ityCur);
+				DrawBtnImage(id, BUTTON_DOWN);
 			}
 
 			/* Mark that it is drawn in the down state.
@@ -1051,6 +1172,86 @@ bool MYDISP::drawButton(int id, int st) {
 	return true;
 }
 
+/* ------------------------------------------------------------ */
+/***	MYDISP::postButton(id, st)
+**
+**	Parameters:
+**		id		- button identifier
+**		st		- button state to show: BUTTON_UP, BUTTON_DOWN or BUTTON_ERASE
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		Returns true if successful, false if not
+**
+**	Description:
+**		Record the state the button should be shown in without drawing it. The
+**		button is drawn by the next call to updateButtons(). Posting a state
+**		more than once before the update only draws the last one, and nothing
+**		is drawn if it is the state already on the display.
+*/
+
+bool MYDISP::postButton(int id, int st) {
+
+	if ((id < 0) || (id >= NUM_BUTTONS) || ((rgbtn[id].fs & fsBtnAlloc) == 0)) {
+		return false;
+	}
+
+	if ((st != BUTTON_UP) && (st != BUTTON_DOWN) && (st != BUTTON_ERASE)) {
+		return false;
+	}
+
+	rgbtn[id].stPost = st;
+	rgbtn[id].fs |= fsBtnDirty;
+
+	return true;
+}
+
+/* ------------------------------------------------------------ */
+/***	MYDISP::updateButtons()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		Returns true if successful, false if not
+**
+**	Description:
+**		Draw every button whose state has been posted since it was last drawn.
+**		The drawing is recorded in a display list, unless the caller already
+**		has one open, so that it goes to the shield back to back.
+*/
+
+bool MYDISP::updateButtons() {
+	int		ibtn;
+	bool	fDlst;
+	bool	fStat;
+
+	fDlst = !mtds.FDisplayListOpen();
+	if (fDlst) {
+		mtds.BeginDisplayList();
+	}
+
+	fStat = true;
+	for (ibtn = 0; ibtn < NUM_BUTTONS; ibtn++) {
+		if ((rgbtn[ibtn].fs & fsBtnDirty) != 0) {
+			if (!drawButton(ibtn, rgbtn[ibtn].stPost)) {
+				fStat = false;
+			}
+		}
+	}
+
+	if (fDlst && !mtds.EndDisplayList()) {
+		fStat = false;
+	}
+
+	return fStat;
+}
+
 /* ------------------------------------------------------------ */
 /***	MYDISP::isEnabled(id)
 **
@@ -1323,14 +1524,22 @@ void MYDISP::checkTouch() {
 **	Description:
 **		This function will check the button array and return the ID of the first 
 **		visible button that contains the specified coordinate. It returns -1 if
-**		no visible button contains the specified coordinate.
+**		no visible button contains the specified coordinate. Only the buttons
+**		that overlap the grid cell containing the point are checked.
 */
 
 int MYDISP::IdBtnFromXcoYco(int16_t xco, int16_t yco) {
-	int		ibtn;
+	uint32_t	fsCell;
+	int			ibtn;
 
-	for (ibtn = 0; ibtn < NUM_BUTTONS; ibtn++) {
-		if (((rgbtn[ibtn].fs & fsBtnAlloc) != 0) && ((rgbtn[ibtn].fs & fsBtnEnabled) != 0)) {
+	if ((xco < 0) || (yco < 0) ||
+		(xco >= cBtnGrid*dcoBtnGrid) || (yco >= cBtnGrid*dcoBtnGrid)) {
+		return -1;
+	}
+
+	fsCell = rgfsBtnGrid[yco / dcoBtnGrid][xco / dcoBtnGrid];
+	for (ibtn = 0; fsCell != 0; ibtn++, fsCell >>= 1) {
+		if ((fsCell & 1) != 0) {
 			if (mtds.PointInRect(&(rgbtn[ibtn].rct), xco, yco)) {
 				return ibtn;
 			}
@@ -1341,6 +1550,191 @@ int MYDISP::IdBtnFromXcoYco(int16_t xco, int16_t yco) {
 
 }
 
+/* ------------------------------------------------------------ */
+/***	MYDISP::SetBtnGrid(id, fSet)
+**
+**	Parameters:
+**		id		- button id
+**		fSet	- true to add the button to the grid, false to remove it
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Set or clear the button's bit in every hit test grid cell that its
+**		rectangle overlaps. Any part of the button that is off the grid can't
+**		be touched and is ignored.
+*/
+
+void MYDISP::SetBtnGrid(int id, bool fSet) {
+	RCT *		prct;
+	uint32_t	fsBtn;
+	int			xcell1;
+	int			ycell1;
+	int			xcell2;
+	int			ycell2;
+	int			xcell;
+	int			ycell;
+
+	prct = &(rgbtn[id].rct);
+	if ((prct->xcoRight < 0) || (prct->ycoBottom < 0) ||
+		(prct->xcoLeft >= cBtnGrid*dcoBtnGrid) || (prct->ycoTop >= cBtnGrid*dcoBtnGrid)) {
+		return;
+	}
+
+	xcell1 = (prct->xcoLeft < 0) ? 0 : prct->xcoLeft / dcoBtnGrid;
+	ycell1 = (prct->ycoTop < 0) ? 0 : prct->ycoTop / dcoBtnGrid;
+	xcell2 = (prct->xcoRight >= cBtnGrid*dcoBtnGrid) ? cBtnGrid - 1 : prct->xcoRight / dcoBtnGrid;
+	ycell2 = (prct->ycoBottom >= cBtnGrid*dcoBtnGrid) ? cBtnGrid - 1 : prct->ycoBottom / dcoBtnGrid;
+
+	fsBtn = (uint32_t)1 << id;
+	for (ycell = ycell1; ycell <= ycell2; ycell++) {
+		for (xcell = xcell1; xcell <= xcell2; xcell++) {
+			if (fSet) {
+				rgfsBtnGrid[ycell][xcell] |= fsBtn;
+			}
+			else {
+				rgfsBtnGrid[ycell][xcell] &= ~fsBtn;
+			}
+		}
+	}
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MYDISP::DrawBtnImage(id, st)
+**
+**	Parameters:
+**		id		- button id
+**		st		- BUTTON_UP or BUTTON_DOWN
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Draw the button on the display in the specified state. When a cached
+**		image of the button over its background is available this is a single
+**		copy. Otherwise the background is restored and the button bitmap drawn
+**		over it.
+*/
+
+void MYDISP::DrawBtnImage(int id, int st) {
+
+	if (FComposeBtnImage(id, st)) {
+		mtds.SetDrawingSurface(hdsBlt, (st == BUTTON_UP) ? rgbtn[id].hbmpCmpUp : rgbtn[id].hbmpCmpDn);
+		mtds.BitBlt(hdsDisp, rgbtn[id].rct.xcoLeft, rgbtn[id].rct.ycoTop,
+							rgbtn[id].dxco, rgbtn[id].dyco,
+							hdsBlt, 0, 0, ropSrcCopy);
+		return;
+	}
+
+	/* Erase the background before drawing the button.
+	*/
+	mtds.SetDrawingSurface(hdsBlt, rgbtn[id].hbmpBg);
+	mtds.BitBlt(hdsDisp, rgbtn[id].rct.xcoLeft, rgbtn[id].rct.ycoTop,
+						rgbtn[id].dxco, rgbtn[id].dyco,
+						hdsBlt, 0, 0, ropSrcCopy);
+
+	/* Draw the button bitmap for the state. A button without a down bitmap is
+	** drawn pressed by dimming the up bitmap.
+	*/
+	if ((st == BUTTON_DOWN) && (rgbtn[id].hbmpDn == 0)) {
+		mtds.SetDrawingSurface(hdsBlt, rgbtn[id].hbmpUp);
+		mtds.SetIntensity(hdsDisp, 50);
+	}
+	else {
+		mtds.SetDrawingSurface(hdsBlt, (st == BUTTON_UP) ? rgbtn[id].hbmpUp : rgbtn[id].hbmpDn);
+		mtds.SetIntensity(hdsDisp, 100);
+	}
+	mtds.DrawBitmap(hdsDisp, rgbtn[id].rct.xcoLeft, rgbtn[id].rct.ycoTop,
+						rgbtn[id].dxco, rgbtn[id].dyco,
+						hdsBlt, 0, 0);
+	mtds.SetIntensity(hdsDisp, ityCur);
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MYDISP::FComposeBtnImage(id, st)
+**
+**	Parameters:
+**		id		- button id
+**		st		- BUTTON_UP or BUTTON_DOWN
+**
+**	Return Values:
+**		Returns true if the cached image for the state is ready, false if not
+**
+**	Errors:
+**		Returns false if the image bitmap can't be created, for example when the
+**		shield is out of memory. The button is then drawn without it.
+**
+**	Description:
+**		Build the cached image of the button drawn over its background in the
+**		specified state, if it isn't already built. The image is drawn the same
+**		way DrawBtnImage() draws the button on the display.
+*/
+
+bool MYDISP::FComposeBtnImage(int id, int st) {
+	HBMP *		phbmp;
+	uint32_t	fsCmp;
+	BMPD		bmpd;
+
+	if (st == BUTTON_UP) {
+		phbmp = &(rgbtn[id].hbmpCmpUp);
+		fsCmp = fsBtnCmpUp;
+	}
+	else {
+		phbmp = &(rgbtn[id].hbmpCmpDn);
+		fsCmp = fsBtnCmpDn;
+	}
+
+	if ((rgbtn[id].fs & fsCmp) != 0) {
+		return true;
+	}
+
+	if (hdsCmp == 0) {
+		return false;
+	}
+
+	if (*phbmp == 0) {
+		if (!mtds.GetBitmapDimensions(rgbtn[id].hbmpBg, &bmpd)) {
+			return false;
+		}
+		if ((*phbmp = HbmpCreateEvict(bmpd.dxco, bmpd.dyco, bmpd.cbpp)) == 0) {
+			return false;
+		}
+	}
+
+	/* Copy the background into the image and draw the button over it.
+	*/
+	mtds.SetDrawingSurface(hdsCmp, *phbmp);
+	mtds.SetDrawingSurface(hdsBlt, rgbtn[id].hbmpBg);
+	mtds.BitBlt(hdsCmp, 0, 0, rgbtn[id].dxco, rgbtn[id].dyco, hdsBlt, 0, 0, ropSrcCopy);
+
+	mtds.SetBkMode(hdsCmp, bkCur);
+	mtds.SetTransColor(hdsCmp, clrTr);
+	if ((st == BUTTON_DOWN) && (rgbtn[id].hbmpDn == 0)) {
+		mtds.SetDrawingSurface(hdsBlt, rgbtn[id].hbmpUp);
+		mtds.SetIntensity(hdsCmp, 50);
+	}
+	else {
+		mtds.SetDrawingSurface(hdsBlt, (st == BUTTON_UP) ? rgbtn[id].hbmpUp : rgbtn[id].hbmpDn);
+		mtds.SetIntensity(hdsCmp, 100);
+	}
+	if (!mtds.DrawBitmap(hdsCmp, 0, 0, rgbtn[id].dxco, rgbtn[id].dyco, hdsBlt, 0, 0)) {
+		return false;
+	}
+
+	rgbtn[id].fs |= fsCmp;
+	return true;
+
+}
+
 /* ------------------------------------------------------------ */
 /***	MYDISP::DeleteBtnBitmaps(id)
 **
@@ -1373,6 +1767,220 @@ void MYDISP::DeleteBtnBitmaps(int id) {
 		mtds.DestroyBitmap(rgbtn[id].hbmpBg);
 		rgbtn[id].hbmpBg = 0;
 	}
+
+	DeleteBtnImages(id);
+}
+
+/* ------------------------------------------------------------ */
+/***	MYDISP::IimgCache(name)
+**
+**	Parameters:
+**		name		- filename of the bitmap file
+**
+**	Return Values:
+**		Returns the image cache index of the bitmap, or -1 if it couldn't be loaded
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Find the named bitmap in the image cache, loading it if it isn't there,
+**		and mark it as the most recently used image. Before an image is loaded,
+**		images are discarded to free a cache entry and to keep cbImgReserve
+**		bytes of display memory free. If the shield runs out of memory while
+**		loading, further images are discarded until the load succeeds or the
+**		cache is empty.
+*/
+
+int MYDISP::IimgCache(char * name) {
+	HBMP	hbmp;
+	BMPD	bmpd;
+	int		iimg;
+	int		iimgFree;
+
+	iimgFree = -1;
+	for (iimg = 0; iimg < NUM_IMAGES; iimg++) {
+		if (rgimg[iimg].hbmp == 0) {
+			iimgFree = iimg;
+		}
+		else if (strcmp(rgimg[iimg].szName, name) == 0) {
+			rgimg[iimg].tckUse = ++tckImg;
+			return iimg;
+		}
+	}
+
+	/* The image isn't cached. Make room for it.
+	*/
+	if (iimgFree == -1) {
+		FEvictImg();
+	}
+	while ((mtds.GetFreeMem() < cbImgReserve) && (mtds.GetLastError() == staCmdSuccess)) {
+		if (!FEvictImg()) {
+			break;
+		}
+	}
+
+	if ((hbmp = HbmpLoadEvict(name)) == 0) {
+#if !defined(__SIM__)
+#if defined(__MTDSTRACE__)
+		Serial.print("!IimgCache ");
+		Serial.println(mtds.GetLastError(), HEX);
+#endif
+#endif
+		return -1;
+	}
+
+	if (!mtds.GetBitmapDimensions(hbmp, &bmpd)) {
+		mtds.DestroyBitmap(hbmp);
+		return -1;
+	}
+
+	/* Evicting may have freed a different entry, so look for one again.
+	*/
+	for (iimg = 0; rgimg[iimg].hbmp != 0; iimg++) {
+	}
+
+	rgimg[iimg].hbmp = hbmp;
+	rgimg[iimg].tckUse = ++tckImg;
+	rgimg[iimg].dxco = bmpd.dxco;
+	rgimg[iimg].dyco = bmpd.dyco;
+	strcpy(rgimg[iimg].szName, name);
+
+	return iimg;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MYDISP::FEvictImg()
+**
+**	Parameters:
+**		none
+**
+**	Return Values:
+**		Returns true if an image was discarded, false if the cache is empty
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Discard the least recently used image in the image cache.
+*/
+
+bool MYDISP::FEvictImg() {
+	int		iimg;
+	int		iimgLru;
+
+	iimgLru = -1;
+	for (iimg = 0; iimg < NUM_IMAGES; iimg++) {
+		if ((rgimg[iimg].hbmp != 0) &&
+			((iimgLru == -1) || (rgimg[iimg].tckUse < rgimg[iimgLru].tckUse))) {
+			iimgLru = iimg;
+		}
+	}
+
+	if (iimgLru == -1) {
+		return false;
+	}
+
+	mtds.DestroyBitmap(rgimg[iimgLru].hbmp);
+	rgimg[iimgLru].hbmp = 0;
+
+	return true;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MYDISP::HbmpLoadEvict(name)
+**
+**	Parameters:
+**		name		- filename of the bitmap file
+**
+**	Return Values:
+**		Returns the handle to the loaded bitmap
+**
+**	Errors:
+**		Returns 0 if the bitmap can't be loaded
+**
+**	Description:
+**		Load the named bitmap file. If the shield is out of memory, discard
+**		the least recently used cached images one at a time and try again
+**		until the load succeeds or the image cache is empty.
+*/
+
+HBMP MYDISP::HbmpLoadEvict(char * name) {
+	HBMP	hbmp;
+
+	while ((hbmp = mtds.LoadBitmap(name)) == 0) {
+		if ((mtds.GetLastError() != staCmdOutOfMemory) || !FEvictImg()) {
+			return 0;
+		}
+	}
+
+	return hbmp;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MYDISP::HbmpCreateEvict(dxco, dyco, cbpp)
+**
+**	Parameters:
+**		dxco		- bitmap width
+**		dyco		- bitmap height
+**		cbpp		- bits per pixel
+**
+**	Return Values:
+**		Returns the handle to the new bitmap
+**
+**	Errors:
+**		Returns 0 if the bitmap can't be created
+**
+**	Description:
+**		Create a bitmap, discarding cached images like HbmpLoadEvict() if the
+**		shield is out of memory.
+*/
+
+HBMP MYDISP::HbmpCreateEvict(int16_t dxco, int16_t dyco, int16_t cbpp) {
+	HBMP	hbmp;
+
+	while ((hbmp = mtds.CreateBitmap(dxco, dyco, cbpp)) == 0) {
+		if ((mtds.GetLastError() != staCmdOutOfMemory) || !FEvictImg()) {
+			return 0;
+		}
+	}
+
+	return hbmp;
+
+}
+
+/* ------------------------------------------------------------ */
+/***	MYDISP::DeleteBtnImages(id)
+**
+**	Parameters:
+**		id		- button id
+**
+**	Return Values:
+**		none
+**
+**	Errors:
+**		none
+**
+**	Description:
+**		Deletes the cached images of the specified button.
+*/
+
+void MYDISP::DeleteBtnImages(int id) {
+
+	if (rgbtn[id].hbmpCmpUp != 0) {
+		mtds.DestroyBitmap(rgbtn[id].hbmpCmpUp);
+		rgbtn[id].hbmpCmpUp = 0;
+	}
+
+	if (rgbtn[id].hbmpCmpDn != 0) {
+		mtds.DestroyBitmap(rgbtn[id].hbmpCmpDn);
+		rgbtn[id].hbmpCmpDn = 0;
+	}
+
+	rgbtn[id].fs &= ~(fsBtnCmpUp|fsBtnCmpDn);
 }
 
 /* ------------------------------------------------------------ */
@@ -32,7 +32,7 @@
 /* ------------------------------------------------------------ */
 
 #define	verMyDispMajor		1
-#define	verMyDispMinor		1
+#define	verMyDispMinor		2
 
 /* Declarations that are part of the library user interface.
 */
@@ -44,6 +44,24 @@
 #endif
 #define	NUM_FINGERS		2
 
+/* Images drawn by name are kept in display memory so that drawing one again
+** doesn't reload it from the SD card. When the cache is full, or loading an
+** image would leave less than cbImgReserve bytes of display memory free, the
+** least recently drawn images are discarded. Images are also discarded when
+** the shield runs out of memory loading or creating any other bitmap. The
+** cache is keyed by file name, so after a file is replaced on the SD card
+** call flushImage() or flushImages() so the new file is drawn.
+*/
+#if defined(__AVR__)
+#define	NUM_IMAGES		4
+#else
+#define	NUM_IMAGES		16
+#endif
+#define	cchImgNameMax	40			// longest cached image name, including the null
+#if !defined(cbImgReserve)
+#define	cbImgReserve	16384
+#endif
+
 #define	FINGER_UP		0
 #define	FINGER_DOWN		1
 #define FINGER_MOVE		2
@@ -70,9 +88,23 @@ struct MDFNG {
 #define	fsBtnTouched	0x0010		// there is a finger within the button bounding rect
 #define	fsBtnImageUp	0x0020		// button is currently drawn up
 #define	fsBtnImageDn	0x0040		// button is currently drawn down
+#define	fsBtnDirty		0x0080		// a posted button state hasn't been drawn yet
+#define	fsBtnCmpUp		0x0100		// hbmpCmpUp holds the current up image
+#define	fsBtnCmpDn		0x0200		// hbmpCmpDn holds the current down image
 #define	fsBtnEnabled	0x4000		// button is active
 #define	fsBtnAlloc		0x8000		// button is allocated
 
+/* Touch hit testing uses a grid of cells laid over the display. Each cell has
+** a bit for every enabled button that overlaps it, so button IDs must fit in
+** a uint32_t. The grid is square so that it covers either orientation.
+*/
+#define	dcoBtnGrid		64			// width and height of a grid cell in pixels
+#define	cBtnGrid		5			// number of grid cells in each direction
+
+#if (NUM_BUTTONS > 32)
+#error "NUM_BUTTONS must not be larger than the number of bits in a grid cell"
+#endif
+
 /* ------------------------------------------------------------ */
 /*					Object Class Declarations					*/
 /* ------------------------------------------------------------ */
@@ -80,16 +112,27 @@ struct MDFNG {
 class	MYDISP;
 extern	MYDISP	mydisp;
 
+struct MDIMG {
+	HBMP		hbmp;			// cached bitmap, 0 if the entry is unused
+	uint32_t	tckUse;			// image cache tick when last drawn
+	int16_t		dxco;			// bitmap width
+	int16_t		dyco;			// bitmap height
+	char		szName[cchImgNameMax];	// file name the bitmap was loaded from
+};
+
 struct MDBTN {
 	uint32_t	fs;				// button state
 	HBMP		hbmpUp;			// bitmap to draw button in up (untouched) state
 	HBMP		hbmpDn;			// bitmap to draw button in down (touched) state
 	HBMP		hbmpBg;			// bitmap for button background used to erase button
+	HBMP		hbmpCmpUp;		// up bitmap drawn over the background, 0 if not cached
+	HBMP		hbmpCmpDn;		// down bitmap drawn over the background, 0 if not cached
 	RCT			rct;			// button region on the display
 	uint32_t	clrTrans;		// background transparency color to use
 	uint16_t	sclPix;			// pixel brightness to use
 	int16_t		dxco;			// bitmap width
 	int16_t		dyco;			// bitmap height
+	int16_t		stPost;			// button state posted by postButton()
 };
 
 class MYDISP {
@@ -98,6 +141,7 @@ private:
 	int			idBtnTrack;		// button currently being tracked for button press
 	HDS			hdsDisp;
 	HDS			hdsBlt;
+	HDS			hdsCmp;			// DS used to build the cached button images
 	HBR			hbrFg;
 	uint32_t	clrFg;
 	uint32_t	clrBg;
@@ -107,9 +151,20 @@ private:
 	int			ityCur;
 	MDFNG		rgfng[2];
 	MDBTN		rgbtn[NUM_BUTTONS];
+	uint32_t	rgfsBtnGrid[cBtnGrid][cBtnGrid];
+	MDIMG		rgimg[NUM_IMAGES];
+	uint32_t	tckImg;			// image cache use counter
 
 	void		DeleteBtnBitmaps(int id);
+	void		DeleteBtnImages(int id);
+	bool		FComposeBtnImage(int id, int st);
+	void		DrawBtnImage(int id, int st);
+	void		SetBtnGrid(int id, bool fSet);
 	int			IdBtnFromXcoYco(int16_t xco, int16_t yco);
+	int			IimgCache(char * name);
+	bool		FEvictImg();
+	HBMP		HbmpLoadEvict(char * name);
+	HBMP		HbmpCreateEvict(int16_t dxco, int16_t dyco, int16_t cbpp);
 
 public:
 			MYDISP();
@@ -132,6 +187,9 @@ public:
 	bool		setFont(int idFont);
 	HBMP		loadImage(char * name);
 	bool		deleteImage(HBMP hbmp)			{ return mtds.DestroyBitmap(hbmp); };
+	bool		preloadImage(char * name);
+	bool		flushImage(char * name);
+	void		flushImages();
 
 	/* Basic graphics drawing functions.
 	*/
@@ -155,6 +213,8 @@ public:
 	bool		deleteButton(int id);
 	bool		enableButton(int id, bool fEn);
 	bool		drawButton(int id, int st);
+	bool		postButton(int id, int st);
+	bool		updateButtons();
 	bool		isEnabled(int id);
 	bool		isTouched(int id);
 	bool		getFinger(int num, MDFNG * fng);
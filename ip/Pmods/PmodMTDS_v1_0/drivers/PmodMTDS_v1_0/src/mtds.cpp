@@ -95,6 +95,11 @@ MTDS::MTDS() {
 
 	fInitialized = false;
 	fUpdating = false;
+	fDlstOpen = false;
+	cpktCredit = 1;
+	fMsgPin = false;
+	ievtMsgHead = 0;
+	cevtMsgQueued = 0;
 
 	clsLastError = 0;
 	cmdLastError = 0;
@@ -186,6 +191,13 @@ bool MTDS::begin(int pinSelInit, uint32_t frqSpi) {
 		return false;
 	}
 
+	/* The shield comes up with its status pins disabled, so anything left in
+	** the local message queue from a previous session is stale.
+	*/
+	fMsgPin = false;
+	ievtMsgHead = 0;
+	cevtMsgQueued = 0;
+
 	cntInit = 10;
 	while (true) {
 		if (mtds.FInitDisplay()) {
@@ -200,6 +212,10 @@ bool MTDS::begin(int pinSelInit, uint32_t frqSpi) {
 		}
 	}
 
+	/* How many data-out packets the firmware will take for each ready handshake.
+	*/
+	cpktCredit = cpktDataOutCredit;
+
 	mtds.ClearDisplay(0);
 
 	fInitialized = true;
@@ -227,6 +243,7 @@ bool MTDS::begin(int pinSelInit, uint32_t frqSpi) {
 void MTDS::end() {
 
 	fInitialized = false;
+	fMsgPin = false;
 
 }
 
@@ -234,7 +251,7 @@ void MTDS::end() {
 /***	MTDS::GetStatusPin(idPin)
 **
 **	Parameters:
-**		idPin	- identifier for pin to check (0=PinA, 1=PinB)
+**		idPin	- identifier for pin to check (idPinStatusA, idPinStatusB)
 **
 **	Return Values:
 **		Returns state of specified status pin. True if high, false if low.
@@ -244,8 +261,8 @@ void MTDS::end() {
 **
 **	Description:
 **		Check the state of the specified status pin and return true if high. The
-**		status pin being low indicates that the shield is signaling for
-**		attention.
+**		shield signals for attention with the pin at stMtdsMsgPinActive, see
+**		mtds.h.
 */
 
 bool MTDS::GetStatusPin(int idPin) {
@@ -385,10 +402,15 @@ void MTDS::MtdsProcessCmdWr(uint8_t cls, uint8_t cmd, uint16_t cbParam, uint8_t
 	uint16_t	cbCur;
 	uint8_t	*	pbCur;
 	uint16_t	cbRem;
+	uint8_t		cpktRem;
 	uint8_t		chnSta;
 	bool		fStat;
 	uint32_t	tusStart;
 
+	/* Anything recorded in the display list has to go out ahead of this command.
+	*/
+	MtdsSyncDisplayList(cls, cmd);
+
 	tusStart = MtdsHalTusElapsed();
 
 	/* Send the command packet.
@@ -428,6 +450,7 @@ void MTDS::MtdsProcessCmdWr(uint8_t cls, uint8_t cmd, uint16_t cbParam, uint8_t
 	if (cbData != 0) {
 		pbCur = pbData;
 		cbRem = cbData;
+		cpktRem = 0;
 		fStat = true;
 
 		while (cbRem > 0) {
@@ -436,29 +459,34 @@ void MTDS::MtdsProcessCmdWr(uint8_t cls, uint8_t cmd, uint16_t cbParam, uint8_t
 			** before sending it. The shield status will go busy as soon as it starts to
 			** receive the command packet. It will go to ready once it has had time to
 			** start processing the command and is ready for the next data packet.
+			** Each ready is good for cpktCredit packets, so with firmware that buffers
+			** packets we keep sending while it works on the ones already sent.
 			*/
-			chnSta = MtdsWaitUntilShieldReady();
-			if (chnSta != chnStaReady) {
-				/* We either got an abort from the shield, or we timed out waiting
-				** for the shield to become ready.
-				*/
-				if (chnSta == chnStaAbort) {
-					/* The shield wants to abort the command, so we need to stop
-					** sending it data packets.
+			if (cpktRem == 0) {
+				chnSta = MtdsWaitUntilShieldReady();
+				if (chnSta != chnStaReady) {
+					/* We either got an abort from the shield, or we timed out waiting
+					** for the shield to become ready.
 					*/
+					if (chnSta == chnStaAbort) {
+						/* The shield wants to abort the command, so we need to stop
+						** sending it data packets.
+						*/
 #if defined(MPIDE)
 #if defined(__MTDSTRACE__)
-					Serial.println("!CmdWr: abort command");
+						Serial.println("!CmdWr: abort command");
 #endif
 #endif
-					if (!MtdsResumeChannel()) {
-						/* We timed out waiting for the display to resume.
-						*/
-						chnSta = chnStaTimeout;
-						fStat = false;
+						if (!MtdsResumeChannel()) {
+							/* We timed out waiting for the display to resume.
+							*/
+							chnSta = chnStaTimeout;
+							fStat = false;
+						}
 					}
+					break;
 				}
-				break;
+				cpktRem = cpktCredit;
 			}
 
 			cbCur = cbRem;
@@ -470,6 +498,7 @@ void MTDS::MtdsProcessCmdWr(uint8_t cls, uint8_t cmd, uint16_t cbParam, uint8_t
 
 			cbRem -= cbCur;
 			pbCur += cbCur;
+			cpktRem -= 1;
 		}
 
 		if (!fStat) {
@@ -617,6 +646,10 @@ void MTDS::MtdsProcessCmdRd(uint8_t cls, uint8_t cmd, uint16_t cbParam, uint8_t
 	bool		fStat;
 	uint32_t	tusStart;
 
+	/* Anything recorded in the display list has to go out ahead of this command.
+	*/
+	MtdsSyncDisplayList(cls, cmd);
+
 	tusStart = MtdsHalTusElapsed();
 
 	/* Send the command packet.
@@ -47,6 +47,32 @@
 
 #define	hwinDesktop			(sigHwin + sigHwinStock + 0)
 
+/* GDI calls made while a display list is open are recorded into a buffer of
+** cbMtdsDlstMax bytes. The last state set on up to cdsMtdsDlstCache DS objects
+** is remembered so that redundant state setter calls can be dropped.
+*/
+#if !defined(cbMtdsDlstMax)
+#define	cbMtdsDlstMax		1024
+#endif
+#define	cdsMtdsDlstCache	4
+#define	cvalMtdsDlstState	10			// cmdGdiSetFgColor through cmdGdiSetDrawingSurface
+
+/* While status pin A is enabled the shield sets it whenever its message queue
+** is not empty. Messages are then drained into a local queue of cevtMtdsMsgQueue
+** entries only when the pin is set, so polling for touch input costs no SPI
+** traffic while there is nothing to report.
+** The library sources disagree on the level: EnableStatusPin() says pin A is
+** "set" with messages queued, the original GetStatusPin() text said low means
+** the shield is signaling. stMtdsMsgPinActive is the level read as set, 1 for
+** high; build with it 0 for a shield that pulls the pin low.
+*/
+#if !defined(cevtMtdsMsgQueue)
+#define	cevtMtdsMsgQueue	8
+#endif
+#if !defined(stMtdsMsgPinActive)
+#define	stMtdsMsgPinActive	1
+#endif
+
 /* ------------------------------------------------------------ */
 /*				Data Structure Declarations						*/
 /* ------------------------------------------------------------ */
@@ -60,6 +86,12 @@ struct VINFO {
 	uint16_t	verDisplay;			// display board revision number
 };
 
+struct DSST {
+	HDS			hds;				// DS the cached state belongs to
+	uint16_t	fsValid;			// bit set for each valid value in rgval
+	uint32_t	rgval[cvalMtdsDlstState];	// last value sent by each state setter
+};
+
 /* ------------------------------------------------------------ */
 /*					Object Class Declarations					*/
 /* ------------------------------------------------------------ */
@@ -80,6 +112,12 @@ private:
 	uint8_t		staLastError;
 	uint32_t	tusElapsed;
 	bool		fUpdating;
+	bool		fDlstOpen;
+	uint8_t		cpktCredit;
+	bool		fMsgPin;
+	uint8_t		ievtMsgHead;
+	uint8_t		cevtMsgQueued;
+	MEVT		rgevtMsgQueue[cevtMtdsMsgQueue];
 
 protected:
 
@@ -88,8 +126,13 @@ protected:
 								uint16_t cbData, uint8_t * pbData);
 	void	MtdsProcessCmdRd(uint8_t cls, uint8_t cmd, uint16_t cbParam, uint8_t * pbParam, 
 								uint16_t cbData, uint8_t * pbData);
+	void	MtdsQueueCmdWr(uint8_t cls, uint8_t cmd, uint16_t cbParam, uint8_t * pbParam,
+								uint16_t cbData, uint8_t * pbData);
+	void	MtdsSyncDisplayList(uint8_t cls, uint8_t cmd);
 	bool	FCheckName(char * sz, uint8_t cls, uint8_t cmd);
 	bool	FBeginUpdate();
+	bool	MtdsRcvMsg(uint8_t cmd, MEVT * pevt);
+	void	MtdsFillMsgQueue();
 
 public:
 				MTDS();
@@ -146,6 +189,11 @@ public:
 	HDS			GetDs();
 	bool		ReleaseDs(HDS hds);
 
+	bool		BeginDisplayList();
+	bool		FlushDisplayList();
+	bool		EndDisplayList();
+	bool		FDisplayListOpen()		{ return fDlstOpen; };
+
 	HBMP		CreateBitmap(int16_t dxco, int16_t dyco, int16_t cbpp);
 	bool		DestroyBitmap(HBMP hbmp);
 	bool		GetBitmapDimensions(HBMP hbmp, BMPD * pbmpd);
@@ -237,6 +285,7 @@ public:
 */
 class MTFS {
 private:
+	uint32_t	ccmdXfer;		// read and write commands sent, for FSXS
 
 public:
 	uint8_t		GetLastError()									{ return mtds.GetLastError(); };
@@ -257,6 +306,10 @@ public:
 	bool		CloseFile(HFIL fh);
 	bool		ReadFile(HFIL fh, uint8_t * rgbBuf, uint32_t cbRead, uint32_t * pcbRes);
 	bool		WriteFile(HFIL fh, uint8_t * rgbBuf, uint32_t cbWrite, uint32_t * pcbRes);
+	bool		SndFile(char * szFile, PFNFSXFER pfnSrc, void * pvRef,
+							uint8_t * rgbBuf, uint32_t cbBuf, FSXS * pfsxs);
+	bool		RcvFile(char * szFile, PFNFSXFER pfnDst, void * pvRef,
+							uint8_t * rgbBuf, uint32_t cbBuf, FSXS * pfsxs);
 	bool		SyncFile(HFIL fh);
 	bool		TruncateFile(HFIL fh);
 	bool		SetFilePointer(HFIL fh, uint32_t off);
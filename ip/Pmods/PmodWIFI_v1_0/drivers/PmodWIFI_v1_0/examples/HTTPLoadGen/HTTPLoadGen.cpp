@@ -0,0 +1,704 @@
+/************************************************************************/
+/*                                                                      */
+/*      HTTPLoadGen                                                     */
+/*                                                                      */
+/*        A Linux host program that loads the HTTPServer example       */
+/*        with many concurrent connections and reports the requests     */
+/*        per second and the p50/p99 latency of each URL.               */
+/*        This is not built for the target, build it on the host with:  */
+/*                                                                      */
+/*          g++ -O2 -o HTTPLoadGen HTTPLoadGen.cpp                      */
+/*                                                                      */
+/************************************************************************/
+/*       Copyright 2016, Digilent Inc.                                  */
+/************************************************************************/
+/*
+*
+* Copyright (c) 2013-2016, Digilent <www.digilentinc.com>
+* Contact Digilent for the latest version.
+*
+* This program is free software; distributed under the terms of
+* BSD 3-clause license ("Revised BSD License", "New BSD License", or "Modified BSD License")
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* 1.    Redistributions of source code must retain the above copyright notice, this
+*        list of conditions and the following disclaimer.
+* 2.    Redistributions in binary form must reproduce the above copyright notice,
+*        this list of conditions and the following disclaimer in the documentation
+*        and/or other materials provided with the distribution.
+* 3.    Neither the name(s) of the above-listed copyright holder(s) nor the names
+*        of its contributors may be used to endorse or promote products derived
+*        from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+* IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+* INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+* OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+* OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+/************************************************************************/
+/*                                                                      */
+/*  Usage:                                                              */
+/*                                                                      */
+/*      HTTPLoadGen [options] host[:port] url [url ...]                 */
+/*                                                                      */
+/*          -c n    concurrent connections, default 4                   */
+/*          -d s    seconds to run, default 10                          */
+/*          -t ms   a request taking longer than this fails, 5000       */
+/*          -n      a new connection for every request (HTTP/1.0)       */
+/*                                                                      */
+/*      Each connection goes round the urls, starting at a different    */
+/*      one so all of them are in flight at once. Connections are       */
+/*      kept alive unless -n is given or the server says close; then    */
+/*      the connect time is part of the request latency. Run it with    */
+/*      the same arguments before and after a server change.            */
+/*                                                                      */
+/*      HTTPLoadGen -c 4 -d 30 192.168.1.190 / /PinsPage.htm /pins.json */
+/*                                                                      */
+/************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define CBREADBUFF          4096        // how much is read from a socket at a time
+#define CBHEADERMAX         8192        // a response header longer than this is an error
+
+/************************************************************************/
+/*    Types                                                             */
+/************************************************************************/
+
+// the numbers kept for each url
+typedef struct _ROUTESTATS
+{
+    std::string             szURL;
+    std::vector<uint32_t>   rgusLatency;    // the latency of every good response in microseconds
+    uint64_t                cbBody;         // body bytes received
+    uint32_t                cNon2xx;        // responses that were not 2xx
+    uint32_t                cErrors;        // connect failures, timeouts, resets and bad responses
+} ROUTESTATS;
+
+typedef enum {
+    CONNIDLE,           // no socket, connect on the next pass
+    CONNCONNECTING,     // non-blocking connect in progress
+    CONNSENDING,        // writing the request
+    CONNHEADER,         // reading the status line and header
+    CONNBODY,           // reading a Content-Length body, or up to the close
+    CONNCHUNKSIZE,      // reading a chunk size line
+    CONNCHUNKDATA,      // reading chunk data and its \r\n
+    CONNTRAILER         // reading the trailer after the last chunk
+} CONNSTATE;
+
+typedef struct _CONN
+{
+    int             fd;
+    CONNSTATE       state;
+    uint32_t        iRoute;         // the url being requested
+    uint64_t        usStart;        // when the request was started, including the connect
+    std::string     szReq;          // the request being sent
+    uint32_t        cbSent;
+    std::string     szIn;           // received bytes not yet parsed
+    int             status;         // HTTP status of the response
+    bool            fClose;         // the server closes the connection after this response
+    bool            fToClose;       // the body runs to the close
+    uint64_t        cbLeft;         // body or chunk bytes still to come
+} CONN;
+
+/************************************************************************/
+/*    Local Module Variables                                            */
+/************************************************************************/
+
+static std::vector<ROUTESTATS>  rgRoute;
+static std::string              szHost;
+static struct sockaddr_storage  saServer;
+static socklen_t                cbsaServer      = 0;
+static uint32_t                 cConn           = 4;
+static uint32_t                 secRun          = 10;
+static uint32_t                 msTimeout       = 5000;
+static bool                     fNewConn        = false;
+static uint64_t                 cConnects       = 0;
+
+/***    static uint64_t GetMicroSecond(void)
+ *
+ *    Parameters:
+ *          None
+ *
+ *    Return Values:
+ *          a monotonic time in microseconds
+ *
+ * ------------------------------------------------------------ */
+static uint64_t GetMicroSecond(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+/***    static void CloseConn(CONN * pConn)
+ *
+ *    Parameters:
+ *          pConn - the connection
+ *
+ *    Return Values:
+ *          None
+ *
+ *    Description:
+ *
+ *      Closes the socket, the next pass opens a new one
+ *
+ * ------------------------------------------------------------ */
+static void CloseConn(CONN * pConn)
+{
+    if(pConn->fd >= 0)
+    {
+        close(pConn->fd);
+    }
+    pConn->fd       = -1;
+    pConn->state    = CONNIDLE;
+    pConn->szIn.clear();
+}
+
+/***    static void StartRequest(CONN * pConn, uint64_t usNow)
+ *
+ *    Parameters:
+ *          pConn - the connection
+ *          usNow - the current time
+ *
+ *    Return Values:
+ *          None
+ *
+ *    Description:
+ *
+ *      Builds the request for the next url, the latency is timed from here.
+ *      If there is no connection, one is started and its time counts too.
+ *
+ * ------------------------------------------------------------ */
+static void StartRequest(CONN * pConn, uint64_t usNow)
+{
+    pConn->iRoute   = (pConn->iRoute + 1) % rgRoute.size();
+    pConn->usStart  = usNow;
+    pConn->cbSent   = 0;
+    pConn->status   = 0;
+    pConn->fClose   = fNewConn;
+    pConn->fToClose = false;
+    pConn->cbLeft   = 0;
+    pConn->szReq    = std::string("GET ") + rgRoute[pConn->iRoute].szURL + (fNewConn ? " HTTP/1.0\r\n" : " HTTP/1.1\r\n") +
+                      "Host: " + szHost + "\r\n" + (fNewConn ? "Connection: close\r\n" : "") + "\r\n";
+
+    if(pConn->fd >= 0)
+    {
+        pConn->state = CONNSENDING;
+        return;
+    }
+
+    pConn->fd = socket(saServer.ss_family, SOCK_STREAM, 0);
+    if(pConn->fd < 0)
+    {
+        perror("socket");
+        exit(1);
+    }
+    fcntl(pConn->fd, F_SETFL, fcntl(pConn->fd, F_GETFL) | O_NONBLOCK);
+
+    int fNoDelay = 1;
+    setsockopt(pConn->fd, IPPROTO_TCP, TCP_NODELAY, &fNoDelay, sizeof(fNoDelay));
+
+    cConnects++;
+    if(connect(pConn->fd, (struct sockaddr *) &saServer, cbsaServer) == 0)
+    {
+        pConn->state = CONNSENDING;
+    }
+    else if(errno == EINPROGRESS)
+    {
+        pConn->state = CONNCONNECTING;
+    }
+    else
+    {
+        rgRoute[pConn->iRoute].cErrors++;
+        CloseConn(pConn);
+    }
+}
+
+/***    static void EndRequest(CONN * pConn, bool fGood, uint64_t usNow)
+ *
+ *    Parameters:
+ *          pConn - the connection
+ *          fGood - a whole response came in
+ *          usNow - the current time
+ *
+ *    Return Values:
+ *          None
+ *
+ *    Description:
+ *
+ *      Records the request and starts the next one
+ *
+ * ------------------------------------------------------------ */
+static void EndRequest(CONN * pConn, bool fGood, uint64_t usNow)
+{
+    ROUTESTATS * pRoute = &rgRoute[pConn->iRoute];
+
+    if(!fGood)
+    {
+        pRoute->cErrors++;
+        CloseConn(pConn);
+    }
+    else
+    {
+        pRoute->rgusLatency.push_back((uint32_t) (usNow - pConn->usStart));
+        if(pConn->status < 200 || pConn->status > 299)
+        {
+            pRoute->cNon2xx++;
+        }
+
+        if(pConn->fClose)
+        {
+            CloseConn(pConn);
+        }
+    }
+
+    StartRequest(pConn, usNow);
+}
+
+/***    static bool ParseHeader(CONN * pConn, size_t cbHeader)
+ *
+ *    Parameters:
+ *          pConn       - the connection
+ *          cbHeader    - the length of the header at the front of szIn, including the blank line
+ *
+ *    Return Values:
+ *          false if the status line is bad
+ *
+ *    Description:
+ *
+ *      Picks the status, the body framing, and if the connection stays up out of the header
+ *
+ * ------------------------------------------------------------ */
+static bool ParseHeader(CONN * pConn, size_t cbHeader)
+{
+    std::string szHeader = pConn->szIn.substr(0, cbHeader);
+    bool        fLength  = false;
+    bool        fChunked = false;
+    size_t      i        = 0;
+
+    for(i = 0; i < szHeader.size(); i++)
+    {
+        szHeader[i] = tolower(szHeader[i]);
+    }
+
+    if(sscanf(szHeader.c_str(), "http/%*d.%*d %d", &pConn->status) != 1)
+    {
+        return(false);
+    }
+
+    if(szHeader.compare(0, 9, "http/1.0 ") == 0 && szHeader.find("\nconnection: keep-alive") == std::string::npos)
+    {
+        pConn->fClose = true;
+    }
+    if(szHeader.find("\nconnection: close") != std::string::npos)
+    {
+        pConn->fClose = true;
+    }
+    if(szHeader.find("\ntransfer-encoding: chunked") != std::string::npos)
+    {
+        fChunked = true;
+    }
+    if((i = szHeader.find("\ncontent-length:")) != std::string::npos)
+    {
+        pConn->cbLeft   = strtoull(&szHeader[i + 16], NULL, 10);
+        fLength         = true;
+    }
+
+    if(fChunked)
+    {
+        pConn->state = CONNCHUNKSIZE;
+    }
+    else if(fLength || pConn->status == 204 || pConn->status == 304)
+    {
+        pConn->state = CONNBODY;
+    }
+    else
+    {
+        pConn->state    = CONNBODY;
+        pConn->fToClose = true;
+        pConn->fClose   = true;
+    }
+
+    pConn->szIn.erase(0, cbHeader);
+    return(true);
+}
+
+/***    static void ParseInput(CONN * pConn, bool fEOF, uint64_t usNow)
+ *
+ *    Parameters:
+ *          pConn   - the connection
+ *          fEOF    - the server closed the connection
+ *          usNow   - the current time
+ *
+ *    Return Values:
+ *          None
+ *
+ *    Description:
+ *
+ *      Runs what is in szIn through the response parser, as many
+ *      responses as are there.
+ *
+ * ------------------------------------------------------------ */
+static void ParseInput(CONN * pConn, bool fEOF, uint64_t usNow)
+{
+    bool fMore = true;
+
+    while(fMore && pConn->state >= CONNHEADER)
+    {
+        size_t i = 0;
+
+        fMore = false;
+        switch(pConn->state)
+        {
+            case CONNHEADER:
+                if((i = pConn->szIn.find("\r\n\r\n")) != std::string::npos)
+                {
+                    if(!ParseHeader(pConn, i + 4))
+                    {
+                        EndRequest(pConn, false, usNow);
+                        return;
+                    }
+                    fMore = true;
+                }
+                else if(pConn->szIn.size() > CBHEADERMAX)
+                {
+                    EndRequest(pConn, false, usNow);
+                    return;
+                }
+                break;
+
+            case CONNBODY:
+                if(pConn->fToClose)
+                {
+                    rgRoute[pConn->iRoute].cbBody += pConn->szIn.size();
+                    pConn->szIn.clear();
+                    if(fEOF)
+                    {
+                        EndRequest(pConn, true, usNow);
+                        return;
+                    }
+                    break;
+                }
+
+                i = (size_t) std::min((uint64_t) pConn->szIn.size(), pConn->cbLeft);
+                rgRoute[pConn->iRoute].cbBody += i;
+                pConn->cbLeft -= i;
+                pConn->szIn.erase(0, i);
+                if(pConn->cbLeft == 0)
+                {
+                    EndRequest(pConn, true, usNow);
+                    return;
+                }
+                break;
+
+            case CONNCHUNKSIZE:
+                if((i = pConn->szIn.find("\r\n")) != std::string::npos)
+                {
+                    pConn->cbLeft = strtoull(pConn->szIn.c_str(), NULL, 16);
+                    pConn->szIn.erase(0, i + 2);
+                    pConn->state = pConn->cbLeft == 0 ? CONNTRAILER : CONNCHUNKDATA;
+                    pConn->cbLeft += 2;     // and the \r\n after the data
+                    fMore = true;
+                }
+                break;
+
+            case CONNCHUNKDATA:
+                i = (size_t) std::min((uint64_t) pConn->szIn.size(), pConn->cbLeft);
+                rgRoute[pConn->iRoute].cbBody += i;
+                pConn->cbLeft -= i;
+                pConn->szIn.erase(0, i);
+                if(pConn->cbLeft == 0)
+                {
+                    rgRoute[pConn->iRoute].cbBody -= 2;
+                    pConn->state = CONNCHUNKSIZE;
+                    fMore = true;
+                }
+                break;
+
+            case CONNTRAILER:
+                // no trailers are sent, this is the \r\n ending the body
+                if(pConn->szIn.size() >= 2)
+                {
+                    pConn->szIn.erase(0, 2);
+                    EndRequest(pConn, true, usNow);
+                    return;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if(fEOF)
+    {
+        EndRequest(pConn, false, usNow);
+    }
+}
+
+/***    static void ServiceConn(CONN * pConn, short revents, uint64_t usNow)
+ *
+ *    Parameters:
+ *          pConn   - the connection
+ *          revents - what poll() said about the socket
+ *          usNow   - the current time
+ *
+ *    Return Values:
+ *          None
+ *
+ * ------------------------------------------------------------ */
+static void ServiceConn(CONN * pConn, short revents, uint64_t usNow)
+{
+    char    rgbRead[CBREADBUFF];
+    ssize_t cb  = 0;
+
+    if(pConn->state == CONNCONNECTING && (revents & (POLLOUT | POLLERR | POLLHUP)))
+    {
+        int         err     = 0;
+        socklen_t   cbErr   = sizeof(err);
+
+        getsockopt(pConn->fd, SOL_SOCKET, SO_ERROR, &err, &cbErr);
+        if(err != 0)
+        {
+            EndRequest(pConn, false, usNow);
+            return;
+        }
+        pConn->state = CONNSENDING;
+    }
+
+    if(pConn->state == CONNSENDING && (revents & (POLLOUT | POLLERR | POLLHUP)))
+    {
+        cb = send(pConn->fd, pConn->szReq.data() + pConn->cbSent, pConn->szReq.size() - pConn->cbSent, MSG_NOSIGNAL);
+        if(cb < 0 && errno != EAGAIN)
+        {
+            EndRequest(pConn, false, usNow);
+            return;
+        }
+        else if(cb > 0 && (pConn->cbSent += cb) == pConn->szReq.size())
+        {
+            pConn->state = CONNHEADER;
+        }
+    }
+
+    else if(pConn->state >= CONNHEADER && (revents & (POLLIN | POLLERR | POLLHUP)))
+    {
+        cb = recv(pConn->fd, rgbRead, sizeof(rgbRead), 0);
+        if(cb < 0 && errno == EAGAIN)
+        {
+            return;
+        }
+        else if(cb > 0)
+        {
+            pConn->szIn.append(rgbRead, cb);
+        }
+        ParseInput(pConn, cb <= 0, usNow);
+    }
+}
+
+/***    static void PrintRoute(const char * szName, std::vector<uint32_t>& rgus, uint64_t cbBody, uint32_t cNon2xx, uint32_t cErrors, double secElapsed)
+ *
+ *    Parameters:
+ *          szName      - the url, or "all"
+ *          rgus        - the latencies, this is sorted
+ *          cbBody      - body bytes received
+ *          cNon2xx     - responses that were not 2xx
+ *          cErrors     - failed requests
+ *          secElapsed  - how long the run took
+ *
+ *    Return Values:
+ *          None
+ *
+ * ------------------------------------------------------------ */
+static void PrintRoute(const char * szName, std::vector<uint32_t>& rgus, uint64_t cbBody, uint32_t cNon2xx, uint32_t cErrors, double secElapsed)
+{
+    double msP50 = 0;
+    double msP99 = 0;
+    double msMax = 0;
+
+    std::sort(rgus.begin(), rgus.end());
+    if(rgus.size() > 0)
+    {
+        msP50 = rgus[(rgus.size() - 1) * 50 / 100] / 1000.0;
+        msP99 = rgus[(rgus.size() - 1) * 99 / 100] / 1000.0;
+        msMax = rgus.back() / 1000.0;
+    }
+
+    printf("%-32s %8u %9.1f %9.1f %9.2f %9.2f %9.2f %6u %6u\n", szName, (unsigned int) rgus.size(), rgus.size() / secElapsed,
+            cbBody / secElapsed / 1024.0, msP50, msP99, msMax, cNon2xx, cErrors);
+}
+
+/***    int main(int argc, char * argv[])
+ *
+ *    Parameters:
+ *          argc, argv - see Usage above
+ *
+ *    Return Values:
+ *          0 if every request got a 2xx response
+ *
+ * ------------------------------------------------------------ */
+int main(int argc, char * argv[])
+{
+    std::vector<CONN>           rgConn;
+    std::vector<struct pollfd>  rgpfd;
+    std::vector<uint32_t>       rgusAll;
+    struct addrinfo             hints;
+    struct addrinfo *           pai         = NULL;
+    std::string                 szPort      = "80";
+    uint64_t                    usStart     = 0;
+    uint64_t                    usEnd       = 0;
+    uint64_t                    cbAll       = 0;
+    uint32_t                    cNon2xxAll  = 0;
+    uint32_t                    cErrorsAll  = 0;
+    int                         opt         = 0;
+    size_t                      i           = 0;
+
+    while((opt = getopt(argc, argv, "c:d:t:n")) != -1)
+    {
+        switch(opt)
+        {
+            case 'c': cConn     = atoi(optarg); break;
+            case 'd': secRun    = atoi(optarg); break;
+            case 't': msTimeout = atoi(optarg); break;
+            case 'n': fNewConn  = true;         break;
+            default:
+                fprintf(stderr, "usage: %s [-c connections] [-d seconds] [-t timeout ms] [-n] host[:port] url [url ...]\n", argv[0]);
+                return(2);
+        }
+    }
+
+    if(argc - optind < 2 || cConn == 0)
+    {
+        fprintf(stderr, "usage: %s [-c connections] [-d seconds] [-t timeout ms] [-n] host[:port] url [url ...]\n", argv[0]);
+        return(2);
+    }
+
+    szHost = argv[optind++];
+    if((i = szHost.rfind(':')) != std::string::npos)
+    {
+        szPort = szHost.substr(i + 1);
+        szHost.erase(i);
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family     = AF_UNSPEC;
+    hints.ai_socktype   = SOCK_STREAM;
+    if(getaddrinfo(szHost.c_str(), szPort.c_str(), &hints, &pai) != 0 || pai == NULL)
+    {
+        fprintf(stderr, "can not resolve %s\n", szHost.c_str());
+        return(2);
+    }
+    memcpy(&saServer, pai->ai_addr, pai->ai_addrlen);
+    cbsaServer = pai->ai_addrlen;
+    freeaddrinfo(pai);
+
+    for( ; optind < argc; optind++)
+    {
+        ROUTESTATS route;
+
+        route.szURL     = argv[optind];
+        route.cbBody    = 0;
+        route.cNon2xx   = 0;
+        route.cErrors   = 0;
+        rgRoute.push_back(route);
+    }
+
+    // every connection starts on a different url
+    rgConn.resize(cConn);
+    rgpfd.resize(cConn);
+    usStart = GetMicroSecond();
+    for(i = 0; i < cConn; i++)
+    {
+        rgConn[i].fd        = -1;
+        rgConn[i].state     = CONNIDLE;
+        rgConn[i].iRoute    = (i + rgRoute.size() - 1) % rgRoute.size();
+        StartRequest(&rgConn[i], usStart);
+    }
+
+    printf("%u connections to %s:%s for %u seconds%s\n", cConn, szHost.c_str(), szPort.c_str(), secRun, fNewConn ? ", a connection per request" : "");
+
+    usEnd = usStart + (uint64_t) secRun * 1000000;
+    while(GetMicroSecond() < usEnd)
+    {
+        uint64_t usNow = 0;
+
+        for(i = 0; i < cConn; i++)
+        {
+            rgpfd[i].fd         = rgConn[i].fd;
+            rgpfd[i].events     = (rgConn[i].state == CONNCONNECTING || rgConn[i].state == CONNSENDING) ? POLLOUT : POLLIN;
+            rgpfd[i].revents    = 0;
+        }
+
+        if(poll(&rgpfd[0], cConn, 10) < 0 && errno != EINTR)
+        {
+            perror("poll");
+            return(2);
+        }
+
+        usNow = GetMicroSecond();
+        for(i = 0; i < cConn; i++)
+        {
+            CONN * pConn = &rgConn[i];
+
+            if(pConn->state == CONNIDLE)
+            {
+                StartRequest(pConn, usNow);
+            }
+            else if(rgpfd[i].revents != 0)
+            {
+                ServiceConn(pConn, rgpfd[i].revents, usNow);
+            }
+            else if((usNow - pConn->usStart) > (uint64_t) msTimeout * 1000)
+            {
+                EndRequest(pConn, false, usNow);
+            }
+        }
+    }
+    usEnd = GetMicroSecond();
+
+    // requests still in flight are not counted
+    for(i = 0; i < cConn; i++)
+    {
+        CloseConn(&rgConn[i]);
+    }
+
+    printf("\n%-32s %8s %9s %9s %9s %9s %9s %6s %6s\n", "url", "requests", "req/s", "KB/s", "p50 ms", "p99 ms", "max ms", "non2xx", "errors");
+    for(i = 0; i < rgRoute.size(); i++)
+    {
+        ROUTESTATS * pRoute = &rgRoute[i];
+
+        rgusAll.insert(rgusAll.end(), pRoute->rgusLatency.begin(), pRoute->rgusLatency.end());
+        cbAll       += pRoute->cbBody;
+        cNon2xxAll  += pRoute->cNon2xx;
+        cErrorsAll  += pRoute->cErrors;
+        PrintRoute(pRoute->szURL.c_str(), pRoute->rgusLatency, pRoute->cbBody, pRoute->cNon2xx, pRoute->cErrors, (usEnd - usStart) / 1000000.0);
+    }
+    PrintRoute("all", rgusAll, cbAll, cNon2xxAll, cErrorsAll, (usEnd - usStart) / 1000000.0);
+    printf("%llu connections opened\n", (unsigned long long) cConnects);
+
+    return((cNon2xxAll == 0 && cErrorsAll == 0) ? 0 : 1);
+}
@@ -45,6 +45,8 @@
 /*    7/19/2013(KeithV): Created                                         */
 /************************************************************************/
 #include    "HTTPServer.h"
+#include    <stdlib.h>
+#include    <stdio.h>
 #ifdef __MICROBLAZE__
 #include    "DXSPISDVOL.h" //If an error occurs, you need to add a PmodSD IP block to your design
 DXSPISDVOL dSDVol(XPAR_PMODSD_0_AXI_LITE_SPI_BASEADDR, XPAR_PMODSD_0_AXI_LITE_SDCS_BASEADDR);
@@ -73,24 +75,104 @@ bool fSDfs = false;
 uint32_t sdLockCur = SDUNLOCKED;
 uint32_t sdLock = 1;
 
-static const char * szFileName      = NULL;
 static const char   szDefaultPage[] = "HomePage.htm";
-static CLIENTINFO * pClientMutex    = NULL;
-static uint32_t     cbSent          = 0;
-static uint32_t     tStart          = 0;
-static uint32_t     sdLockId        = SDUNLOCKED;
+
+// The number of files that can be sent at the same time, each takes a sector of RAM.
+// A client that finds them all in use waits in HTTPSTART.
+#ifndef cSDSendMax
+#define cSDSendMax          cMaxSocketsToListen
+#endif
+#define CBSDSENDBUFF        DFILE::FS_DEFAULT_BUFF_SIZE     // we read a sector at a time
+#define CBSDEXT             8                               // room for the file extension, for the content type
+#define CBSDNAME            48                              // longest file name we will cache
+#define CBETAG              24                              // room for a quoted ETag
+
+// The longest directive BuildHTTPRangeStr() makes for us: a 206 with keep-alive,
+// the longest content type, a full Content-Range, the ETag, gzip and Vary.
+// The directive is built in rgbOut, if it does not fit the file can't be sent.
+#define CBSDHTTPMAX         264
+#if (CBCLILENTOUTPUTBUFF < CBSDHTTPMAX)
+#error CBCLILENTOUTPUTBUFF is too small for the HTMLSDPage HTTP directive
+#endif
+
+// The RAM cache of small, hot files. Files are kept whole in rgbSDCache and the
+// least recently used file not being sent is thrown out to make room.
+#ifndef CBSDCACHE
+#define CBSDCACHE           (64 * 1024)     // bytes of RAM for cached files; 0 turns the cache off
+#endif
+#ifndef CBSDCACHEFILEMAX
+#define CBSDCACHEFILEMAX    (20 * 1024)     // larger files are always read off the SD
+#endif
+#ifndef cSDCacheMax
+#define cSDCacheMax         16              // max number of files in the cache
+#endif
+#ifndef msSDCacheCheck
+#define msSDCacheCheck      10000           // a cached file older than this is checked against the SD (size, date and time) before use
+#endif
+
+typedef struct
+{
+    char            szName[CBSDNAME];       // the file name, "" if the entry is free
+    char            szETag[CBETAG];         // the ETag of the cached version
+    uint32_t        iArena;                 // where the file is in rgbSDCache
+    uint32_t        cbFile;                 // the file size
+    uint32_t        cbFilled;               // bytes loaded so far; only usable once this is cbFile
+    uint32_t        tUsed;                  // last time the entry was used, for the LRU
+    uint32_t        tChecked;               // last time the entry was checked against the SD
+    uint32_t        cUsers;                 // clients sending out of the entry, it can't move or go away while > 0
+    bool            fFilling;               // a client is loading the file as it sends it
+    bool            fNoGzip;                // there was no .gz copy of the file when we last looked
+} SDCACHE;
+
+#if (CBSDCACHE > 0)
+static SDCACHE  rgSDCache[cSDCacheMax];
+static uint8_t  rgbSDCache[CBSDCACHE];
+#endif
+
+// a file being sent to a client; the SD is only locked while a sector is read,
+// the client then writes it to the socket without holding the SD.
+typedef struct
+{
+    CLIENTINFO *    pClientInfo;                // the client this file is sent to, NULL if free
+    DFILE           dFile;                      // the open file, not opened when we send out of the cache
+    SDCACHE *       pCache;                     // the cache entry we send out of, or fill; NULL to read through rgbBuff
+    const uint8_t * pbBase;                     // the data in memory at file offset iBase
+    uint32_t        iBase;                      // file offset of pbBase
+    uint32_t        iSent;                      // file offset of the next byte to write to the socket
+    uint32_t        iAvail;                     // file offset one past the data we have in memory
+    uint32_t        iFirst;                     // file offset of the first byte to send
+    uint32_t        iEnd;                       // file offset one past the last byte to send
+    uint32_t        cbFile;                     // the file size
+    uint32_t        tLast;                      // last time we made progress, for SDREADTIMEOUT
+    bool            fFill;                      // we are loading pCache as we send
+    bool            fNotModified;               // the client already has this version, send a 304
+    bool            fGzip;                      // we are sending the .gz copy of the file
+    char            szName[CBSDNAME];           // the file name if it fits, for the cache and the .gz copy; the request line is gone by the time we build the header
+    char            szExt[CBSDEXT];             // the file extension, for the content type
+    char            szETag[CBETAG];             // the ETag of the file we send
+    uint8_t         rgbBuff[CBSDSENDBUFF];      // the sector being sent when not using the cache
+} SDSEND;
+
+static SDSEND rgSDSend[cSDSendMax];
 
 /************************************************************************/
 /*    HTML Strings                                                      */
 /************************************************************************/
 static const char szEndOfURL[] = " HTTP";
 static const char szGET[] = "GET /";
+static const char szRange[] = "range:";           // header names and tokens are lower case, they are compared case insensitive
+static const char szBytes[] = "bytes=";
+static const char szIfNoneMatch[] = "if-none-match:";
+static const char szAcceptEncoding[] = "accept-encoding:";
+static const char szGzip[] = "gzip";
+static const char szGzipExt[] = ".gz";
 
 /************************************************************************/
 /*    State machine states                                              */
 /************************************************************************/
 typedef enum {
     PARSEFILENAME,
+    PARSEHEADER,
     BUILDHTTP,
     EXIT,
     SENDFILE,
@@ -98,30 +180,594 @@ typedef enum {
     DONE
  } STATE;
 
- /***    uint32_t SDRead(File fileSD, uint8_t * pbRead, uint32_t cbRead)
+/***    static FRESULT SDGetETag(const char * szFileName, char * szETag, uint32_t * pcbFile)
+ *
+ *    Parameters:
+ *          szFileName: The file to look up, you must hold the SD lock
+ *          szETag:     Receives the quoted ETag, CBETAG bytes
+ *          pcbFile:    Receives the file size
+ *              
+ *    Return Values:
+ *          FR_OK if the file exists
+ *
+ *    Description: 
+ *    
+ *      The ETag is made from the size and the FAT date and time of the file,
+ *      so it can be checked without reading the file.
+ * ------------------------------------------------------------ */
+static FRESULT SDGetETag(const char * szFileName, char * szETag, uint32_t * pcbFile)
+{
+    FRESULT fr = DDIRINFO::fsstat(szFileName);
+
+    if(fr == FR_OK)
+    {
+        *pcbFile = DDIRINFO::fsgetFileSize();
+        sprintf(szETag, "\"%x-%04x%04x\"", (unsigned int) *pcbFile, (unsigned int) DDIRINFO::fsgetDate(), (unsigned int) DDIRINFO::fsgetTime());
+    }
+
+    return(fr);
+}
+
+#if (CBSDCACHE > 0)
+/***    static SDCACHE * SDCacheLookup(const char * szFileName)
+ *
+ *    Parameters:
+ *          szFileName: The file to look for
+ *              
+ *    Return Values:
+ *          The loaded cache entry for the file, or NULL
+ *
+ * ------------------------------------------------------------ */
+static SDCACHE * SDCacheLookup(const char * szFileName)
+{
+    for(uint32_t i = 0; i < cSDCacheMax; i++)
+    {
+        if(rgSDCache[i].szName[0] != '\0' && !rgSDCache[i].fFilling && strcmp(rgSDCache[i].szName, szFileName) == 0)
+        {
+            return(&rgSDCache[i]);
+        }
+    }
+
+    return(NULL);
+}
+
+/***    static SDCACHE * SDCacheAlloc(const char * szFileName, uint32_t cbFile, const char * szETag)
+ *
+ *    Parameters:
+ *          szFileName: The file to cache
+ *          cbFile:     The size of the file
+ *          szETag:     The ETag of the file
+ *              
+ *    Return Values:
+ *          An entry marked fFilling with room for the file, or NULL if the file can't be cached right now
+ *
+ *    Description: 
+ *    
+ *      Files are packed in rgbSDCache. If there is not enough room at the end, least
+ *      recently used files are thrown out and the rest are moved down. Nothing moves
+ *      while a client is sending out of the cache; the file is just not cached this time.
+ * ------------------------------------------------------------ */
+static SDCACHE * SDCacheAlloc(const char * szFileName, uint32_t cbFile, const char * szETag)
+{
+    uint32_t    tCur    = SYSGetMilliSecond();
+    SDCACHE *   pFree   = NULL;
+
+    if(cbFile == 0 || cbFile > CBSDCACHEFILEMAX || cbFile > CBSDCACHE || szFileName[0] == '\0')
+    {
+        return(NULL);
+    }
+
+    while(true)
+    {
+        SDCACHE *   pLRU        = NULL;
+        uint32_t    cbUsed      = 0;
+        uint32_t    iTop        = 0;
+        bool        fMovable    = true;
+
+        pFree = NULL;
+        for(uint32_t i = 0; i < cSDCacheMax; i++)
+        {
+            SDCACHE * pCache = &rgSDCache[i];
+
+            if(pCache->szName[0] == '\0')
+            {
+                if(pFree == NULL)
+                {
+                    pFree = pCache;
+                }
+                continue;
+            }
+
+            cbUsed += pCache->cbFile;
+            if(pCache->iArena + pCache->cbFile > iTop)
+            {
+                iTop = pCache->iArena + pCache->cbFile;
+            }
+
+            if(pCache->cUsers > 0 || pCache->fFilling)
+            {
+                fMovable = false;
+            }
+            else if(pLRU == NULL || (tCur - pCache->tUsed) > (tCur - pLRU->tUsed))
+            {
+                pLRU = pCache;
+            }
+        }
+
+        // room at the end
+        if(pFree != NULL && iTop + cbFile <= CBSDCACHE)
+        {
+            pFree->iArena = iTop;
+            break;
+        }
+
+        // room if we pack the files down
+        else if(pFree != NULL && cbUsed + cbFile <= CBSDCACHE)
+        {
+            bool rgfMoved[cSDCacheMax];
+
+            if(!fMovable)
+            {
+                return(NULL);
+            }
+
+            memset(rgfMoved, 0, sizeof(rgfMoved));
+            iTop = 0;
+
+            // move the files down in the order they are in the arena so nothing is overwritten
+            while(true)
+            {
+                SDCACHE * pLow = NULL;
+
+                for(uint32_t i = 0; i < cSDCacheMax; i++)
+                {
+                    if(rgSDCache[i].szName[0] != '\0' && !rgfMoved[i] && (pLow == NULL || rgSDCache[i].iArena < pLow->iArena))
+                    {
+                        pLow = &rgSDCache[i];
+                    }
+                }
+
+                if(pLow == NULL)
+                {
+                    break;
+                }
+
+                memmove(&rgbSDCache[iTop], &rgbSDCache[pLow->iArena], pLow->cbFile);
+                pLow->iArena = iTop;
+                iTop += pLow->cbFile;
+                rgfMoved[pLow - rgSDCache] = true;
+            }
+
+            pFree->iArena = iTop;
+            break;
+        }
+
+        // throw out the least recently used file and try again
+        else if(pLRU != NULL)
+        {
+            xil_printf("Cache drop: %s\r\n", pLRU->szName);
+            pLRU->szName[0] = '\0';
+        }
+
+        else
+        {
+            return(NULL);
+        }
+    }
+
+    strcpy(pFree->szName, szFileName);
+    strcpy(pFree->szETag, szETag);
+    pFree->cbFile   = cbFile;
+    pFree->cbFilled = 0;
+    pFree->tUsed    = tCur;
+    pFree->tChecked = tCur;
+    pFree->cUsers   = 1;
+    pFree->fFilling = true;
+    pFree->fNoGzip  = false;
+
+    return(pFree);
+}
+#endif
+
+/***    static SDSEND * GetSDSend(CLIENTINFO * pClientInfo, bool fAlloc)
+ *
+ *    Parameters:
+ *          pClientInfo:    The client to find the send slot for
+ *          fAlloc:         true to take a free slot if the client does not have one
+ *              
+ *    Return Values:
+ *          The slot, or NULL if the client has none and none is free
+ *
+ * ------------------------------------------------------------ */
+static SDSEND * GetSDSend(CLIENTINFO * pClientInfo, bool fAlloc)
+{
+    SDSEND * pFree = NULL;
+
+    for(uint32_t i = 0; i < cSDSendMax; i++)
+    {
+        if(rgSDSend[i].pClientInfo == pClientInfo)
+        {
+            return(&rgSDSend[i]);
+        }
+        else if(pFree == NULL && rgSDSend[i].pClientInfo == NULL)
+        {
+            pFree = &rgSDSend[i];
+        }
+    }
+
+    if(fAlloc && pFree != NULL)
+    {
+        pFree->pClientInfo  = pClientInfo;
+        pFree->pCache       = NULL;
+        pFree->pbBase       = pFree->rgbBuff;
+        pFree->iBase        = 0;
+        pFree->iSent        = 0;
+        pFree->iAvail       = 0;
+        pFree->iFirst       = 0;
+        pFree->iEnd         = 0;
+        pFree->cbFile       = 0;
+        pFree->fFill        = false;
+        pFree->fNotModified = false;
+        pFree->fGzip        = false;
+        pFree->szName[0]    = '\0';
+        pFree->szExt[0]     = '\0';
+        pFree->szETag[0]    = '\0';
+        return(pFree);
+    }
+
+    return(NULL);
+}
+
+/***    static FRESULT SDOpenFile(SDSEND * pSend, const char * szFileName)
+ *
+ *    Parameters:
+ *          pSend:      The slot to open the file in, it must not have a file open
+ *          szFileName: The file to open; you must hold the SD lock
+ *              
+ *    Return Values:
+ *          FR_OK if the file is open or found in the cache
+ *
+ *    Description: 
+ *    
+ *      Looks for the file in the RAM cache first, every so often checking the
+ *      cached copy against the SD. Otherwise the file is opened on the SD.
+ *      On return cbFile and szETag are set.
+ * ------------------------------------------------------------ */
+static FRESULT SDOpenFile(SDSEND * pSend, const char * szFileName)
+{
+    FRESULT fr = FR_OK;
+
+#if (CBSDCACHE > 0)
+    // see if we have the file in RAM
+    if((pSend->pCache = SDCacheLookup(szFileName)) != NULL)
+    {
+        SDCACHE *   pCache  = pSend->pCache;
+        uint32_t    tCur    = SYSGetMilliSecond();
+
+        // every so often make sure the file on the SD has not changed
+        if((tCur - pCache->tChecked) > msSDCacheCheck)
+        {
+            uint32_t    cbFile  = 0;
+            char        szETag[CBETAG];
+
+            if(SDGetETag(szFileName, szETag, &cbFile) == FR_OK && strcmp(szETag, pCache->szETag) == 0)
+            {
+                pCache->tChecked    = tCur;
+                pCache->fNoGzip     = false;    // look for a .gz copy again too
+            }
+            else
+            {
+                xil_printf("Cache stale: %s\r\n", pCache->szName);
+
+                // if someone is still sending it, it goes on the next check
+                if(pCache->cUsers == 0)
+                {
+                    pCache->szName[0] = '\0';
+                }
+                pSend->pCache = NULL;
+            }
+        }
+
+        if(pSend->pCache != NULL)
+        {
+            xil_printf("HTML page: %s is cached\r\n", szFileName);
+            pCache->cUsers++;
+            pCache->tUsed   = tCur;
+            pSend->cbFile   = pCache->cbFile;
+            strcpy(pSend->szETag, pCache->szETag);
+            return(FR_OK);
+        }
+    }
+#endif
+
+    // not cached, open it on the SD
+    if((fr = SDGetETag(szFileName, pSend->szETag, &pSend->cbFile)) == FR_OK && (fr = pSend->dFile.fsopen(szFileName, FA_READ)) == FR_OK)
+    {
+        xil_printf("HTML page: %s exists!\r\n", szFileName);
+        pSend->cbFile = pSend->dFile.fssize();
+    }
+
+    return(fr);
+}
+
+/***    static void SDCloseFile(SDSEND * pSend)
+ *
+ *    Parameters:
+ *          pSend:  The slot to close the file in
+ *              
+ *    Return Values:
+ *          None
+ *
+ *    Description: 
+ *    
+ *      Closes the file and lets go of the cache entry. The file is only read,
+ *      so closing it does not touch the card and we don't need the SD lock.
+ *      A cache entry we were loading is kept only if all of the file made it in.
+ * ------------------------------------------------------------ */
+static void SDCloseFile(SDSEND * pSend)
+{
+    if(pSend->dFile)
+    {
+        pSend->dFile.fsclose();
+    }
+
+    if(pSend->pCache != NULL)
+    {
+        SDCACHE * pCache = pSend->pCache;
+
+        pCache->cUsers--;
+        if(pSend->fFill)
+        {
+            pCache->fFilling = false;
+            if(pCache->cbFilled != pCache->cbFile)
+            {
+                pCache->szName[0] = '\0';
+            }
+        }
+        pSend->pCache   = NULL;
+        pSend->fFill    = false;
+    }
+}
+
+/***    static void FreeSDSend(SDSEND * pSend)
+ *
+ *    Parameters:
+ *          pSend:  The slot to free, may be NULL
+ *              
+ *    Return Values:
+ *          None
+ *
+ *    Description: 
+ *    
+ *      Closes the file and frees the slot.
+ * ------------------------------------------------------------ */
+static void FreeSDSend(SDSEND * pSend)
+{
+    if(pSend != NULL)
+    {
+        SDCloseFile(pSend);
+        pSend->pClientInfo = NULL;
+    }
+}
+
+/***    static const char * SDHeaderValue(const char * szLine, const char * szHdr)
+ *
+ *    Parameters:
+ *          szLine:     A zero terminated request header line
+ *          szHdr:      The lower case header name including the :
+ *              
+ *    Return Values:
+ *          The value of the header with leading white space skipped, NULL if the line is not a szHdr header
+ *
+ * ------------------------------------------------------------ */
+static const char * SDHeaderValue(const char * szLine, const char * szHdr)
+{
+    uint32_t cbLine = strlen(szLine);
+
+    if(!IsHeader((const byte *) szLine, cbLine, szHdr))
+    {
+        return(NULL);
+    }
+
+    szLine += strlen(szHdr);
+    while(*szLine == ' ' || *szLine == '\t')
+    {
+        szLine++;
+    }
+
+    return(szLine);
+}
+
+/***    static bool SDAcceptsGzip(const char * szEncodings)
+ *
+ *    Parameters:
+ *          szEncodings:    What follows "Accept-Encoding: ", like "gzip, deflate, br"
+ *              
+ *    Return Values:
+ *          true if gzip is in the list, in any case, and not turned off with q=0
+ *
+ * ------------------------------------------------------------ */
+static bool SDAcceptsGzip(const char * szEncodings)
+{
+    const char *    szGz    = szEncodings;
+    uint32_t        cb      = strlen(szEncodings);
+
+    for( ; cb > 0 && !IsHeader((const byte *) szGz, cb, szGzip); szGz++, cb--);
+
+    if(cb == 0)
+    {
+        return(false);
+    }
+
+    // skip to the parameters, if any
+    szGz += sizeof(szGzip) - 1;
+    while(*szGz == ' ')
+    {
+        szGz++;
+    }
+
+    if(*szGz == ';')
+    {
+        const char * szQ = strstr(szGz, "q=");
+
+        if(szQ != NULL && (szQ - szGz) < 4 && strtod(&szQ[2], NULL) == 0)
+        {
+            return(false);
+        }
+    }
+
+    return(true);
+}
+
+/***    static bool SDParseRange(SDSEND * pSend, const char * szRangeSpec)
+ *
+ *    Parameters:
+ *          pSend:          The file to send
+ *          szRangeSpec:    What follows "Range: bytes=", like "500-999", "500-" or "-500"
+ *              
+ *    Return Values:
+ *          true if the range was taken
+ *
+ *    Description: 
+ *    
+ *      We only do a single range. A list of ranges, or a range we can't satisfy,
+ *      is ignored and the whole file is sent, which HTTP allows.
+ * ------------------------------------------------------------ */
+static bool SDParseRange(SDSEND * pSend, const char * szRangeSpec)
+{
+    uint32_t    cbFile  = pSend->cbFile;
+    uint32_t    iFirst  = 0;
+    uint32_t    iLast   = 0;
+    char *      szEnd   = NULL;
+
+    if(strchr(szRangeSpec, ',') != NULL || cbFile == 0)
+    {
+        return(false);
+    }
+
+    // the last n bytes
+    if(*szRangeSpec == '-')
+    {
+        uint32_t cbSuffix = strtoul(&szRangeSpec[1], &szEnd, 10);
+
+        if(szEnd == &szRangeSpec[1] || cbSuffix == 0)
+        {
+            return(false);
+        }
+        iFirst  = (cbSuffix < cbFile) ? cbFile - cbSuffix : 0;
+        iLast   = cbFile - 1;
+    }
+
+    // first-last or first-
+    else
+    {
+        iFirst = strtoul(szRangeSpec, &szEnd, 10);
+        if(szEnd == szRangeSpec || *szEnd != '-')
+        {
+            return(false);
+        }
+
+        szRangeSpec = szEnd + 1;
+        iLast = strtoul(szRangeSpec, &szEnd, 10);
+        if(szEnd == szRangeSpec || iLast >= cbFile)
+        {
+            iLast = cbFile - 1;
+        }
+    }
+
+    if(iFirst > iLast || iFirst >= cbFile)
+    {
+        return(false);
+    }
+
+    pSend->iFirst   = iFirst;
+    pSend->iEnd     = iLast + 1;
+    return(true);
+}
+
+/***    static bool SDSendFile(SDSEND * pSend, TCPSocket * pTCPSocket, IPSTATUS * pStatus)
  *
  *    Parameters:
- *          fileSD: An open SD file to read from, you must set the positon before calling SDRead
- *          pbRead: A pointer to a buffer to receive the data read
- *          cbRead: Max size of pbRead buffer
+ *          pSend:      The file being sent
+ *          pTCPSocket: The socket to send it on
+ *          pStatus:    Receives the socket status if the write failed
  *              
  *    Return Values:
- *          How many bytes were actually read.
+ *          true if something was read or written
  *
  *    Description: 
  *    
- *      Helper routine to read a buffer from a file.
+ *      Moves as much of the file to the socket as the socket takes.
+ *      When everything in memory has been sent the next sector is read, taking the SD
+ *      lock just for the read; sector aligned reads go from the card straight into
+ *      rgbBuff, or into the cache entry we are loading. From there it is written straight
+ *      into the socket, there is no copy through rgbOut and no trip through ProcessClient
+ *      for every 256 bytes. Whatever the socket does not take stays in memory for the
+ *      next call, so nothing is read twice and the SD is free for the other clients meanwhile.
+ *      A file sent out of the cache is never read at all.
  * ------------------------------------------------------------ */
-uint32_t SDRead(DFILE& dFile, uint8_t * pbRead, uint32_t cbRead)
- {
-    uint32_t cbA;
+static bool SDSendFile(SDSEND * pSend, TCPSocket * pTCPSocket, IPSTATUS * pStatus)
+{
+    bool fProgress = false;
+
+    // read the next piece of the file
+    if(pSend->iSent == pSend->iAvail && pSend->iAvail < pSend->iEnd)
+    {
+        uint32_t sdLockId = lockSD();
+
+        if(sdLockId != SDUNLOCKED)
+        {
+            // read up to the next sector boundary so the following reads are whole sectors
+            uint32_t    cbRead  = CBSDSENDBUFF - (pSend->iAvail % CBSDSENDBUFF);
+            uint32_t    cbGot   = 0;
+            uint8_t *   pbRead  = pSend->rgbBuff;
 
-    cbA = min(min(dFile.fssize(), cbRead), DFILE::FS_DEFAULT_BUFF_SIZE);
-    dFile.fsread(pbRead, cbA, &cbRead);
+            if(cbRead > (pSend->iEnd - pSend->iAvail))
+            {
+                cbRead = pSend->iEnd - pSend->iAvail;
+            }
 
+#if (CBSDCACHE > 0)
+            if(pSend->fFill)
+            {
+                pbRead = &rgbSDCache[pSend->pCache->iArena + pSend->iAvail];
+            }
+            else
+#endif
+            {
+                pSend->pbBase   = pSend->rgbBuff;
+                pSend->iBase    = pSend->iAvail;
+            }
 
-    return(cbRead);
- }
+            if(pSend->dFile.fstell() != pSend->iAvail)
+            {
+                pSend->dFile.fslseek(pSend->iAvail);
+            }
+
+            pSend->dFile.fsread(pbRead, cbRead, &cbGot);
+            pSend->iAvail += cbGot;
+            fProgress = cbGot > 0;
+
+            if(pSend->fFill)
+            {
+                pSend->pCache->cbFilled = pSend->iAvail;
+            }
+
+            unlockSD(sdLockId);
+        }
+    }
+
+    // and send it
+    if(pSend->iSent < pSend->iAvail)
+    {
+        uint32_t cbWritten = pTCPSocket->writeStream(&pSend->pbBase[pSend->iSent - pSend->iBase], pSend->iAvail - pSend->iSent, pStatus);
+
+        pSend->iSent += cbWritten;
+        fProgress = fProgress || cbWritten > 0;
+    }
+
+    return(fProgress);
+}
 
 /***    void SDSetup(void)
  *
@@ -194,11 +840,17 @@ void SDSetup(void)
  *      .htm, .html, .jpeg, .png, .txt and more may be rendered
  *      The file extension on the filename determine the MIME type
  *      returned to the client.
+ *      Small files are kept in a RAM cache after the first time they are sent,
+ *      and every file goes out with an ETag so a client that already has it
+ *      gets a 304 Not Modified. If the client takes gzip and there is a .gz copy
+ *      of the file next to it, the .gz copy is sent instead.
  *    
  * ------------------------------------------------------------ */
 GCMD::ACTION ComposeHTMLSDPage(CLIENTINFO * pClientInfo)
 {
-    char * pFileNameEnd     = NULL;
+    char *          pFileNameEnd    = NULL;
+    const char *    szFileName      = NULL;
+    SDSEND *        pSend           = GetSDSend(pClientInfo, false);
 
     GCMD::ACTION retCMD = GCMD::CONTINUE;
 
@@ -206,94 +858,240 @@ GCMD::ACTION ComposeHTMLSDPage(CLIENTINFO * pClientInfo)
     {
         case HTTPSTART:
 
-            if(pClientMutex != NULL || (sdLockId = lockSD()) == SDUNLOCKED)
+            if((pSend = GetSDSend(pClientInfo, true)) == NULL)
             {
                 break;
             }
-            pClientMutex = pClientInfo;
 
             xil_printf("Read an HTML page off of the SD card\r\n");
 
-            xil_printf("Entering Client ID: 0x%X\r\n", pClientMutex);
+            xil_printf("Entering Client ID: 0x%X\r\n", pClientInfo);
 
             pClientInfo->htmlState = PARSEFILENAME;
             retCMD = GCMD::GETLINE;
             break;
 
         case PARSEFILENAME:
+            {
+                uint32_t sdLockId = SDUNLOCKED;
 
-            // the assumption is that the file name will be on the first line of the command
-            // there is a bunch of other stuff on the line we don't care about, but it is at the
-            // end of the line.
-        	xil_printf("%s\r\n",(char *) pClientInfo->rgbIn);
+                // we need the SD to open the file; don't touch the line until we have it
+                if((sdLockId = lockSD()) == SDUNLOCKED)
+                {
+                    break;
+                }
 
-            // find the begining of the file name
-            szFileName = strstr((const char *) pClientInfo->rgbIn, szGET);
-            if(szFileName == NULL)
-            {
-                pClientInfo->htmlState = JMPFILENOTFOUND;
-                break;
-            }
-            szFileName += sizeof(szGET) - 1;
+                // the assumption is that the file name will be on the first line of the command
+                // there is a bunch of other stuff on the line we don't care about, but it is at the
+                // end of the line.
+                xil_printf("%s\r\n",(char *) pClientInfo->rgbIn);
 
-            // find the end of the file name
-            pFileNameEnd = strstr(szFileName, szEndOfURL);
+                // find the begining of the file name
+                szFileName = strstr((const char *) pClientInfo->rgbIn, szGET);
+                if(szFileName == NULL)
+                {
+                    unlockSD(sdLockId);
+                    pClientInfo->htmlState = JMPFILENOTFOUND;
+                    break;
+                }
+                szFileName += sizeof(szGET) - 1;
 
-            if(pFileNameEnd == NULL)
-            {
-                pClientInfo->htmlState = JMPFILENOTFOUND;
-                break;
+                // find the end of the file name
+                pFileNameEnd = strstr((char *) szFileName, szEndOfURL);
+
+                if(pFileNameEnd == NULL)
+                {
+                    unlockSD(sdLockId);
+                    pClientInfo->htmlState = JMPFILENOTFOUND;
+                    break;
+                }
+                else if(pFileNameEnd == szFileName)
+                {
+                    szFileName = szDefaultPage;
+                }
+                else
+                {
+                    *pFileNameEnd = '\0';
+                }
+
+                xil_printf("SD FileName: %s", szFileName);
+
+                // only names that fit can be cached
+                if(strlen(szFileName) < sizeof(pSend->szName))
+                {
+                    strcpy(pSend->szName, szFileName);
+                }
+
+                if(SDOpenFile(pSend, szFileName) != FR_OK)
+                {
+                    xil_printf("Unable to find HTML page: %s\r\n", szFileName);
+                    unlockSD(sdLockId);
+                    pClientInfo->htmlState = JMPFILENOTFOUND;
+                    break;
+                }
+
+                unlockSD(sdLockId);
+
+                // remember the extension for the content type
+                {
+                    const char * szExt = strchr(szFileName, '.');
+
+                    if(szExt != NULL && strlen(szExt) < sizeof(pSend->szExt))
+                    {
+                        strcpy(pSend->szExt, szExt);
+                    }
+                }
+
+                // by default the whole file is sent
+                pSend->iFirst   = 0;
+                pSend->iEnd     = pSend->cbFile;
+
+                pClientInfo->htmlState = PARSEHEADER;
+                retCMD = GCMD::GETLINE;
             }
-            else if(pFileNameEnd == szFileName)
+            break;
+
+        // read the rest of the header looking for a Range, If-None-Match or Accept-Encoding
+        case PARSEHEADER:
+
+            // a blank line is the end of the header
+            if(strlen((char *) pClientInfo->rgbIn) == 0)    // cbRead may be longer than just the line, so do a strlen()
             {
-                szFileName = szDefaultPage;
+                pClientInfo->htmlState = BUILDHTTP;
             }
             else
             {
-                *pFileNameEnd = '\0';
-            }
+                const char * szValue = NULL;
 
-            xil_printf("SD FileName: %s", szFileName);
+                if((szValue = SDHeaderValue((char *) pClientInfo->rgbIn, szRange)) != NULL)
+                {
+                    if(IsHeader((const byte *) szValue, strlen(szValue), szBytes) && SDParseRange(pSend, &szValue[sizeof(szBytes) - 1]))
+                    {
+                        xil_printf("Range %d-%d\r\n", pSend->iFirst, pSend->iEnd - 1);
+                    }
+                }
 
+                // the client already has this version of the file
+                else if((szValue = SDHeaderValue((char *) pClientInfo->rgbIn, szIfNoneMatch)) != NULL)
+                {
+                    pSend->fNotModified = strstr(szValue, pSend->szETag) != NULL || strchr(szValue, '*') != NULL;
+                }
 
-            if(dFile.fsopen(szFileName, FA_READ) == FR_OK)
-            {
-            	xil_printf("HTML page: %s exists!\r\n", szFileName);
-                pClientInfo->htmlState = BUILDHTTP;
-            }
+                // if the client takes gzip, see if there is a .gz copy of the file to send instead
+                else if((szValue = SDHeaderValue((char *) pClientInfo->rgbIn, szAcceptEncoding)) != NULL &&
+                        !pSend->fGzip && pSend->szName[0] != '\0' && strlen(pSend->szName) + sizeof(szGzipExt) <= sizeof(pSend->szName) &&
+                        (pSend->pCache == NULL || !pSend->pCache->fNoGzip) &&
+                        SDAcceptsGzip(szValue))
+                {
+                    uint32_t    sdLockId = SDUNLOCKED;
+                    char        szGzName[CBSDNAME];
 
-            else
-            {
-            	xil_printf("Unable to find HTML page: %s\r\n", szFileName);
-                pClientInfo->htmlState = JMPFILENOTFOUND;
+                    // we need the SD to look for the file; come back with the same line if we can't have it
+                    if((sdLockId = lockSD()) == SDUNLOCKED)
+                    {
+                        break;
+                    }
+
+                    strcpy(szGzName, pSend->szName);
+                    strcat(szGzName, szGzipExt);
+
+                    if(
+#if (CBSDCACHE > 0)
+                        SDCacheLookup(szGzName) != NULL ||
+#endif
+                        DFATFS::fsexists(szGzName))
+                    {
+                        SDCloseFile(pSend);
+
+                        if(SDOpenFile(pSend, szGzName) == FR_OK)
+                        {
+                            xil_printf("Sending %s\r\n", szGzName);
+                            strcpy(pSend->szName, szGzName);
+                            pSend->fGzip = true;
+                        }
+
+                        // it went away, go back to the plain file
+                        else if(SDOpenFile(pSend, pSend->szName) != FR_OK)
+                        {
+                            unlockSD(sdLockId);
+                            pClientInfo->htmlState = JMPFILENOTFOUND;
+                            break;
+                        }
+
+                        // Range and If-None-Match were for the other file
+                        pSend->iFirst       = 0;
+                        pSend->iEnd         = pSend->cbFile;
+                        pSend->fNotModified = false;
+                    }
+
+                    // don't look again until the cached file is checked
+                    else if(pSend->pCache != NULL)
+                    {
+                        pSend->pCache->fNoGzip = true;
+                    }
+
+                    unlockSD(sdLockId);
+                }
+                retCMD = GCMD::GETLINE;
             }
             break;
 
         // We need to build the HTTP directive
         case BUILDHTTP:
 
-            if(dFile && (dFile.fslseek(0) == FR_OK))
+            if(pSend->fNotModified)
             {
-                pClientInfo->cbWrite = BuildHTTPOKStr(false, dFile.fssize(), szFileName, (char *) pClientInfo->rgbOut, sizeof(pClientInfo->rgbOut));
-                if(pClientInfo->cbWrite > 0)
-                {
-                    pClientInfo->pbOut = pClientInfo->rgbOut;
-                    retCMD = GCMD::WRITE;
-                    pClientInfo->htmlState = SENDFILE;
-                    cbSent = 0;
-                    tStart = SYSGetMilliSecond();
+                xil_printf("Not modified\r\n");
+                pClientInfo->cbWrite = BuildHTTPNotModifiedStr(pClientInfo, pSend->szETag, (char *) pClientInfo->rgbOut, sizeof(pClientInfo->rgbOut));
+            }
+            else
+            {
+                pSend->iSent = pSend->iFirst;
 
-                    xil_printf("Writing file:%s\r\n", szFileName);
+                // sending out of the cache, it is all in memory
+                if(pSend->pCache != NULL)
+                {
+#if (CBSDCACHE > 0)
+                    pSend->pbBase   = &rgbSDCache[pSend->pCache->iArena];
+#endif
+                    pSend->iBase    = 0;
+                    pSend->iAvail   = pSend->iEnd;
                 }
+
+                // reading off of the SD
                 else
                 {
-                	xil_printf("Unable to build HTTP directive for file: %s", szFileName);
-                    pClientInfo->htmlState = JMPFILENOTFOUND;
+                    pSend->pbBase   = pSend->rgbBuff;
+                    pSend->iBase    = pSend->iFirst;
+                    pSend->iAvail   = pSend->iFirst;
+
+#if (CBSDCACHE > 0)
+                    // load the whole file into the cache as we send it, if there is room
+                    if(pSend->iFirst == 0 && pSend->iEnd == pSend->cbFile && (pSend->pCache = SDCacheAlloc(pSend->szName, pSend->cbFile, pSend->szETag)) != NULL)
+                    {
+                        xil_printf("Caching %s\r\n", pSend->szName);
+                        pSend->fFill    = true;
+                        pSend->pbBase   = &rgbSDCache[pSend->pCache->iArena];
+                        pSend->iBase    = 0;
+                    }
+#endif
                 }
+
+                pClientInfo->cbWrite = BuildHTTPRangeStr(pClientInfo, pSend->iFirst, pSend->iEnd - pSend->iFirst, pSend->cbFile, pSend->szExt, pSend->szETag, pSend->fGzip, (char *) pClientInfo->rgbOut, sizeof(pClientInfo->rgbOut));
+            }
+
+            if(pClientInfo->cbWrite > 0)
+            {
+                pClientInfo->pbOut = pClientInfo->rgbOut;
+                retCMD = GCMD::WRITE;
+                pClientInfo->htmlState = pSend->fNotModified ? EXIT : SENDFILE;
+                pSend->tLast = SYSGetMilliSecond();
+
+                xil_printf("Writing file\r\n");
             }
             else
             {
-            	xil_printf("Unable to open HTML page: %s\r\n", szFileName);
+                xil_printf("Unable to build HTTP directive for file");
                 pClientInfo->htmlState = JMPFILENOTFOUND;
             }
             break;
@@ -301,23 +1099,32 @@ GCMD::ACTION ComposeHTMLSDPage(CLIENTINFO * pClientInfo)
         // Send the file
         case SENDFILE:
             {
-                uint32_t    cbT = 0;
+                IPSTATUS status = ipsSuccess;
+
+                if(SDSendFile(pSend, pClientInfo->pTCPClient, &status))
+                {
+                    pSend->tLast = SYSGetMilliSecond();
+                }
 
-                if((cbT = SDRead(dFile, pClientInfo->rgbOut, sizeof(pClientInfo->rgbOut))) > 0)
+                // the socket did not take what we have, don't call us until it has room
+                else if(pSend->iSent < pSend->iAvail)
                 {
-                    cbSent += cbT;
-                    pClientInfo->pbOut = pClientInfo->rgbOut;
-                    pClientInfo->cbWrite = cbT;
-                    tStart = SYSGetMilliSecond();
-                    retCMD = GCMD::WRITE;
+                    pClientInfo->pollWait = TCPPOLLWRITE;
                 }
-                else if(cbSent == dFile.fssize())
+
+                if(IsIPStatusAnError(status))
                 {
-                   pClientInfo->htmlState = EXIT;
+                    // the response did not make it, don't keep the connection
+                    pClientInfo->fRespKeepAlive = false;
+                    pClientInfo->htmlState = HTTPDISCONNECT;
                 }
-                else if((SYSGetMilliSecond() - tStart) > SDREADTIMEOUT)
+                else if(pSend->iSent == pSend->iEnd)
                 {
-                   pClientInfo->htmlState = HTTPTIMEOUT;
+                    pClientInfo->htmlState = EXIT;
+                }
+                else if((SYSGetMilliSecond() - pSend->tLast) > SDREADTIMEOUT)
+                {
+                    pClientInfo->htmlState = HTTPTIMEOUT;
                 }
             }
             break;
@@ -329,37 +1136,23 @@ GCMD::ACTION ComposeHTMLSDPage(CLIENTINFO * pClientInfo)
 
         case JMPFILENOTFOUND:
         	xil_printf("Jumping to HTTP File Not Found page\r\n");
-
-            if(isMySD(sdLockId))
-            {
-                if(dFile)
-                {
-                    dFile.fsclose();
-                }
-                sdLockId = unlockSD(sdLockId);
-            }
-            pClientMutex = NULL;
+            FreeSDSend(pSend);
             return(JumpToComposeHTMLPage(pClientInfo, ComposeHTTP404Error));
             break;
 
         case HTTPTIMEOUT:
         	xil_printf("Timeout error occured, closing the session\r\n");
 
+            // we can't finish the response, don't keep the connection
+            pClientInfo->fRespKeepAlive = false;
+
             // fall thru to close
 
         case HTTPDISCONNECT:
-            if(pClientMutex == pClientInfo)
+            if(pSend != NULL)
             {
-            	xil_printf("Closing Client ID: 0x%X\r\n", pClientMutex);
-                if(isMySD(sdLockId))
-                {
-                    if(dFile)
-                    {
-                        dFile.fsclose();
-                    }
-                    sdLockId = unlockSD(sdLockId);
-                }
-                pClientMutex = NULL;
+            	xil_printf("Closing Client ID: 0x%X\r\n", pClientInfo);
+                FreeSDSend(pSend);
             }
             // fall thru Done
 
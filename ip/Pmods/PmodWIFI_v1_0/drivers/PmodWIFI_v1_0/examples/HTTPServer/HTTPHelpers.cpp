@@ -48,14 +48,24 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
 
 /************************************************************************/
 /*    HTTP Strings                                                      */
 /************************************************************************/
 static const char szHTTP404Error[] = "HTTP/1.1 404 Not Found\r\n\r\n";
+static const char szHTTP404KeepAlive[] = "HTTP/1.1 404 Not Found\r\nConnection: keep-alive\r\nContent-Length: 0\r\n\r\n";
 static const char szHTTPOK[] = "HTTP/1.1 200 OK\r\n";
+static const char szHTTPPartial[] = "HTTP/1.1 206 Partial Content\r\n";
+static const char szHTTPNotModified[] = "HTTP/1.1 304 Not Modified\r\n";
+static const char szETag[] = "ETag: ";
+static const char szContentEncodingGzip[] = "Content-Encoding: gzip\r\n";
+static const char szVaryEncoding[] = "Vary: Accept-Encoding\r\n";
+static const char szAcceptRanges[] = "Accept-Ranges: bytes\r\n";
 static const char szNoCache[] = "Cache-Control: no-cache\r\n";
 static const char szConnection[] = "Connection: close\r\n";
+static const char szConnectionKeepAlive[] = "Connection: keep-alive\r\n";
+static const char szChunked[] = "Transfer-Encoding: chunked\r\n";
 static const char szContentType[] = "Content-Type: ";
 static const char szContentLength[] = "Content-Length: ";
 static const char szLineTerminator[] = "\r\n";
@@ -70,6 +80,24 @@ typedef enum {
 
 static CLIENTINFO * pClientMutex = NULL;
 
+/***    static bool CanKeepAlive(CLIENTINFO * pClientInfo)
+ *
+ *    Parameters:
+ *          pClientInfo - the client info representing this connection
+ *              
+ *    Return Values:
+ *          true if the response may promise to keep the connection open
+ *
+ *    Description: 
+ *    
+ *      The client must have asked for a persistent connection (HTTP/1.1 or Connection: keep-alive)
+ *      and we must not have served cMaxKeepAliveRequests on this connection yet.
+ * ------------------------------------------------------------ */
+static bool CanKeepAlive(CLIENTINFO * pClientInfo)
+{
+    return(pClientInfo->fReqKeepAlive && (pClientInfo->cRequests + 1) < cMaxKeepAliveRequests);
+}
+
 
 /***    GCMD::ACTION ComposeHTTP404Error(CLIENTINFO * pClientInfo)
  *
@@ -109,8 +137,17 @@ GCMD::ACTION ComposeHTTP404Error(CLIENTINFO * pClientInfo)
 
         case HTTPERROR:
         	xil_printf("\r\n");
-            pClientInfo->pbOut = (const byte *) szHTTP404Error;
-            pClientInfo->cbWrite = sizeof(szHTTP404Error)-1;
+            if(CanKeepAlive(pClientInfo))
+            {
+                pClientInfo->fRespKeepAlive = true;
+                pClientInfo->pbOut = (const byte *) szHTTP404KeepAlive;
+                pClientInfo->cbWrite = sizeof(szHTTP404KeepAlive)-1;
+            }
+            else
+            {
+                pClientInfo->pbOut = (const byte *) szHTTP404Error;
+                pClientInfo->cbWrite = sizeof(szHTTP404Error)-1;
+            }
             pClientInfo->htmlState = HTTPDISCONNECT;
             retCMD = GCMD::WRITE;
             break;
@@ -132,6 +169,54 @@ GCMD::ACTION ComposeHTTP404Error(CLIENTINFO * pClientInfo)
     return(retCMD);
 }
 
+/***    bool FindToken(const byte * pb, uint32_t cb, const char * szToken)
+ *
+ *    Parameters:
+ *          pb      - the bytes to search, not zero terminated
+ *          cb      - the number of bytes in pb
+ *          szToken - the lower case token to look for
+ *              
+ *    Return Values:
+ *          true if szToken is in pb, ignoring case
+ *
+ * ------------------------------------------------------------ */
+bool FindToken(const byte * pb, uint32_t cb, const char * szToken)
+{
+    uint32_t cbToken = strlen(szToken);
+
+    for(uint32_t i = 0; i + cbToken <= cb; i++)
+    {
+        uint32_t j = 0;
+
+        for(j = 0; j < cbToken && tolower(pb[i+j]) == szToken[j]; j++);
+
+        if(j == cbToken)
+        {
+            return(true);
+        }
+    }
+
+    return(false);
+}
+
+/***    bool IsHeader(const byte * pb, uint32_t cb, const char * szHdr)
+ *
+ *    Parameters:
+ *          pb      - a request header line, not zero terminated
+ *          cb      - the number of bytes in pb
+ *          szHdr   - the lower case header name including the :
+ *              
+ *    Return Values:
+ *          true if the line is a szHdr header
+ *
+ * ------------------------------------------------------------ */
+bool IsHeader(const byte * pb, uint32_t cb, const char * szHdr)
+{
+    uint32_t cbHdr = strlen(szHdr);
+
+    return(cbHdr <= cb && FindToken(pb, cbHdr, szHdr));
+}
+
 /***    const char * GetContentTypeFromExt(const char * szExt)
  *
  *    Parameters:
@@ -166,6 +251,8 @@ const char * GetContentTypeFromExt(const char * szExt)
 
     else if(strcmp(szExt, "xml") == 0) return("text/xml");
 
+    else if(strcmp(szExt, "json") == 0) return("application/json");
+
     else if(strcmp(szExt, "zip") == 0) return("application/x-zip-compressed");
 
     else if(strcmp(szExt, "mpg") == 0 || strcmp(szExt, "mpeg") == 0) return("video/mpeg");
@@ -181,16 +268,18 @@ const char * GetContentTypeFromExt(const char * szExt)
     else return("text/plain");
 }
 
-/***    uint32_t BuildHTTPOKStr(bool fNoCache, uint32_t cbContentLen, const char * szFile, char * szHTTPOK, uint32_t cbHTTPOK)
+/***    static uint32_t BuildHTTPHeader(const char * szStatus, bool fNoCache, uint32_t cbContentLen, const char * szFile, bool fKeepAlive, bool fChunked, const char * szExtra, char * szHTTPOKStr, uint32_t cbHTTPOK)
  *
  *    Parameters:
+ *          szStatus        - the HTTP status line, like szHTTPOK
  *          fNoCache:       - true if you want the HTTP header to specify that the HTML page should not be cached by the browser
  *          cbContentLen:   - The length of the content, specify zero if you do not want this tag in there.
- *          szFile          - The full file name with extension. The content type will be derived from the file extension, 
- *                              if no extension a text content type is assumed
+ *          szFile          - The full file name with extension, used to derive the content type
+ *          fKeepAlive      - true to emit Connection: keep-alive, false for Connection: close
+ *          fChunked        - true to emit Transfer-Encoding: chunked
+ *          szExtra         - more header lines, each ending with \r\n; or NULL
  *          szHTTPOK        - A pointer to a string to take the HTTP OK command
- *          cbHTTPOK        - the length in bytes of the szHTTPOK string, this must be big enough to hold the whole HTTP directive
- *                              figure about 128 bytes. The ClientInfo->rgbOut output buffer big enough to hold the HTTP directive
+ *          cbHTTPOK        - the length in bytes of the szHTTPOK string
  *              
  *    Return Values:
  *          The number of bytes in the HTTP OK directive; less the null terminator
@@ -198,12 +287,14 @@ const char * GetContentTypeFromExt(const char * szExt)
  *
  *    Description: 
  *    
- *      This builds an HTTP OK directive. szHTTPOK must be large enough to hold the whole directive or zero will be returned
+ *      The common code behind the BuildHTTPOKStr() and BuildHTTPRangeStr() functions.
  *    
  * ------------------------------------------------------------ */
-uint32_t BuildHTTPOKStr(bool fNoCache, uint32_t cbContentLen, const char * szFile, char * szHTTPOKStr, uint32_t cbHTTPOK)
+static uint32_t BuildHTTPHeader(const char * szStatus, bool fNoCache, uint32_t cbContentLen, const char * szFile, bool fKeepAlive, bool fChunked, const char * szExtra, char * szHTTPOKStr, uint32_t cbHTTPOK)
 {
     uint32_t i = 0;
+    uint32_t cbStatus = strlen(szStatus);
+    uint32_t cbExtra = (szExtra != NULL) ? strlen(szExtra) : 0;
 
     char szContentLenStr[36];
     sprintf(szContentLenStr, "%d", (int)cbContentLen);
@@ -212,7 +303,10 @@ uint32_t BuildHTTPOKStr(bool fNoCache, uint32_t cbContentLen, const char * szFil
     const char * szContentTypeStr = GetContentTypeFromExt(strchr(szFile, '.'));
     uint32_t cbContentTypeStr = 0;
 
-    uint32_t cb = sizeof(szHTTPOK) + sizeof(szLineTerminator) - 2;
+    const char * szConnectionStr = fKeepAlive ? szConnectionKeepAlive : szConnection;
+    uint32_t cbConnectionStr = fKeepAlive ? sizeof(szConnectionKeepAlive) - 1 : sizeof(szConnection) - 1;
+
+    uint32_t cb = cbStatus + cbExtra + sizeof(szLineTerminator) - 1;
 
 
     if(fNoCache)
@@ -220,7 +314,7 @@ uint32_t BuildHTTPOKStr(bool fNoCache, uint32_t cbContentLen, const char * szFil
         cb += sizeof(szNoCache) - 1;
     }
 
-    cb += sizeof(szConnection) - 1;
+    cb += cbConnectionStr;
 
     if(szContentTypeStr == NULL)
     {
@@ -238,6 +332,11 @@ uint32_t BuildHTTPOKStr(bool fNoCache, uint32_t cbContentLen, const char * szFil
         cb += cbContentLenStr + sizeof(szContentLength) + sizeof(szLineTerminator) - 2;
     }
 
+    if(fChunked)
+    {
+        cb += sizeof(szChunked) - 1;
+    }
+
     // make sure we have enough room
     // we say >= because we must leave room for the terminating NULL
     if(cb >= cbHTTPOK)
@@ -246,8 +345,8 @@ uint32_t BuildHTTPOKStr(bool fNoCache, uint32_t cbContentLen, const char * szFil
     }
 
     // now start to build the HTTP OK header
-    memcpy(szHTTPOKStr, szHTTPOK, sizeof(szHTTPOK) - 1);
-    i = sizeof(szHTTPOK) - 1;
+    memcpy(szHTTPOKStr, szStatus, cbStatus);
+    i = cbStatus;
 
     // put in the no cache line if requested
     if(fNoCache)
@@ -257,8 +356,8 @@ uint32_t BuildHTTPOKStr(bool fNoCache, uint32_t cbContentLen, const char * szFil
     }
 
     // put in the connection type
-    memcpy(&szHTTPOKStr[i], szConnection, sizeof(szConnection) - 1);
-    i += sizeof(szConnection) - 1;
+    memcpy(&szHTTPOKStr[i], szConnectionStr, cbConnectionStr);
+    i += cbConnectionStr;
 
     // put in the content type
     if(szContentTypeStr != NULL)
@@ -282,6 +381,20 @@ uint32_t BuildHTTPOKStr(bool fNoCache, uint32_t cbContentLen, const char * szFil
         i += sizeof(szLineTerminator) - 1;
     }
 
+    // or say the body comes in chunks
+    if(fChunked)
+    {
+        memcpy(&szHTTPOKStr[i], szChunked, sizeof(szChunked) - 1);
+        i += sizeof(szChunked) - 1;
+    }
+
+    // anything else the caller wants in there
+    if(cbExtra > 0)
+    {
+        memcpy(&szHTTPOKStr[i], szExtra, cbExtra);
+        i += cbExtra;
+    }
+
     // terminate the HTTP header
     memcpy(&szHTTPOKStr[i], szLineTerminator, sizeof(szLineTerminator) - 1);
     i += sizeof(szLineTerminator) - 1;
@@ -293,3 +406,181 @@ uint32_t BuildHTTPOKStr(bool fNoCache, uint32_t cbContentLen, const char * szFil
 
     return(i);
 }
+
+/***    uint32_t BuildHTTPOKStr(bool fNoCache, uint32_t cbContentLen, const char * szFile, char * szHTTPOK, uint32_t cbHTTPOK)
+ *
+ *    Parameters:
+ *          fNoCache:       - true if you want the HTTP header to specify that the HTML page should not be cached by the browser
+ *          cbContentLen:   - The length of the content, specify zero if you do not want this tag in there.
+ *          szFile          - The full file name with extension. The content type will be derived from the file extension, 
+ *                              if no extension a text content type is assumed
+ *          szHTTPOK        - A pointer to a string to take the HTTP OK command
+ *          cbHTTPOK        - the length in bytes of the szHTTPOK string, this must be big enough to hold the whole HTTP directive
+ *                              figure about 128 bytes. The ClientInfo->rgbOut output buffer big enough to hold the HTTP directive
+ *              
+ *    Return Values:
+ *          The number of bytes in the HTTP OK directive; less the null terminator
+ *          zero is return on error of if szHTTPOKStr was not big enough to hold the whole directive
+ *
+ *    Description: 
+ *    
+ *      This builds an HTTP OK directive. szHTTPOK must be large enough to hold the whole directive or zero will be returned
+ *      The directive always says Connection: close, so the connection is closed once the page is done.
+ *    
+ * ------------------------------------------------------------ */
+uint32_t BuildHTTPOKStr(bool fNoCache, uint32_t cbContentLen, const char * szFile, char * szHTTPOKStr, uint32_t cbHTTPOK)
+{
+    return(BuildHTTPHeader(szHTTPOK, fNoCache, cbContentLen, szFile, false, false, NULL, szHTTPOKStr, cbHTTPOK));
+}
+
+/***    uint32_t BuildHTTPOKStr(CLIENTINFO * pClientInfo, bool fNoCache, uint32_t cbContentLen, const char * szFile, char * szHTTPOK, uint32_t cbHTTPOK)
+ *
+ *    Parameters:
+ *          pClientInfo     - the client info representing this connection and web page
+ *          fNoCache:       - true if you want the HTTP header to specify that the HTML page should not be cached by the browser
+ *          cbContentLen:   - The length of the content, specify zero if the length is not known
+ *          szFile          - The full file name with extension. The content type will be derived from the file extension, 
+ *                              if no extension a text content type is assumed
+ *          szHTTPOK        - A pointer to a string to take the HTTP OK command
+ *          cbHTTPOK        - the length in bytes of the szHTTPOK string, this must be big enough to hold the whole HTTP directive
+ *              
+ *    Return Values:
+ *          The number of bytes in the HTTP OK directive; less the null terminator
+ *          zero is return on error of if szHTTPOKStr was not big enough to hold the whole directive
+ *
+ *    Description: 
+ *    
+ *      Same as above, but if the client asked for a persistent connection the directive says
+ *      Connection: keep-alive and ProcessClient will wait for the next request on the connection
+ *      once the page returns GCMD::DONE. If the content length is not known the body is then sent
+ *      with Transfer-Encoding: chunked; ProcessClient frames every GCMD::WRITE after the header as a chunk,
+ *      so the directive must be the very next thing written.
+ *    
+ * ------------------------------------------------------------ */
+uint32_t BuildHTTPOKStr(CLIENTINFO * pClientInfo, bool fNoCache, uint32_t cbContentLen, const char * szFile, char * szHTTPOKStr, uint32_t cbHTTPOK)
+{
+    bool        fKeepAlive  = CanKeepAlive(pClientInfo);
+    bool        fChunked    = fKeepAlive && cbContentLen == 0;
+    uint32_t    cb          = BuildHTTPHeader(szHTTPOK, fNoCache, cbContentLen, szFile, fKeepAlive, fChunked, NULL, szHTTPOKStr, cbHTTPOK);
+
+    if(cb > 0)
+    {
+        pClientInfo->fRespKeepAlive = fKeepAlive;
+        pClientInfo->chunkState     = fChunked ? HTTPCHUNKHEADER : HTTPCHUNKNONE;
+    }
+
+    return(cb);
+}
+
+/***    uint32_t BuildHTTPRangeStr(CLIENTINFO * pClientInfo, uint32_t iFirst, uint32_t cbRange, uint32_t cbFile, const char * szFile, const char * szETagValue, bool fGzip, char * szHTTPStr, uint32_t cbHTTP)
+ *
+ *    Parameters:
+ *          pClientInfo     - the client info representing this connection and web page
+ *          iFirst          - the offset in the file of the first byte sent
+ *          cbRange         - the number of bytes sent
+ *          cbFile          - the size of the whole file
+ *          szFile          - The full file name with extension, used to derive the content type
+ *          szETagValue     - the quoted ETag of the file, or NULL or "" for none
+ *          fGzip           - the body is the gzip'ed file, szFile still gives the content type
+ *          szHTTPStr       - A pointer to a string to take the HTTP directive
+ *          cbHTTP          - the length in bytes of the szHTTPStr string
+ *              
+ *    Return Values:
+ *          The number of bytes in the HTTP directive; less the null terminator
+ *          zero is return on error of if szHTTPStr was not big enough to hold the whole directive
+ *
+ *    Description: 
+ *    
+ *      Builds the header for a page that can answer HTTP Range requests. If the range is the
+ *      whole file this is a 200 OK saying Accept-Ranges: bytes, otherwise a 206 Partial Content
+ *      with the Content-Range. Keep-alive is handled as in BuildHTTPOKStr(pClientInfo, ...).
+ *      With an ETag the client can later ask for the file with If-None-Match
+ *      and get a BuildHTTPNotModifiedStr() back instead of the file.
+ *      Vary: Accept-Encoding is always sent as the file may have a .gz copy,
+ *      so caches keep the gzip'ed and plain answers apart.
+ *    
+ * ------------------------------------------------------------ */
+uint32_t BuildHTTPRangeStr(CLIENTINFO * pClientInfo, uint32_t iFirst, uint32_t cbRange, uint32_t cbFile, const char * szFile, const char * szETagValue, bool fGzip, char * szHTTPStr, uint32_t cbHTTP)
+{
+    bool        fKeepAlive  = CanKeepAlive(pClientInfo);
+    bool        fChunked    = fKeepAlive && cbRange == 0;
+    bool        fPartial    = cbRange != cbFile;
+    char        szExtra[176];
+    uint32_t    cb          = 0;
+
+    if(fPartial)
+    {
+        sprintf(szExtra, "Content-Range: bytes %u-%u/%u\r\n", (unsigned int) iFirst, (unsigned int) (iFirst + cbRange - 1), (unsigned int) cbFile);
+    }
+    else
+    {
+        strcpy(szExtra, szAcceptRanges);
+    }
+
+    if(szETagValue != NULL && szETagValue[0] != '\0' && strlen(szExtra) + sizeof(szETag) + strlen(szETagValue) + sizeof(szLineTerminator) <= sizeof(szExtra) - sizeof(szContentEncodingGzip) - sizeof(szVaryEncoding))
+    {
+        strcat(szExtra, szETag);
+        strcat(szExtra, szETagValue);
+        strcat(szExtra, szLineTerminator);
+    }
+
+    if(fGzip)
+    {
+        strcat(szExtra, szContentEncodingGzip);
+    }
+    strcat(szExtra, szVaryEncoding);
+
+    cb = BuildHTTPHeader(fPartial ? szHTTPPartial : szHTTPOK, false, cbRange, szFile, fKeepAlive, fChunked, szExtra, szHTTPStr, cbHTTP);
+
+    if(cb > 0)
+    {
+        pClientInfo->fRespKeepAlive = fKeepAlive;
+        pClientInfo->chunkState     = fChunked ? HTTPCHUNKHEADER : HTTPCHUNKNONE;
+    }
+
+    return(cb);
+}
+
+/***    uint32_t BuildHTTPNotModifiedStr(CLIENTINFO * pClientInfo, const char * szETagValue, char * szHTTPStr, uint32_t cbHTTP)
+ *
+ *    Parameters:
+ *          pClientInfo     - the client info representing this connection and web page
+ *          szETagValue     - the quoted ETag of the file the client already has
+ *          szHTTPStr       - A pointer to a string to take the HTTP directive
+ *          cbHTTP          - the length in bytes of the szHTTPStr string
+ *              
+ *    Return Values:
+ *          The number of bytes in the HTTP directive; less the null terminator
+ *          zero is return on error of if szHTTPStr was not big enough to hold the whole directive
+ *
+ *    Description: 
+ *    
+ *      Builds a 304 Not Modified, the answer to an If-None-Match that matched.
+ *      A 304 never has a body, so the connection can be kept without a length.
+ *      It carries the same Vary: Accept-Encoding as BuildHTTPRangeStr() did for the file.
+ *    
+ * ------------------------------------------------------------ */
+uint32_t BuildHTTPNotModifiedStr(CLIENTINFO * pClientInfo, const char * szETagValue, char * szHTTPStr, uint32_t cbHTTP)
+{
+    bool            fKeepAlive      = CanKeepAlive(pClientInfo);
+    const char *    szConn          = fKeepAlive ? szConnectionKeepAlive : szConnection;
+    uint32_t        cb              = (sizeof(szHTTPNotModified) - 1) + (sizeof(szETag) - 1) + strlen(szETagValue) + (sizeof(szLineTerminator) - 1) + (sizeof(szVaryEncoding) - 1) + strlen(szConn) + (sizeof(szLineTerminator) - 1);
+
+    if(cb >= cbHTTP)
+    {
+        return(0);
+    }
+
+    strcpy(szHTTPStr, szHTTPNotModified);
+    strcat(szHTTPStr, szETag);
+    strcat(szHTTPStr, szETagValue);
+    strcat(szHTTPStr, szLineTerminator);
+    strcat(szHTTPStr, szVaryEncoding);
+    strcat(szHTTPStr, szConn);
+    strcat(szHTTPStr, szLineTerminator);
+
+    pClientInfo->fRespKeepAlive = fKeepAlive;
+    pClientInfo->chunkState     = HTTPCHUNKNONE;
+
+    return(cb);
+}
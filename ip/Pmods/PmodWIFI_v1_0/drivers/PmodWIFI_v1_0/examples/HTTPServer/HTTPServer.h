@@ -60,10 +60,23 @@
 
 #define OFFSETOF(t,m)        ((uint32_t) (&(((t *) 0)->m)))
 
-#define CNTHTTPCMD          10      // The Max number of unique HTML pages we vector off of. This must be at least 1. 
+#ifndef CNTROUTENODES
+#define CNTROUTENODES       1024    // The Max number of nodes in the URL router; each AddHTMLPage() takes one per character not shared with an earlier match string, 12 bytes each
+#endif
+#define CNTROUTEPARAMS      4       // The Max number of path parameters remembered for a request
+#define ROUTEPARAM          '*'     // In an AddHTMLPage() match string this matches one path segment, fetch it with GetRouteParam()
 #define secClientTO         10      // time in seconds to wait for a response before aborting a client connection.
+#define secClientKeepAliveTO 5      // time in seconds an idle HTTP/1.1 persistent connection is held open waiting for the next request.
+#define cMaxKeepAliveRequests 100   // max number of requests served on one persistent connection before it is closed.
+#ifndef CBCLILENTINPUTBUFF
 #define CBCLILENTINPUTBUFF  256     // The max size of the TCP read buffer, this typically only has to be as large as the URL up to the HTTP tag in the GET line
-#define CBCLILENTOUTPUTBUFF 256     // This is scratch output buffer space to generate out going HTML strings it, it is optional if not needed can be set as small as 4;
+#endif
+#ifndef CBCLILENTOUTPUTBUFF
+#define CBCLILENTOUTPUTBUFF 320     // This is scratch output buffer space to generate out going HTML strings it, it is optional if not needed can be set as small as 4; HTMLSDPage needs CBSDHTTPMAX
+#endif
+#ifndef cClientStepsMax
+#define cClientStepsMax     8       // The max number of ProcessClient() steps a ready client gets each time through ProcessServer()
+#endif
 
 // these are predefine HTML state machine states, HTTPINIT "must" be implemented, the others can be processed under case default if not needed.
 #define HTTPSTART           10000   // This is a predefine state for the rendering HTML page to initialize the state machine 
@@ -72,6 +85,12 @@
 
 #define SDREADTIMEOUT 10000          // We have waited too long to read from the SD card in ms
 
+// chunked transfer encoding of the response body, set up by BuildHTTPOKStr(pClientInfo, ...) when the content length is not known
+#define HTTPCHUNKNONE       0       // the response body is not chunked
+#define HTTPCHUNKHEADER     1       // the next GCMD::WRITE is the HTTP header and is written as is
+#define HTTPCHUNKBODY       2       // every GCMD::WRITE is sent as one chunk; no chunk written yet
+#define HTTPCHUNKOPEN       3       // a chunk has been written and still needs its closing \r\n
+
 // LED State Machine
 // we put all of the global state variables in namespaces so the namespace is completely open in each HTML render file
 namespace SLED {
@@ -135,17 +154,52 @@ typedef struct CLIENTINFO_T
 
     // pointer to the HTML page rendering function
     FNRENDERHTML    ComposeHTMLPage;
+
+    // the TCPPOLL* events the client is waiting for; 0 if it has work to do. ProcessClient() sets this
+    // when it runs out of input or socket space, a page returning GCMD::CONTINUE may set it too.
+    // ProcessServer() does not call the client again until one of the events, a TCPPOLLHUP, or its timeout.
+    uint32_t        pollWait;
+
+    // HTTP/1.1 persistent connection variables, process client owns these
+    uint32_t        secTimeout;                     // the timeout in seconds currently applied to tStartClient; shorter while idle between requests
+    uint32_t        cRequests;                      // number of requests completed on this connection
+    uint32_t        cbLine;                         // length of the line handed out on the last GCMD::GETLINE, it is still at the front of rgbIn
+    uint32_t        cbReadLine;                     // cbRead when that line was handed out; if the page changes cbRead we no longer know where the line ends
+    uint32_t        cbBodyLeft;                     // request body bytes (Content-Length) still to be thrown away before the next request
+    bool            fReqLine;                       // the request line of the current request has been looked at
+    bool            fEndOfHeader;                   // the blank line ending the request header has been seen
+    bool            fReqKeepAlive;                  // the client will accept another request on this connection
+    bool            fRespKeepAlive;                 // our response header promised to keep the connection open
+    uint32_t        chunkState;                     // one of the HTTPCHUNK* values
+    uint32_t        cbChunk;                        // number of bytes in rgbChunk
+    uint32_t        cbChunkWritten;                 // number of bytes of rgbChunk written so far
+    byte            rgbChunk[16];                   // the chunk size line, or the last chunk, of a chunked response
+
+    // URL router variables, process client owns these
+    uint32_t        cbRouted;                       // number of bytes of rgbIn run through the router so far
+    uint16_t        iRouteNode;                     // where the router is in the route trie, 0 is the root
+    uint16_t        iRouteMatch;                    // the node of the longest match string matched so far, 0 if none
+    bool            fInRouteParam;                  // the router is in the middle of a path parameter
+    uint8_t         cRouteParams;                   // number of path parameters seen so far
+    uint8_t         cRouteParamsMatch;              // number of those that belong to iRouteMatch
+    uint16_t        rgiRouteParam[CNTROUTEPARAMS];  // where each path parameter starts in the request line
+    uint16_t        rgcbRouteParam[CNTROUTEPARAMS]; // and how long it is
 } CLIENTINFO;
 
 // server/client functions
 void ServerSetup(void);
 void ProcessServer(void);
 GCMD::ACTION ProcessClient(CLIENTINFO * pClientInfo);
+bool IsClientReady(CLIENTINFO * pClientInfo);
 GCMD::ACTION JumpToComposeHTMLPage(CLIENTINFO * pClientInfo, FNRENDERHTML FnJumpComposeHTMLPage);
 
 // rendering functions
 bool AddHTMLPage(const char * szMatchStr, FNRENDERHTML FnComposeHTMLPage);
 void SetDefaultHTMLPage(FNRENDERHTML FnDefaultHTMLPage);
+uint32_t GetRouteParam(CLIENTINFO * pClientInfo, uint32_t iParam, char * szParam, uint32_t cbParam);
+#ifdef ROUTESELFTEST
+bool RouteSelfTest(void);
+#endif
 
 // predefined rendering pages
 GCMD::ACTION ComposeHTTP404Error(CLIENTINFO * pClientInfo);
@@ -185,8 +239,13 @@ static inline uint32_t __attribute__((always_inline)) unlockSD(uint32_t sdUnlock
 }
 
 // HTTP helper functions
+bool FindToken(const byte * pb, uint32_t cb, const char * szToken);
+bool IsHeader(const byte * pb, uint32_t cb, const char * szHdr);
 const char * GetContentTypeFromExt(const char * szExt);
 uint32_t BuildHTTPOKStr(bool fNoCache, uint32_t cbContentLen, const char * szFile, char * szHTTPOKStr, uint32_t cbHTTPOK);
+uint32_t BuildHTTPOKStr(CLIENTINFO * pClientInfo, bool fNoCache, uint32_t cbContentLen, const char * szFile, char * szHTTPOKStr, uint32_t cbHTTPOK);
+uint32_t BuildHTTPRangeStr(CLIENTINFO * pClientInfo, uint32_t iFirst, uint32_t cbRange, uint32_t cbFile, const char * szFile, const char * szETagValue, bool fGzip, char * szHTTPStr, uint32_t cbHTTP);
+uint32_t BuildHTTPNotModifiedStr(CLIENTINFO * pClientInfo, const char * szETagValue, char * szHTTPStr, uint32_t cbHTTP);
 
 // Generic Helper functions
 void SetLED(SLED::STATE state);
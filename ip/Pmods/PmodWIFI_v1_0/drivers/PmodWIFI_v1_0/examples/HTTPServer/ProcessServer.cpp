@@ -227,7 +227,7 @@ void ServerSetup(void)
  *          4. Or uses the static IP you assign; then you must supply DNS and subnet
  *          5. Starts listening on the supplied server port.
  *          6. Accepts client connections
- *          7. Schedules the processing on client connections in a round robin yet fashion (cooperative execution).
+ *          7. Schedules the processing on client connections that are ready in a round robin yet fashion (cooperative execution).
  *          8. Automatically restart if the network goes down
  *      
  *      This illistrates how to write a state machine like loop
@@ -959,43 +959,59 @@ void ProcessServer(void)
         break;
     }
   
-    // process only 1 of the clients in a round robin fashion.
+    // process the next client that has something to do, in a round robin fashion.
+    // A client waiting on its socket is skipped until TCPPoll() says the socket is ready,
+    // so idle connections cost a poll and not a trip through their state machines.
     cWorkingClients = 0;
     i = iNextClientToProcess;
     do {
         if(rgClient[i].pTCPClient != NULL)
         {
             cWorkingClients++;
-            SetLED(SLED::WORKING);
-            switch(ProcessClient(&rgClient[i]))
+
+            if(IsClientReady(&rgClient[i]))
             {
-                case GCMD::RESTART:
-                    state = RESTARTNOW;
-                    break;
+                GCMD::ACTION    action  = GCMD::CONTINUE;
+                uint32_t        cSteps  = 0;
 
-                case GCMD::TERMINATE:
-                    state = TERMINATE;
-                    break;
+                SetLED(SLED::WORKING);
 
-                case GCMD::REBOOT:
-                    state = REBOOT;
-                    break;
+                // let it run a few steps while it has work and does not need the server
+                do {
+                    action = ProcessClient(&rgClient[i]);
+                    cSteps++;
+                } while(action == GCMD::CONTINUE && rgClient[i].pollWait == 0 && cSteps < cClientStepsMax);
 
-                // done with this socket
-                case GCMD::ADDSOCKET:
-                    tcpServer.addSocket(*(rgClient[i].pTCPClient));
-                    rgClient[i].pTCPClient = NULL;
-                    break;
-
-                case GCMD::CONTINUE:
-                case GCMD::READ:
-                case GCMD::WRITE:  
-                case GCMD::DONE:  
-                default:
-                    break;
+                switch(action)
+                {
+                    case GCMD::RESTART:
+                        state = RESTARTNOW;
+                        break;
+
+                    case GCMD::TERMINATE:
+                        state = TERMINATE;
+                        break;
+
+                    case GCMD::REBOOT:
+                        state = REBOOT;
+                        break;
+
+                    // done with this socket
+                    case GCMD::ADDSOCKET:
+                        tcpServer.addSocket(*(rgClient[i].pTCPClient));
+                        rgClient[i].pTCPClient = NULL;
+                        break;
+
+                    case GCMD::CONTINUE:
+                    case GCMD::READ:
+                    case GCMD::WRITE:  
+                    case GCMD::DONE:  
+                    default:
+                        break;
+                }
+                iNextClientToProcess = (i + 1) % cMaxSocketsToListen;
+                break;
             }
-            iNextClientToProcess = (i + 1) % cMaxSocketsToListen;
-            break;
         }
         ++i %=  cMaxSocketsToListen;
     } while(i != iNextClientToProcess);
@@ -73,6 +73,34 @@ static uint32_t cbContentLenght = 0;
 static uint32_t iIn = 0;
 
 #define cModifiablePins (NUM_DIGITAL_PINS - (sizeof(rgDedicatedPins)/sizeof(rgDedicatedPins[0])))
+
+// the JSON pin API, one scan of the GPIO banks is shared by every client asking for the pins
+#define msPinScan           20                                  // the GPIO banks are read at most this often
+#define msPinWaitMax        25000                               // the longest a GET /pins.json?wait= request is held
+#define CBPINJSON           48                                  // room for one pin in the JSON output
+#define CNTGPIO             (sizeof(gpio)/sizeof(gpio[0]))
+
+#ifndef cPinsJSONMax
+#define cPinsJSONMax        cMaxSocketsToListen
+#endif
+
+typedef struct _PINSJSON
+{
+    CLIENTINFO *    pClientInfo;    // the client this is for, NULL if free
+    uint32_t        revSince;       // only send the pins changed after this revision, 0 for all of them
+    uint32_t        revSent;        // the revision the response says it is
+    uint32_t        tWaitStart;     // when the request came in
+    uint32_t        msWait;         // how long to hold the request waiting for a change
+    uint32_t        iPin;           // the next pin to write
+    bool            fFirst;         // no pin written yet
+} PINSJSON;
+
+static PINSJSON rgPinsJSON[cPinsJSONMax];
+static uint32_t revPins             = 1;        // bumped by every scan that sees a change and every pin state change
+static uint32_t rgrevPin[CNTGPIO];              // the revPins each pin last changed at
+static u8       rgPinValue[CNTGPIO];            // the pin values as of the last scan
+static uint32_t tPinScan            = 0;
+static bool     fPinScanned         = false;
 /************************************************************************/
 /*    HTML Strings                                                      */
 /************************************************************************/
@@ -238,7 +266,7 @@ GCMD::ACTION ComposeHTMLGetPINS(CLIENTINFO * pClientInfo)
 
         // Put out the header
         case WRITEHTTP:
-            pClientInfo->cbWrite = BuildHTTPOKStr(false, cbPage, ".htm", (char *) pClientInfo->rgbOut, sizeof(pClientInfo->rgbOut));
+            pClientInfo->cbWrite = BuildHTTPOKStr(pClientInfo, false, cbPage, ".htm", (char *) pClientInfo->rgbOut, sizeof(pClientInfo->rgbOut));
             pClientInfo->pbOut = pClientInfo->rgbOut;
             pClientInfo->htmlState = WRITEHTMLSTART;
             retCMD = GCMD::WRITE;
@@ -561,6 +589,7 @@ static void UpdatePin(const u32 iPin, const char pinState)
     }
 
     gpio[iPin].pinState = pinCfg;
+    rgrevPin[iPin] = ++revPins;
 
     return;
 }
@@ -794,6 +823,307 @@ GCMD::ACTION ComposeHTMLPostPINS(CLIENTINFO * pClientInfo)
     return(retCMD);
 }
 
+/***    static void ScanPins(void)
+ *
+ *    Parameters:
+ *          None
+ *
+ *    Return Values:
+ *          None
+ *
+ *    Description:
+ *
+ *      Reads the GPIO banks into rgPinValue and gives the pins that
+ *      changed a new revision. Each bank is read once no matter how
+ *      many pins it has, and no more often than msPinScan no matter
+ *      how many clients are waiting on the pins.
+ *
+ * ------------------------------------------------------------ */
+static void ScanPins(void)
+{
+    uint32_t    tCur        = SYSGetMilliSecond();
+    u32         baseaddr    = 0;
+    u32         dwBank      = 0;
+    bool        fBank       = false;
+    bool        fChanged    = false;
+
+    if(fPinScanned && (tCur - tPinScan) < msPinScan)
+    {
+        return;
+    }
+    fPinScanned = true;
+    tPinScan    = tCur;
+
+    for(uint32_t i = 0; i < NUM_DIGITAL_PINS; i++)
+    {
+        u8 value = 0;
+
+        if(gpio[i].pincap == DEDICATED)
+        {
+            continue;
+        }
+
+        // the pins of a bank are added together, so this is one read per bank
+        if(!fBank || gpio[i].baseaddr != baseaddr)
+        {
+            baseaddr    = gpio[i].baseaddr;
+            dwBank      = Xil_In32(baseaddr);
+            fBank       = true;
+        }
+
+        value = (dwBank >> gpio[i].bitnum) & 1;
+        if(value != rgPinValue[i])
+        {
+            if(!fChanged)
+            {
+                revPins++;
+                fChanged = true;
+            }
+            rgPinValue[i]   = value;
+            rgrevPin[i]     = revPins;
+        }
+    }
+}
+
+/***    static bool GetQueryValue(CLIENTINFO * pClientInfo, const char * szName, uint32_t * pValue)
+ *
+ *    Parameters:
+ *          pClientInfo - the client info representing this connection and web page
+ *          szName      - the name of the query parameter
+ *          pValue      - receives the value of the parameter
+ *
+ *    Return Values:
+ *          true if the parameter was found
+ *
+ *    Description:
+ *
+ *      Looks for ?name=value or &name=value in the URL of the request line,
+ *      this must be called while the request line is still in rgbIn.
+ *
+ * ------------------------------------------------------------ */
+static bool GetQueryValue(CLIENTINFO * pClientInfo, const char * szName, uint32_t * pValue)
+{
+    uint32_t    cbName  = strlen(szName);
+    uint32_t    cSpaces = 0;
+
+    for(uint32_t i = 0; i < pClientInfo->cbRead; i++)
+    {
+        byte b = pClientInfo->rgbIn[i];
+
+        // the URL is between the first and second space
+        if(b == '\r' || b == '\n' || (b == ' ' && ++cSpaces == 2))
+        {
+            break;
+        }
+
+        else if(cSpaces == 1 && (b == '?' || b == '&') && (i + cbName + 1) < pClientInfo->cbRead &&
+                memcmp(&pClientInfo->rgbIn[i+1], szName, cbName) == 0 && pClientInfo->rgbIn[i+cbName+1] == '=')
+        {
+            *pValue = strtoul((char *) &pClientInfo->rgbIn[i+cbName+2], NULL, 10);
+            return(true);
+        }
+    }
+
+    return(false);
+}
+
+/***    static PINSJSON * GetPinsJSON(CLIENTINFO * pClientInfo, bool fAlloc)
+ *
+ *    Parameters:
+ *          pClientInfo:    The client to find the JSON slot for
+ *          fAlloc:         true to take a free slot if the client does not have one
+ *
+ *    Return Values:
+ *          The slot, or NULL if the client has none and none is free
+ *
+ * ------------------------------------------------------------ */
+static PINSJSON * GetPinsJSON(CLIENTINFO * pClientInfo, bool fAlloc)
+{
+    PINSJSON * pFree = NULL;
+
+    for(uint32_t i = 0; i < cPinsJSONMax; i++)
+    {
+        if(rgPinsJSON[i].pClientInfo == pClientInfo)
+        {
+            return(&rgPinsJSON[i]);
+        }
+        else if(pFree == NULL && rgPinsJSON[i].pClientInfo == NULL)
+        {
+            pFree = &rgPinsJSON[i];
+        }
+    }
+
+    if(fAlloc && pFree != NULL)
+    {
+        memset(pFree, 0, sizeof(PINSJSON));
+        pFree->pClientInfo = pClientInfo;
+        return(pFree);
+    }
+
+    return(NULL);
+}
+
+/************************************************************************/
+/*    State machine states                                              */
+/************************************************************************/
+typedef enum {
+    JSONWAIT,
+    JSONHTTP,
+    JSONPINS,
+    JSONDONE
+} STATEJSON;
+
+/***    GCMD::ACTION ComposeJSONGetPINS(CLIENTINFO * pClientInfo)
+ *
+ *    Parameters:
+ *          pClientInfo - the client info representing this connection and web page
+ *
+ *    Return Values:
+ *          GCMD::ACTION    - GCMD::CONTINUE, GCMD::WRITE, or GCMD::DONE as for the other pages
+ *
+ *    Description:
+ *
+ *      GET /pins.json answers with the pins as
+ *
+ *          {"rev":12,"pins":[{"pin":0,"state":"L","value":0},...]}
+ *
+ *      where state is the letter the pins page posts (X for a dedicated pin)
+ *      and value is null for pins that are not read. With ?rev=N only the pins
+ *      that changed after revision N are sent, so a dashboard just keeps asking
+ *      with the rev of the last answer. Adding &wait=S holds the request up to S seconds
+ *      until something changes (long poll). No mutex is taken, every client works
+ *      off the one shared ScanPins(), so a waiting client costs a compare until the
+ *      next scan sees a change.
+ *
+ * ------------------------------------------------------------ */
+GCMD::ACTION ComposeJSONGetPINS(CLIENTINFO * pClientInfo)
+{
+    PINSJSON *      pJSON   = GetPinsJSON(pClientInfo, false);
+    GCMD::ACTION    retCMD  = GCMD::CONTINUE;
+    uint32_t        cb      = 0;
+
+    switch(pClientInfo->htmlState)
+    {
+        case HTTPSTART:
+
+            // wait for a free slot
+            if((pJSON = GetPinsJSON(pClientInfo, true)) == NULL)
+            {
+                break;
+            }
+
+            GetQueryValue(pClientInfo, "rev", &pJSON->revSince);
+            if(GetQueryValue(pClientInfo, "wait", &pJSON->msWait))
+            {
+                pJSON->msWait = pJSON->msWait < (msPinWaitMax / 1000) ? pJSON->msWait * 1000 : msPinWaitMax;
+            }
+
+            // a revision we have not got to, say from before a reboot; send everything
+            ScanPins();
+            if(pJSON->revSince > revPins)
+            {
+                pJSON->revSince = 0;
+            }
+
+            pJSON->tWaitStart = SYSGetMilliSecond();
+            pClientInfo->htmlState = JSONWAIT;
+            break;
+
+        case JSONWAIT:
+            ScanPins();
+            if(pJSON->revSince < revPins || (SYSGetMilliSecond() - pJSON->tWaitStart) >= pJSON->msWait)
+            {
+                pClientInfo->htmlState = JSONHTTP;
+            }
+            break;
+
+        // the length is not known up front, so this goes out chunked on a keep-alive connection
+        case JSONHTTP:
+            pJSON->revSent  = revPins;
+            pJSON->iPin     = 0;
+            pJSON->fFirst   = true;
+            pClientInfo->cbWrite = BuildHTTPOKStr(pClientInfo, true, 0, ".json", (char *) pClientInfo->rgbOut, sizeof(pClientInfo->rgbOut));
+            pClientInfo->pbOut = pClientInfo->rgbOut;
+            pClientInfo->htmlState = JSONPINS;
+            retCMD = GCMD::WRITE;
+            break;
+
+        // as many pins as fit in rgbOut each time through
+        case JSONPINS:
+            if(pJSON->iPin == 0)
+            {
+                cb = sprintf((char *) pClientInfo->rgbOut, "{\"rev\":%u,\"pins\":[", (unsigned int) pJSON->revSent);
+            }
+
+            for( ; pJSON->iPin < NUM_DIGITAL_PINS && (cb + CBPINJSON) <= sizeof(pClientInfo->rgbOut); pJSON->iPin++)
+            {
+                uint32_t    i       = pJSON->iPin;
+                char        chState = 'X';
+                char        szValue[8];
+
+                if(pJSON->revSince != 0 && rgrevPin[i] <= pJSON->revSince)
+                {
+                    continue;
+                }
+
+                switch(gpio[i].pinState)
+                {
+                    case TRISTATE:          chState = 'T'; break;
+                    case DIGITALIN:         chState = 'D'; break;
+                    case DIGITALOUTLOW:     chState = 'L'; break;
+                    case DIGITALOUTHIGH:    chState = 'H'; break;
+                    case ANALOGIN:          chState = 'A'; break;
+                    default:                chState = 'X'; break;
+                }
+
+                if(chState == 'X' || chState == 'T')
+                {
+                    strcpy(szValue, "null");
+                }
+                else
+                {
+                    sprintf(szValue, "%u", (unsigned int) rgPinValue[i]);
+                }
+
+                cb += sprintf((char *) &pClientInfo->rgbOut[cb], "%s{\"pin\":%u,\"state\":\"%c\",\"value\":%s}",
+                                pJSON->fFirst ? "" : ",", (unsigned int) i, chState, szValue);
+                pJSON->fFirst = false;
+            }
+
+            if(pJSON->iPin >= NUM_DIGITAL_PINS && (cb + 5) <= sizeof(pClientInfo->rgbOut))
+            {
+                cb += sprintf((char *) &pClientInfo->rgbOut[cb], "]}\r\n");
+                pClientInfo->htmlState = JSONDONE;
+            }
+
+            if(cb > 0)
+            {
+                pClientInfo->cbWrite = cb;
+                pClientInfo->pbOut = pClientInfo->rgbOut;
+                retCMD = GCMD::WRITE;
+            }
+            break;
+
+        case HTTPTIMEOUT:
+            xil_printf("Timeout error occured, closing the session\r\n");
+
+            // fall thru to close
+
+        case HTTPDISCONNECT:
+        case JSONDONE:
+        default:
+            if(pJSON != NULL)
+            {
+                pJSON->pClientInfo = NULL;
+            }
+            pClientInfo->cbWrite = 0;
+            retCMD = GCMD::DONE;
+            break;
+    }
+
+    return(retCMD);
+}
+
 /***    void InitializePins(void)
  *
  *    Parameters:
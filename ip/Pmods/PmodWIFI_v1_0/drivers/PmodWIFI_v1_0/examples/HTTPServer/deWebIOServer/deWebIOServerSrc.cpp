@@ -61,10 +61,13 @@ static const char szHTMLReboot[]        = "GET /Reboot ";
 static const char szHTMLFavicon[]       = "GET /favicon.ico ";
 static const char szHTMLGetPins[]       = "GET /PinsPage.htm ";
 static const char szHTMLPostPins[]      = "POST /PinsPage.htm ";
+static const char szJSONGetPins[]       = "GET /pins.json ";
+static const char szJSONGetPinsQuery[]  = "GET /pins.json?";
 
 // here is our sample/example dynamically created HTML page
 GCMD::ACTION ComposeHTMLGetPINS(CLIENTINFO * pClientInfo);
 GCMD::ACTION ComposeHTMLPostPINS(CLIENTINFO * pClientInfo);
+GCMD::ACTION ComposeJSONGetPINS(CLIENTINFO * pClientInfo);
 
 // get rid of as much of the heap as we can, the SD library requires some heap
 #define CHANGE_HEAP_SIZE(size) __asm__ volatile ("\t.globl _min_heap_size\n\t.equ _min_heap_size, " #size "\n")
@@ -112,13 +115,23 @@ int main(void)
 	//Initialize system timer
     WF_TimerInit();
 
+#ifdef ROUTESELFTEST
+    // check the URL router before the real pages go in
+    RouteSelfTest();
+#endif
+
     // add rendering functions for dynamically created web pages
-    // max of 10 AddHTMLPage() allowed 
+    // the longest matching string wins; CNTROUTENODES in HTTPServer.h limits how many can be added
 
     // these are the Select picture pages in Post.htm
     AddHTMLPage(szHTMLGetPins,      ComposeHTMLGetPINS);
     AddHTMLPage(szHTMLPostPins,     ComposeHTMLPostPINS);
 
+    // the pins as JSON for dashboards; /pins.json?rev=N&wait=S sends only the
+    // pins changed since revision N, waiting up to S seconds for a change
+    AddHTMLPage(szJSONGetPins,      ComposeJSONGetPINS);
+    AddHTMLPage(szJSONGetPinsQuery, ComposeJSONGetPINS);
+
     // comment this out if you do not want to support
     // restarting the network stack from a browser
     AddHTMLPage(szHTMLRestart,      ComposeHTMLRestartPage);
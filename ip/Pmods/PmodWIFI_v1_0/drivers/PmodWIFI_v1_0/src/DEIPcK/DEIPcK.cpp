@@ -164,6 +164,9 @@ bool DEIPcK::begin(const IPv4& ip, const IPv4& ipGateway, const IPv4& subnetMask
 
     DNSInit(_pLLAdp, rgbDNSMem, cbDNSMem, hDhcpDnsNtpPMGR, &status);
 
+    // IP fragments are reassembled in their own pages
+    ILReasmInit(hIPReasmPMGR);
+
     // if we are not to use DHCP; fill in what came in.
     if((ip.u8[0] | ip.u8[1] | ip.u8[2] | ip.u8[3]) != 0)
     {
@@ -348,6 +351,62 @@ unsigned long DEIPcK::secondsSinceEpoch(IPSTATUS * pStatus)
     return(secEpoch);
 }
 
+/***	uint64_t DEIPcK::microsecondsSinceEpoch(void)
+**      uint64_t DEIPcK::microsecondsSinceEpoch(DEIPcK::STATUS * pStatus)
+**
+**	Synopsis:   
+**
+**      Returns the number of microseconds since Epoch (Jan 1, 1970).
+**
+*
+**	Parameters:
+**      pStatus     A pointer to receive the status of the clock. If the clock is
+**                  not initialized or DNS is not available the time returned is
+**                  microseconds since powerup (ipsTimeSincePowerUp), and not epoch time (ipsTimeSinceEpoch).
+**              
+**
+**	Return Values:
+**      The number of microseconds since Jan 1 1970; or epoch
+**
+**	Errors:
+**      Returns microseconds since powerup if epoch time could not be obtained.
+**
+**  Notes:
+**
+**      The clock is disciplined against the NTP servers, both offset and
+**      frequency, and will not run backwards except when a large correction steps it.
+**          
+*/
+uint64_t DEIPcK::microsecondsSinceEpoch(IPSTATUS * pStatus)
+{
+    uint64_t    usEpoch = SNTPv4GetUNIXEpochTimeUSec(_pLLAdp);
+    bool        fInit = usEpoch != 0;
+
+    // dynamically initialize the timer service
+    if(_pLLAdp != NULL && _pLLAdp->pNTPMem == NULL)
+    {
+        SNTPv4Init(_pLLAdp, rgbSNTPv4Mem, SNTPv4MemSize, hDhcpDnsNtpPMGR, NULL, 0, NULL);
+    }
+
+    if(!fInit)
+    {
+        usEpoch = SYSGetMicroSecond64();
+    }
+
+    if(pStatus != NULL)
+    {
+        if(fInit)
+        {
+            *pStatus = ipsTimeSinceEpoch;
+        }
+        else
+        {
+            *pStatus = ipsTimeSincePowerUp;
+        }
+    }
+    return(usEpoch);
+}
+
 /***	bool DEIPcK::getMyMac(MACADDR *pMAC)
 **
 **	Synopsis:   
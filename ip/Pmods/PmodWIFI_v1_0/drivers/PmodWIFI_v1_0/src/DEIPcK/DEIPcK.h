@@ -147,6 +147,16 @@ public:
         return(isConnected(NULL));
     }
 
+    // what can be done right now, TCPPOLLREAD | TCPPOLLWRITE | TCPPOLLHUP
+    uint32_t poll(IPSTATUS * pStatus)
+    {
+        return(TCPPoll(&_socket, pStatus));
+    }
+    uint32_t poll(void)
+    {
+        return(poll(NULL));
+    }
+
     void discardReadBuffer(void);
     size_t available(void);
 
@@ -166,6 +176,7 @@ public:
     size_t writeStream(const byte *rgbWrite, size_t cbWrite, IPSTATUS * pStatus);
 
     void flush(void) {TCPFlush(&_socket);}
+    bool setKeepAlive(bool fEnable) {return(TCPSetKeepAlive(&_socket, fEnable));}
  
     bool getRemoteEndPoint(IPEndPoint& epRemote);
     bool getLocalEndPoint(IPEndPoint& epLocal);
@@ -454,6 +465,12 @@ public:
         return(secondsSinceEpoch(NULL));
     }
 
+    uint64_t microsecondsSinceEpoch(IPSTATUS * pStatus);
+    uint64_t microsecondsSinceEpoch(void)
+    {
+        return(microsecondsSinceEpoch(NULL));
+    }
+
     bool getMyMac(MACADDR& mac);
     bool getMyIP(IPv4& ip);
     bool getGateway(IPv4& gateway);
@@ -620,10 +637,12 @@ extern uint8_t  rgbAdpHeap[];               // ipStack mem
 extern uint8_t  rgbDHCPMem[];               // DHCP mem
 extern uint8_t  rgbSNTPv4Mem[];             // SNTP mem
 extern uint8_t  rgbDhcpDnsNtpPageMGR[];     // UDP socket buffer space shared DHCP / DNS / SNTP
+extern uint8_t  rgbIPReasmPageMGR[];        // IP fragment reassembly buffer space
 
 extern HRRHEAP  hRRAdpHeap;                 // handle to ipStack in memory Round Robin Heap
 extern HPMGR    hNetworkPMGR;               // handle to Socket mem page manager
 extern HPMGR    hDhcpDnsNtpPMGR;            // handle to shared DHCP / DNS / SNTP mem page mgr
+extern HPMGR    hIPReasmPMGR;               // handle to the IP fragment reassembly page mgr
 
 #include <AdaptorClass.h>
 
@@ -670,6 +689,20 @@ extern HPMGR    hDhcpDnsNtpPMGR;            // handle to shared DHCP / DNS / SNT
     uint8_t  rgbDhcpDnsNtpPageMGR[cbrgbDhcpDnsNtpPageMGR];
     HPMGR    hDhcpDnsNtpPMGR = RAMCreatePageMGR(rgbDhcpDnsNtpPageMGR, cbrgbDhcpDnsNtpPageMGR, cPagesDhcpDnsNtp, pfDhcpDnsNtp);
 
+    // IP fragment reassembly RAM page manager
+    // partial datagrams are held here until all of the fragments come in.
+    // 128 byte pages * 24 = 3072, enough for one max sized (cbILReasmMax) datagram, or
+    // a couple of typical 1500 byte MTU split datagrams at the same time.
+    #ifndef pfIPReasm
+    #define pfIPReasm           7   // 1<<7 == 128 byte pages
+    #endif
+    #ifndef cPagesIPReasm
+    #define cPagesIPReasm       24  // 24 pages
+    #endif
+    #define cbrgbIPReasmPageMGR RAMGetPMGRSize(cPagesIPReasm, pfIPReasm)
+    uint8_t  rgbIPReasmPageMGR[cbrgbIPReasmPageMGR];
+    HPMGR    hIPReasmPMGR = RAMCreatePageMGR(rgbIPReasmPageMGR, cbrgbIPReasmPageMGR, cPagesIPReasm, pfIPReasm);
+
 #endif  // place code
 
 #endif
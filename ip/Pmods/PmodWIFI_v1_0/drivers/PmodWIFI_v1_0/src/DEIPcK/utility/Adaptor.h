@@ -188,6 +188,17 @@ typedef struct
     uint8_t      ssidLen;                               // Number of valid characters in ssid
 } SCANINFO;
 
+// background scanning and roaming between APs of the connected SSID
+// rssi is on the adaptor's scan scale, bigger is stronger
+typedef struct WFROAMCONFIG_T
+{
+    bool        fEnable;
+    uint8_t     rssiRoam;               // below this the current AP is weak; scan more often and roam
+    uint8_t     rssiDelta;              // a new AP must be this much stronger than the current one
+    uint32_t    msScanInterval;         // background scan period while the current AP is strong
+    uint32_t    msScanIntervalWeak;     // background scan period while the current AP is weak
+} WFROAMCONFIG;
+
 
 
 
@@ -199,6 +210,7 @@ typedef struct NWWF_T
     bool (* StartScan)(WFSCANMODE filter, IPSTATUS * pStatus);
     bool (* IsScanDone)(int32_t * pcAP);
     bool (* GetScanResult)(int32_t index, SCANINFO *pScanInfo);    
+    bool (* SetRoaming)(const WFROAMCONFIG * pRoamConfig, IPSTATUS * pStatus);
 } NWWF;
 
 #endif  // _NETWORK_ADAPTOR_H_
\ No newline at end of file
@@ -52,6 +52,152 @@
 #include "deIP.h"
 
 static const char szIPInUse[] = "IP in Use";
+static const DHCPLEASESTORE * g_pDhcpLeaseStore = NULL;
+
+/*****************************************************************************
+  Function:
+	void DHCPSetLeaseStore(const DHCPLEASESTORE * pStore)
+
+  Description:
+        Sets where the DHCP lease is saved across power cycles. If a saved lease
+        is found when DHCPInit is called, we INIT-REBOOT and go straight to
+        a REQUEST for that IP instead of a DISCOVER.
+
+  Parameters:
+	pStore:         The application supplied load and save lease functions, may be NULL
+
+  Returns:
+        None
+  ***************************************************************************/
+void DHCPSetLeaseStore(const DHCPLEASESTORE * pStore)
+{
+    g_pDhcpLeaseStore = pStore;
+}
+
+static bool DHCPLoadLease(const LLADP * pLLAdp, DHCPLEASE * pLease)
+{
+    return( g_pDhcpLeaseStore != NULL                                                   &&
+            g_pDhcpLeaseStore->LoadLease != NULL                                        &&
+            g_pDhcpLeaseStore->LoadLease(pLease)                                        &&
+            pLease->sig == dhcpLeaseSig                                                 &&
+            memcmp(&pLease->mac, &pLLAdp->pNwAdp->mac, sizeof(MACADDR)) == 0            &&
+            pLease->ip.u32 != IPv4NONE.u32                                              &&
+            pLease->ip.u32 != IPv4BROADCAST.u32                                         );
+}
+
+static void DHCPSaveLease(const LLADP * pLLAdp)
+{
+    DHCPLEASE lease;
+
+    if(g_pDhcpLeaseStore != NULL && g_pDhcpLeaseStore->SaveLease != NULL)
+    {
+        memset(&lease, 0, sizeof(DHCPLEASE));
+        lease.sig       = dhcpLeaseSig;
+        lease.ip.u32    = pLLAdp->ipMy.ipv4.u32;
+        lease.tsLease   = pLLAdp->pDHCPMem->tsLease;
+        memcpy(&lease.mac, &pLLAdp->pNwAdp->mac, sizeof(MACADDR));
+        g_pDhcpLeaseStore->SaveLease(&lease);
+    }
+}
+
+static void DHCPMakeDiscover(const LLADP * pLLAdp)
+{
+    // erase the DHCP message and clear the options too; starting over from scratch
+    memset(&pLLAdp->pDHCPMem->dgDHCP, 0, sizeof(DHCPDG) + cbDHCPOptions);
+
+    // fill in the dhcp header for a discovery
+    pLLAdp->pDHCPMem->dgDHCP.op                 = BOOTREQUEST;  // VVVV if we have no mask, we must tell DHCP to broadcast VVVV
+    // pLLAdp->pDHCPMem->dgDHCP.flags              = DHCPREQUIREBROADCAST;  // done in DHCPSend()
+    pLLAdp->pDHCPMem->dgDHCP.htype              = hwtypeEthernet;
+    pLLAdp->pDHCPMem->dgDHCP.hlen               = sizeof(MACADDR);
+    pLLAdp->pDHCPMem->dgDHCP.xid                = GetSysTick() + (((uint32_t) pLLAdp->pNwAdp->mac.u16[0]) << 16) + pLLAdp->pNwAdp->mac.u16[1] + pLLAdp->pNwAdp->mac.u16[2];        // quazi random number
+ //   pLLAdp->pDHCPMem->dgDHCP.xid                = GetSysTick() + *((uint32_t *) &pLLAdp->pNwAdp->mac.u8[0]) + *((uint16_t *) &pLLAdp->pNwAdp->mac.u8[4]);        // quazi random number
+ //   pLLAdp->pDHCPMem->dgDHCP.xid                = GetSysTick() + ((UNALIGNPTR *) &pLLAdp->pNwAdp->mac.u8[0])->u32 + ((UNALIGNPTR *) &pLLAdp->pNwAdp->mac.u8[4])->u16;        // quazi random number
+    memcpy(pLLAdp->pDHCPMem->dgDHCP.chaddr, &pLLAdp->pNwAdp->mac, sizeof(MACADDR));
+    pLLAdp->pDHCPMem->dgDHCP.MagicCookie.u32    = MAGICCOOKIE;
+
+    // messageType option; do not exceed cbDHCPOptions (32) bytes
+    pLLAdp->pDHCPMem->dgDHCP.options[0]         = dhcpOpMessageType;
+    pLLAdp->pDHCPMem->dgDHCP.options[1]         = 1;
+    pLLAdp->pDHCPMem->dgDHCP.options[2]         = (uint8_t) dhcpDISCOVER;
+
+    // RFC says I should put in the max datagram size; which is the min size as well.
+    // this is all the bigger my buffer is.
+    pLLAdp->pDHCPMem->dgDHCP.options[3]         = dhcpOpMaxMessageSize;
+    pLLAdp->pDHCPMem->dgDHCP.options[4]         = 2;
+    pLLAdp->pDHCPMem->dgDHCP.options[5]         = (uint8_t) ((cbMinDHCPDGSize & 0x0000FF00) >> 8);
+    pLLAdp->pDHCPMem->dgDHCP.options[6]         = (uint8_t) (cbMinDHCPDGSize & 0x000000FF);
+
+    // END option
+    pLLAdp->pDHCPMem->dgDHCP.options[7]        = dhcpOpEnd;
+}
+
+static void DHCPMakeRequest(const LLADP * pLLAdp, const uint8_t * pbOpSId, const IPv4 * pIPRequest)
+{
+    // The RFC says, if we put an option in the DISCOVER, I
+    // MUST duplicate those options in the REQUEST
+    // so we only need to add to the DISCOVER datagram
+
+    // messageType option; do not exceed cbDHCPOptions (32) bytes
+    //pLLAdp->pDHCPMem->dgDHCP.options[0]         = dhcpOpMessageType;
+    //pLLAdp->pDHCPMem->dgDHCP.options[1]         = 1;
+    pLLAdp->pDHCPMem->dgDHCP.options[2]         = (uint8_t) dhcpREQUEST;
+
+    // RFC says I should put in the max datagram size; which is the min size as well.
+    // this is all the bigger my buffer is.
+    // This is the same as before, no need to define it again
+    //pLLAdp->pDHCPMem->dgDHCP.options[3]         = dhcpOpMaxMessageSize;
+    //pLLAdp->pDHCPMem->dgDHCP.options[4]         = 2;
+    //pLLAdp->pDHCPMem->dgDHCP.options[5]         = (uint8_t) ((cbMinDHCPDGSize & 0x0000FF00) >> 8);
+    //pLLAdp->pDHCPMem->dgDHCP.options[6]         = (uint8_t) (cbMinDHCPDGSize & 0x000000FF);
+
+    // identify the server I am responding too
+    // INIT-REBOOT MUST NOT send the server ident, but we keep the slot
+    // padded so the option offsets do not move; the ACK will fill it in.
+    if(pbOpSId != NULL)
+    {
+        pLLAdp->pDHCPMem->dgDHCP.options[7]         = dhcpOpServerIdent;
+        pLLAdp->pDHCPMem->dgDHCP.options[8]         = 4;
+        pLLAdp->pDHCPMem->dgDHCP.options[9]         = pbOpSId[2];
+        pLLAdp->pDHCPMem->dgDHCP.options[10]        = pbOpSId[3];
+        pLLAdp->pDHCPMem->dgDHCP.options[11]        = pbOpSId[4];
+        pLLAdp->pDHCPMem->dgDHCP.options[12]        = pbOpSId[5];
+    }
+    else
+    {
+        memset(&pLLAdp->pDHCPMem->dgDHCP.options[7], dhcpOpPad, 6);
+    }
+
+    // the IP I am requesting
+    // this option needs to stay here as I do checks on the IP later
+    pLLAdp->pDHCPMem->dgDHCP.options[13]        = dhcpOpRequstIP;
+    pLLAdp->pDHCPMem->dgDHCP.options[14]        = 4;
+    pLLAdp->pDHCPMem->dgDHCP.options[15]        = pIPRequest->u8[0];
+    pLLAdp->pDHCPMem->dgDHCP.options[16]        = pIPRequest->u8[1];
+    pLLAdp->pDHCPMem->dgDHCP.options[17]        = pIPRequest->u8[2];
+    pLLAdp->pDHCPMem->dgDHCP.options[18]        = pIPRequest->u8[3];
+
+    // messageType option
+    pLLAdp->pDHCPMem->dgDHCP.options[19]        = dhcpOpParamRequestList;
+    pLLAdp->pDHCPMem->dgDHCP.options[20]        = 7;
+    pLLAdp->pDHCPMem->dgDHCP.options[21]        = dhcpOpSubMask;            // submask addr
+    pLLAdp->pDHCPMem->dgDHCP.options[22]        = dhcpOpRouter;             // gateway
+    pLLAdp->pDHCPMem->dgDHCP.options[23]        = dhcpOpDomainNameServer;   // list of DNS servers
+    pLLAdp->pDHCPMem->dgDHCP.options[24]        = dhcpOpIPLeaseTime;        // server must return
+    pLLAdp->pDHCPMem->dgDHCP.options[25]        = dhcpOpRenewalTime;        // default .5 lease
+    pLLAdp->pDHCPMem->dgDHCP.options[26]        = dhcpOpReBindTime;         // default .875 lease
+    pLLAdp->pDHCPMem->dgDHCP.options[27]        = dhcpOpHostName;           // Network Domain name
+
+    // END option
+    pLLAdp->pDHCPMem->dgDHCP.options[28]        = dhcpOpEnd;
+
+    // clear the rest of the options area
+    // must be set to the first unused option byte
+    memset(&pLLAdp->pDHCPMem->dgDHCP.options[29], 0, (cbDHCPOptions-29));
+
+    // we do not worry about relay agents; we broadcast! The relay agent needs
+    // to broadcast through to all of the orignal DHCP servers.
+}
 
 /*****************************************************************************
   Function:
@@ -59,6 +205,8 @@ static const char szIPInUse[] = "IP in Use";
 
   Description:
         This starts the DHCP IPv4 acquition process.
+        If a lease store is set and has a lease for this adaptor
+        we start with an INIT-REBOOT instead of a DISCOVER.
 
   Parameters:
 	pLLAdp:         The adaptor to get an IP for
@@ -76,6 +224,7 @@ bool DHCPInit(const LLADP * pLLAdp, void * rgbDHCPMem, uint32_t cbDHCPMem, HPMGR
     UDPSOCKET *     pSocket = NULL;
     IPSTATUS        status = ipsSuccess;
     DHCPMEM *       pDHCPMem = (DHCPMEM *) rgbDHCPMem;
+    DHCPLEASE       lease;
 
     if(pLLAdp == NULL)
     {
@@ -174,6 +323,14 @@ bool DHCPInit(const LLADP * pLLAdp, void * rgbDHCPMem, uint32_t cbDHCPMem, HPMGR
     ((LLADP *) pLLAdp)->dhcpState = dhcpStartDISCOVER;
      pDHCPMem->cTryDiscovery = 0;
 
+    // unless we have a lease from last time, then just ask for it again
+    if(DHCPLoadLease(pLLAdp, &lease))
+    {
+        // the IP to request is kept in ciaddr until we build the REQUEST
+        pDHCPMem->dgDHCP.ciaddr.u32 = lease.ip.u32;
+        ((LLADP *) pLLAdp)->dhcpState = dhcpINITREBOOT;
+    }
+
     return(true);
 }
 
@@ -385,6 +542,26 @@ static void DHCPStateMachine(const LLADP * pLLAdp)
     // process the state we are in.
     switch(pLLAdp->dhcpState)
     {
+        // RFC 2131 3.2, we had a lease before we went down
+        // broadcast a REQUEST for it without a server ident and with ciaddr zero
+        // a server will ACK or NAK it; if no one answers we fall back to a DISCOVER
+        case dhcpINITREBOOT:
+            {
+                IPv4 ipRequest = pLLAdp->pDHCPMem->dgDHCP.ciaddr;
+
+                // MUST do this before scewing with the dgDHCP or the checksum will not work out!
+                IPSSetToMachineOrder(&pLLAdp->pDHCPMem->ipStack);
+
+                DHCPMakeDiscover(pLLAdp);
+                DHCPMakeRequest(pLLAdp, NULL, &ipRequest);
+
+                pLLAdp->pDHCPMem->fInitReboot   = true;
+                pLLAdp->pDHCPMem->tsStart       = SYSGetSecond();
+                pLLAdp->pDHCPMem->tsLease       = dhcpRebootRetryTime;
+                ((LLADP *) pLLAdp)->dhcpState   = dhcpREQUEST;
+            }
+            break;
+
         case dhcpRetryDISCOVER:
              pLLAdp->pDHCPMem->cTryDiscovery++;
              // fall thru
@@ -413,34 +590,9 @@ static void DHCPStateMachine(const LLADP * pLLAdp)
             // but we want to be back in machine order
             IPSSetToMachineOrder(&pLLAdp->pDHCPMem->ipStack);
 
-           // erase the DHCP message and clear the options too; starting over from scratch
-            memset(&pLLAdp->pDHCPMem->dgDHCP, 0, sizeof(DHCPDG) + cbDHCPOptions);
-
-            // fill in the dhcp header for a discovery
-            pLLAdp->pDHCPMem->dgDHCP.op                 = BOOTREQUEST;  // VVVV if we have no mask, we must tell DHCP to broadcast VVVV
-            // pLLAdp->pDHCPMem->dgDHCP.flags              = DHCPREQUIREBROADCAST;  // done in DHCPSend()
-            pLLAdp->pDHCPMem->dgDHCP.htype              = hwtypeEthernet;
-            pLLAdp->pDHCPMem->dgDHCP.hlen               = sizeof(MACADDR);
-            pLLAdp->pDHCPMem->dgDHCP.xid                = GetSysTick() + (((uint32_t) pLLAdp->pNwAdp->mac.u16[0]) << 16) + pLLAdp->pNwAdp->mac.u16[1] + pLLAdp->pNwAdp->mac.u16[2];        // quazi random number
- //           pLLAdp->pDHCPMem->dgDHCP.xid                = GetSysTick() + *((uint32_t *) &pLLAdp->pNwAdp->mac.u8[0]) + *((uint16_t *) &pLLAdp->pNwAdp->mac.u8[4]);        // quazi random number
- //           pLLAdp->pDHCPMem->dgDHCP.xid                = GetSysTick() + ((UNALIGNPTR *) &pLLAdp->pNwAdp->mac.u8[0])->u32 + ((UNALIGNPTR *) &pLLAdp->pNwAdp->mac.u8[4])->u16;        // quazi random number
-            memcpy(pLLAdp->pDHCPMem->dgDHCP.chaddr, &pLLAdp->pNwAdp->mac, sizeof(MACADDR));
-            pLLAdp->pDHCPMem->dgDHCP.MagicCookie.u32    = MAGICCOOKIE;
-
-            // messageType option; do not exceed cbDHCPOptions (32) bytes
-            pLLAdp->pDHCPMem->dgDHCP.options[0]         = dhcpOpMessageType;
-            pLLAdp->pDHCPMem->dgDHCP.options[1]         = 1;
-            pLLAdp->pDHCPMem->dgDHCP.options[2]         = (uint8_t) dhcpDISCOVER;
-
-            // RFC says I should put in the max datagram size; which is the min size as well.
-            // this is all the bigger my buffer is.
-            pLLAdp->pDHCPMem->dgDHCP.options[3]         = dhcpOpMaxMessageSize;
-            pLLAdp->pDHCPMem->dgDHCP.options[4]         = 2;
-            pLLAdp->pDHCPMem->dgDHCP.options[5]         = (uint8_t) ((cbMinDHCPDGSize & 0x0000FF00) >> 8);
-            pLLAdp->pDHCPMem->dgDHCP.options[6]         = (uint8_t) (cbMinDHCPDGSize & 0x000000FF);
-
-            // END option
-            pLLAdp->pDHCPMem->dgDHCP.options[7]        = dhcpOpEnd;
+            // erase the DHCP message and start over from scratch
+            DHCPMakeDiscover(pLLAdp);
+            pLLAdp->pDHCPMem->fInitReboot = false;
 
             // send it off
             if(DHCPSend(pLLAdp, true, DHCPREQUIREBROADCAST))
@@ -486,64 +638,10 @@ static void DHCPStateMachine(const LLADP * pLLAdp)
                         IPSSetToMachineOrder(&pLLAdp->pDHCPMem->ipStack);
 
                         // make our new REQUEST datagram
-                        // The RFC says, if we put an option in the DISCOVER, I
-                        // MUST duplicate those options in the REQUEST
-                        // so we only need to add to the DISCOVER datagram
-
                         // we must set it up in this state because this is when I have
                         // the incoming datagram, so set it up now.
                         // we can also retransmit on the request without resetting up the DHCP datagram
-
-                        // messageType option; do not exceed cbDHCPOptions (32) bytes
-                        //pLLAdp->pDHCPMem->dgDHCP.options[0]         = dhcpOpMessageType;
-                        //pLLAdp->pDHCPMem->dgDHCP.options[1]         = 1;
-                        pLLAdp->pDHCPMem->dgDHCP.options[2]         = (uint8_t) dhcpREQUEST;
-
-                        // RFC says I should put in the max datagram size; which is the min size as well.
-                        // this is all the bigger my buffer is.
-                        // This is the same as before, no need to define it again
-                        //pLLAdp->pDHCPMem->dgDHCP.options[3]         = dhcpOpMaxMessageSize;
-                        //pLLAdp->pDHCPMem->dgDHCP.options[4]         = 2;
-                        //pLLAdp->pDHCPMem->dgDHCP.options[5]         = (uint8_t) ((cbMinDHCPDGSize & 0x0000FF00) >> 8);
-                        //pLLAdp->pDHCPMem->dgDHCP.options[6]         = (uint8_t) (cbMinDHCPDGSize & 0x000000FF);
-
-                        // identify the server I am responding too
-                        pLLAdp->pDHCPMem->dgDHCP.options[7]         = dhcpOpServerIdent;
-                        pLLAdp->pDHCPMem->dgDHCP.options[8]         = 4;
-                        pLLAdp->pDHCPMem->dgDHCP.options[9]         = pbOpSId[2];
-                        pLLAdp->pDHCPMem->dgDHCP.options[10]        = pbOpSId[3];
-                        pLLAdp->pDHCPMem->dgDHCP.options[11]        = pbOpSId[4];
-                        pLLAdp->pDHCPMem->dgDHCP.options[12]        = pbOpSId[5];
-
-                        // the IP I am requesting
-                        // this option needs to stay here as I do checks on the IP later
-                        pLLAdp->pDHCPMem->dgDHCP.options[13]        = dhcpOpRequstIP;
-                        pLLAdp->pDHCPMem->dgDHCP.options[14]        = 4;
-                        pLLAdp->pDHCPMem->dgDHCP.options[15]        = pDHCPDG->yiaddr.u8[0];
-                        pLLAdp->pDHCPMem->dgDHCP.options[16]        = pDHCPDG->yiaddr.u8[1];
-                        pLLAdp->pDHCPMem->dgDHCP.options[17]        = pDHCPDG->yiaddr.u8[2];
-                        pLLAdp->pDHCPMem->dgDHCP.options[18]        = pDHCPDG->yiaddr.u8[3];
-
-                        // messageType option
-                        pLLAdp->pDHCPMem->dgDHCP.options[19]        = dhcpOpParamRequestList;
-                        pLLAdp->pDHCPMem->dgDHCP.options[20]        = 7;
-                        pLLAdp->pDHCPMem->dgDHCP.options[21]        = dhcpOpSubMask;            // submask addr
-                        pLLAdp->pDHCPMem->dgDHCP.options[22]        = dhcpOpRouter;             // gateway
-                        pLLAdp->pDHCPMem->dgDHCP.options[23]        = dhcpOpDomainNameServer;   // list of DNS servers
-                        pLLAdp->pDHCPMem->dgDHCP.options[24]        = dhcpOpIPLeaseTime;        // server must return
-                        pLLAdp->pDHCPMem->dgDHCP.options[25]        = dhcpOpRenewalTime;        // default .5 lease
-                        pLLAdp->pDHCPMem->dgDHCP.options[26]        = dhcpOpReBindTime;         // default .875 lease
-                        pLLAdp->pDHCPMem->dgDHCP.options[27]        = dhcpOpHostName;           // Network Domain name
-
-                        // END option
-                        pLLAdp->pDHCPMem->dgDHCP.options[28]        = dhcpOpEnd;
-
-                        // clear the rest of the options area
-                        // must be set to the first unused option byte
-                        memset(&pLLAdp->pDHCPMem->dgDHCP.options[29], 0, (cbDHCPOptions-29));
-
-                        // we do not worry about relay agents; we broadcast! The relay agent needs
-                        // to broadcast through to all of the orignal DHCP servers.
+                        DHCPMakeRequest(pLLAdp, pbOpSId, &pDHCPDG->yiaddr);
 
                         // use our lease time as our timeout/retry timer.
                         pLLAdp->pDHCPMem->tsStart = SYSGetSecond();
@@ -612,15 +710,41 @@ static void DHCPStateMachine(const LLADP * pLLAdp)
                     {
                         if(pbOp[2] == dhcpACK)
                         {
+                            const uint8_t * pbOpSId = NULL;
+
+                            // on INIT-REBOOT we did not know the server, we do now; we need it if we DECLINE
+                            if( pLLAdp->pDHCPMem->fInitReboot                                                          &&
+                                (pbOpSId = DHCPFindOption(dhcpOpServerIdent, pDHCPDG->options, cbOptions))  != NULL    )
+                            {
+                                pLLAdp->pDHCPMem->dgDHCP.options[7]         = dhcpOpServerIdent;
+                                pLLAdp->pDHCPMem->dgDHCP.options[8]         = 4;
+                                memcpy(&pLLAdp->pDHCPMem->dgDHCP.options[9], &pbOpSId[2], sizeof(IPv4));
+                            }
+
+                            // we held this IP before we went down, if allowed, do not spend the time to ARP for it
+                            if(pLLAdp->pDHCPMem->fInitReboot && g_pDhcpLeaseStore != NULL && g_pDhcpLeaseStore->fSkipARPProbe)
+                            {
+                                ((LLADP *) pLLAdp)->dhcpState = dhcpACCEPT;
+                            }
 
                             // stuff our IP away for awhile so we can do an ARP
                             //if the ARP fails, we must zero this out before restarting.
-                            memcpy((void *) &pLLAdp->pDHCPMem->dgDHCP.ciaddr, &pDHCPDG->yiaddr, sizeof(IPv4));
-                            ((LLADP *) pLLAdp)->dhcpState = dhcpARPWait;
+                            else
+                            {
+                                memcpy((void *) &pLLAdp->pDHCPMem->dgDHCP.ciaddr, &pDHCPDG->yiaddr, sizeof(IPv4));
+                                ((LLADP *) pLLAdp)->dhcpState = dhcpARPWait;
+                            }
                             
                             // this is our lease start time
                             pLLAdp->pDHCPMem->tsStart = SYSGetSecond();
                         }
+
+                        // our old lease is no good, no penalty, just start a normal DISCOVER
+                        else if(pbOp[2] == dhcpNAK && pLLAdp->pDHCPMem->fInitReboot)
+                        {
+                            ((LLADP *) pLLAdp)->dhcpState = dhcpStartDISCOVER;
+                        }
+
                         // something went wrong, re-negotiate for something else
                         else if(pbOp[2] == dhcpNAK)
                         {
@@ -636,8 +760,14 @@ static void DHCPStateMachine(const LLADP * pLLAdp)
                 // back off factor of 2, required.
                 pLLAdp->pDHCPMem->tsLease *= 2;
 
+                // no one is confirming our old lease, don't wait the full 60 seconds
+                if(pLLAdp->pDHCPMem->fInitReboot && pLLAdp->pDHCPMem->tsLease > dhcpRebootMaxTime)
+                {
+                    ((LLADP *) pLLAdp)->dhcpState = dhcpStartDISCOVER;
+                }
+
                 // but no more than 60 seconds, defined
-                if(pLLAdp->pDHCPMem->tsLease <= dhcpMaxRetryTime)
+                else if(pLLAdp->pDHCPMem->tsLease <= dhcpMaxRetryTime)
                 {
                     ((LLADP *) pLLAdp)->dhcpState = dhcpREQUEST;
                 }
@@ -718,6 +848,10 @@ static void DHCPStateMachine(const LLADP * pLLAdp)
 
                             ((LLADP *) pLLAdp)->dhcpState = dhcpBOUND;
 
+                            // remember it for the next power up
+                            DHCPSaveLease(pLLAdp);
+                            pLLAdp->pDHCPMem->fInitReboot = false;
+
                             // We should broadcast an ARP to announce our new IP/MAC RFC 2131 4.2.1
                             // remember we are doing an ARP, this is the ARP ipstack, not the DHCP ipstack
                             if(!IPSIsInUse(&pLLAdp->ipStack))
@@ -83,6 +83,7 @@ extern "C" {
 #define    dhcpStartDISCOVER    51
 #define    dhcpARPWait          52
 #define    dhcpACCEPT           53
+#define    dhcpINITREBOOT       54  // RFC 2131 3.2, REQUEST our last IP without a DISCOVER
             
 // These are all active states where we have our IP and masks and stuff
 #define    dhcpSTARTConnected   100 // this is the start of the connected states
@@ -222,6 +223,32 @@ typedef struct DHCPDG_T
 #define dhcpInfiniteLease   0xFFFFFFFF  // the value for an infinite lease time
 #define dhcpMaxRetryTime    60          // only return for 60 seconds
 #define dhcpInitRetryTime   4           // required, 4 + 8 + 16 + 32 = 60
+#define dhcpRebootRetryTime 2           // INIT-REBOOT, 2 + 4 + 8 = 14 seconds before we DISCOVER
+#define dhcpRebootMaxTime   8
+
+// A lease saved across power cycles so we can INIT-REBOOT
+// We have no real time clock across a power cycle, so we can
+// not know if the lease expired; we always ask the server to confirm it.
+#define dhcpLeaseSig        0x44484350  // "DHCP"
+typedef struct DHCPLEASE_T
+{
+    uint32_t    sig;            // dhcpLeaseSig if this is a valid lease
+    MACADDR     mac;            // the adaptor the lease was given to
+    IPv4        ip;             // the leased IP
+    uint32_t    tsLease;        // the lease time in seconds the server gave us
+} DHCPLEASE;
+
+// The application supplies where the lease lives, flash, SD...
+// Load returns false if there is no lease. Save is called when we get a new lease.
+typedef bool (* FNDHCPLOADLEASE)(DHCPLEASE * pLease);
+typedef void (* FNDHCPSAVELEASE)(const DHCPLEASE * pLease);
+typedef struct DHCPLEASESTORE_T
+{
+    FNDHCPLOADLEASE     LoadLease;
+    FNDHCPSAVELEASE     SaveLease;
+    bool                fSkipARPProbe;  // on INIT-REBOOT, do not ARP for the IP we already had
+} DHCPLEASESTORE;
+
 typedef struct DHCPMEM_T
 {
     uint32_t            tsStart;
@@ -232,6 +259,7 @@ typedef struct DHCPMEM_T
         uint32_t        tsReBind;       // broadcast REQUEST for new lease, default .875 lease time; set ciaddr, do not send server ident
         uint32_t        cTryDiscovery;  // The number of times to retry before giving up
     };
+    bool                fInitReboot;    // we are confirming a saved lease, not a new offer
     IPSTACK             ipStack;
     ETHERNETII_FRAME    frameII;        // maybe we can share the ARP frame, but only if we ALWAYS broadcast to the server.
     IPv4HDR             ipv4Hdr;
@@ -721,3 +721,23 @@ void SMGRFree(HSMGR hSMGR)
         }
     }
 }
+
+uint8_t SMGRCntAlloc(HSMGR hSMGR)
+{
+    SMGR *  pSMGR = (SMGR *) hSMGR;
+    uint8_t cAlloc = 0;
+    uint32_t i = 0;
+
+    if(pSMGR != NULL)
+    {
+        for(i=0; i<pSMGR->cPages; i++)
+        {
+            if(pSMGR->rgPages[i] != PMGRFreePage)
+            {
+                cAlloc++;
+            }
+        }
+    }
+
+    return(cAlloc);
+}
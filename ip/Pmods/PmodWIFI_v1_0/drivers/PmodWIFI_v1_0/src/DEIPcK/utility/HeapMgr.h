@@ -155,6 +155,7 @@ uint16_t SMGRCopyInOut(HSMGR hSMGR, bool fIn, uint16_t index, void * pb, uint16_
 void SMGRMoveEnd(HSMGR hSMGR, uint16_t index, uint16_t end);
 #define SMGRcbStream(_hSMGR) (((SMGR *) (_hSMGR))->iEnd - ((SMGR *) (_hSMGR))->iStart)
 void SMGRFree(HSMGR hSMGR);
+uint8_t SMGRCntAlloc(HSMGR hSMGR);
 
 typedef struct FFPT_T
 {
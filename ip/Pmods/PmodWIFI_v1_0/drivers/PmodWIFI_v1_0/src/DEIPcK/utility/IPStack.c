@@ -53,6 +53,7 @@
 
 #include "deIP.h"
 static HRRHEAP          g_hSocketHeap = NULL;
+static uint32_t         g_cEstSockets = 0;
 
 #if defined(__MICROBLAZE__)||defined(__arm__)
 const IPv4 IPv4BROADCAST  = {{0xFF, 0xFF, 0xFF, 0xFF}};
@@ -104,6 +105,7 @@ bool IPSInit(uint8_t * pScratchMem, uint32_t cbScratchMem, uint32_t cEstSockets)
         }
 
         g_hSocketHeap = RRHPInit(pScratchMem, cbSocketHeap);
+        g_cEstSockets = cEstSockets;
 
         if(g_hSocketHeap == NULL)
         {
@@ -129,11 +131,39 @@ void IPSClearSocketHeap(void)
 {
     RRHPTerminate(g_hSocketHeap);
     g_hSocketHeap = NULL;
+    g_cEstSockets = 0;
 }
 
 TCPSOCKET * IPSGetSocketFromSocketHeap(void)
 {
-    return((TCPSOCKET*)RRHPAlloc(g_hSocketHeap, sizeof(TCPSOCKET)));
+    TCPSOCKET * pSocket = NULL;
+
+    if(g_hSocketHeap == NULL)
+    {
+        return(NULL);
+    }
+
+    // if we are out, see if we can take one back from a
+    // connection the user has already closed, and try again
+    else if((pSocket = (TCPSOCKET*)RRHPAlloc(g_hSocketHeap, sizeof(TCPSOCKET))) == NULL && TCPReapIdleSocket(0, true))
+    {
+        pSocket = (TCPSOCKET*)RRHPAlloc(g_hSocketHeap, sizeof(TCPSOCKET));
+    }
+
+    return(pSocket);
+}
+
+bool IPSIsSocketFromHeap(const void * pSocket)
+{
+    const RRHEAP * pHeap = (const RRHEAP *) g_hSocketHeap;
+
+    return(pHeap != NULL && pHeap->rgbHeap <= ((const uint8_t *) pSocket) && ((const uint8_t *) pSocket) < (pHeap->rgbHeap + pHeap->cbHeap));
+}
+
+// the heap was sized for cEstSockets, when we get near that, we are low
+bool IPSIsSocketHeapLow(void)
+{
+    return(g_hSocketHeap != NULL && (RRHPcInUse(g_hSocketHeap) + cTCPREAPLOWWATER) >= g_cEstSockets);
 }
 
 void IPSReleaseSocket(TCPSOCKET * pSocket)
@@ -69,6 +69,8 @@ IPSTACK * IPSInitIpStack(const LLADP * pLLAdp, void * pIpStackBuff, uint32_t typ
 #define IPSGetSocketMemorySize(_cEstSockets) (IPSGetSocketHeapSize(_cEstSockets))
 
 TCPSOCKET * IPSGetSocketFromSocketHeap(void);
+bool IPSIsSocketFromHeap(const void * pSocket);
+bool IPSIsSocketHeapLow(void);
 void IPSReleaseSocket(TCPSOCKET * pSocket);
 
 IPSTACK * IPSRelease(IPSTACK * pIpStack);
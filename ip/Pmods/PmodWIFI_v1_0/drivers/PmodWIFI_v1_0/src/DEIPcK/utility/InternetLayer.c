@@ -52,6 +52,36 @@
 
 #include "deIP.h"
 static FFPT ffptIpStackArpWaitList = {NULL, NULL};
+static uint16_t g_ipIdent = 0;
+
+typedef struct ILREASM_T
+{
+    const LLADP *   pLLAdp;                             // NULL if the entry is not in use
+    uint32_t        tStart;                             // when the first fragment came in
+    IPv4            ipSrc;
+    IPv4            ipDest;
+    uint16_t        ident;                              // left in network order, only compared
+    IPPN            protocol;
+    uint8_t         cbFrame;                            // 0 until the offset 0 fragment comes in
+    uint8_t         cbIPHeader;
+    uint16_t        cbData;                             // 0 until the last fragment comes in
+    uint8_t         rgbHdr[ILReasmHdrMax];              // frame and IP header from the offset 0 fragment
+    uint8_t         rgBlocks[cbILReasmMax >> 6];        // bit map of the 8 byte blocks we have
+    PGID            rgPages[cbILReasmMax >> PMGRpf2Min];
+} ILREASM;
+
+typedef struct ILFRAGTX_T
+{
+    IPSTACK *       pIpStack;                           // the original datagram, NULL if the entry is not in use
+    uint8_t *       pbFrags;                            // the fragment IPSTACKs and their headers
+    uint16_t        cbFragEntry;                        // size of each fragment entry in pbFrags
+    uint16_t        cFrag;                              // fragments handed to the adaptor
+} ILFRAGTX;
+
+static HPMGR        g_hReasmPMGR = NULL;
+static ILREASM      g_rgReasm[cILReasmEntries];
+static ILFRAGTX     g_rgFragTx[cILFragTxEntries];
+static ILFRAGSTATS  g_ilFragStats;
 
 int32_t ExILIPv4Header(void * pv, uint32_t cb, bool fStartsInMachineOrder)
 {
@@ -332,7 +362,564 @@ bool ILSend(IPSTACK * pIpStack, IPSTATUS * pStatus)
     return(fRet);
 }
 
+// RFC 791, the identification only needs to be unique for the
+// src, dest, protocol tuple while the datagram is alive on the net
+uint16_t ILGetNextIdent(void)
+{
+    return(g_ipIdent++);
+}
+
+/************************************************************************/
+/*                                                                      */
+/*  IPv4 fragmentation and reassembly, RFC 791 / RFC 1122               */
+/*                                                                      */
+/*  Fragments are caught in the link layer before the frame is parsed,  */
+/*  because the transport header is only in the first fragment and the  */
+/*  transport checksum covers the whole datagram. The data is held in   */
+/*  pages of the reassembly page manager, and when the datagram is      */
+/*  complete a new frame is built that looks exactly like it came in    */
+/*  whole from the adaptor.                                             */
+/*                                                                      */
+/************************************************************************/
+void ILReasmInit(HPMGR hPMGR)
+{
+    memset(g_rgReasm, 0, sizeof(g_rgReasm));
+    memset(g_rgFragTx, 0, sizeof(g_rgFragTx));
+    g_hReasmPMGR = hPMGR;
+}
+
+void ILGetFragStats(ILFRAGSTATS * pStats)
+{
+    if(pStats != NULL)
+    {
+        memcpy(pStats, &g_ilFragStats, sizeof(ILFRAGSTATS));
+    }
+}
+
+static void ILFreeReasm(ILREASM * pReasm)
+{
+    uint32_t i = 0;
+
+    if(pReasm->pLLAdp != NULL)
+    {
+        for(i=0; i<sizeof(pReasm->rgPages); i++)
+        {
+            if(pReasm->rgPages[i] != PMGRFreePage)
+            {
+                PMGRFree(g_hReasmPMGR, pReasm->rgPages[i]);
+            }
+        }
+    }
+
+    memset(pReasm, 0, sizeof(ILREASM));
+}
+
+static IPv4HDR * ILGetRawIPv4Hdr(const IPSTACK * pIpStack, uint16_t * pcbFrame)
+{
+    const ETHERNETII_FRAME *    pFrameII    = (const ETHERNETII_FRAME *) pIpStack->pPayload;
+    uint16_t                    cbFrame     = sizeof(ETHERNETII_FRAME);
+    ETHERTYPE                   etherType   = 0;
+
+    // we are looking at the raw frame as it came from the adaptor
+    if(pIpStack->fFrameIsParsed || pIpStack->cbPayload < sizeof(ETHERNETII_FRAME))
+    {
+        return(NULL);
+    }
+
+    etherType = pFrameII->etherType;
+    ExEndian(&etherType, sizeof(ETHERTYPE));
+
+    if(IsIEEE802(etherType))
+    {
+        if(pIpStack->cbPayload < sizeof(ETHERNET_802_FRAME))
+        {
+            return(NULL);
+        }
+
+        etherType = ((const ETHERNET_802_FRAME *) pFrameII)->snap.etherType;
+        ExEndian(&etherType, sizeof(ETHERTYPE));
+        cbFrame = sizeof(ETHERNET_802_FRAME);
+    }
+
+    if(etherType != ethertypeIPv4 || pIpStack->cbPayload < (cbFrame + sizeof(IPv4HDR)))
+    {
+        return(NULL);
+    }
+
+    *pcbFrame = cbFrame;
+    return((IPv4HDR *) (pIpStack->pbPayload + cbFrame));
+}
+
+static ILREASM * ILFindReasm(const LLADP * pLLAdp, const IPv4HDR * pIPv4Hdr)
+{
+    ILREASM *   pReasm      = NULL;
+    uint32_t    tCur        = SYSGetMilliSecond();
+    uint32_t    tOldest     = 0;
+    uint32_t    i           = 0;
+
+    // RFC 791, the datagram is identified by src, dest, protocol, and ident
+    for(i=0; i<cILReasmEntries; i++)
+    {
+        if( g_rgReasm[i].pLLAdp         == pLLAdp               &&
+            g_rgReasm[i].ipSrc.u32      == pIPv4Hdr->ipSrc.u32  &&
+            g_rgReasm[i].ipDest.u32     == pIPv4Hdr->ipDest.u32 &&
+            g_rgReasm[i].ident          == pIPv4Hdr->ident      &&
+            g_rgReasm[i].protocol       == pIPv4Hdr->protocol   )
+        {
+            return(&g_rgReasm[i]);
+        }
+    }
+
+    // a new datagram, take a free entry or kick out the oldest
+    for(i=0; i<cILReasmEntries; i++)
+    {
+        if(g_rgReasm[i].pLLAdp == NULL)
+        {
+            pReasm = &g_rgReasm[i];
+            break;
+        }
+        else if((tCur - g_rgReasm[i].tStart) >= tOldest)
+        {
+            tOldest = tCur - g_rgReasm[i].tStart;
+            pReasm = &g_rgReasm[i];
+        }
+    }
+
+    if(pReasm->pLLAdp != NULL)
+    {
+        g_ilFragStats.cReasmDropped++;
+        ILFreeReasm(pReasm);
+    }
+
+    pReasm->pLLAdp          = pLLAdp;
+    pReasm->tStart          = tCur;
+    pReasm->ipSrc.u32       = pIPv4Hdr->ipSrc.u32;
+    pReasm->ipDest.u32      = pIPv4Hdr->ipDest.u32;
+    pReasm->ident           = pIPv4Hdr->ident;
+    pReasm->protocol        = pIPv4Hdr->protocol;
+    memset(pReasm->rgPages, PMGRFreePage, sizeof(pReasm->rgPages));
+
+    return(pReasm);
+}
+
+static bool ILReasmCopyIn(ILREASM * pReasm, uint32_t iOffset, const uint8_t * pb, uint32_t cb)
+{
+    uint32_t    pf2     = ((PMGR *) g_hReasmPMGR)->pf2PerPage;
+    uint32_t    cbPage  = PMGRcbPage(g_hReasmPMGR);
+    uint32_t    iPage   = 0;
+    uint32_t    oPage   = 0;
+    uint32_t    cbCopy  = 0;
+
+    while(cb > 0)
+    {
+        iPage   = iOffset >> pf2;
+        oPage   = iOffset & (cbPage - 1);
+        cbCopy  = min(cbPage - oPage, cb);
+
+        // pages are only allocated as data lands in them
+        if( iPage >= sizeof(pReasm->rgPages)                                                                ||
+            (pReasm->rgPages[iPage] == PMGRFreePage && (pReasm->rgPages[iPage] = PMGRAlloc(g_hReasmPMGR)) == PMGRFreePage)  ||
+            PMGRCopyToPage(g_hReasmPMGR, pReasm->rgPages[iPage], oPage, pb, cbCopy) != cbCopy              )
+        {
+            return(false);
+        }
+
+        iOffset += cbCopy;
+        pb      += cbCopy;
+        cb      -= cbCopy;
+    }
+
+    return(true);
+}
+
+static bool ILIsReasmComplete(const ILREASM * pReasm)
+{
+    uint32_t    cBlocks = (pReasm->cbData + 7) >> 3;
+    uint32_t    i       = 0;
+
+    // must have the first and last fragment
+    if(pReasm->cbFrame == 0 || pReasm->cbData == 0)
+    {
+        return(false);
+    }
+
+    for(i=0; i<cBlocks; i++)
+    {
+        if((pReasm->rgBlocks[i >> 3] & (0x01 << (i & 0x07))) == 0)
+        {
+            return(false);
+        }
+    }
+
+    return(true);
+}
+
+static IPSTACK * ILReasmBuild(ILREASM * pReasm)
+{
+    const LLADP *   pLLAdp      = pReasm->pLLAdp;
+    IPSTACK *       pIpStack    = NULL;
+    IPv4HDR *       pIPv4Hdr    = NULL;
+    uint8_t *       pbFrag      = NULL;
+    uint16_t        cbHdr       = pReasm->cbFrame + pReasm->cbIPHeader;
+    uint16_t        cbTotal     = pReasm->cbIPHeader + pReasm->cbData;
+    uint32_t        cbPage      = PMGRcbPage(g_hReasmPMGR);
+    uint32_t        cbLeft      = pReasm->cbData;
+    uint32_t        cbCopy      = 0;
+    uint32_t        i           = 0;
+
+    if((pIpStack = (IPSTACK *) RRHPAlloc(pLLAdp->pNwAdp->hAdpHeap, IPStackEntrySize)) == NULL)
+    {
+        g_ilFragStats.cReasmDropped++;
+        ILFreeReasm(pReasm);
+        return(NULL);
+    }
+    memset(pIpStack, 0, sizeof(IPSTACK));
+
+    pIpStack->pLLAdp            = pLLAdp;
+    pIpStack->fFreeIpStackToAdp = true;
+
+    if(IPSGetPayloadFromAdaptor(pIpStack, cbHdr + pReasm->cbData) != (cbHdr + pReasm->cbData))
+    {
+        g_ilFragStats.cReasmDropped++;
+        ILFreeReasm(pReasm);
+        IPSRelease(pIpStack);
+        return(NULL);
+    }
+
+    // lay the frame out just as the adaptor would have
+    memcpy(pIpStack->pbPayload, pReasm->rgbHdr, cbHdr);
+    for(i=0; cbLeft > 0; i++)
+    {
+        cbCopy = min(cbPage, cbLeft);
+        PMGRCopyFromPage(g_hReasmPMGR, pReasm->rgPages[i], 0, pIpStack->pbPayload + cbHdr + (i * cbPage), cbCopy);
+        cbLeft -= cbCopy;
+    }
+
+    // it is one datagram now, fix up the IP header, still in network order
+    pIPv4Hdr                = (IPv4HDR *) (pIpStack->pbPayload + pReasm->cbFrame);
+    pIPv4Hdr->cbTotal       = cbTotal;
+    ExEndian(&pIPv4Hdr->cbTotal, sizeof(pIPv4Hdr->cbTotal));
+    pbFrag                  = (uint8_t *) &pIPv4Hdr->u16;
+    pbFrag[0]              &= ILFragDF;
+    pbFrag[1]               = 0;
+    pIPv4Hdr->hdrChecksum   = 0;
+    pIPv4Hdr->hdrChecksum   = CalculateChecksum(0, pIPv4Hdr, pReasm->cbIPHeader);
+
+    pIpStack->headerOrder       = NETWORK_ORDER;
+    pIpStack->fFrameIsParsed    = false;
+
+    g_ilFragStats.cReasmOK++;
+    ILFreeReasm(pReasm);
+
+    return(pIpStack);
+}
+
+/*
+ * Returns the IPSTACK to process. If this is not a fragment, that is
+ * the one passed in. If it is a fragment it is consumed and NULL is returned
+ * unless it completed a datagram, then the whole datagram is returned.
+ */
+IPSTACK * ILReassemble(IPSTACK * pIpStack)
+{
+    IPv4HDR *   pIPv4Hdr    = NULL;
+    ILREASM *   pReasm      = NULL;
+    uint8_t *   pbFrag      = NULL;
+    uint16_t    cbFrame     = 0;
+    uint16_t    cbIPHeader  = 0;
+    uint16_t    cbTotal     = 0;
+    uint32_t    cbFrag      = 0;
+    uint32_t    iOffset     = 0;
+    uint32_t    i           = 0;
+
+    if((pIPv4Hdr = ILGetRawIPv4Hdr(pIpStack, &cbFrame)) == NULL)
+    {
+        return(pIpStack);
+    }
+
+    // only a fragment if MF is set or there is an offset
+    pbFrag = (uint8_t *) &pIPv4Hdr->u16;
+    if((pbFrag[0] & (ILFragMF | ILFragOffsetHi)) == 0 && pbFrag[1] == 0)
+    {
+        return(pIpStack);
+    }
+
+    g_ilFragStats.cFragRx++;
+
+    cbIPHeader  = pIPv4Hdr->cdwHeader * sizeof(uint32_t);
+    cbTotal     = pIPv4Hdr->cbTotal;
+    ExEndian(&cbTotal, sizeof(cbTotal));
+    iOffset     = ((((uint32_t) (pbFrag[0] & ILFragOffsetHi)) << 8) | pbFrag[1]) << 3;
+    cbFrag      = cbTotal - cbIPHeader;
+
+    // check it all out before we commit any memory to it
+    if( g_hReasmPMGR == NULL                                            ||
+        cbIPHeader < sizeof(IPv4HDR)                                    ||
+        cbTotal <= cbIPHeader                                           ||
+        (cbFrame + cbTotal) > pIpStack->cbPayload                       ||
+        ((pbFrag[0] & ILFragMF) && (cbFrag & 0x07) != 0)                ||
+        CalculateChecksum(0, pIPv4Hdr, cbIPHeader) != 0                 )
+    {
+        g_ilFragStats.cReasmDropped++;
+        IPSRelease(pIpStack);
+        return(NULL);
+    }
+
+    pReasm = ILFindReasm(pIpStack->pLLAdp, pIPv4Hdr);
+
+    // too big, past the end we were told about, or a second last fragment that disagrees
+    if( (iOffset + cbFrag) > cbILReasmMax                                                       ||
+        (pReasm->cbData != 0 && (iOffset + cbFrag) > pReasm->cbData)                            ||
+        (pReasm->cbData != 0 && (pbFrag[0] & ILFragMF) == 0 && (iOffset + cbFrag) != pReasm->cbData)   ||
+        !ILReasmCopyIn(pReasm, iOffset, ((uint8_t *) pIPv4Hdr) + cbIPHeader, cbFrag)           )
+    {
+        g_ilFragStats.cReasmDropped++;
+        ILFreeReasm(pReasm);
+        IPSRelease(pIpStack);
+        return(NULL);
+    }
+
+    // the last fragment tells us how big the datagram is
+    if((pbFrag[0] & ILFragMF) == 0)
+    {
+        pReasm->cbData = iOffset + cbFrag;
+    }
+
+    // the first fragment has the header we will use
+    if(iOffset == 0)
+    {
+        pReasm->cbFrame     = cbFrame;
+        pReasm->cbIPHeader  = cbIPHeader;
+        memcpy(pReasm->rgbHdr, pIpStack->pPayload, cbFrame + cbIPHeader);
+    }
+
+    // mark the blocks we now have
+    for(i=(iOffset >> 3); i<((iOffset + cbFrag + 7) >> 3); i++)
+    {
+        pReasm->rgBlocks[i >> 3] |= (0x01 << (i & 0x07));
+    }
+
+    // we are done with the fragment
+    IPSRelease(pIpStack);
+
+    if(ILIsReasmComplete(pReasm))
+    {
+        return(ILReasmBuild(pReasm));
+    }
+
+    return(NULL);
+}
+
+static void ILReasmServiceTimers(void)
+{
+    uint32_t    tCur    = SYSGetMilliSecond();
+    uint32_t    i       = 0;
+
+    for(i=0; i<cILReasmEntries; i++)
+    {
+        if(g_rgReasm[i].pLLAdp != NULL && (tCur - g_rgReasm[i].tStart) >= ILReasmTimeout)
+        {
+            g_ilFragStats.cReasmTimeout++;
+            ILFreeReasm(&g_rgReasm[i]);
+        }
+    }
+}
+
+/*
+ * Anything bigger than the adaptor says it can send goes out as fragments.
+ * Must be called after the IPSTACK is put in network order.
+ */
+bool ILIsFragmentNeeded(const IPSTACK * pIpStack)
+{
+    return( pIpStack->fFrameIsParsed                                                                            &&
+            pIpStack->headerOrder == NETWORK_ORDER                                                              &&
+            pIpStack->etherType == ethertypeIPv4                                                                &&
+            ((uint32_t) (pIpStack->cbIPHeader + pIpStack->cbTranportHeader + pIpStack->cbPayload)) > LLGetMTUS(pIpStack->pLLAdp)  &&
+            (((uint8_t *) &pIpStack->pIPv4Hdr->u16)[0] & ILFragDF) == 0                                         );
+}
+
+static bool ILIsFragTxDone(const ILFRAGTX * pFragTx)
+{
+    uint32_t    i   = 0;
+
+    for(i=0; i<pFragTx->cFrag; i++)
+    {
+        if(IPSIsInUse((IPSTACK *) (pFragTx->pbFrags + (i * pFragTx->cbFragEntry))))
+        {
+            return(false);
+        }
+    }
+
+    return(true);
+}
+
+// give back the datagrams whose fragments the adaptor has finished with
+static void ILFragTxServiceHeld(void)
+{
+    IPSTACK *   pIpStack    = NULL;
+    uint32_t    i           = 0;
+
+    for(i=0; i<cILFragTxEntries; i++)
+    {
+        if(g_rgFragTx[i].pIpStack != NULL && ILIsFragTxDone(&g_rgFragTx[i]))
+        {
+            pIpStack = g_rgFragTx[i].pIpStack;
+            RRHPFree(pIpStack->pLLAdp->pNwAdp->hAdpHeap, g_rgFragTx[i].pbFrags);
+            memset(&g_rgFragTx[i], 0, sizeof(ILFRAGTX));
+
+            // now release it just as the adaptor would have
+            pIpStack->fOwnedByAdp = false;
+            IPSRelease(pIpStack);
+        }
+    }
+}
+
+/*
+ * Breaks a network order IPv4 datagram into fragments and hands them to the
+ * adaptor. The data is not copied, each fragment IPSTACK only has its own frame
+ * and IP header and points into the transport header and payload of the original.
+ * So the adaptor heap only needs about 80 bytes per fragment on top of the datagram.
+ *
+ * The original is marked as owned by the adaptor and held in g_rgFragTx until
+ * the adaptor is done with every fragment, then it is released just as the adaptor
+ * would have after sending it; an IPSRelease by the caller in the mean time does nothing.
+ *
+ * If the adaptor refuses a fragment part way through, the fragments already handed
+ * to it still go out and we return false; the receiver drops the incomplete datagram
+ * when its reassembly timer runs out.
+ */
+bool ILSendFragments(IPSTACK * pIpStack, IPSTATUS * pStatus)
+{
+    const LLADP *   pLLAdp      = pIpStack->pLLAdp;
+    ILFRAGTX *      pFragTx     = NULL;
+    IPSTACK *       pFrag       = NULL;
+    uint8_t *       pbFrag      = NULL;
+    uint32_t        cbData      = pIpStack->cbTranportHeader + pIpStack->cbPayload;
+    uint32_t        cbFragMax   = (LLGetMTUS(pLLAdp) - pIpStack->cbIPHeader) & ~0x07;
+    uint32_t        cFrag       = (cbData + cbFragMax - 1) / cbFragMax;
+    uint32_t        cbFragEntry = SYSAdjToDerefSize(sizeof(IPSTACK) + pIpStack->cbFrame + pIpStack->cbIPHeader);
+    uint32_t        cbFrag      = 0;
+    uint32_t        cbHdrPart   = 0;
+    uint32_t        iOffset     = 0;
+    uint32_t        i           = 0;
+    uint16_t        ident       = 0;
+    IPSTATUS        status      = ipsSuccess;
+
+    // get back anything the adaptor is done with, and find a place to hold this datagram
+    ILFragTxServiceHeld();
+    for(i=0; i<cILFragTxEntries; i++)
+    {
+        if(g_rgFragTx[i].pIpStack == NULL)
+        {
+            pFragTx = &g_rgFragTx[i];
+            break;
+        }
+    }
+
+    if(pFragTx == NULL)
+    {
+        g_ilFragStats.cFragTxFailed++;
+        AssignStatusSafely(pStatus, ipsIpStackAllInUse);
+        return(false);
+    }
+
+    else if((pFragTx->pbFrags = (uint8_t *) RRHPAlloc(pLLAdp->pNwAdp->hAdpHeap, cFrag * cbFragEntry)) == NULL)
+    {
+        g_ilFragStats.cFragTxFailed++;
+        AssignStatusSafely(pStatus, ispOutOfMemory);
+        return(false);
+    }
+    memset(pFragTx->pbFrags, 0, cFrag * cbFragEntry);
+    pFragTx->cbFragEntry = cbFragEntry;
+
+    // every fragment must carry the same ident, IPSSetHeader leaves it zero
+    if(pIpStack->pIPv4Hdr->ident == 0)
+    {
+        ident = ILGetNextIdent();
+        ExEndian(&ident, sizeof(ident));
+        pIpStack->pIPv4Hdr->ident = ident;
+    }
+
+    for(iOffset=0; iOffset<cbData; iOffset += cbFrag)
+    {
+        cbFrag = min(cbFragMax, cbData - iOffset);
+        pFrag = (IPSTACK *) (pFragTx->pbFrags + (pFragTx->cFrag * cbFragEntry));
+
+        pFrag->pLLAdp               = pLLAdp;
+
+        // same header layout as IPSInitIpStack
+        pFrag->pFrameII             = (ETHERNETII_FRAME *) (((uint8_t *) pFrag) + sizeof(IPSTACK));
+        pFrag->cbFrame              = pIpStack->cbFrame;
+        pFrag->pIPv4Hdr             = (IPv4HDR *) (((uint8_t *) pFrag->pFrameII) + pFrag->cbFrame);
+        pFrag->cbIPHeader           = pIpStack->cbIPHeader;
+        pFrag->etherType            = pIpStack->etherType;
+        pFrag->protocol             = pIpStack->protocol;
+        memcpy(pFrag->pFrameII, pIpStack->pFrameII, pFrag->cbFrame);
+        memcpy(pFrag->pIPv4Hdr, pIpStack->pIPv4Hdr, pFrag->cbIPHeader);
+
+        // the data is the transport header and payload of the original as one buffer,
+        // a fragment may start in the transport header and run on into the payload
+        cbHdrPart = 0;
+        if(iOffset < pIpStack->cbTranportHeader)
+        {
+            cbHdrPart                   = min(cbFrag, pIpStack->cbTranportHeader - iOffset);
+            pFrag->pTransportHeader     = ((uint8_t *) pIpStack->pTransportHeader) + iOffset;
+            pFrag->cbTranportHeader     = cbHdrPart;
+        }
+        if(cbFrag > cbHdrPart)
+        {
+            pFrag->pPayload             = pIpStack->pbPayload + (iOffset + cbHdrPart - pIpStack->cbTranportHeader);
+            pFrag->cbPayload            = cbFrag - cbHdrPart;
+        }
+
+        // patch the IP header, all in network order
+        pFrag->pIPv4Hdr->cbTotal    = pFrag->cbIPHeader + cbFrag;
+        ExEndian(&pFrag->pIPv4Hdr->cbTotal, sizeof(pFrag->pIPv4Hdr->cbTotal));
+        pbFrag                      = (uint8_t *) &pFrag->pIPv4Hdr->u16;
+        pbFrag[0]                   = ((iOffset + cbFrag) < cbData ? ILFragMF : 0) | ((iOffset >> 11) & ILFragOffsetHi);
+        pbFrag[1]                   = (uint8_t) (iOffset >> 3);
+        pFrag->pIPv4Hdr->hdrChecksum = 0;
+        pFrag->pIPv4Hdr->hdrChecksum = CalculateChecksum(0, pFrag->pIPv4Hdr, pFrag->cbIPHeader);
+
+        pFrag->headerOrder          = NETWORK_ORDER;
+        pFrag->fFrameIsParsed       = true;
+
+        if(!pLLAdp->pNwAdp->Send(pFrag, &status))
+        {
+            status = ForceIPError(status);
+            break;
+        }
+        pFragTx->cFrag++;
+        g_ilFragStats.cFragTx++;
+    }
+
+    // nothing went out, the caller still owns the datagram
+    if(pFragTx->cFrag == 0)
+    {
+        RRHPFree(pLLAdp->pNwAdp->hAdpHeap, pFragTx->pbFrags);
+        memset(pFragTx, 0, sizeof(ILFRAGTX));
+    }
+
+    // hold the datagram until the adaptor is done with the fragments pointing into it
+    else
+    {
+        pIpStack->fOwnedByAdp   = true;
+        pFragTx->pIpStack       = pIpStack;
+    }
+
+    if(IsIPStatusAnError(status))
+    {
+        g_ilFragStats.cFragTxFailed++;
+        AssignStatusSafely(pStatus, status);
+        return(false);
+    }
+
+    AssignStatusSafely(pStatus, ipsSuccess);
+    return(true);
+}
+
 void ILPeriodicTasks(void)
 {
     ILProcessWaitList();
+    ILReasmServiceTimers();
+    ILFragTxServiceHeld();
 }
@@ -55,6 +55,41 @@
 #define TCP_EMTU_S          576     // RFC 791
 #define TIME_TO_LIVE        0x80    // How long an IP packet is to survive in the internet
 
+// IPv4 fragmentation, the flags and offset as they appear
+// in the first byte of the network order frag field
+#define ILFragDF            0x40    // don't fragment
+#define ILFragMF            0x20    // more fragments
+#define ILFragOffsetHi      0x1F    // top 5 bits of the offset in 8 byte blocks
+
+// IPv4 reassembly, RFC 791 / RFC 1122
+// A partial datagram is buffered in the reassembly page manager
+// so memory use is bounded by that page manager, and no single datagram
+// may be bigger than cbILReasmMax. Datagrams bigger than that are dropped.
+#ifndef cILReasmEntries
+#define cILReasmEntries     2       // how many datagrams can be reassembled at once
+#endif
+#ifndef cbILReasmMax
+#define cbILReasmMax        3072    // max IP data one reassembled datagram may have, multiple of 64
+#endif
+#define ILReasmTimeout      15000   // RFC 791 recommends 15 seconds
+#define ILReasmHdrMax       (sizeof(ETHERNET_802_FRAME) + 60)  // biggest frame and IPv4 header we keep
+
+// IPv4 fragmentation on send
+// fragments point into the original datagram, which is held until they are all sent
+#ifndef cILFragTxEntries
+#define cILFragTxEntries    2       // how many fragmented datagrams can be in the adaptor at once
+#endif
+
+typedef struct ILFRAGSTATS_T
+{
+    uint32_t    cFragRx;            // fragments received
+    uint32_t    cReasmOK;           // datagrams successfully reassembled
+    uint32_t    cReasmTimeout;      // partial datagrams that timed out
+    uint32_t    cReasmDropped;      // fragments dropped; malformed, too big, or out of memory
+    uint32_t    cFragTx;            // fragments sent
+    uint32_t    cFragTxFailed;      // datagrams we could not fragment
+} ILFRAGSTATS;
+
 // RFC 790 Assigned Numbers, IP protocol numbers
 #define ippnNone                        0 
 #define ippnICMP                        1
@@ -242,5 +277,11 @@ typedef struct IPv6HDR_T
 int32_t ExILIPv4Header(void * pv, uint32_t cb, bool fStartsInMachineOrder);
 void ILPeriodicTasks(void);
 bool ILSend(IPSTACK * pIpStack, IPSTATUS * pStatus);
+uint16_t ILGetNextIdent(void);
+void ILReasmInit(HPMGR hPMGR);
+IPSTACK * ILReassemble(IPSTACK * pIpStack);
+bool ILIsFragmentNeeded(const IPSTACK * pIpStack);
+bool ILSendFragments(IPSTACK * pIpStack, IPSTATUS * pStatus);
+void ILGetFragStats(ILFRAGSTATS * pStats);
 
 #endif // _INTERNET_LAYER_H_
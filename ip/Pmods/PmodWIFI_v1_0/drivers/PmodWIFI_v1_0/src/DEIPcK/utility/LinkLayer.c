@@ -182,8 +182,17 @@ bool LLSend(IPSTACK * pIpStack, IPSTATUS * pStatus)
     // put in network order
     IPSSetToNetworkOrder(pIpStack);
 
+    // too big for the link, it goes out as IP fragments
+    if(ILIsFragmentNeeded(pIpStack))
+    {
+        fRet = ILSendFragments(pIpStack, pStatus);
+    }
+
     // try and send it to the adaptor
-    fRet = pIpStack->pLLAdp->pNwAdp->Send(pIpStack, pStatus);
+    else
+    {
+        fRet = pIpStack->pLLAdp->pNwAdp->Send(pIpStack, pStatus);
+    }
 
     return(fRet);
 }
@@ -729,6 +738,13 @@ static void LLManagementTask(void)
                     IPSRelease(pIpStack);
                 }
 
+                // IP fragments are held until the whole datagram is in,
+                // then we get the whole datagram back as a new IPSTACK
+                else if((pIpStack = ILReassemble(pIpStack)) == NULL)
+                {
+                    continue;
+                }
+
                 // this must be a frame in Network order
                 // see if we can parse the packet, if not, discard it.
                 // we could delay this until we take it off of the stack
@@ -127,7 +127,8 @@ bool SNTPv4Init(const LLADP * pLLAdp, void * rgbSNTPvMem, uint32_t cbSNTPv4Mem,
     pNTPMem->iServerNext    = 0;
     pNTPMem->sntpState      = sntpResolveServerName;
     pNTPMem->cAttempt       = 0;
-    pNTPMem->tCorrection    = 0;
+    pNTPMem->fSynced        = false;
+    pNTPMem->tPoll          = ntpACQUIRESEC;
 
     // put this in my adpator
     ((LLADP *) pLLAdp)->pNTPMem = pNTPMem;
@@ -151,15 +152,159 @@ bool SNTPv4Terminate(const LLADP * pLLAdp)
     return(true);
 }
 
-uint32_t SNTPv4GetNTPEpochTime(const LLADP * pLLAdp)
+/*****************************************************************************
+ *  NTP timestamps are 32.32 fixed point seconds. Everything in here is done
+ *  in 64 bit microseconds; that is good for 292,000 years, and 1 usec is
+ *  more resolution than the round trip jitter will ever let us see.
+ *
+ *  RFC 4330: if the MSB of the seconds is clear, the time is in NTP era 1,
+ *  after Feb-7-2036 when the 32 bit seconds wrap.
+ *****************************************************************************/
+static uint64_t SNTPv4NTPToUSec(const NTPV4HDRTIME * pTime)
+{
+    uint64_t    cSeconds = pTime->cSeconds;
+
+    if((cSeconds & 0x80000000ul) == 0)
+    {
+        cSeconds += 0x100000000ull;
+    }
+
+    return((cSeconds * ntpUSECPERSEC) + ((((uint64_t) pTime->secFraction) * ntpUSECPERSEC) >> 32));
+}
+
+static void SNTPv4USecToNTP(uint64_t usTime, NTPV4HDRTIME * pTime)
+{
+    pTime->cSeconds     = (uint32_t) (usTime / ntpUSECPERSEC);
+    pTime->secFraction  = (uint32_t) (((usTime % ntpUSECPERSEC) << 32) / ntpUSECPERSEC);
+}
+
+// NTP time in usec for a given local time, per the clock model in NTPCLOCK
+static uint64_t SNTPv4ClockUSec(const NTPCLOCK * pClock, uint64_t usLocal)
+{
+    int64_t usElapsed = (int64_t) (usLocal - pClock->usLocalBase);
+
+    return(pClock->usNTPBase + usElapsed + ((usElapsed * pClock->freqPPB) / 1000000000ll));
+}
+
+// keep the correction found at usLocal, and restart the clock model there
+static void SNTPv4ClockSet(NTPCLOCK * pClock, uint64_t usLocal, int64_t offset)
 {
+    pClock->usNTPBase   = SNTPv4ClockUSec(pClock, usLocal) + offset;
+    pClock->usLocalBase = usLocal;
+}
+
+/*****************************************************************************
+ *  Clock filter and discipline, loosely after RFC 5905 sections 10 and 11.
+ *
+ *  Of the samples that came in since the last update, the one with the
+ *  lowest round trip delay is the one least disturbed by queuing, so it is
+ *  the one we believe. A large offset steps the clock and starts over,
+ *  otherwise the offset is removed and whatever offset has built up since
+ *  the last update is frequency error of our crystal, which we
+ *  fold into freqPPB so the clock holds between polls.
+ *****************************************************************************/
+static void SNTPv4ClockUpdate(NTPMEM * pNTPMem)
+{
+    NTPCLOCK *      pClock  = &pNTPMem->clock;
+    NTPSAMPLE *     pBest   = NULL;
+    uint64_t        usLocal = SYSGetMicroSecond64();
+    uint32_t        i       = 0;
+
+    for(i = 0; i < ntpFILTERSIZE; i++)
+    {
+        NTPSAMPLE * pSample = &pNTPMem->rgSamples[i];
+
+        if(pSample->tLocal > pClock->tLastUpdate && (pBest == NULL || pSample->delay < pBest->delay))
+        {
+            pBest = pSample;
+        }
+    }
+
+    // nothing new
+    if(pBest == NULL)
+    {
+        return;
+    }
+
+    if(!pNTPMem->fSynced || pBest->offset > ntpSTEPUSEC || pBest->offset < -ntpSTEPUSEC)
+    {
+        // step, we may go backwards
+        SNTPv4ClockSet(pClock, usLocal, pBest->offset);
+        pClock->usLastRead  = 0;
+        pClock->cUpdates    = 0;
+        pNTPMem->tPoll      = ntpFIRSTPOLLSEC;
+        pNTPMem->fSynced    = true;
+    }
+    else
+    {
+        int64_t usInterval = (int64_t) (pBest->tLocal - pClock->tLastUpdate);
+
+        // frequency is only meaningful over a reasonable interval
+        if(usInterval >= (((int64_t) ntpMINPOLLSEC) * ntpUSECPERSEC))
+        {
+            int64_t dFreq   = (pBest->offset * 1000000000ll) / usInterval;
+            int64_t freqPPB = pClock->freqPPB;
+
+            // the first estimate is taken whole, then averaged
+            freqPPB += (pClock->cUpdates == 0) ? dFreq : (dFreq / (1 << ntpFREQAVG));
+
+            if(freqPPB > ntpMAXFREQPPB)
+            {
+                freqPPB = ntpMAXFREQPPB;
+            }
+            else if(freqPPB < -ntpMAXFREQPPB)
+            {
+                freqPPB = -ntpMAXFREQPPB;
+            }
+
+            pClock->freqPPB = (int32_t) freqPPB;
+            pClock->cUpdates++;
+        }
+
+        // the frequency change only applies from here on
+        SNTPv4ClockSet(pClock, usLocal, pBest->offset);
+        pNTPMem->tPoll = min(pNTPMem->tPoll * 2, ntpPOLLSEC);
+    }
+
+    pClock->tLastUpdate = pBest->tLocal;
+    pClock->offset      = pBest->offset;
+    pClock->delay       = pBest->delay;
+}
+
+static void SNTPv4AddSample(NTPMEM * pNTPMem, uint64_t usT4)
+{
+    NTPV4 *         pResponse   = &pNTPMem->ntpv4Response;
+    NTPSAMPLE *     pSample     = &pNTPMem->rgSamples[pNTPMem->iSample];
+    uint64_t        t1          = SNTPv4ClockUSec(&pNTPMem->clock, pNTPMem->usT1);
+    uint64_t        t2          = SNTPv4NTPToUSec(&pResponse->recTimeStamp);
+    uint64_t        t3          = SNTPv4NTPToUSec(&pResponse->transmitTimeStamp);
+    uint64_t        t4          = SNTPv4ClockUSec(&pNTPMem->clock, usT4);
+
+    pSample->tLocal = usT4;
+    pSample->offset = (((int64_t) (t2 - t1)) + ((int64_t) (t3 - t4))) / 2;
+    pSample->delay  = ((int64_t) (t4 - t1)) - ((int64_t) (t3 - t2));
+
+    // rounding at the server can make this slightly negative
+    if(pSample->delay < 0)
+    {
+        pSample->delay = 0;
+    }
+
+    pNTPMem->iSample = (pNTPMem->iSample + 1) % ntpFILTERSIZE;
+}
+
+uint64_t SNTPv4GetNTPEpochTimeUSec(const LLADP * pLLAdp)
+{
+    NTPCLOCK *  pClock = NULL;
+    uint64_t    usTime = 0;
+
     if(pLLAdp == NULL || pLLAdp->pNTPMem == NULL)
     {
         return(0);
     }
 
     // if the time has not been acquired, keep trying to get it
-    else if(pLLAdp->pNTPMem->tCorrection == 0)
+    else if(!pLLAdp->pNTPMem->fSynced)
     {
 
         // this is for the impatient, if you keep asking for the
@@ -175,79 +320,133 @@ uint32_t SNTPv4GetNTPEpochTime(const LLADP * pLLAdp)
         return(0);
     }
 
-    return(SYSGetSecond() + pLLAdp->pNTPMem->tCorrection);
+    // small corrections can set the clock back a little, hold the
+    // time until it catches up so timestamps never run backwards
+    pClock = &pLLAdp->pNTPMem->clock;
+    usTime = SNTPv4ClockUSec(pClock, SYSGetMicroSecond64());
+    if(usTime < pClock->usLastRead)
+    {
+        usTime = pClock->usLastRead;
+    }
+    pClock->usLastRead = usTime;
+
+    return(usTime);
 }
 
-uint32_t SNTPv4GetUNIXEpochTime(const LLADP * pLLAdp)
+uint64_t SNTPv4GetUNIXEpochTimeUSec(const LLADP * pLLAdp)
 {
-    uint32_t unixTime = SNTPv4GetNTPEpochTime(pLLAdp);
+    uint64_t usTime = SNTPv4GetNTPEpochTimeUSec(pLLAdp);
 
-    if(unixTime == 0)
+    if(usTime == 0)
     {
         return(0);
     }
-    return(unixTime - 2208988800ul);
+    return(usTime - (UNIXEPOCHOFFSET * ((uint64_t) ntpUSECPERSEC)));
+}
+
+uint32_t SNTPv4GetNTPEpochTime(const LLADP * pLLAdp)
+{
+    return((uint32_t) (SNTPv4GetNTPEpochTimeUSec(pLLAdp) / ntpUSECPERSEC));
+}
+
+uint32_t SNTPv4GetUNIXEpochTime(const LLADP * pLLAdp)
+{
+    return((uint32_t) (SNTPv4GetUNIXEpochTimeUSec(pLLAdp) / ntpUSECPERSEC));
 }
 
+bool SNTPv4GetClockStats(const LLADP * pLLAdp, NTPCLOCKSTATS * pStats)
+{
+    NTPCLOCK * pClock = NULL;
+
+    if(pLLAdp == NULL || pLLAdp->pNTPMem == NULL || pStats == NULL || !pLLAdp->pNTPMem->fSynced)
+    {
+        return(false);
+    }
+
+    pClock = &pLLAdp->pNTPMem->clock;
+    pStats->offset          = (int32_t) pClock->offset;
+    pStats->delay           = (uint32_t) pClock->delay;
+    pStats->freqPPB         = pClock->freqPPB;
+    pStats->cUpdates        = pClock->cUpdates;
+    pStats->tSinceUpdate    = (uint32_t) ((SYSGetMicroSecond64() - pClock->tLastUpdate) / ntpUSECPERSEC);
+
+    return(true);
+}
 
 static void SNTPv4StateMachine(const LLADP * pLLAdp)
 {
     IPSTATUS            status = ipsSuccess;
-    IPv4                ipServer;
+    NTPMEM *            pNTPMem = NULL;
     uint8_t const *     szServer = NULL;
-    uint32_t            cbDatagram = 0;
 
-    if(pLLAdp == NULL || pLLAdp->pNTPMem == NULL || IPSIsInUse(&pLLAdp->pNTPMem->ntpIpStack) || !ILIsIPSetup(pLLAdp, NULL))
+    if(pLLAdp == NULL || (pNTPMem = pLLAdp->pNTPMem) == NULL || IPSIsInUse(&pNTPMem->ntpIpStack) || !ILIsIPSetup(pLLAdp, NULL))
     {
         return;
     }
 
-    switch(pLLAdp->pNTPMem->sntpState)
+    switch(pNTPMem->sntpState)
     {
         case sntpResolveServerName:
 
             // if too many attempts, just wait
-            if(pLLAdp->pNTPMem->cAttempt == pLLAdp->pNTPMem->cNTPServers)
+            if(pNTPMem->cAttempt == pNTPMem->cNTPServers)
                 {
-                    pLLAdp->pNTPMem->sntpState  = sntpStartWait;
+                    pNTPMem->sntpState  = sntpStartWait;
                     break;
                 }
 
             // Resolve the next NTP server to try
-            szServer = pLLAdp->pNTPMem->ppNTPServers[pLLAdp->pNTPMem->iServerNext];
-            if(DNSResolve(pLLAdp, szServer, (uint32_t) strlen((const char *) szServer), &ipServer, &status))
+            szServer = pNTPMem->ppNTPServers[pNTPMem->iServerNext];
+            if(DNSResolve(pLLAdp, szServer, (uint32_t) strlen((const char *) szServer), &pNTPMem->ipServer, &status))
             {
-                IPSTACK * pIpStack  = IPSInitIpStack(pLLAdp, &pLLAdp->pNTPMem->ntpIpStack, ippnUDP);
-
                 // next time, use the next server
-                pLLAdp->pNTPMem->iServerNext = (pLLAdp->pNTPMem->iServerNext + 1) % pLLAdp->pNTPMem->cNTPServers;
+                pNTPMem->iServerNext = (pNTPMem->iServerNext + 1) % pNTPMem->cNTPServers;
 
-                // set up our UDP packet
-                pLLAdp->pNTPMem->tStart     = SYSGetSecond();
-                if(pLLAdp->pNTPMem->tCorrection == 0)
-                {
-                    pLLAdp->pNTPMem->ntpv4Request.orgTimeStamp.cSeconds = 0;
-                }
-                else
-                {
-                    pLLAdp->pNTPMem->ntpv4Request.orgTimeStamp.cSeconds = pLLAdp->pNTPMem->tStart + pLLAdp->pNTPMem->tCorrection;
-                }
+                // take a burst of samples from this server
+                pNTPMem->cBurst     = 0;
+                pNTPMem->sntpState  = sntpSendRequest;
+            }
+            else if(IsIPStatusAnError(status))
+            {
+                // go to the next server
+                pNTPMem->cAttempt++;
+                pNTPMem->iServerNext = (pNTPMem->iServerNext + 1) % pNTPMem->cNTPServers;
+                pNTPMem->tStart     = SYSGetSecond();
+                pNTPMem->sntpState  = sntpStartWait;
+            }
+            break;
 
+        case sntpSendRequest:
+            {
+                IPSTACK * pIpStack  = IPSInitIpStack(pLLAdp, &pNTPMem->ntpIpStack, ippnUDP);
 
                 // for now assume we will fail to send; which will cause us to
                 // wait for our next attempt.
-                pLLAdp->pNTPMem->sntpState  = sntpStartWait;
+                pNTPMem->tStart     = SYSGetSecond();
+                pNTPMem->sntpState  = sntpStartWait;
+
+                // get rid of anything late from the last request
+                if(UDPAvailable(&pNTPMem->socket) > 0)
+                {
+                    UDPDiscard(&pNTPMem->socket);
+                }
 
                 // send it out
                 if(pIpStack != NULL)
                 {
+                    // T1; the server returns this in the origin timestamp
+                    // which is how we know the response is to this request
+                    pNTPMem->usT1 = SYSGetMicroSecond64();
+                    SNTPv4USecToNTP(SNTPv4ClockUSec(&pNTPMem->clock, pNTPMem->usT1), &pNTPMem->ntpv4Request.transmitTimeStamp);
+                    ExEndian(&pNTPMem->ntpv4Request.transmitTimeStamp.cSeconds, sizeof(uint32_t));
+                    ExEndian(&pNTPMem->ntpv4Request.transmitTimeStamp.secFraction, sizeof(uint32_t));
+
                     // set the time to live to the maximum it can go on the WAN
                     pIpStack->pIPv4Hdr->timeToLive = ntpMAXDIST;
-                    ExEndian(&pLLAdp->pNTPMem->ntpv4Request.orgTimeStamp.cSeconds, sizeof(uint32_t));
-                    if(UDPRawSend(pLLAdp, pIpStack, &ipServer, ntpPORT, SKTGetLocalPort(&pLLAdp->pNTPMem->socket), (uint8_t *) &pLLAdp->pNTPMem->ntpv4Request, sizeof(NTPV4), false, &status))
+                    if(UDPRawSend(pLLAdp, pIpStack, &pNTPMem->ipServer, ntpPORT, SKTGetLocalPort(&pNTPMem->socket), (uint8_t *) &pNTPMem->ntpv4Request, sizeof(NTPV4), false, &status))
                     {
                         // here is where we succeed.
-                        pLLAdp->pNTPMem->sntpState  = sntpWaitResponse;
+                        pNTPMem->sntpState  = sntpWaitResponse;
                     }
                     else
                     {
@@ -255,77 +454,99 @@ static void SNTPv4StateMachine(const LLADP * pLLAdp)
                     }
                 }
             }
-            else if(IsIPStatusAnError(status))
-            {
-                // go to the next server
-                pLLAdp->pNTPMem->cAttempt++;
-                pLLAdp->pNTPMem->iServerNext = (pLLAdp->pNTPMem->iServerNext + 1) % pLLAdp->pNTPMem->cNTPServers;
-                pLLAdp->pNTPMem->tStart     = SYSGetSecond();
-                pLLAdp->pNTPMem->sntpState  = sntpStartWait;
-            }
             break;
 
         case sntpWaitResponse:
             // see if any data is in the socket.
-            if((cbDatagram = UDPAvailable(&pLLAdp->pNTPMem->socket)) > 0)
+            if(UDPAvailable(&pNTPMem->socket) > 0)
             {
-                if(UDPRead(&pLLAdp->pNTPMem->socket, (uint8_t *) &pLLAdp->pNTPMem->ntpv4Response, sizeof(NTPV4), &status) >= sizeof(NTPV4))
+                // T4, take it before anything else
+                uint64_t usT4 = SYSGetMicroSecond64();
+
+                if(UDPRead(&pNTPMem->socket, (uint8_t *) &pNTPMem->ntpv4Response, sizeof(NTPV4), &status) >= sizeof(NTPV4))
                 {
-                    NTPV4 * pResponse = &pLLAdp->pNTPMem->ntpv4Response;
+                    NTPV4 * pResponse = &pNTPMem->ntpv4Response;
 
                     ExEndian(&pResponse->recTimeStamp.cSeconds, sizeof(uint32_t));
+                    ExEndian(&pResponse->recTimeStamp.secFraction, sizeof(uint32_t));
                     ExEndian(&pResponse->transmitTimeStamp.cSeconds, sizeof(uint32_t));
-//                    ExEndian(&pResponse->orgTimeStamp.cSeconds, sizeof(uint32_t));
-                    
-                    // only because sometimes we don't get the original time back in the response
-                    // so recalcuate it from what we put in
-                    pResponse->orgTimeStamp.cSeconds = pLLAdp->pNTPMem->tStart + pLLAdp->pNTPMem->tCorrection;
+                    ExEndian(&pResponse->transmitTimeStamp.secFraction, sizeof(uint32_t));
 
-                    if( pResponse->mode == ntpModeServer
+                    // both still in network order
+                    if( memcmp(&pResponse->orgTimeStamp, &pNTPMem->ntpv4Request.transmitTimeStamp, sizeof(NTPV4HDRTIME)) == 0
+                                            &&
+                        pResponse->mode == ntpModeServer
+                                            &&
+                        pResponse->li != ntpLiUnknown
                                             &&
                         pResponse->stratum >= ntpStratumPrimaryServer
                                             &&
-                        pResponse->stratum <= ntpStratumSecondaryServerEnd )
+                        pResponse->stratum <= ntpStratumSecondaryServerEnd
+                                            &&
+                        pResponse->transmitTimeStamp.cSeconds != 0 )
                     {
-
-                        // calculate the correction factor
-                        pLLAdp->pNTPMem->tCorrection +=
-                            ((uint32_t) (((((int64_t) pResponse->recTimeStamp.cSeconds) - pResponse->orgTimeStamp.cSeconds) +
-                            (((int64_t) pResponse->transmitTimeStamp.cSeconds) - (SYSGetSecond() + pLLAdp->pNTPMem->tCorrection))) / 2));
-                        pLLAdp->pNTPMem->sntpState  = sntpStartWait;
+                        SNTPv4AddSample(pNTPMem, usT4);
+                        pNTPMem->cBurst++;
+
+                        if(pNTPMem->cBurst < ntpBURSTCNT)
+                        {
+                            pNTPMem->tStart     = SYSGetSecond();
+                            pNTPMem->sntpState  = sntpBurstWait;
+                        }
+                        else
+                        {
+                            SNTPv4ClockUpdate(pNTPMem);
+                            pNTPMem->sntpState  = sntpStartWait;
+                        }
                     }
                 }
                 
                 // not a datagram I am expecting, or clear the rest of the datagram
-                if(UDPAvailable(&pLLAdp->pNTPMem->socket) > 0)
+                if(UDPAvailable(&pNTPMem->socket) > 0)
                 {
-                    UDPDiscard(&pLLAdp->pNTPMem->socket);
+                    UDPDiscard(&pNTPMem->socket);
                 }
             }
 
-            // timeout on this guy, try the next server
-            else if((SYSGetSecond() - pLLAdp->pNTPMem->tStart) >= (4*ntpMAXDIST))
+            // timeout on this guy
+            else if((SYSGetSecond() - pNTPMem->tStart) >= (4*ntpMAXDIST))
             {
-                // go to the next server
-                pLLAdp->pNTPMem->cAttempt++;
-                pLLAdp->pNTPMem->iServerNext = (pLLAdp->pNTPMem->iServerNext + 1) % pLLAdp->pNTPMem->cNTPServers;
-                pLLAdp->pNTPMem->sntpState  = sntpResolveServerName;
+                // if we got part of a burst, use what we have
+                if(pNTPMem->cBurst > 0)
+                {
+                    SNTPv4ClockUpdate(pNTPMem);
+                    pNTPMem->sntpState  = sntpStartWait;
+                }
+
+                // otherwise try the next server
+                else
+                {
+                    pNTPMem->cAttempt++;
+                    pNTPMem->sntpState  = sntpResolveServerName;
+                }
+            }
+            break;
+
+        case sntpBurstWait:
+            if((SYSGetSecond() - pNTPMem->tStart) >= ntpBURSTSEC)
+            {
+                pNTPMem->sntpState  = sntpSendRequest;
             }
             break;
             
         case sntpStartWait:
             // initialize the wait and start over on attempts
-            pLLAdp->pNTPMem->cAttempt   = 0;
-            pLLAdp->pNTPMem->tStart = SYSGetSecond();
-            pLLAdp->pNTPMem->sntpState  = sntpWait;
+            pNTPMem->cAttempt   = 0;
+            pNTPMem->tStart = SYSGetSecond();
+            pNTPMem->sntpState  = sntpWait;
             break;
             
         case sntpWait:
             // wait
-            if((SYSGetSecond() - pLLAdp->pNTPMem->tStart) >= (pLLAdp->pNTPMem->tCorrection == 0 ? ntpACQUIRESEC : ntpPOLLSEC))
+            if((SYSGetSecond() - pNTPMem->tStart) >= (pNTPMem->fSynced ? pNTPMem->tPoll : ntpACQUIRESEC))
             {
                 // now try again
-                pLLAdp->pNTPMem->sntpState  = sntpResolveServerName;
+                pNTPMem->sntpState  = sntpResolveServerName;
             }
             break;
 
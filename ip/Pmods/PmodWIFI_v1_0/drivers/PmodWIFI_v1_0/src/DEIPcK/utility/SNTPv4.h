@@ -174,6 +174,16 @@ typedef struct NTPV4_T
 #define ntpACQUIRESEC   30      // the poll rate we use if we are still trying to acquire the initial time
 //#define ntpPOLLSEC      30    // the poll rate we use (every half hour)
 
+// clock filter and discipline
+#define ntpFILTERSIZE   8       // samples kept in the clock filter; RFC 5905 NSTAGE
+#define ntpBURSTCNT     4       // samples taken from a server on each poll
+#define ntpBURSTSEC     2       // seconds between samples in a burst
+#define ntpFIRSTPOLLSEC 64      // poll rate after the first sync, doubles on each update up to ntpPOLLSEC
+#define ntpSTEPUSEC     128000  // offsets larger than this step the clock, RFC 5905 STEPT (128 ms)
+#define ntpMAXFREQPPB   500000  // maximum frequency correction, RFC 5905 MAXFREQ (500 ppm)
+#define ntpFREQAVG      2       // after the first estimate, frequency updates are weighted by 1/2^ntpFREQAVG
+#define ntpUSECPERSEC   1000000
+
 #define ntpDefaultServerList {(uint8_t const * const) "0.us.pool.ntp.org", (uint8_t const * const) "1.us.pool.ntp.org", (uint8_t const * const) "2.us.pool.ntp.org", (uint8_t const * const) "3.us.pool.ntp.org"}
 
 #pragma pack(pop)
@@ -182,12 +192,45 @@ typedef enum
 {
     sntpUninitialized,
     sntpResolveServerName,
+    sntpSendRequest,
     sntpWaitResponse,
+    sntpBurstWait,
     sntpStartWait,
     sntpWait,
 } SNTPSTATE;
 
 
+// one round trip; all times in usec
+typedef struct NTPSAMPLE_T
+{
+    uint64_t                tLocal;         // local time the response arrived (T4), 0 if unused
+    int64_t                 offset;         // ((T2 - T1) + (T3 - T4)) / 2
+    int64_t                 delay;          // (T4 - T1) - (T3 - T2)
+} NTPSAMPLE;
+
+// NTP time = usNTPBase + elapsed + elapsed * freqPPB / 10^9
+// where elapsed is the local time since usLocalBase
+typedef struct NTPCLOCK_T
+{
+    uint64_t                usNTPBase;      // NTP time in usec at usLocalBase
+    uint64_t                usLocalBase;    // SYSGetMicroSecond64 when the clock was last set
+    uint64_t                usLastRead;     // last time handed out, keeps time from going backwards
+    uint64_t                tLastUpdate;    // local time of the sample last used to update the clock
+    int32_t                 freqPPB;        // frequency correction of the local clock
+    uint32_t                cUpdates;       // updates since the last step
+    int64_t                 offset;         // offset of the last sample used
+    int64_t                 delay;          // round trip delay of the last sample used
+} NTPCLOCK;
+
+typedef struct NTPCLOCKSTATS_T
+{
+    int32_t                 offset;         // usec; offset applied by the last update
+    uint32_t                delay;          // usec; round trip delay of the last update
+    int32_t                 freqPPB;        // current frequency correction
+    uint32_t                cUpdates;       // updates since the clock was last stepped
+    uint32_t                tSinceUpdate;   // seconds since the last update
+} NTPCLOCKSTATS;
+
 typedef struct NTPMEM_T
 {
     SNTPSTATE               sntpState;
@@ -195,10 +238,17 @@ typedef struct NTPMEM_T
     uint32_t                iServerNext;
     uint16_t                cNTPServers;
     uint16_t                cAttempt;
+    uint16_t                cBurst;
+    bool                    fSynced;
     uint32_t                tStart;
+    uint32_t                tPoll;
+    IPv4                    ipServer;
+    uint64_t                usT1;
     NTPV4                   ntpv4Request;
     NTPV4                   ntpv4Response;
-    uint32_t                tCorrection;
+    NTPCLOCK                clock;
+    uint32_t                iSample;
+    NTPSAMPLE               rgSamples[ntpFILTERSIZE];
     IPSTACK                 ntpIpStack;
     uint8_t                 rgbIpStackExBuff[IPStackEntrySize-sizeof(IPSTACK)];
     UDPSOCKET               socket;
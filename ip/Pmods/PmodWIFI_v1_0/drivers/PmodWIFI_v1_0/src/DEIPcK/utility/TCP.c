@@ -52,6 +52,8 @@
 
 static uint16_t     g_nextTCPEphemeralPort  = portEphemeralFirst;
 FFPT                g_ffptActiveTCPSockets = {NULL, NULL};
+TCPKEEPALIVE        g_tcpKeepAlive = {TCPKEEPALIVEIDLE, TCPKEEPALIVEINTVL, TCPKEEPALIVECNT};
+TCPSOCKETSTATS      g_tcpSocketStats;
 
 // the compiler will zero this, but it would be better if this were random and uninitialized
 static uint32_t     cSeqNbrFixup;
@@ -219,6 +221,7 @@ uint32_t ExTCPHeader(IPSTACK * pIpStack, bool fStartsInMachineOrder)
 void TCPInitSockets(void)
 {
     memset(&g_ffptActiveTCPSockets, 0, sizeof(g_ffptActiveTCPSockets));
+    memset(&g_tcpSocketStats, 0, sizeof(g_tcpSocketStats));
     g_nextTCPEphemeralPort      = portEphemeralFirst;
 //    cSeqNbrFixup                = 0;
 }
@@ -447,6 +450,11 @@ TCPSOCKET * TCPInitSocket(const LLADP * pLLAdp, TCPSOCKET * pSocketOpen, HPMGR h
     pSocketOpen->s.pLLAdp       = pLLAdp;
     memcpy(&pSocketOpen->s.ipRemote, pIPvXDest, ILIPSize(pLLAdp));
 
+    pSocketOpen->fKeepAlive     = TCPKEEPALIVEDEFAULT;
+    pSocketOpen->cKeepAlive     = 0;
+    pSocketOpen->fKeepAliveDropped = false;
+    pSocketOpen->tLastRcv       = SYSGetMilliSecond();
+
     // get a new seq nbr
     pSocketOpen->sndISS = TCPGetSeqNumber(pLLAdp);
 
@@ -535,6 +543,8 @@ void TCPResetSocket(TCPSOCKET *  pSocket)
 
     pSocket->fGotFin        = false;
     pSocket->fSocketOpen    = false;
+    pSocket->cKeepAlive     = 0;
+    pSocket->fKeepAliveDropped = false;
 
     // Jacobson rule
     pSocket->RTTsa      = RTTsaINIT;
@@ -597,6 +607,10 @@ void TCPProcess(IPSTACK *  pIpStack)
     // a match to an active socket
     if(pSocketExact != NULL)
     {
+        // anything from the remote says it is still there
+        pSocketExact->tLastRcv      = SYSGetMilliSecond();
+        pSocketExact->cKeepAlive    = 0;
+
         IPSUpdateARPEntry(pIpStack);
         memcpy(&pSocketExact->s.macRemote, &pIpStack->pFrameII->macSrc, sizeof(MACADDR));
         TCPStateMachine(pIpStack, pSocketExact, NULL);
@@ -648,6 +662,55 @@ uint32_t TCPAddRxDataToSocket(TCPSOCKET * pSocket, uint32_t seqNbr, uint8_t * pb
     return(0);
 }
 
+/*********************************************************************
+ * Function:        bool TCPReapIdleSocket(uint32_t tMinIdle, bool fHeapOnly)
+ *
+ * Input:           tMinIdle:   Only consider sockets that have not heard
+ *                              from the remote in this many ms
+ *                  fHeapOnly:  Only consider sockets that came out of the
+ *                              socket heap.
+ *
+ * Returns:         true if a socket was aborted
+ *
+ * Note:            Only orphans, sockets the user has closed, are
+ *                  candidates. A socket the user still holds can't be
+ *                  released out from under the user's handle, those are
+ *                  left to keep-alive. Of the candidates, the one idle
+ *                  the longest is aborted.
+ *
+ ********************************************************************/
+bool TCPReapIdleSocket(uint32_t tMinIdle, bool fHeapOnly)
+{
+    TCPSOCKET * pSocketCur  = NULL;
+    TCPSOCKET * pSocketReap = NULL;
+    uint32_t    tCur        = SYSGetMilliSecond();
+    uint32_t    tIdleMax    = 0;
+
+    while((pSocketCur = (TCPSOCKET*)FFNext(&g_ffptActiveTCPSockets, pSocketCur)) != NULL)
+    {
+        uint32_t tIdle = tCur - pSocketCur->tLastRcv;
+
+        if( !pSocketCur->fSocketOpen                            &&
+            pSocketCur->tcpState > tcpListen                    &&
+            tIdle >= tMinIdle                                   &&
+            (pSocketReap == NULL || tIdle > tIdleMax)           &&
+            (!fHeapOnly || IPSIsSocketFromHeap(pSocketCur))     )
+        {
+            pSocketReap = pSocketCur;
+            tIdleMax    = tIdle;
+        }
+    }
+
+    if(pSocketReap != NULL)
+    {
+        TCPAbort(pSocketReap);
+        g_tcpSocketStats.cReaped++;
+        return(true);
+    }
+
+    return(false);
+}
+
 void TCPPeriodicTasks(void)
 {
     TCPSOCKET * pSocketCur = (TCPSOCKET*)FFNext(&g_ffptActiveTCPSockets, NULL);
@@ -664,5 +727,12 @@ void TCPPeriodicTasks(void)
         TCPStateMachine(NULL, pSocketCur, NULL);
         pSocketCur = pSocketNext;
     }
+
+    // clean out orphans the remote has abandoned, and if
+    // we are running out of sockets, don't wait as long.
+    if(!TCPReapIdleSocket(TCPORPHANIDLE, false) && IPSIsSocketHeapLow())
+    {
+        TCPReapIdleSocket(TCPREAPMINIDLE, true);
+    }
 }
 
@@ -129,6 +129,12 @@ bool TCPIsConnected(HSOCKET hSocket, IPSTATUS * pStatus)
             {
                 status = IPStatusFromTCPState(pSocket->tcpState);
             }
+
+            // the remote went away without closing, say so
+            else if(pSocket->fKeepAliveDropped)
+            {
+                status = ipsKeepAliveTimeout;
+            }
             else
             {
                 status = IPErrorFromTCPState(pSocket->tcpState);
@@ -812,3 +818,190 @@ void TCPAbort(HSOCKET hSocket)
 
     return;
 }
+
+/*****************************************************************************
+  Function:
+	bool TCPSetKeepAlive(HSOCKET hSocket, bool fEnable)
+
+  Description:
+    Turns RFC 1122 keep-alive probes on or off for the socket. An idle
+    connection is probed, and if the remote does not answer, the connection
+    is dropped. Once any data left in the socket has been read,
+    TCPIsConnected returns false with a status of ipsKeepAliveTimeout.
+    This must be set after the socket is opened.
+
+  Parameters:
+	hSocket:        The socket
+        fEnable:        true to send keep-alives
+
+  Returns:
+        true if set, false if the socket is NULL
+
+  ***************************************************************************/
+bool TCPSetKeepAlive(HSOCKET hSocket, bool fEnable)
+{
+    TCPSOCKET * pSocket = (TCPSOCKET *) hSocket;
+
+    if(pSocket == NULL)
+    {
+        return(false);
+    }
+
+    pSocket->fKeepAlive = fEnable;
+    pSocket->cKeepAlive = 0;
+
+    return(true);
+}
+
+/*****************************************************************************
+  Function:
+	void TCPSetKeepAliveParams(uint32_t tIdle, uint32_t tInterval, uint32_t cProbes)
+
+  Description:
+    Sets the keep-alive timing for all sockets. RFC 1122 says the idle time
+    must default to no less than 2 hours; the defaults are TCPKEEPALIVEIDLE,
+    TCPKEEPALIVEINTVL and TCPKEEPALIVECNT
+
+  Parameters:
+	tIdle:          ms with nothing from the remote before the first probe
+        tInterval:      ms between unanswered probes
+        cProbes:        unanswered probes before the connection is dropped
+
+  Returns:
+        None
+
+  ***************************************************************************/
+void TCPSetKeepAliveParams(uint32_t tIdle, uint32_t tInterval, uint32_t cProbes)
+{
+    g_tcpKeepAlive.tIdle        = tIdle;
+    g_tcpKeepAlive.tInterval    = tInterval;
+    g_tcpKeepAlive.cProbes      = cProbes;
+}
+
+/*****************************************************************************
+  Function:
+	uint32_t TCPPoll(HSOCKET hSocket, IPSTATUS * pStatus)
+
+  Description:
+        Says what can be done on the socket right now without doing it, so a caller
+        with many sockets only needs to service the ones that are ready.
+        This only looks at the TCB and the page manager; nothing is copied.
+        Write readiness means there are free pages in the socket's page manager,
+        it does not say how many bytes will fit.
+
+  Parameters:
+	hSocket:        The socket to poll
+        pStatus:        A pointer to a status variable to recieve the state of the socket as a status
+
+  Returns:
+        The TCPPOLLREAD, TCPPOLLWRITE and TCPPOLLHUP bits that are true
+
+  ***************************************************************************/
+uint32_t TCPPoll(HSOCKET hSocket, IPSTATUS * pStatus)
+{
+    TCPSOCKET * pSocket = (TCPSOCKET *) hSocket;
+    uint32_t    events  = 0;
+
+    if(!TCPIsConnected(hSocket, pStatus))
+    {
+        return(TCPPOLLHUP);
+    }
+
+    if(TCPAvailable(hSocket, NULL) > 0)
+    {
+        events |= TCPPOLLREAD;
+    }
+
+    if(pSocket->fGotFin)
+    {
+        events |= TCPPOLLHUP;
+    }
+
+    if(TCPState(pSocket) == tcpEstablished && pSocket->hPMGR != NULL && PMGRMaxFree(pSocket->hPMGR) > 0)
+    {
+        events |= TCPPOLLWRITE;
+    }
+
+    return(events);
+}
+
+/*****************************************************************************
+  Function:
+	uint32_t TCPGetSocketPageCount(HSOCKET hSocket)
+
+  Description:
+    Returns how many page manager pages the socket is holding; this is
+    the Rx and Tx buffers and the indirect stream pointing to them.
+
+  Parameters:
+	hSocket:        The socket
+
+  Returns:
+        The number of pages held
+
+  ***************************************************************************/
+uint32_t TCPGetSocketPageCount(HSOCKET hSocket)
+{
+    TCPSOCKET * pSocket = (TCPSOCKET *) hSocket;
+    SMGR *      pSMGR   = NULL;
+    uint32_t    cb      = 0;
+    uint32_t    cPages  = 0;
+
+    if(pSocket == NULL || pSocket->smgrRxTxBuff.pPMGR == NULL)
+    {
+        return(0);
+    }
+
+    cb      = pSocket->cbRxSMGR + pSocket->cbTxSMGR;
+    pSMGR   = (SMGR*)alloca(cb);
+    cPages  = SMGRCntAlloc((HSMGR) &pSocket->smgrRxTxBuff);
+
+    if(pSMGR != NULL && SMGRRead((HSMGR) &pSocket->smgrRxTxBuff, 0, pSMGR, cb) == cb)
+    {
+        cPages += SMGRCntAlloc((HSMGR) pSMGR);
+        cPages += SMGRCntAlloc((HSMGR) (((uint8_t *) pSMGR) + pSocket->cbRxSMGR));
+    }
+
+    return(cPages);
+}
+
+/*****************************************************************************
+  Function:
+	void TCPGetSocketStats(TCPSOCKETSTATS * pStats)
+
+  Description:
+    Fills in the socket accounting; what is active right now, the pages
+    held by those sockets, and the keep-alive and reaper counts.
+
+  Parameters:
+	pStats:         Receives the stats
+
+  Returns:
+        None
+
+  ***************************************************************************/
+void TCPGetSocketStats(TCPSOCKETSTATS * pStats)
+{
+    TCPSOCKET * pSocket = NULL;
+
+    if(pStats == NULL)
+    {
+        return;
+    }
+
+    memcpy(pStats, &g_tcpSocketStats, sizeof(TCPSOCKETSTATS));
+    pStats->cActive     = 0;
+    pStats->cOrphans    = 0;
+    pStats->cPagesHeld  = 0;
+
+    while((pSocket = (TCPSOCKET*)FFNext(&g_ffptActiveTCPSockets, pSocket)) != NULL)
+    {
+        pStats->cActive++;
+        pStats->cPagesHeld += TCPGetSocketPageCount(pSocket);
+
+        if(!pSocket->fSocketOpen && pSocket->tcpState > tcpListen)
+        {
+            pStats->cOrphans++;
+        }
+    }
+}
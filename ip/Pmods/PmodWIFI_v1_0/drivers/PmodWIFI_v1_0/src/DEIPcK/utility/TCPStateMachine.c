@@ -1184,6 +1184,8 @@ static bool TCPCheckForReTransmit(IPSTACK *  pIpStack, TCPSOCKET * pSocket, uint
     {
         bool fSendAck = false;
         bool fSendRst = false;
+        bool fKeepAlive = false;
+        bool fNoKeepAlive = false;
 
         // these are stable states that the connection can be open forever
         // as we are current on their ACK. However, this can also keep the
@@ -1200,6 +1202,27 @@ static bool TCPCheckForReTransmit(IPSTACK *  pIpStack, TCPSOCKET * pSocket, uint
 //                {
 //                    fSendAck = true;
 //                }
+                // fall thru
+
+            // RFC 1122 4.2.3.6; if asked to, probe an idle connection
+            // so a remote that went away does not hold the socket forever.
+            // Only on a maintenance pass, anything coming in resets the probe count.
+            case tcpCloseWait:
+                if( pSocket->fKeepAlive     &&
+                    pIpStack == NULL        &&
+                    (tCur - pSocket->tLastRcv) >= (g_tcpKeepAlive.tIdle + (pSocket->cKeepAlive * g_tcpKeepAlive.tInterval)))
+                {
+                    if(pSocket->cKeepAlive >= g_tcpKeepAlive.cProbes)
+                    {
+                        fSendRst = true;
+                        fNoKeepAlive = true;
+                    }
+                    else
+                    {
+                        fKeepAlive = true;
+                    }
+                    fSendAck = true;
+                }
                 break;
 
             // if we send a FIN, and they ACKed our FIN
@@ -1224,12 +1247,31 @@ static bool TCPCheckForReTransmit(IPSTACK *  pIpStack, TCPSOCKET * pSocket, uint
             // reset if asked to reset
             pIpStack->pTCPHdr->fRst = fSendRst;
 
-            // Send an ACK
+            // Send an ACK, or the keep-alive probe, SEQ = SND.NXT - 1
             // here we have the a valid socket, but may not have a valid IpStack.
-            TCPTransmit(pIpStack, pSocket, 0, 0, true, tCur, pStatus);
+            TCPTransmit(pIpStack, pSocket, fKeepAlive ? -1 : 0, 0, true, tCur, pStatus);
+
+            if(fKeepAlive)
+            {
+                pSocket->cKeepAlive++;
+                g_tcpSocketStats.cKeepAliveProbes++;
+            }
+            else if(fNoKeepAlive)
+            {
+                g_tcpSocketStats.cKeepAliveDrops++;
+            }
+
+            // the remote stopped answering keep-alives, but the user still
+            // has the socket; let them read what is left and see it is gone.
+            if(fNoKeepAlive && pSocket->fSocketOpen)
+            {
+                pSocket->tcpState = tcpWaitUserClose;
+                pSocket->fKeepAliveDropped = true;
+                AssignStatusSafely(pStatus, ipsKeepAliveTimeout);
+            }
 
             // garbage collect the socket
-            if(fSendRst)
+            else if(fSendRst)
             {
                 // clean up the socket and release it.
                 TCPResetSocket(pSocket);
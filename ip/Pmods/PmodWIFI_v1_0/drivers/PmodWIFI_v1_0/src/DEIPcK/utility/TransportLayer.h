@@ -57,6 +57,20 @@
 #define TCPMSL              120000ul                    // RFC 793 Section 3.3, 2 MIN
 #define TCPMAXHALFCLOSE     5000ul                      // If we are in a half closed state waiting for the other side to ACK, this is the max time before sending a reset
 
+// RFC 1122 4.2.3.6 keep-alive; off by default per the RFC, see TCPSetKeepAlive
+#ifndef TCPKEEPALIVEDEFAULT
+#define TCPKEEPALIVEDEFAULT false
+#endif
+#define TCPKEEPALIVEIDLE    7200000ul                   // 2 hours idle before the first probe, the RFC minimum default
+#define TCPKEEPALIVEINTVL   75000ul                     // time between unanswered probes
+#define TCPKEEPALIVECNT     9                           // unanswered probes before the connection is dropped
+
+// Sockets the user has closed (orphans) are only held for the remote to finish
+// closing. If the remote has gone away, nothing will ever finish it, so reap them.
+#define TCPORPHANIDLE       TCPMSL                      // orphans hearing nothing for this long are aborted
+#define TCPREAPMINIDLE      5000ul                      // when the socket heap is low, orphans idle this long are reclaimed early
+#define cTCPREAPLOWWATER    1                           // the socket heap is low when this few free sockets are left
+
 #define cbTCPOptionSpace    16      // must be a mult of 4; this is how much space is reserved for option in a TCP Header for the pool space
 
 // this is based off of the 2 usec seq clock, NOT the ms clock.
@@ -149,6 +163,18 @@ typedef struct UDPHDR_T
     uint16_t checksum;
 } UDPHDR;
 
+// a fully formed, network order, header template for a connected UDP socket
+// the layout MUST match how IPSInitIpStack lays out the headers behind an IPSTACK
+typedef struct UDPTMPL_T
+{
+    ETHERNETII_FRAME    frameII;
+    IPv4HDR             ipv4Hdr;
+    UDPHDR              udpHdr;
+} UDPTMPL;
+
+// the IPv4 total length is 16 bits and includes the IP and UDP headers
+#define cbUDPMaxDatagram    (0xFFFF - sizeof(IPv4HDR) - sizeof(UDPHDR))
+
 #if 0
 // the pseudo header for calculating checksums
 // acutally not used, it is here for documentation reasons.
@@ -303,12 +329,15 @@ typedef struct TCPSOCKET_T
     // Round Trip and retry timers
     uint32_t                tLastSnd;       // the last time we sent any packet
     uint32_t                tLastAck;       // the last time we got an Ack from the remote, or watch an RTO (Retransmit TimeOut)
+    uint32_t                tLastRcv;       // the last time we got anything from the remote; keep-alive and the reaper go off this
 
     struct
     {
         unsigned            fSocketOpen         : 1;    // If true the socket is in use and has not been closed by the user
         unsigned            fGotFin             : 1;    // did I recieve the FIN or not
-        unsigned            pad                 : 6;    // padding
+        unsigned            fKeepAlive          : 1;    // send keep-alive probes when idle
+        unsigned            fKeepAliveDropped   : 1;    // the remote stopped answering keep-alives
+        unsigned            pad                 : 4;    // padding
     };
 
     uint8_t                 cZWndProbe;         // How many times we have retransmitted a zero window probe
@@ -317,7 +346,7 @@ typedef struct TCPSOCKET_T
     uint8_t                 cTxUntilPause;      // how many sends until we pause sending waiting for an ACK
     uint8_t                 cSameAck;           // count of identical ACK coming in
     uint8_t                 cRetransmit;        // How many times we have retransmitted
-    uint8_t                 pad2;               // padding
+    uint8_t                 cKeepAlive;         // How many keep-alive probes have gone unanswered
 
     int32_t                 RTTsa;          // See Jacobson's algorithms
     int32_t                 RTTsv;          // See Jacobson's algorithms
@@ -348,6 +377,28 @@ typedef struct TCPSOCKET_T
     };
 } TCPSOCKET;
 
+typedef struct TCPKEEPALIVE_T
+{
+    uint32_t    tIdle;          // ms idle before the first probe
+    uint32_t    tInterval;      // ms between unanswered probes
+    uint32_t    cProbes;        // unanswered probes before dropping the connection
+} TCPKEEPALIVE;
+
+// readiness bits returned by TCPPoll
+#define TCPPOLLREAD     0x01    // there are bytes to read
+#define TCPPOLLWRITE    0x02    // the connection is established and there are free pages to write into
+#define TCPPOLLHUP      0x04    // the remote closed its side, or the connection is gone
+
+typedef struct TCPSOCKETSTATS_T
+{
+    uint32_t    cActive;            // sockets on the active list
+    uint32_t    cOrphans;           // of those, how many the user has closed
+    uint32_t    cPagesHeld;         // socket buffer pages held by all active sockets
+    uint32_t    cKeepAliveProbes;   // keep-alive probes sent
+    uint32_t    cKeepAliveDrops;    // connections dropped for not answering keep-alives
+    uint32_t    cReaped;            // orphans aborted by the idle reaper
+} TCPSOCKETSTATS;
+
 #define SEQBOUNDARY             (0x80000000ul)  // Half way into out uint32_t linear range for a less than test.
 #define cRTTINVALID             8               // how many round trip measurments before the RTT is accurate, 8 is what J&K says
 #define cDupAckFastRetransmit   3               // you think this might be 2, but NetMon reports this on 3 dup acks
@@ -380,6 +431,18 @@ typedef struct UDPSOCKET_T
     // datagrams can not be more than 65K so the uint16_t is good
     uint16_t                cbNextDataGram;
 
+    // connected send fast path, see UDPSend
+    // the template is only good for the remote IP/port pair and local IP it was built with
+    // and is rebuilt at the ARP valid time so a changed remote MAC is picked up.
+    // NOTE: UDPSOCKETs are allocated out of the socket heap at sizeof(TCPSOCKET)
+    // so this structure must remain smaller than a TCPSOCKET.
+    bool                    fTmplValid;     // the template has been built and can be used
+    uint16_t                sumTmplIP;      // IP header checksum less cbTotal and ident
+    uint16_t                sumTmplUDP;     // UDP checksum of the psuedo header IPs, protocol and ports
+    uint32_t                portPairTmpl;   // the socket portPair the template was built with
+    uint32_t                tTmpl;          // the ms time the template was built
+    UDPTMPL                 tmpl;           // network order Frame, IP and UDP headers
+
     // this is really a stream to a stream
     // we copy the actual datagram stream structure on the stack to get to the data
     // this puts a non-fixed size datagram stream in the page memory.
@@ -415,6 +478,9 @@ uint32_t TCPGetSeqNumber(const LLADP * pLLAdp);
 void TCPResetSocket(TCPSOCKET *  pSocket);
 void TCPProcess(IPSTACK *  pIpStack);
 bool TCPScaleSndIndexes(TCPSOCKET * pSocket, SMGR *  pSMGR);
+bool TCPReapIdleSocket(uint32_t tMinIdle, bool fHeapOnly);
+extern TCPKEEPALIVE     g_tcpKeepAlive;
+extern TCPSOCKETSTATS   g_tcpSocketStats;
 
 #define TCPGetSocketEntrySize(_cbRxBuff, _cbTxBuff) ((sizeof(TCPSOCKET) + _cbRxBuff + _cbTxBuff + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1))
 #define TCPGetSocketPoolSize(_cSockets, _cbRxBuff, _cbTxBuff) ((uint32_t) ((_cSockets * TCPGetSocketEntrySize(_cbRxBuff, _cbTxBuff)) + sizeof(SOCKETPOOL)))
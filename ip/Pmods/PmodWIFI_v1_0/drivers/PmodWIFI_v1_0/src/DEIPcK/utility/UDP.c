@@ -51,6 +51,10 @@
 /************************************************************************/
 #include "deIP.h"
 
+// UDPSOCKETs are allocated out of the socket heap at sizeof(TCPSOCKET), see IPSGetSocketFromSocketHeap.
+// This fails to compile (negative array size) if the UDP send template grew the UDPSOCKET past that.
+typedef char UDPSOCKET_MUST_FIT_IN_A_TCPSOCKET[(sizeof(UDPSOCKET) <= sizeof(TCPSOCKET)) ? 1 : -1];
+
 static FFPT         g_ffptListeningUDPSockets = {NULL, NULL};
 static uint16_t     g_nextUDPEphemeralPort = portEphemeralFirst;
 
@@ -152,6 +156,10 @@ bool UDPRawSend(const LLADP * pLLAdp, IPSTACK *   pIpStack, const void * pIPvXDe
     {
         status = ipsUDPNullDatagram;
     }
+    else if(!ILIsIPv6(pLLAdp) && cbDatagram > cbUDPMaxDatagram)
+    {
+        status = ipsUDPDatagramTooBig;
+    }
     
     // sometimes we want to keep the actual buffer we passed in the IpStack
     // because we will later want to reuse it and don't want it copied and freed
@@ -273,6 +281,7 @@ HSOCKET UDPOpenWithSocket(const LLADP * pLLAdp, UDPSOCKET * pSocket, HPMGR hPMGR
     memcpy(&pSocket->s.ipRemote, pIPvXDest, ILIPSize(pLLAdp));
 
     pSocket->cbRxSMGR       = cb;
+    pSocket->fTmplValid     = false;
 
     // put on the listening list.
     FFInPacket(&g_ffptListeningUDPSockets, pSocket);
@@ -603,6 +612,173 @@ uint32_t UDPRead(HSOCKET hSocket, uint8_t * pbRead, uint16_t cbRead, IPSTATUS *
     return(cb);
 }
 
+/*****************************************************************************
+  Connected UDP send fast path
+
+  When a socket keeps sending to the same remote endpoint there is no reason
+  to rebuild the Frame, IP and UDP headers, look up the ARP entry and checksum
+  the psuedo header for every datagram. Instead we build a network order header
+  template once, and on each send copy it behind a raw IPSTACK and patch
+  only the lengths, the IP ident and the checksums.
+
+  The template is thrown away if our IP, the remote IP or the ports change,
+  and is rebuilt every UDPTmplLifeTime ms so we follow the ARP cache aging.
+  If the template can not be built (no IP yet, ARP pending, IPv6) we fall back
+  to the normal UDPRawSend path which will queue and wait for the ARP.
+  ***************************************************************************/
+#define UDPTmplLifeTime     ARPValidTime
+
+static bool UDPIsTmplValid(UDPSOCKET * pSocket)
+{
+    return( pSocket->fTmplValid                                                     &&
+            pSocket->portPairTmpl == pSocket->s.portPair                            &&
+            pSocket->tmpl.ipv4Hdr.ipDest.u32 == pSocket->s.ipRemote.ipv4.u32       &&
+            pSocket->tmpl.ipv4Hdr.ipSrc.u32 == pSocket->s.pLLAdp->ipMy.ipv4.u32     &&
+            (SYSGetMilliSecond() - pSocket->tTmpl) < UDPTmplLifeTime                );
+}
+
+static bool UDPBuildTmpl(UDPSOCKET * pSocket)
+{
+    const LLADP *   pLLAdp  = pSocket->s.pLLAdp;
+    UDPTMPL *       pTmpl   = &pSocket->tmpl;
+    uint16_t        sum     = ~(ippnUDP << 8);
+    IPv4            ipDest;
+
+    pSocket->fTmplValid = false;
+
+    // we only template IPv4, and we must have our IP to put in the headers
+    if(ILIsIPv6(pLLAdp) || !ILIsIPNetworkReady(pLLAdp, NULL))
+    {
+        return(false);
+    }
+
+    memset(pTmpl, 0, sizeof(UDPTMPL));
+    ipDest.u32 = pSocket->s.ipRemote.ipv4.u32;
+
+    // a broadcast IP goes to the broadcast MAC, same test as ILIsBroadcastIP
+    if(((pLLAdp->submask.ipv4.u32 | ipDest.u32) == IPv4BROADCAST.u32) && ipDest.u8[0] != 127)
+    {
+        memcpy(&pTmpl->frameII.macDest, &MACBROADCAST, sizeof(MACADDR));
+    }
+
+    // otherwise we need the MAC, this does not block, if the ARP is
+    // pending the caller will take the slow path and we will try again next send
+    else if(!LLARPLookup(pLLAdp, &ipDest, &pTmpl->frameII.macDest, ARPSendCount, NULL))
+    {
+        return(false);
+    }
+
+    // the frame
+    memcpy(&pTmpl->frameII.macSrc, &pLLAdp->pNwAdp->mac, sizeof(MACADDR));
+    pTmpl->frameII.etherType        = ethertypeIPv4;
+    ExEndian(&pTmpl->frameII.etherType, sizeof(ETHERTYPE));
+
+    // the IP header; cbTotal, ident and hdrChecksum are left at zero and patched on send
+    pTmpl->ipv4Hdr.version          = 4;
+    pTmpl->ipv4Hdr.cdwHeader        = sizeof(IPv4HDR) / 4;
+    pTmpl->ipv4Hdr.timeToLive       = TIME_TO_LIVE;
+    pTmpl->ipv4Hdr.protocol         = ippnUDP;
+    pTmpl->ipv4Hdr.ipSrc.u32        = pLLAdp->ipMy.ipv4.u32;
+    pTmpl->ipv4Hdr.ipDest.u32       = ipDest.u32;
+    pSocket->sumTmplIP              = CalculateChecksum(0, &pTmpl->ipv4Hdr, sizeof(IPv4HDR));
+
+    // the UDP header; cbHdrData and checksum are patched on send
+    pTmpl->udpHdr.portSrc           = pSocket->s.portLocal;
+    pTmpl->udpHdr.portDest          = pSocket->s.portRemote;
+    ExEndian(&pTmpl->udpHdr.portSrc, sizeof(pTmpl->udpHdr.portSrc));
+    ExEndian(&pTmpl->udpHdr.portDest, sizeof(pTmpl->udpHdr.portDest));
+
+    // the constant part of the checksum, see ExUDPHeader
+    sum = CalculateChecksum(sum, &pTmpl->ipv4Hdr.ipSrc, sizeof(IPv4));
+    sum = CalculateChecksum(sum, &pTmpl->ipv4Hdr.ipDest, sizeof(IPv4));
+    pSocket->sumTmplUDP             = CalculateChecksum(sum, &pTmpl->udpHdr.portPair, sizeof(pTmpl->udpHdr.portPair));
+
+    pSocket->portPairTmpl           = pSocket->s.portPair;
+    pSocket->tTmpl                  = SYSGetMilliSecond();
+    pSocket->fTmplValid             = true;
+
+    return(true);
+}
+
+static bool UDPTmplSend(UDPSOCKET * pSocket, const uint8_t * pbDatagram, uint16_t cbDatagram, IPSTATUS * pStatus)
+{
+    const LLADP *   pLLAdp      = pSocket->s.pLLAdp;
+    IPSTACK *       pIpStack    = NULL;
+    uint16_t        sum         = 0;
+
+    // we still must be on the network, the template does not know if we dropped the AP
+    if(!ILIsIPNetworkReady(pLLAdp, pStatus))
+    {
+        return(false);
+    }
+
+    // we do not need IPSInitIpStack to build up default headers,
+    // we are going to copy the template over them.
+    else if((pIpStack = (IPSTACK *) RRHPAlloc(pLLAdp->pNwAdp->hAdpHeap, IPStackEntrySize)) == NULL)
+    {
+        AssignStatusSafely(pStatus, ipsIpStackAllInUse);
+        return(false);
+    }
+    memset(pIpStack, 0, sizeof(IPSTACK));
+
+    pIpStack->pLLAdp                = pLLAdp;
+    pIpStack->fFreeIpStackToAdp     = true;
+
+    // the payload must be copied, see the comment in UDPRawSend
+    if(cbDatagram > 0)
+    {
+        if((pIpStack->pPayload = RRHPAlloc(pLLAdp->pNwAdp->hAdpHeap, cbDatagram)) == NULL)
+        {
+            IPSRelease(pIpStack);
+            AssignStatusSafely(pStatus, ispOutOfMemory);
+            return(false);
+        }
+        pIpStack->fFreePayloadToAdp = true;
+        pIpStack->cbPayload         = cbDatagram;
+        memcpy(pIpStack->pPayload, pbDatagram, cbDatagram);
+    }
+
+    // same header layout as IPSInitIpStack
+    pIpStack->pFrameII              = (ETHERNETII_FRAME *) (((uint8_t *) pIpStack) + sizeof(IPSTACK));
+    pIpStack->cbFrame               = sizeof(ETHERNETII_FRAME);
+    pIpStack->pIPv4Hdr              = &((UDPTMPL *) pIpStack->pFrameII)->ipv4Hdr;
+    pIpStack->cbIPHeader            = sizeof(IPv4HDR);
+    pIpStack->pUDPHdr               = &((UDPTMPL *) pIpStack->pFrameII)->udpHdr;
+    pIpStack->cbTranportHeader      = sizeof(UDPHDR);
+    pIpStack->etherType             = ethertypeIPv4;
+    pIpStack->protocol              = ippnUDP;
+    memcpy(pIpStack->pFrameII, &pSocket->tmpl, sizeof(UDPTMPL));
+
+    // patch the IP header, cbTotal and ident are adjacent in the header
+    pIpStack->pIPv4Hdr->cbTotal     = sizeof(IPv4HDR) + sizeof(UDPHDR) + cbDatagram;
+    pIpStack->pIPv4Hdr->ident       = ILGetNextIdent();
+    ExEndian(&pIpStack->pIPv4Hdr->cbTotal, sizeof(pIpStack->pIPv4Hdr->cbTotal));
+    ExEndian(&pIpStack->pIPv4Hdr->ident, sizeof(pIpStack->pIPv4Hdr->ident));
+    pIpStack->pIPv4Hdr->hdrChecksum = CalculateChecksum(pSocket->sumTmplIP, &pIpStack->pIPv4Hdr->cbTotal, sizeof(pIpStack->pIPv4Hdr->cbTotal) + sizeof(pIpStack->pIPv4Hdr->ident));
+
+    // patch the UDP header, the size is in the psuedo header as well, so do it twice
+    pIpStack->pUDPHdr->cbHdrData    = sizeof(UDPHDR) + cbDatagram;
+    ExEndian(&pIpStack->pUDPHdr->cbHdrData, sizeof(pIpStack->pUDPHdr->cbHdrData));
+    sum = CalculateChecksum(pSocket->sumTmplUDP, &pIpStack->pUDPHdr->cbHdrData, sizeof(pIpStack->pUDPHdr->cbHdrData));
+    sum = CalculateChecksum(sum, &pIpStack->pUDPHdr->cbHdrData, sizeof(pIpStack->pUDPHdr->cbHdrData));
+    sum = CalculateChecksum(sum, pIpStack->pPayload, pIpStack->cbPayload);
+
+    // RFC 768, if zero and outgoing, make all FFs
+    pIpStack->pUDPHdr->checksum     = (sum == 0) ? 0xFFFF : sum;
+
+    // already in network order and parsed, so LLSend will not touch the headers
+    pIpStack->headerOrder           = NETWORK_ORDER;
+    pIpStack->fFrameIsParsed        = true;
+
+    if(LLSend(pIpStack, pStatus))
+    {
+        return(true);
+    }
+
+    IPSRelease(pIpStack);
+    return(false);
+}
+
 bool UDPSend(HSOCKET hSocket, const uint8_t * pbDatagram, uint16_t cbDatagram, IPSTATUS * pStatus)
 {
     UDPSOCKET * pSocket     = (UDPSOCKET *) hSocket;
@@ -613,6 +789,26 @@ bool UDPSend(HSOCKET hSocket, const uint8_t * pbDatagram, uint16_t cbDatagram, I
         AssignStatusSafely(pStatus, ipsSocketNotResolved);
         return(false);
     }
+    else if(pbDatagram == NULL)
+    {
+        AssignStatusSafely(pStatus, ipsUDPNullDatagram);
+        return(false);
+    }
+
+    // cbTotal in the IPv4 header would wrap, the template path patches it without looking
+    else if(!ILIsIPv6(pSocket->s.pLLAdp) && cbDatagram > cbUDPMaxDatagram)
+    {
+        AssignStatusSafely(pStatus, ipsUDPDatagramTooBig);
+        return(false);
+    }
+
+    // the connected fast path
+    else if(UDPIsTmplValid(pSocket) || UDPBuildTmpl(pSocket))
+    {
+        return(UDPTmplSend(pSocket, pbDatagram, cbDatagram, pStatus));
+    }
+
+    // the general path, this will wait for ARP if needed
     else if((pIpStack = IPSGetIpStackFromAdaptor(pSocket->s.pLLAdp, ippnUDP, pStatus)) == NULL)
     {
         return(false);
@@ -140,6 +140,7 @@ extern "C" {
 #define ipsUDPCacheNotBigEnough             0x10070002
 #define ipsUDPUnableToCreateSocket          0x10070003
 #define ipsUDPNullDatagram                  0x10070004
+#define ipsUDPDatagramTooBig                0x10070005
 
 // 00080001 -> 0008EFFF; TCP Transport Layer status
 #define ipsUnexpectedSyn                    0x00080001
@@ -155,6 +156,7 @@ extern "C" {
 #define ipsConnectionOutofSyncSendRST       0x10080004
 #define ipsNoACKinMSLTime                   0x10080005
 #define ipsFailedToReadStreamBuffer         0x10080006
+#define ipsKeepAliveTimeout                 0x10080007
 
 // These are special in that discribe the tcpState as a status
 // the range is from 0008F000 -> 0008FFFF;
@@ -510,6 +512,7 @@ bool TCPIsConnected(HSOCKET hSocket, IPSTATUS * pStatus);
 bool TCPIsEstablished(HSOCKET hSocket, IPSTATUS * pStatus);
 IPSTATUS TCPStatus(HSOCKET hSocket);
 uint32_t TCPAvailable(HSOCKET hSocket, IPSTATUS * pStatus);
+uint32_t TCPPoll(HSOCKET hSocket, IPSTATUS * pStatus);
 uint32_t TCPPeekIdx(HSOCKET hSocket, uint32_t index, void * pv, uint32_t cb, IPSTATUS * pStatus);
 #define TCPPeek(_hSocket, _pv, _cb, _pStatus) TCPPeekIdx(_hSocket, 0, _pv, _cb, _pStatus)
 uint32_t TCPRead(HSOCKET hSocket, void * pv, uint32_t cb, IPSTATUS * pStatus);
@@ -518,12 +521,17 @@ void TCPDiscard(HSOCKET hSocket);
 void TCPFlush(HSOCKET hSocket);
 void TCPAbort(HSOCKET hSocket);
 void TCPAbortAllSockets(void);
+bool TCPSetKeepAlive(HSOCKET hSocket, bool fEnable);
+void TCPSetKeepAliveParams(uint32_t tIdle, uint32_t tInterval, uint32_t cProbes);
+uint32_t TCPGetSocketPageCount(HSOCKET hSocket);
+void TCPGetSocketStats(TCPSOCKETSTATS * pStats);
 
 // DHCP RFC1531, RFC 2131, RFC 1533
 #define DHCPMemSize (sizeof(DHCPMEM))
 bool DHCPInit(const LLADP * pLLAdp, void * rgbDHCPMem, uint32_t cbDHCPMem, HPMGR hPMGR, IPSTATUS * pStatus);
 bool DHCPTerminate(const LLADP * pLLAdp);
 bool DHCPIsDone(const LLADP * pLLAdp, IPSTATUS * pStatus);
+void DHCPSetLeaseStore(const DHCPLEASESTORE * pStore);
 
 // DNS stuff
 #define DNSMemorySize(_cdnsNS)  (sizeof(DNSMEM) + _cdnsNS * sizeof(IPv4or6))
@@ -542,6 +550,9 @@ bool DNSGetNS(const LLADP * pLLAdp, uint32_t index, void * pIPvX);
 bool SNTPv4Init(const LLADP * pLLAdp, void * rgbSNTPvMem, uint32_t cbSNTPv4Mem, HPMGR hPMGR, uint8_t const * const * const rgpServers, uint32_t cServers, IPSTATUS * pStatus);
 uint32_t SNTPv4GetNTPEpochTime(const LLADP * pLLAdp);
 uint32_t SNTPv4GetUNIXEpochTime(const LLADP * pLLAdp);
+uint64_t SNTPv4GetNTPEpochTimeUSec(const LLADP * pLLAdp);
+uint64_t SNTPv4GetUNIXEpochTimeUSec(const LLADP * pLLAdp);
+bool SNTPv4GetClockStats(const LLADP * pLLAdp, NTPCLOCKSTATS * pStats);
 bool SNTPv4Terminate(const LLADP * pLLAdp);
 
 #ifdef	__cplusplus
@@ -118,6 +118,7 @@ void SYSPeriodicTasks(void);
 uint32_t SYSGetSecond(void);
 uint32_t SYSGetMilliSecond(void);
 uint32_t SYSGetMicroSecond(void);
+uint64_t SYSGetMicroSecond64(void);
 uint32_t SYSGetSeqNumber(void);
 void setPmodWifiAddresses(u32 SPI_BASEADDRESS, u32 WFGPIO_BASEADDRESS, u32 WFCS_BASEADDRESS, u32 TIMER_BASEADDRESS);
 void setPmodWifiIntVector(u32 VectorNumber);
@@ -196,6 +196,16 @@ uint32_t SYSGetMicroSecond(void)
     return(((GetSysTick() - tSYSTicksLastSec) / SYSTICKSPERUSEC) + (tSYSSec * 1000000));
 }
 
+// a uint32_t microsecond count wraps every 71 minutes, too short
+// for a clock that is disciplined over hours. This one does not wrap
+// so long as SYSGetSecond is called before the system counter wraps
+uint64_t SYSGetMicroSecond64(void)
+{
+    uint32_t tSec = SYSGetSecond();
+
+    return((((uint64_t) tSec) * 1000000) + (((uint32_t) (GetSysTick() - tSYSTicksLastSec)) / SYSTICKSPERUSEC));
+}
+
 // RFC 1122 4.2.2.9 & RFC 793 3.3
 // 4 usec sequence number clock.
 uint32_t SYSGetSeqNumber(void)
@@ -117,6 +117,7 @@ void SYSPeriodicTasks(void);
 uint32_t SYSGetSecond(void);
 uint32_t SYSGetMilliSecond(void);
 uint32_t SYSGetMicroSecond(void);
+uint64_t SYSGetMicroSecond64(void);
 uint32_t SYSGetSeqNumber(void);
 
 
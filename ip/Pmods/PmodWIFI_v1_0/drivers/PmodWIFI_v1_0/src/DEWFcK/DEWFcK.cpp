@@ -356,3 +356,54 @@ bool DEWFcK::getScanInfo(int iNetwork, SCANINFO * pscanInfo)
     return(false);
 }
 
+/*****************************************************************************
+  Function:
+    bool DEWFcK::wfSetRoaming(bool fEnable)
+    bool DEWFcK::wfSetRoaming(const WFROAMCONFIG& roamConfig, IPSTATUS * pStatus)
+
+    Description:
+	    Turns background scanning and roaming between the APs of the
+        connected SSID on or off.
+
+  Parameters:
+    fEnable       - true to roam with the adaptor's default thresholds and intervals
+    roamConfig    - thresholds and scan intervals to use
+    pStatus       - A pointer to return the status
+
+  Returns:
+	True if the setting was taken.
+
+  Remarks:
+    A roam is a reassociation to the stronger AP with the connection profile
+    already on the adaptor; the IP configuration and open sockets are kept,
+    the link is only down for the reassociation. The default is not to roam,
+    a background scan takes the radio off channel briefly and received data
+    can be dropped while the adaptor waits on the scan.
+ ***************************************************************************/
+bool DEWFcK::wfSetRoaming(bool fEnable)
+{
+    WFROAMCONFIG    roamConfig = {fEnable, 0, 0, 0, 0};
+
+    if(!isWFInitialized(NULL) || _pNwWF->SetRoaming == NULL)
+    {
+        return(false);
+    }
+
+    // 0's take the adaptor defaults
+    return(_pNwWF->SetRoaming(&roamConfig, NULL));
+}
+
+bool DEWFcK::wfSetRoaming(const WFROAMCONFIG& roamConfig, IPSTATUS * pStatus)
+{
+    if(!isWFInitialized(pStatus))
+    {
+        return(false);
+    }
+    else if(_pNwWF->SetRoaming == NULL)
+    {
+        AssignStatusSafely(pStatus, ipsInvalidOperation);
+        return(false);
+    }
+
+    return(_pNwWF->SetRoaming(&roamConfig, pStatus));
+}
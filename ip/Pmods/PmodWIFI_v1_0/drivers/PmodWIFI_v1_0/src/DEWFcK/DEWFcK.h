@@ -124,6 +124,9 @@ public:
     }
 
     bool getScanInfo(int iNetwork, SCANINFO * pscanInfo);
+
+    bool wfSetRoaming(bool fEnable);
+    bool wfSetRoaming(const WFROAMCONFIG& roamConfig, IPSTATUS * pStatus);
 };
 
 #endif  // __cplusplus
@@ -54,6 +54,8 @@
 extern          WFMRFD         wfmrf24;
 static t_wpaKeyInfo wpaKeyInfoG;
 
+static void RoamReset(const uint8_t * szSsid);
+
 
 static bool IsInitialized(IPSTATUS * pStatus)
 {
@@ -117,67 +119,95 @@ static bool IsLinked(IPSTATUS * pStatus)
     return(status == ipsSuccess);
 }
 
+static bool SendNextIpStack(void);
+
 static bool Send(IPSTACK * pIpStack, IPSTATUS * pStatus)
 {
     AssignStatusSafely(pStatus, ipsSuccess);
     pIpStack->fOwnedByAdp = true;
     FFInPacket(&wfmrf24.priv.ffptWrite, pIpStack);
+
+    wfmrf24.priv.txStats.cQueued++;
+    if(wfmrf24.priv.txStats.cQueued > wfmrf24.priv.txStats.cQueuedMax)
+    {
+        wfmrf24.priv.txStats.cQueuedMax = wfmrf24.priv.txStats.cQueued;
+    }
+
+    // don't wait for the periodic task, push it to the MRF24WG now if there is room
+    if(wfmrf24.priv.initStatus == (InitMask | WF_INIT_SUCCESSFUL))
+    {
+        SendNextIpStack();
+    }
+
     return(true);
 }
 
+// Hand as many queued frames as the MRF24WG data tx pool will take, up to
+// MRF24G_TX_BURST.  Each transmitted frame stays in the pool until it is on
+// the air and the MRF24WG frees it, so several can be in flight at once.
+// There is no tx complete interrupt from the MRF24WG, so when the pool is full
+// we return and retry on the next Send() or periodic task; the retry is one
+// register read, not the 20ms spin in WF_TxPacketAllocate().
 static bool SendNextIpStack(void)
 {
+    uint32_t    cSent = 0;
 
-    // get the next stack to send if we have one
-    if(wfmrf24.priv.pIpStackBeingTx == NULL)
-    {
-        wfmrf24.priv.pIpStackBeingTx = (IPSTACK*)FFOutPacket(&wfmrf24.priv.ffptWrite);
-    }
-
-    // try and send it.
-    if(wfmrf24.priv.pIpStackBeingTx != NULL)
+    while(cSent < MRF24G_TX_BURST)
     {
-        IPSTACK *   pIPStack = wfmrf24.priv.pIpStackBeingTx;
-        int16_t     cbTotal = pIPStack->cbFrame + pIPStack->cbIPHeader + pIPStack->cbTranportHeader + pIPStack->cbPayload;
+        IPSTACK *   pIPStack;
+        int16_t     cbTotal;
 
-        if(WF_TxPacketAllocate(cbTotal))
+        // get the next stack to send if we have one
+        if(wfmrf24.priv.pIpStackBeingTx == NULL)
         {
-
-            // always have a frame, alwasy FRAME II (we don't support 802.3 outgoing frames; this is typical)
-            WF_TxPacketCopy((uint8_t *) pIPStack->pFrameII, pIPStack->cbFrame);
-
-            // IP Header
-            if(pIPStack->cbIPHeader > 0)
+            wfmrf24.priv.pIpStackBeingTx = (IPSTACK*)FFOutPacket(&wfmrf24.priv.ffptWrite);
+            if(wfmrf24.priv.pIpStackBeingTx == NULL)
             {
-                WF_TxPacketCopy((uint8_t *) pIPStack->pIPHeader, pIPStack->cbIPHeader);
+                break;
             }
+        }
 
-            // Transport Header (TCP/UDP)
-            if(pIPStack->cbTranportHeader > 0)
-            {
-                WF_TxPacketCopy((uint8_t *) pIPStack->pTransportHeader, pIPStack->cbTranportHeader);
-            }
+        pIPStack = wfmrf24.priv.pIpStackBeingTx;
+        cbTotal = pIPStack->cbFrame + pIPStack->cbIPHeader + pIPStack->cbTranportHeader + pIPStack->cbPayload;
 
-            // Payload / ARP / ICMP
-            if(pIPStack->cbPayload > 0)
-            {
-                WF_TxPacketCopy((uint8_t *) pIPStack->pPayload, pIPStack->cbPayload);
-            }
+        if(!WF_TxPacketTryAllocate(cbTotal))
+        {
+            wfmrf24.priv.txStats.cPoolFull++;
+            return(false);
+        }
 
-            // transmit
-            WF_TxPacketTransmit(cbTotal);
+        // always have a frame, alwasy FRAME II (we don't support 802.3 outgoing frames; this is typical)
+        WF_TxPacketCopy((uint8_t *) pIPStack->pFrameII, pIPStack->cbFrame);
 
-            // we sent it, clean up
-            pIPStack->fOwnedByAdp = false;
-            IPSRelease(pIPStack);
-            wfmrf24.priv.pIpStackBeingTx = NULL;
+        // IP Header
+        if(pIPStack->cbIPHeader > 0)
+        {
+            WF_TxPacketCopy((uint8_t *) pIPStack->pIPHeader, pIPStack->cbIPHeader);
+        }
 
-            return(true);
+        // Transport Header (TCP/UDP)
+        if(pIPStack->cbTranportHeader > 0)
+        {
+            WF_TxPacketCopy((uint8_t *) pIPStack->pTransportHeader, pIPStack->cbTranportHeader);
         }
-        else
+
+        // Payload / ARP / ICMP
+        if(pIPStack->cbPayload > 0)
         {
-            return(false);
+            WF_TxPacketCopy((uint8_t *) pIPStack->pPayload, pIPStack->cbPayload);
         }
+
+        // transmit
+        WF_TxPacketTransmit(cbTotal);
+
+        // we sent it, clean up
+        pIPStack->fOwnedByAdp = false;
+        IPSRelease(pIPStack);
+        wfmrf24.priv.pIpStackBeingTx = NULL;
+
+        wfmrf24.priv.txStats.cQueued--;
+        wfmrf24.priv.txStats.cSent++;
+        cSent++;
     }
 
     return(true);
@@ -231,6 +261,7 @@ static void Disconnect(void)
 
     // in all cases want to pretend at least the we disconnected.
     wfmrf24.priv.connectionStatus = ForceIPStatus((InitMask | WF_EVENT_INITIALIZATION));
+    wfmrf24.priv.roam.state = roamIdle;
 }
 
 static bool IsInitNotLinked(IPSTATUS * pStatus)
@@ -320,6 +351,9 @@ static bool Connect(SECURITY security, const uint8_t * szSsid, const void * pvPk
     }
     else if(IsInitNotLinked(pStatus))
     {
+        // undo anything roaming did to the profile for the last SSID
+        RoamReset(szSsid);
+
         // set the SSID
         WF_SsidSet((uint8_t *) szSsid, (uint8_t) strlen((char *) szSsid));
 
@@ -359,8 +393,9 @@ static bool Connect(SECURITY security, const uint8_t * szSsid, const void * pvPk
 #if defined(WF_USE_HOST_WPA_KEY_CALCULATION)
                 if(fPICKeyCalc)
                 {
-                    // this is very ugly as it holds the PIC
-                    // for 4 seconds
+                    // this holds the processor for the PBKDF2 the first
+                    // time a passphrase/SSID is seen, later connects hit
+                    // the PMK cache (see WF_PmkStoreSet)
                     WF_WpaConvPassphraseToKey(&wpa.keyInfo);    // not sure how to check for errors
                     wpa.wpaSecurityType--;                      // go to the KEY form of the type
                 }
@@ -412,11 +447,318 @@ static void WF_PowerStateGetT(uint8_t *p_powerState)
     WF_PowerStateGet(p_powerState);
 }
 
+/*****************************************************************************
+  Background scan and roaming
+
+  While linked, the SSID is scanned every config.msScanInterval, or every
+  config.msScanIntervalWeak once the current AP is below config.rssiRoam.
+  If a cached AP of the same SSID is at least config.rssiDelta stronger, the
+  MRF24WG is pointed at that BSSID and channel only and reconnected. The
+  connection profile keeps the security key, so no key calculation is done,
+  and nothing above the adaptor is told about it: the IP configuration, ARP
+  cache and sockets stay as they are, the link is only down for the
+  reassociation.
+
+  The MRF24WG only takes BSSID and channel list changes while it is not
+  connected, so the target is set after the disconnect of a roam and put
+  back to any AP on all channels the next time the link is down: a failed
+  roam, a connection that is lost for good, or Connect(). Until then the
+  firmware's own reconnect after a beacon loss only tries the AP roamed to.
+  Background scans are WF_SCAN_ALL, which ignores the connection profile, so
+  they see every AP of the SSID without touching it. Each scan is still a
+  handful of management messages, and received data can be dropped while
+  the adaptor waits on their responses.
+
+  The MRF24WG does not report which AP it associated to, so until the first
+  roam the current AP is taken to be the strongest one of the SSID, which is
+  the one the MRF24WG connection algorithm picks.
+*****************************************************************************/
+static const uint8_t bssidAny[WF_BSSID_LENGTH] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// only while the MRF24WG is not connected
+static void RoamUnpin(void)
+{
+    MRF24ROAM * pRoam   = &wfmrf24.priv.roam;
+    uint8_t     channelAll = 0;
+
+    if(pRoam->fNarrowed)
+    {
+        // 0 channels means all channels in the regional domain
+        WF_BssidSet((uint8_t *) bssidAny);
+        WF_ChannelListSet(&channelAll, 0);
+        pRoam->fNarrowed = false;
+    }
+}
+
+// put the connection profile back the way Connect() left it
+static void RoamReset(const uint8_t * szSsid)
+{
+    MRF24ROAM * pRoam = &wfmrf24.priv.roam;
+    uint32_t    cbSsid = (szSsid == NULL) ? 0 : strlen((const char *) szSsid);
+
+    RoamUnpin();
+
+    if(szSsid != NULL && (cbSsid != pRoam->ssidLen || memcmp(pRoam->ssid, szSsid, cbSsid) != 0))
+    {
+        memset(pRoam->rgBss, 0, sizeof(pRoam->rgBss));
+        pRoam->ssidLen = (cbSsid > WF_MAX_SSID_LENGTH) ? WF_MAX_SSID_LENGTH : cbSsid;
+        memcpy(pRoam->ssid, szSsid, pRoam->ssidLen);
+    }
+
+    pRoam->state    = roamIdle;
+    pRoam->fLinked  = false;
+    pRoam->fCurrent = false;
+}
+
+static void RoamCacheScan(uint32_t tNow)
+{
+    MRF24ROAM *     pRoam = &wfmrf24.priv.roam;
+    t_scanResult    scanResult;
+    int32_t         i;
+    uint32_t        j, iUse;
+
+    for(i = 0; i < wfmrf24.priv.cScanResults; i++)
+    {
+        WF_ScanResultGet(i, &scanResult);
+
+        if(scanResult.bssType != WF_NETWORK_TYPE_INFRASTRUCTURE || scanResult.ssidLen != pRoam->ssidLen || memcmp(scanResult.ssid, pRoam->ssid, pRoam->ssidLen) != 0)
+        {
+            continue;
+        }
+
+        // same AP, or an empty slot, or the one not seen the longest
+        iUse = 0;
+        for(j = 0; j < MRF24G_BSS_CACHE; j++)
+        {
+            if(memcmp(pRoam->rgBss[j].bssid, scanResult.bssid, WF_BSSID_LENGTH) == 0)
+            {
+                iUse = j;
+                break;
+            }
+            else if(pRoam->rgBss[j].channel == 0 || (pRoam->rgBss[iUse].channel != 0 && (int32_t) (pRoam->rgBss[j].tLastSeen - pRoam->rgBss[iUse].tLastSeen) < 0))
+            {
+                iUse = j;
+            }
+        }
+
+        memcpy(pRoam->rgBss[iUse].bssid, scanResult.bssid, WF_BSSID_LENGTH);
+        pRoam->rgBss[iUse].channel      = scanResult.channel;
+        pRoam->rgBss[iUse].rssi         = scanResult.rssi;
+        pRoam->rgBss[iUse].tLastSeen    = tNow;
+    }
+
+    // forget APs not seen for a long time
+    for(j = 0; j < MRF24G_BSS_CACHE; j++)
+    {
+        if(pRoam->rgBss[j].channel != 0 && (tNow - pRoam->rgBss[j].tLastSeen) >= MRF24G_BSS_MAXAGE)
+        {
+            memset(&pRoam->rgBss[j], 0, sizeof(MRF24BSS));
+        }
+    }
+}
+
+// returns the index of the AP to move to, or -1 to stay
+static int32_t RoamEvaluate(uint32_t tNow)
+{
+    MRF24ROAM * pRoam       = &wfmrf24.priv.roam;
+    int32_t     iCurrent    = -1;
+    int32_t     iBest       = -1;
+    uint8_t     rssiCurrent = 0;
+    uint32_t    i;
+
+    for(i = 0; i < MRF24G_BSS_CACHE; i++)
+    {
+        // only APs heard on this scan
+        if(pRoam->rgBss[i].channel == 0 || pRoam->rgBss[i].tLastSeen != tNow)
+        {
+            continue;
+        }
+        else if(pRoam->fCurrent && memcmp(pRoam->rgBss[i].bssid, pRoam->bssidCurrent, WF_BSSID_LENGTH) == 0)
+        {
+            iCurrent = i;
+        }
+        else if(iBest < 0 || pRoam->rgBss[i].rssi > pRoam->rgBss[iBest].rssi)
+        {
+            iBest = i;
+        }
+    }
+
+    // we don't know where the MRF24WG went, assume the strongest
+    if(!pRoam->fCurrent && iBest >= 0)
+    {
+        memcpy(pRoam->bssidCurrent, pRoam->rgBss[iBest].bssid, WF_BSSID_LENGTH);
+        pRoam->fCurrent = true;
+        return(RoamEvaluate(tNow));
+    }
+
+    if(iCurrent >= 0)
+    {
+        rssiCurrent = pRoam->rgBss[iCurrent].rssi;
+        pRoam->stats.channel = pRoam->rgBss[iCurrent].channel;
+    }
+    pRoam->stats.rssi = rssiCurrent;
+
+    if(rssiCurrent < pRoam->config.rssiRoam)
+    {
+        pRoam->tNextScan = tNow + pRoam->config.msScanIntervalWeak;
+
+        if(iBest >= 0 && pRoam->rgBss[iBest].rssi >= rssiCurrent + pRoam->config.rssiDelta)
+        {
+            return(iBest);
+        }
+    }
+    else
+    {
+        pRoam->tNextScan = tNow + pRoam->config.msScanInterval;
+    }
+
+    return(-1);
+}
+
+static void RoamTask(void)
+{
+    MRF24ROAM * pRoam   = &wfmrf24.priv.roam;
+    uint32_t    tNow    = SYSGetMilliSecond();
+    bool        fLinked = (wfmrf24.priv.connectionStatus == ipsSuccess);
+    int32_t     iTarget;
+
+    switch(pRoam->state)
+    {
+        case roamIdle:
+
+            // (re)linked, by us or the firmware; we may be on any AP now
+            if(fLinked && !pRoam->fLinked)
+            {
+                pRoam->fCurrent = false;
+                pRoam->tNextScan = tNow + MRF24G_ROAM_FIRSTSCAN;
+            }
+            pRoam->fLinked = fLinked;
+
+            // the link is gone for good and the MRF24WG is idle, drop the pin to the AP we roamed to
+            if(IsIPStatusAnError(wfmrf24.priv.connectionStatus) && !wfmrf24.priv.fMRFBusy)
+            {
+                RoamUnpin();
+            }
+
+            if(!pRoam->config.fEnable || !fLinked || wfmrf24.priv.fMRFBusy || (int32_t) (tNow - pRoam->tNextScan) < 0)
+            {
+                break;
+            }
+
+            // all channels, RoamCacheScan keeps only our SSID
+            wfmrf24.priv.fMRFBusy = true;
+            wfmrf24.priv.cScanResults = -1;
+            WF_Scan(WF_SCAN_ALL);
+            pRoam->state = roamScanning;
+            break;
+
+        case roamScanning:
+
+            if(wfmrf24.priv.fMRFBusy)
+            {
+                break;
+            }
+
+            pRoam->stats.cScans++;
+            pRoam->state = roamIdle;
+
+            // something other than the scan result came in (link lost?)
+            if(wfmrf24.priv.lastEventType != WF_EVENT_SCAN_RESULTS_READY)
+            {
+                pRoam->tNextScan = tNow + pRoam->config.msScanIntervalWeak;
+                break;
+            }
+
+            RoamCacheScan(tNow);
+            iTarget = RoamEvaluate(tNow);
+
+            if(iTarget >= 0 && wfmrf24.priv.connectionStatus == ipsSuccess)
+            {
+                // only the one AP on its one channel, so the connect does not scan;
+                // the MRF24WG takes these only once disconnected
+                pRoam->iTarget = (uint8_t) iTarget;
+                WF_Disconnect();
+                WF_BssidSet(pRoam->rgBss[iTarget].bssid);
+                WF_ChannelListSet(&pRoam->rgBss[iTarget].channel, 1);
+                pRoam->fNarrowed = true;
+
+                wfmrf24.priv.connectionStatus = ForceIPStatus(RoamMask);
+                wfmrf24.priv.fMRFBusy = true;
+                WF_Connect();
+                pRoam->state = roamReassociating;
+            }
+            break;
+
+        case roamReassociating:
+
+            if(wfmrf24.priv.fMRFBusy)
+            {
+                break;
+            }
+
+            if(wfmrf24.priv.connectionStatus == ipsSuccess)
+            {
+                memcpy(pRoam->bssidCurrent, pRoam->rgBss[pRoam->iTarget].bssid, WF_BSSID_LENGTH);
+                pRoam->fCurrent = true;
+                pRoam->fLinked  = true;
+                pRoam->stats.cRoams++;
+                pRoam->stats.channel = pRoam->rgBss[pRoam->iTarget].channel;
+                pRoam->stats.rssi = pRoam->rgBss[pRoam->iTarget].rssi;
+                pRoam->tNextScan = tNow + pRoam->config.msScanInterval;
+            }
+
+            // the new AP did not take us, connect the normal way to whatever is there
+            else
+            {
+                pRoam->stats.cRoamFails++;
+                memset(&pRoam->rgBss[pRoam->iTarget], 0, sizeof(MRF24BSS));
+                RoamUnpin();
+                wfmrf24.priv.fMRFBusy = true;
+                WF_Connect();
+            }
+
+            pRoam->state = roamIdle;
+            break;
+
+        default:
+            pRoam->state = roamIdle;
+            break;
+    }
+}
+
+// 0 for any of the thresholds or intervals takes the default
+static bool SetRoaming(const WFROAMCONFIG * pRoamConfig, IPSTATUS * pStatus)
+{
+    WFROAMCONFIG * pConfig = &wfmrf24.priv.roam.config;
+
+    if(pRoamConfig == NULL)
+    {
+        AssignStatusSafely(pStatus, ispInvalidArgument);
+        return(false);
+    }
+
+    *pConfig = *pRoamConfig;
+    if(pConfig->rssiRoam == 0)              pConfig->rssiRoam = MRF24G_ROAM_RSSI;
+    if(pConfig->rssiDelta == 0)             pConfig->rssiDelta = MRF24G_ROAM_DELTA;
+    if(pConfig->msScanInterval == 0)        pConfig->msScanInterval = MRF24G_ROAM_SCAN;
+    if(pConfig->msScanIntervalWeak == 0)    pConfig->msScanIntervalWeak = MRF24G_ROAM_SCAN_WEAK;
+
+    wfmrf24.priv.roam.tNextScan = SYSGetMilliSecond() + MRF24G_ROAM_FIRSTSCAN;
+
+    AssignStatusSafely(pStatus, ipsSuccess);
+    return(true);
+}
+
 static void MRF24PeriodicTasks(void)
 {
     IPSTATUS status;
     
     SendNextIpStack();
+
+    if(wfmrf24.priv.initStatus == (InitMask | WF_INIT_SUCCESSFUL))
+    {
+        RoamTask();
+    }
     
     // if initialization has started, we want to finish
     IsInitialized(&status);     // this will call WF_Task();)
@@ -450,6 +792,7 @@ WFMRFD wfmrf24 =
         StartScan,
         IsScanDone,
         GetScanResult,
+        SetRoaming,
     },
     {
         WF_ConnectionStateGet,
@@ -509,6 +852,7 @@ WFMRFD wfmrf24 =
         {NULL, NULL},
         {NULL, NULL},
         NULL,
+        {0, 0, 0, 0},
         ForceIPStatus((InitMask | WF_INIT_ERROR_SPI_NOT_CONNECTED)),
         ForceIPStatus((InitMask | WF_EVENT_INITIALIZATION)),
         -1,
@@ -532,6 +876,12 @@ const NWADP * GetMRF24GAdaptor(MACADDR *pUseThisMac, HRRHEAP hAdpHeap, IPSTATUS
     wfmrf24.priv.cScanResults = -1;
     wfmrf24.adpMRF24G.hAdpHeap = hAdpHeap;
     wfmrf24.priv.pIpStackBeingTx = NULL;
+    memset(&wfmrf24.priv.txStats, 0, sizeof(MRF24TXSTATS));
+    memset(&wfmrf24.priv.roam, 0, sizeof(MRF24ROAM));
+    wfmrf24.priv.roam.config.rssiRoam           = MRF24G_ROAM_RSSI;
+    wfmrf24.priv.roam.config.rssiDelta          = MRF24G_ROAM_DELTA;
+    wfmrf24.priv.roam.config.msScanInterval     = MRF24G_ROAM_SCAN;
+    wfmrf24.priv.roam.config.msScanIntervalWeak = MRF24G_ROAM_SCAN_WEAK;
     memset(&wfmrf24.priv.ffptRead, 0, sizeof(FFPT));
     memset(&wfmrf24.priv.ffptWrite, 0, sizeof(FFPT));
 
@@ -558,3 +908,19 @@ const WFMRF * GetMRF24GFunc(void)
 {
     return(&wfmrf24.funcMRF24G);
 }
+
+void MRF24GGetRoamStats(MRF24ROAMSTATS * pRoamStats)
+{
+    if(pRoamStats != NULL)
+    {
+        memcpy(pRoamStats, &wfmrf24.priv.roam.stats, sizeof(MRF24ROAMSTATS));
+    }
+}
+
+void MRF24GGetTxStats(MRF24TXSTATS * pTxStats)
+{
+    if(pTxStats != NULL)
+    {
+        memcpy(pTxStats, &wfmrf24.priv.txStats, sizeof(MRF24TXSTATS));
+    }
+}
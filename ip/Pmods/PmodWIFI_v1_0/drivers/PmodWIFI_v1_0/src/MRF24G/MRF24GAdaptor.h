@@ -73,6 +73,7 @@ extern "C" {
 #define WPSMask     0x00008000
 #define P2PMask     0x00009000
 #define WFDMask     0x0000A000
+#define RoamMask    0x0000B000      // connection status while reassociating to a new AP
 
 // 00000001 -> 0000FFFF; Adaptor status; specific to adaptor
 
@@ -82,6 +83,12 @@ extern "C" {
 
 #define WFNbrAllocFails 10
 
+// max frames handed to the MRF24WG per send pass; the rest wait in ffptWrite
+// for the data tx pool to drain
+#ifndef MRF24G_TX_BURST
+#define MRF24G_TX_BURST             8
+#endif
+
 #define MRF24G_NWA_VERSION          0x01000101
 #define MRF24G_NWA_MTU_RX_FRAME     1536
 #define MRF24G_NWA_MTU_RX           1500
@@ -178,17 +185,76 @@ typedef struct WFMRF_T
 
 } WFMRF;
 
+// background scan and roaming
+#define MRF24G_BSS_CACHE            8           // APs of the connected SSID remembered
+#define MRF24G_BSS_MAXAGE           300000ul    // ms an AP stays cached without being seen
+#define MRF24G_ROAM_FIRSTSCAN       5000ul      // ms after linking before the first background scan
+#define MRF24G_ROAM_RSSI            60          // WFROAMCONFIG defaults, scan rssi is 43 to 106
+#define MRF24G_ROAM_DELTA           8
+#define MRF24G_ROAM_SCAN            60000ul
+#define MRF24G_ROAM_SCAN_WEAK       10000ul
+
+typedef enum
+{
+    roamIdle = 0,
+    roamScanning,
+    roamReassociating,
+} ROAMSTATE;
+
+typedef struct MRF24BSS_T
+{
+    uint8_t     bssid[WF_BSSID_LENGTH];
+    uint8_t     channel;
+    uint8_t     rssi;
+    uint32_t    tLastSeen;      // ms
+} MRF24BSS;
+
+typedef struct MRF24ROAMSTATS_T
+{
+    uint32_t    cScans;         // background scans done
+    uint32_t    cRoams;         // successful moves to a stronger AP
+    uint32_t    cRoamFails;     // moves that failed and fell back to a normal connect
+    uint8_t     rssi;           // current AP at the last scan, 0 if not seen
+    uint8_t     channel;        // current AP channel, 0 if unknown
+} MRF24ROAMSTATS;
+
+typedef struct MRF24ROAM_T
+{
+    WFROAMCONFIG    config;
+    ROAMSTATE       state;
+    bool            fLinked;                // linked at the last periodic task
+    bool            fCurrent;               // bssid of the current AP is known
+    bool            fNarrowed;              // MRF24WG BSSID / channel list pinned to the AP roamed to
+    uint32_t        tNextScan;              // ms
+    uint8_t         ssid[WF_MAX_SSID_LENGTH];
+    uint8_t         ssidLen;
+    uint8_t         bssidCurrent[WF_BSSID_LENGTH];
+    uint8_t         iTarget;                // rgBss index being reassociated to
+    MRF24BSS        rgBss[MRF24G_BSS_CACHE];
+    MRF24ROAMSTATS  stats;
+} MRF24ROAM;
+
+typedef struct MRF24TXSTATS_T
+{
+    uint16_t    cQueued;        // frames waiting to go to the MRF24WG, including one being sent
+    uint16_t    cQueuedMax;     // high water mark of cQueued
+    uint32_t    cSent;          // frames handed to the MRF24WG
+    uint32_t    cPoolFull;      // send passes that stopped because the tx pool was full
+} MRF24TXSTATS;
+
 typedef struct WFMRFP_T
 {
     FFPT                    ffptRead;
     FFPT                    ffptWrite;
     IPSTACK *               pIpStackBeingTx;
+    MRF24TXSTATS            txStats;
     IPSTATUS    volatile    initStatus;
     IPSTATUS    volatile    connectionStatus;
     int32_t     volatile    cScanResults;
     bool        volatile    fMRFBusy;      // scan, key gen, connect
     uint8_t     volatile    lastEventType;
     uint32_t    volatile    lastEventData;
+    MRF24ROAM               roam;
 } WFMRFP;
 
 typedef struct WFMRFD_T
@@ -203,6 +269,8 @@ void __attribute__((interrupt(),nomips16)) _WFInterrupt(void);
 const NWADP * GetMRF24GAdaptor(MACADDR *pUseThisMac, HRRHEAP hAdpHeap, IPSTATUS * pStatus);
 const NWWF *  GetMRF24WF(void);
 const WFMRF * GetMRF24GFunc(void);
+void MRF24GGetTxStats(MRF24TXSTATS * pTxStats);
+void MRF24GGetRoamStats(MRF24ROAMSTATS * pRoamStats);
 
 #ifdef	__cplusplus
 }
@@ -48,10 +48,20 @@
 #include "xspi.h"
 
 
+// Depth of the AXI SPI TX/RX FIFOs (C_FIFO_DEPTH, 16 or 256).  The burst
+// engine keeps at most this many bytes in flight so the RX FIFO never overruns.
+#ifndef WF_SPI_FIFO_DEPTH
+#define WF_SPI_FIFO_DEPTH   16
+#endif
+
 extern u32 WF_CS_BASEADDRESS;
 extern u32 WF_SPI_BASEADDRESS;
 XSpi WF_Spi;
 
+static void SpiBurst(const uint8_t *p_cmd, uint16_t cmdLength,
+                     const uint8_t *p_txBuf, uint16_t txLength,
+                     uint8_t *p_rxBuf, uint16_t rxLength);
+
 XSpi_Config WFSPIConfig =
 {
 	0,
@@ -142,6 +152,13 @@ void WF_SpiInit(void)
 	XSpi_SetSlaveSelect(&WF_Spi, 1);
 	XSpi_Start(&WF_Spi);
 	XSpi_IntrGlobalDisable(&WF_Spi);
+
+	// SpiBurst() drives the FIFOs directly and never touches the slave
+	// select register, so set it once here; CS itself is the GPIO line.
+	XSpi_WriteReg(WF_SPI_BASEADDRESS, XSP_SSR_OFFSET, WF_Spi.SlaveSelectReg);
+	XSpi_WriteReg(WF_SPI_BASEADDRESS, XSP_CR_OFFSET,
+			XSpi_ReadReg(WF_SPI_BASEADDRESS, XSP_CR_OFFSET) |
+			XSP_CR_TRANS_INHIBIT_MASK | XSP_CR_TXFIFO_RESET_MASK | XSP_CR_RXFIFO_RESET_MASK);
 }
 
 /*****************************************************************************
@@ -226,46 +243,128 @@ void WF_SpiDisableChipSelect(void)
   Remarks:
     Should not be called directly from application code.
 *****************************************************************************/
-void WF_SpiTxRx(const uint8_t *p_txBuf, uint16_t txLength, uint8_t *p_rxBuf,uint16_t rxLength){
-    uint16_t byteCount;
+void WF_SpiTxRx(const uint8_t *p_txBuf, uint16_t txLength, uint8_t *p_rxBuf, uint16_t rxLength)
+{
     // TODO: need a check either here or somewhere else to flag an error if
     //       MRF24WG is in hibernate mode.  Another stub function to check if
     //       in hibernate mode?
-    
-    // total number of bytes to clock out is whichever is larger, txLength or rxLength
-    byteCount = (txLength >= rxLength)?txLength:rxLength;
-
-    XSpi_Transfer(&WF_Spi, (uint8_t*)p_txBuf, p_rxBuf, (u32)byteCount);
-    // for each byte being clocked 
-//    for (i = 0; i < byteCount; ++i)
-//    {
-//        /* if still have bytes to transmit from tx buffer */
-//        if (txLength > 0)
-//        {
-//            WIFI_SPIBUF = *p_txBuf++;
-//            --txLength;
-//        }
-//        /* else done writing bytes out from tx buffer */
-//        else
-//        {
-//            WIFI_SPIBUF = 0xff;  /* clock out a "don't care" byte */
-//        }
-//
-//        // wait until byte in SPI Tx buffer has fully clocked and the incoming
-//        // byte is fully received
-//        while (!WIFI_SPISTATbits.SPITBE || !WIFI_SPISTATbits.SPIRBF);
-//
-//        // if still have bytes to read into rx buffer
-//        if (rxLength > 0)
-//        {
-//            *p_rxBuf++ = WIFI_SPIBUF;
-//            --rxLength;
-//        }
-//        // else done reading bytes into rx buffer
-//        else
-//        {
-//            rxTrash = WIFI_SPIBUF;  // read and throw away byte
-//            (void) rxTrash;  // prevent unused warning
-//        }
-//    }  // end for loop
+    SpiBurst(NULL, 0, p_txBuf, txLength, p_rxBuf, rxLength);
+}
+
+/*****************************************************************************
+  Function:
+    void WF_SpiCmdTxRx(uint8_t cmd, const uint8_t *p_txBuf, uint16_t txLength,
+                       uint8_t *p_rxBuf, uint16_t rxLength);
+
+  Summary:
+    Sends a command byte followed by a data transfer in one SPI burst.
+
+  Description:
+    Same as WF_SpiTxRx(&cmd, 1, NULL, 0) followed by
+    WF_SpiTxRx(p_txBuf, txLength, p_rxBuf, rxLength), but the command and
+    data are streamed through the FIFO back to back.  Used for raw window
+    reads and writes so the command byte does not cost a FIFO round trip.
+
+ Parameters:
+    cmd      -- command (register id) byte, the byte clocked in is discarded
+    p_txBuf  -- pointer to the transmit buffer, may be NULL if txLength is 0
+    txLength -- number of bytes to be transmitted from p_txBuf
+    p_rxBuf  -- pointer to receive buffer, may be NULL if rxLength is 0
+    rxLength -- number of bytes to read and copy into p_rxBuf
+
+  Returns:
+    None
+
+  Remarks:
+    Should not be called directly from application code.
+*****************************************************************************/
+void WF_SpiCmdTxRx(uint8_t cmd, const uint8_t *p_txBuf, uint16_t txLength, uint8_t *p_rxBuf, uint16_t rxLength)
+{
+    SpiBurst(&cmd, 1, p_txBuf, txLength, p_rxBuf, rxLength);
+}
+
+/*****************************************************************************
+  Function:
+    static void SpiBurst(const uint8_t *p_cmd, uint16_t cmdLength,
+                         const uint8_t *p_txBuf, uint16_t txLength,
+                         uint8_t *p_rxBuf, uint16_t rxLength);
+
+  Summary:
+    FIFO burst transfer on the AXI SPI controller.
+
+  Description:
+    Clocks out cmdLength bytes of p_cmd, then max(txLength, rxLength) data
+    bytes.  Data past txLength is sent as 0xFF, and only rxLength bytes
+    clocked in after the command are kept.
+
+    The TX FIFO is primed with the shifter inhibited so the first bytes go
+    out back to back, then refilled as soon as RX bytes are drained, keeping
+    up to WF_SPI_FIFO_DEPTH bytes in flight.  This replaces XSpi_Transfer,
+    which re-validates and reprograms the controller on every call and writes
+    the full byte count into the receive buffer whatever rxLength is.
+
+    The refill is polled rather than interrupt driven: the register access
+    functions are called from the MRF24WG external interrupt handler, and the
+    shifter at SPI clock rates drains a FIFO in far less time than an
+    interrupt round trip.
+*****************************************************************************/
+static void SpiBurst(const uint8_t *p_cmd, uint16_t cmdLength,
+                     const uint8_t *p_txBuf, uint16_t txLength,
+                     uint8_t *p_rxBuf, uint16_t rxLength)
+{
+    u32      baseAddr   = WF_Spi.BaseAddr;
+    u32      cr         = XSpi_ReadReg(baseAddr, XSP_CR_OFFSET) | XSP_CR_TRANS_INHIBIT_MASK;
+    uint32_t byteCount  = cmdLength + ((txLength >= rxLength) ? txLength : rxLength);
+    uint32_t txCount    = 0;
+    uint32_t rxCount    = 0;
+    bool     fStarted   = false;
+    uint8_t  b;
+
+    if (p_rxBuf == NULL)
+    {
+        rxLength = 0;
+    }
+
+    XSpi_WriteReg(baseAddr, XSP_CR_OFFSET, cr);
+
+    while (rxCount < byteCount)
+    {
+        // top up the TX FIFO
+        while ((txCount < byteCount) && ((txCount - rxCount) < WF_SPI_FIFO_DEPTH))
+        {
+            if (txCount < cmdLength)
+            {
+                b = p_cmd[txCount];
+            }
+            else if ((txCount - cmdLength) < txLength)
+            {
+                b = p_txBuf[txCount - cmdLength];
+            }
+            else
+            {
+                b = 0xff;   /* clock out a "don't care" byte */
+            }
+            XSpi_WriteReg(baseAddr, XSP_DTR_OFFSET, b);
+            txCount++;
+        }
+
+        if (!fStarted)
+        {
+            XSpi_WriteReg(baseAddr, XSP_CR_OFFSET, cr & ~XSP_CR_TRANS_INHIBIT_MASK);
+            fStarted = true;
+        }
+
+        // drain what has come in
+        while (rxCount < txCount && !(XSpi_ReadReg(baseAddr, XSP_SR_OFFSET) & XSP_SR_RX_EMPTY_MASK))
+        {
+            b = (uint8_t) XSpi_ReadReg(baseAddr, XSP_DRR_OFFSET);
+            if ((rxCount >= cmdLength) && ((rxCount - cmdLength) < rxLength))
+            {
+                p_rxBuf[rxCount - cmdLength] = b;
+            }
+            rxCount++;
+        }
+    }
+
+    XSpi_WriteReg(baseAddr, XSP_CR_OFFSET, cr);
 }
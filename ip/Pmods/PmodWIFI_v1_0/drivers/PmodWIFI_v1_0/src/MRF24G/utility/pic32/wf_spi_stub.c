@@ -246,3 +246,24 @@ void WF_SpiTxRx(const uint8_t *p_txBuf,
         }
     }  // end for loop 
 }
+
+/*****************************************************************************
+  Function:
+    void WF_SpiCmdTxRx(uint8_t cmd, const uint8_t *p_txBuf, uint16_t txLength,
+                       uint8_t *p_rxBuf, uint16_t rxLength);
+
+  Summary:
+    Sends a command byte followed by a data transfer.
+
+  Description:
+    The PIC32 SPI is driven a byte at a time, so this is simply the command
+    byte followed by WF_SpiTxRx().
+
+  Remarks:
+    Should not be called directly from application code.
+*****************************************************************************/
+void WF_SpiCmdTxRx(uint8_t cmd, const uint8_t *p_txBuf, uint16_t txLength, uint8_t *p_rxBuf, uint16_t rxLength)
+{
+    WF_SpiTxRx(&cmd, 1, NULL, 0);
+    WF_SpiTxRx(p_txBuf, txLength, p_rxBuf, rxLength);
+}
@@ -59,6 +59,7 @@ void WF_SpiInit(void);
 void WF_SpiEnableChipSelect(void);
 void WF_SpiDisableChipSelect(void);
 void WF_SpiTxRx(const uint8_t *p_txBuf, uint16_t txLength, uint8_t *p_rxBuf, uint16_t rxLength);
+void WF_SpiCmdTxRx(uint8_t cmd, const uint8_t *p_txBuf, uint16_t txLength, uint8_t *p_rxBuf, uint16_t rxLength);
 
 //== MRF24WG External Interrupt Stub Function Protypes =========================
 //   Located in wf_eint_stub.c
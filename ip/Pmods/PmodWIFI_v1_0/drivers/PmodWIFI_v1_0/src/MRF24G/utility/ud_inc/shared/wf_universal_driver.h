@@ -346,6 +346,31 @@ typedef struct wpaContext
     t_wpaKeyInfo keyInfo;
 } t_wpaContext;
 
+#if defined(WF_USE_HOST_WPA_KEY_CALCULATION)
+#define WF_PMK_CACHE_SIG    0x504D4B32      // 'PMK2', marks a valid t_pmkCacheEntry
+
+// A passphrase to binary key (PMK) result.  The passphrase itself is not
+// kept, only a SHA1 of passphrase and SSID so a changed passphrase misses.
+typedef struct pmkCacheEntry
+{
+    uint32_t sig;                           // WF_PMK_CACHE_SIG if the entry is valid
+    uint32_t seq;                           // save order; the lowest is replaced first
+    uint8_t  ssidLen;                       // number of bytes in SSID
+    uint8_t  ssid[WF_MAX_SSID_LENGTH];      // ssid
+    uint8_t  passHash[20];                  // SHA1(passphrase || ssid)
+    uint8_t  pmk[WF_WPA_KEY_LENGTH];        // 32-byte binary key
+} t_pmkCacheEntry;
+
+// See WF_PmkStoreSet(); optional persistent (flash/EEPROM) store for
+// t_pmkCacheEntry, so a reboot does not redo the 4096 iteration PBKDF2.
+typedef struct pmkStore
+{
+    bool (*load)(uint8_t index, t_pmkCacheEntry *p_entry);       // false if slot empty or unreadable
+    bool (*save)(uint8_t index, const t_pmkCacheEntry *p_entry); // false on write error
+    uint8_t numEntries;                                           // number of slots in the store
+} t_pmkStore;
+#endif /* WF_USE_HOST_WPA_KEY_CALCULATION */
+
 #if defined(WF_USE_WPS_SECURITY)
 // See WF_SetSecurityWps()
 typedef struct wpsContext
@@ -545,6 +570,7 @@ void WF_SecurityWpaSet(t_wpaContext *p_context);
 #if defined(WF_USE_HOST_WPA_KEY_CALCULATION)
     void WF_WpaConvPassphraseToKey(t_wpaKeyInfo *p_keyInfo);
     void WF_WpsKeyGenerate(void);
+    void WF_PmkStoreSet(const t_pmkStore *p_store);
 #endif /* WF_USE_HOST_WPA_KEY_CALCULATION */
 
 // WiFi Connection functions
@@ -588,6 +614,7 @@ void WF_MacStatsGet(t_macStats *p_stats);
 // data tx functions
 //------------------
 bool WF_TxPacketAllocate(uint16_t bytesNeeded);
+bool WF_TxPacketTryAllocate(uint16_t bytesNeeded);
 void WF_TxPacketCopy(uint8_t *p_buf, uint16_t length);
 void WF_TxPacketTransmit(uint16_t packetSize);
 
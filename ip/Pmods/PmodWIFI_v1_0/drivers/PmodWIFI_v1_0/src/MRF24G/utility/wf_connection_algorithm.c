@@ -82,6 +82,13 @@ static void LowLevel_CAGetElement(uint8_t elementId,
 // did not want to create header file for one function
 extern void pbkdf2_sha1(const char *passphrase, const char *ssid, uint16_t ssid_len,
                         uint16_t iterations, uint8_t *buf, uint16_t buflen);
+#if defined(WF_USE_HOST_WPA_KEY_CALCULATION)
+extern void sha1_vector(size_t num_elem, const uint8_t *addr[], const size_t *len, uint8_t *mac);
+
+// last conversion kept in RAM, and an optional persistent store behind it
+static t_pmkCacheEntry  g_pmkCacheRam;
+static const t_pmkStore *g_p_pmkStore = NULL;
+#endif
 
 
 /*******************************************************************************
@@ -489,9 +496,140 @@ void WF_ConnectionStateGet(uint8_t *p_state)
     Called needs to be aware that two of the input fields will be overwritten
     with the result of the conversion.
   *****************************************************************************/
+static void PmkPassHash(const t_wpaKeyInfo *p_keyInfo, uint8_t *p_hash)
+{
+    const uint8_t *addr[2];
+    size_t len[2];
+
+    addr[0] = p_keyInfo->key;
+    len[0]  = p_keyInfo->keyLength;
+    addr[1] = p_keyInfo->ssid;
+    len[1]  = p_keyInfo->ssidLen;
+    sha1_vector(2, addr, len, p_hash);
+}
+
+static bool PmkMatch(const t_pmkCacheEntry *p_entry, const t_wpaKeyInfo *p_keyInfo, const uint8_t *p_hash)
+{
+    return (p_entry->sig == WF_PMK_CACHE_SIG)                      &&
+           (p_entry->ssidLen == p_keyInfo->ssidLen)                &&
+           (memcmp(p_entry->ssid, p_keyInfo->ssid, p_keyInfo->ssidLen) == 0) &&
+           (memcmp(p_entry->passHash, p_hash, sizeof(p_entry->passHash)) == 0);
+}
+
+static bool PmkCacheLookup(const t_wpaKeyInfo *p_keyInfo, const uint8_t *p_hash, uint8_t *p_pmk)
+{
+    t_pmkCacheEntry entry;
+    uint8_t i;
+
+    if (PmkMatch(&g_pmkCacheRam, p_keyInfo, p_hash))
+    {
+        memcpy(p_pmk, g_pmkCacheRam.pmk, WF_WPA_KEY_LENGTH);
+        return true;
+    }
+
+    if ((g_p_pmkStore == NULL) || (g_p_pmkStore->load == NULL))
+    {
+        return false;
+    }
+
+    for (i = 0; i < g_p_pmkStore->numEntries; ++i)
+    {
+        if (g_p_pmkStore->load(i, &entry) && PmkMatch(&entry, p_keyInfo, p_hash))
+        {
+            memcpy(p_pmk, entry.pmk, WF_WPA_KEY_LENGTH);
+            g_pmkCacheRam = entry;
+            memset(&entry, 0, sizeof(entry));
+            return true;
+        }
+    }
+    memset(&entry, 0, sizeof(entry));
+    return false;
+}
+
+static void PmkCacheSave(void)
+{
+    t_pmkCacheEntry entry;
+    uint8_t i;
+    uint8_t slotSame   = 0xFF;
+    uint8_t slotEmpty  = 0xFF;
+    uint8_t slotOldest = 0;
+    uint32_t seqOldest = 0xFFFFFFFF;
+    uint32_t seqNewest = 0;
+
+    if ((g_p_pmkStore == NULL) || (g_p_pmkStore->save == NULL) || (g_p_pmkStore->numEntries == 0))
+    {
+        return;
+    }
+
+    // replace this SSID's old entry if there is one, else the first empty
+    // slot, else the entry saved longest ago.  The age is kept in the store
+    // itself so it survives a reset.
+    if (g_p_pmkStore->load != NULL)
+    {
+        for (i = 0; i < g_p_pmkStore->numEntries; ++i)
+        {
+            if (!g_p_pmkStore->load(i, &entry) || (entry.sig != WF_PMK_CACHE_SIG))
+            {
+                if (slotEmpty == 0xFF)
+                {
+                    slotEmpty = i;
+                }
+                continue;
+            }
+
+            if (entry.seq >= seqNewest)
+            {
+                seqNewest = entry.seq;
+            }
+            if (entry.seq < seqOldest)
+            {
+                seqOldest  = entry.seq;
+                slotOldest = i;
+            }
+            if ((slotSame == 0xFF) &&
+                (entry.ssidLen == g_pmkCacheRam.ssidLen) &&
+                (memcmp(entry.ssid, g_pmkCacheRam.ssid, entry.ssidLen) == 0))
+            {
+                slotSame = i;
+            }
+        }
+        memset(&entry, 0, sizeof(entry));
+    }
+
+    g_pmkCacheRam.seq = seqNewest + 1;
+    g_p_pmkStore->save((slotSame != 0xFF) ? slotSame : (slotEmpty != 0xFF) ? slotEmpty : slotOldest, &g_pmkCacheRam);
+}
+
+/*******************************************************************************
+  Function:
+    void WF_PmkStoreSet(const t_pmkStore *p_store)
+
+  Summary:
+    Sets the persistent store used to cache passphrase to key conversions
+
+  Description:
+    WF_WpaConvPassphraseToKey() always remembers its last result in RAM.  If a
+    store is set, results are also looked up in and written to it, so the
+    PBKDF2 is only run the first time a passphrase is used with an SSID, even
+    across resets.  The store holds the binary key, so it should be kept as
+    private as the passphrase itself.
+
+  Parameters:
+    p_store -- load/save callbacks and number of slots; NULL for RAM only.
+               Must point to global memory.
+
+  Returns:
+    None
+  *****************************************************************************/
+void WF_PmkStoreSet(const t_pmkStore *p_store)
+{
+    g_p_pmkStore = p_store;
+}
+
 void WF_WpaConvPassphraseToKey(t_wpaKeyInfo *p_keyInfo)
 {
     uint8_t binaryKey[WF_WPA_KEY_LENGTH];
+    uint8_t passHash[20];
 #if defined(WF_ERROR_CHECKING)
     uint32_t errorCode = UdConvWpaPassphrase(p_keyInfo);
     if (errorCode != UD_SUCCESS)
@@ -502,13 +640,25 @@ void WF_WpaConvPassphraseToKey(t_wpaKeyInfo *p_keyInfo)
 #endif
     p_keyInfo->key[p_keyInfo->keyLength] = '\0';   // make sure passphrase is terminated
 
-    // generate the binary key
-    pbkdf2_sha1((const char *)p_keyInfo->key,
-                (const char *)p_keyInfo->ssid,
-                p_keyInfo->ssidLen,
-                4096,
-                binaryKey, // binary key will be written to this field
-                32);
+    // the PBKDF2 takes seconds, so reuse an earlier result if there is one
+    PmkPassHash(p_keyInfo, passHash);
+    if (!PmkCacheLookup(p_keyInfo, passHash, binaryKey))
+    {
+        // generate the binary key
+        pbkdf2_sha1((const char *)p_keyInfo->key,
+                    (const char *)p_keyInfo->ssid,
+                    p_keyInfo->ssidLen,
+                    4096,
+                    binaryKey, // binary key will be written to this field
+                    32);
+
+        g_pmkCacheRam.sig     = WF_PMK_CACHE_SIG;
+        g_pmkCacheRam.ssidLen = p_keyInfo->ssidLen;
+        memcpy(g_pmkCacheRam.ssid, p_keyInfo->ssid, p_keyInfo->ssidLen);
+        memcpy(g_pmkCacheRam.passHash, passHash, sizeof(passHash));
+        memcpy(g_pmkCacheRam.pmk, binaryKey, WF_WPA_KEY_LENGTH);
+        PmkCacheSave();
+    }
 
     // overwrite the passphrase with binary key
     memcpy(p_keyInfo->key, binaryKey, WF_WPA_KEY_LENGTH);
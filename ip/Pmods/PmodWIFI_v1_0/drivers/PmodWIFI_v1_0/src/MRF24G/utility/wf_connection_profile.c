@@ -445,10 +445,9 @@ void WF_BssidSet(uint8_t *p_bssid)
     }
 
 #endif
-    LowLevel_CPGetElement(WF_CP_ELEMENT_BSSID,   // Element ID
+    LowLevel_CPSetElement(WF_CP_ELEMENT_BSSID,   // Element ID
                           p_bssid,               // pointer to element data
-                          WF_BSSID_LENGTH,       // number of element data bytes
-                          true);                 // read data, free buffer after read
+                          WF_BSSID_LENGTH);      // number of element data bytes
 }
 
 
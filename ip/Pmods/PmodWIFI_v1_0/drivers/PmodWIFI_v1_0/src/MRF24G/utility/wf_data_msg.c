@@ -117,6 +117,24 @@ bool WF_TxPacketAllocate(uint16_t packetSize)
     return result;
 }
 
+// Same as WF_TxPacketAllocate() but a single attempt; returns false at once if
+// the MRF24WG data tx pool is still holding earlier frames.  For callers that
+// keep several frames in flight and retry later rather than spin.
+bool WF_TxPacketTryAllocate(uint16_t packetSize)
+{
+    EnsureWFisAwake();
+
+    // allocate an extra 4 bytes for WiFi message preamble
+    if (AllocateDataTxBuffer(packetSize + WF_TX_PREAMBLE_SIZE))
+    {
+        // Ethernet packet data starts at index 4
+        RawSetIndex(RAW_DATA_TX_ID, 4);
+        return true;
+    }
+
+    return false;
+}
+
 void WF_TxPacketCopy(uint8_t *p_buf, uint16_t length)
 {
    RawSetByte(RAW_DATA_TX_ID, p_buf, length);
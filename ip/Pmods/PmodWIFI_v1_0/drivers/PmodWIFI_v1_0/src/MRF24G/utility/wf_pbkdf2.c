@@ -36,6 +36,8 @@
 #define LITTLEENDIAN 1
 
 void sha1_vector(size_t num_elem, const uint8_t *addr[], const size_t *len, uint8_t *mac);
+static void SHA1Transform(uint32_t state[5], const unsigned char buffer[64]);
+static void SHA1TransformWords(uint32_t state[5], uint32_t block[16]);
 
 /**
  * hmac_sha1_vector - HMAC-SHA1 over data vector (RFC 2104)
@@ -229,11 +231,99 @@ void sha1_t_prf(const uint8_t *key, size_t key_len, const char *label,
 	}
 }
 
+/* SHA1 initial state, FIPS 180-1 */
+static const uint32_t sha1_init_state[5] = {
+	0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+/**
+ * hmac_sha1_precompute - SHA1 states after the HMAC key blocks
+ * @key: Key for HMAC operations
+ * @key_len: Length of the key in bytes
+ * @istate: SHA1 state after hashing (K XOR ipad)
+ * @ostate: SHA1 state after hashing (K XOR opad)
+ *
+ * The key blocks are the same for every HMAC in PBKDF2, so hash them
+ * once and start each iteration from these states.
+ */
+static void hmac_sha1_precompute(const uint8_t *key, size_t key_len,
+				 uint32_t istate[5], uint32_t ostate[5])
+{
+	unsigned char k_pad[64];
+	unsigned char tk[SHA1_MAC_LEN];
+	unsigned int i;
+
+	if (key_len > 64) {
+		sha1_vector(1, &key, &key_len, tk);
+		key = tk;
+		key_len = SHA1_MAC_LEN;
+	}
+
+	memset(k_pad, 0, sizeof(k_pad));
+	memcpy(k_pad, key, key_len);
+	for (i = 0; i < 64; i++)
+		k_pad[i] ^= 0x36;
+	memcpy(istate, sha1_init_state, sizeof(sha1_init_state));
+	SHA1Transform(istate, k_pad);
+
+	for (i = 0; i < 64; i++)
+		k_pad[i] ^= 0x36 ^ 0x5c;
+	memcpy(ostate, sha1_init_state, sizeof(sha1_init_state));
+	SHA1Transform(ostate, k_pad);
+
+	memset(k_pad, 0, sizeof(k_pad));
+	memset(tk, 0, sizeof(tk));
+}
+
+/**
+ * hmac_sha1_words - HMAC-SHA1 of a 20 byte message from precomputed states
+ * @istate: Inner state from hmac_sha1_precompute
+ * @ostate: Outer state from hmac_sha1_precompute
+ * @in: Message as 5 big endian words in host order
+ * @out: HMAC as 5 big endian words in host order, may be the same as in
+ *
+ * Both the inner and outer hash are over a 64 byte key block and then
+ * 20 bytes, so each is exactly one more block with fixed padding; no
+ * byte buffering, no padding loop and no endian conversion.
+ */
+static void hmac_sha1_words(const uint32_t istate[5], const uint32_t ostate[5],
+			    const uint32_t in[5], uint32_t out[5])
+{
+	uint32_t state[5];
+	uint32_t block[16];
+
+	/* inner */
+	memcpy(state, istate, sizeof(state));
+	block[0] = in[0];
+	block[1] = in[1];
+	block[2] = in[2];
+	block[3] = in[3];
+	block[4] = in[4];
+	block[5] = 0x80000000;
+	memset(&block[6], 0, 9 * sizeof(uint32_t));
+	block[15] = (64 + SHA1_MAC_LEN) * 8;
+	SHA1TransformWords(state, block);
+
+	/* outer */
+	block[0] = state[0];
+	block[1] = state[1];
+	block[2] = state[2];
+	block[3] = state[3];
+	block[4] = state[4];
+	block[5] = 0x80000000;
+	memset(&block[6], 0, 9 * sizeof(uint32_t));
+	block[15] = (64 + SHA1_MAC_LEN) * 8;
+	memcpy(out, ostate, 5 * sizeof(uint32_t));
+	SHA1TransformWords(out, block);
+}
+
 static void pbkdf2_sha1_f(const char *passphrase, const char *ssid,
 			  size_t ssid_len, int iterations, int count,
 			  uint8_t *digest)
 {
-	unsigned char tmp[SHA1_MAC_LEN], tmp2[SHA1_MAC_LEN];
+	unsigned char tmp[SHA1_MAC_LEN];
+	uint32_t istate[5], ostate[5];
+	uint32_t u[5], f[5];
 	int i, j;
 	unsigned char count_buf[4];
 	const uint8_t *addr[2];
@@ -256,21 +346,34 @@ static void pbkdf2_sha1_f(const char *passphrase, const char *ssid,
 	count_buf[2] = (count >> 8) & 0xff;
 	count_buf[3] = count & 0xff;
 	hmac_sha1_vector((uint8_t *) passphrase, passphrase_len, 2, addr, len, tmp);
-	memcpy(digest, tmp, SHA1_MAC_LEN);
 
-	for (i = 1; i < iterations; i++) {
-		uint8_t* pTemp;
+	/* U1 to words, the rest of the iterations stay in words */
+	for (j = 0; j < 5; j++) {
+		u[j] = ((uint32_t) tmp[4 * j] << 24) | ((uint32_t) tmp[4 * j + 1] << 16) |
+		       ((uint32_t) tmp[4 * j + 2] << 8) | (uint32_t) tmp[4 * j + 3];
+		f[j] = u[j];
+	}
 
-		
-		hmac_sha1((uint8_t *) passphrase, passphrase_len, ((i&0x01)? tmp:tmp2), SHA1_MAC_LEN,
-			  ((i&0x01)? tmp2:tmp));
-		//memcpy(tmp, tmp2, SHA1_MAC_LEN);
-		 
-		pTemp = (i&0x01)? tmp2 : tmp;
+	hmac_sha1_precompute((uint8_t *) passphrase, passphrase_len, istate, ostate);
 
-		for (j = 0; j < SHA1_MAC_LEN; j++)
-			digest[j] ^= pTemp[j];
+	for (i = 1; i < iterations; i++) {
+		hmac_sha1_words(istate, ostate, u, u);
+		f[0] ^= u[0];
+		f[1] ^= u[1];
+		f[2] ^= u[2];
+		f[3] ^= u[3];
+		f[4] ^= u[4];
+	}
+
+	for (j = 0; j < 5; j++) {
+		digest[4 * j]     = (uint8_t) (f[j] >> 24);
+		digest[4 * j + 1] = (uint8_t) (f[j] >> 16);
+		digest[4 * j + 2] = (uint8_t) (f[j] >> 8);
+		digest[4 * j + 3] = (uint8_t) f[j];
 	}
+
+	memset(istate, 0, sizeof(istate));
+	memset(ostate, 0, sizeof(ostate));
 }
 
 
@@ -316,7 +419,6 @@ typedef struct {
 static void SHA1Init(SHA1_CTX *context);
 static void SHA1Update(SHA1_CTX *context, const void *data, uint32_t len);
 static void SHA1Final(unsigned char digest[20], SHA1_CTX* context);
-static void SHA1Transform(uint32_t state[5], const unsigned char buffer[64]);
 
 /**
  * sha1_vector - SHA-1 hash for data vector
@@ -531,6 +633,54 @@ static void SHA1Transform(uint32_t state[5], const unsigned char buffer[64])
 	memset((uint8_t*)block, 0, 64);
 }
 
+/* Hash a single 512-bit block already in host order 32 bit words.
+ * Same as SHA1Transform without the copy and byte swap; block is used
+ * as the workspace and is overwritten. */
+#define R0W(v,w,x,y,z,i) \
+	z += ((w & (x ^ y)) ^ y) + block->l[i] + 0x5A827999 + rol(v, 5); \
+	w = rol(w, 30);
+
+static void SHA1TransformWords(uint32_t state[5], uint32_t words[16])
+{
+	uint32_t a, b, c, d, e;
+	typedef struct {
+		uint32_t l[16];
+	} LONG16;
+	LONG16* block = (LONG16 *) words;
+
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+	/* 4 rounds of 20 operations each. Loop unrolled. */
+	R0W(a,b,c,d,e, 0); R0W(e,a,b,c,d, 1); R0W(d,e,a,b,c, 2); R0W(c,d,e,a,b, 3);
+	R0W(b,c,d,e,a, 4); R0W(a,b,c,d,e, 5); R0W(e,a,b,c,d, 6); R0W(d,e,a,b,c, 7);
+	R0W(c,d,e,a,b, 8); R0W(b,c,d,e,a, 9); R0W(a,b,c,d,e,10); R0W(e,a,b,c,d,11);
+	R0W(d,e,a,b,c,12); R0W(c,d,e,a,b,13); R0W(b,c,d,e,a,14); R0W(a,b,c,d,e,15);
+	R1(e,a,b,c,d,16); R1(d,e,a,b,c,17); R1(c,d,e,a,b,18); R1(b,c,d,e,a,19);
+	R2(a,b,c,d,e,20); R2(e,a,b,c,d,21); R2(d,e,a,b,c,22); R2(c,d,e,a,b,23);
+	R2(b,c,d,e,a,24); R2(a,b,c,d,e,25); R2(e,a,b,c,d,26); R2(d,e,a,b,c,27);
+	R2(c,d,e,a,b,28); R2(b,c,d,e,a,29); R2(a,b,c,d,e,30); R2(e,a,b,c,d,31);
+	R2(d,e,a,b,c,32); R2(c,d,e,a,b,33); R2(b,c,d,e,a,34); R2(a,b,c,d,e,35);
+	R2(e,a,b,c,d,36); R2(d,e,a,b,c,37); R2(c,d,e,a,b,38); R2(b,c,d,e,a,39);
+	R3(a,b,c,d,e,40); R3(e,a,b,c,d,41); R3(d,e,a,b,c,42); R3(c,d,e,a,b,43);
+	R3(b,c,d,e,a,44); R3(a,b,c,d,e,45); R3(e,a,b,c,d,46); R3(d,e,a,b,c,47);
+	R3(c,d,e,a,b,48); R3(b,c,d,e,a,49); R3(a,b,c,d,e,50); R3(e,a,b,c,d,51);
+	R3(d,e,a,b,c,52); R3(c,d,e,a,b,53); R3(b,c,d,e,a,54); R3(a,b,c,d,e,55);
+	R3(e,a,b,c,d,56); R3(d,e,a,b,c,57); R3(c,d,e,a,b,58); R3(b,c,d,e,a,59);
+	R4(a,b,c,d,e,60); R4(e,a,b,c,d,61); R4(d,e,a,b,c,62); R4(c,d,e,a,b,63);
+	R4(b,c,d,e,a,64); R4(a,b,c,d,e,65); R4(e,a,b,c,d,66); R4(d,e,a,b,c,67);
+	R4(c,d,e,a,b,68); R4(b,c,d,e,a,69); R4(a,b,c,d,e,70); R4(e,a,b,c,d,71);
+	R4(d,e,a,b,c,72); R4(c,d,e,a,b,73); R4(b,c,d,e,a,74); R4(a,b,c,d,e,75);
+	R4(e,a,b,c,d,76); R4(d,e,a,b,c,77); R4(c,d,e,a,b,78); R4(b,c,d,e,a,79);
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
 /* SHA1Init - Initialize new context */
 static void SHA1Init(SHA1_CTX* context)
 {
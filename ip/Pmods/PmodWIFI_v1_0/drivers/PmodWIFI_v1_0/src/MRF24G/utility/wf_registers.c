@@ -170,21 +170,14 @@ uint16_t Read16BitWFRegister(uint8_t regId)
  *****************************************************************************/
 void WriteWFArray(uint8_t regId, const uint8_t *p_Buf, uint16_t length)
 {
-    g_txBuf[0] = regId;
-
     WF_SpiEnableChipSelect();
 
-    /* output cmd byte */
-    WF_SpiTxRx(g_txBuf,
-               1,
-               g_rxBuf,
-               1);
-
-    /* output data array bytes */
-    WF_SpiTxRx(p_Buf,
-               length,
-               0,
-               1);
+    /* output cmd byte and data array bytes in one burst */
+    WF_SpiCmdTxRx(regId,
+                  p_Buf,
+                  length,
+                  NULL,
+                  0);
 
     WF_SpiDisableChipSelect();
 }
@@ -205,18 +198,12 @@ void ReadWFArray(uint8_t  regId, uint8_t *p_Buf, uint16_t length)
 {
     WF_SpiEnableChipSelect();
 
-    /* output command byte */
-    g_txBuf[0] = regId | WF_READ_REGISTER_MASK;
-    WF_SpiTxRx(g_txBuf,
-               1,
-               g_rxBuf,
-               1);
-
-    /* read data array */
-    WF_SpiTxRx(g_txBuf,
-               1,   /* garbage tx byte */
-               p_Buf,
-               length);
+    /* output command byte and read data array in one burst */
+    WF_SpiCmdTxRx(regId | WF_READ_REGISTER_MASK,
+                  NULL,
+                  0,     /* garbage tx bytes */
+                  p_Buf,
+                  length);
 
     WF_SpiDisableChipSelect();
 }